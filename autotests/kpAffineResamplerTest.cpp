@@ -0,0 +1,263 @@
+/*
+   Copyright (c) 2026 The KolourPaint Authors
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+   OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+   IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+   INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+   NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+   THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include "imagelib/transforms/kpAffineResampler.h"
+
+#include <cmath>
+#include <random>
+
+#include <QDebug>
+#include <QImage>
+#include <QPainter>
+#include <QTest>
+#include <QTransform>
+#include <QtMath>
+
+#include "imagelib/kpColor.h"
+
+
+//
+// Checks kpAffineResampler against QPainter::drawImage() with a world
+// transform, which TransformPixmap() used before (and still falls back to).
+//
+// Both take the source pixel under the centre of each destination pixel, but
+// in different fixed point precisions (and QPainter decides which pixels are
+// covered by rasterizing the outline of the source), so they can only
+// disagree about sample points that are practically on the boundary between
+// 2 source pixels or on the edge of the source.
+//
+
+// How close to a boundary between source pixels, or to the edge of the
+// source, a sample point must be for a difference to be forgiven.
+static const double PixelBoundaryEpsilon = 1.0 / 128;
+static const double EdgeEpsilon = 1.0 / 16;
+
+
+// Returns a <width> x <height> image of random (valid premultiplied) pixels.
+static QImage RandomImage (int width, int height, std::mt19937 *random)
+{
+    QImage image (width, height, QImage::Format_ARGB32_Premultiplied);
+    for (int y = 0; y < height; y++)
+    {
+        auto *row = reinterpret_cast <QRgb *> (image.scanLine (y));
+        for (int x = 0; x < width; x++) {
+            row [x] = qPremultiply (static_cast <QRgb> ((*random) ()));
+        }
+    }
+
+    return image;
+}
+
+// The matrix that TransformPixmap() gives kpAffineResampler, for <matrix>
+// (without the tiny rounding fixes of TrueMatrix()).
+static QTransform TrueMatrix (const QTransform &matrix, const QImage &image)
+{
+    return QImage::trueMatrix (matrix, image.width (), image.height ());
+}
+
+// The QPainter path of TransformPixmap().
+static QImage PainterTransform (const QImage &image, const QTransform &matrix,
+                                int width, int height,
+                                const kpColor &backgroundColor)
+{
+    QImage newQImage (width, height, QImage::Format_ARGB32_Premultiplied);
+    newQImage.fill (backgroundColor.isValid () ?
+        qPremultiply (backgroundColor.toQRgb ()) :
+        0);
+
+    QPainter p (&newQImage);
+    {
+        p.setCompositionMode (QPainter::CompositionMode_Source);
+
+        p.setWorldTransform (matrix);
+        p.drawImage (QPoint (0, 0), image);
+    }
+    p.end ();
+
+    return newQImage;
+}
+
+static double DistanceToInteger (double x)
+{
+    return std::fabs (x - std::floor (x + 0.5));
+}
+
+// Returns whether destination pixel (<x>, <y>) is allowed to differ.
+static bool IsAmbiguous (const QImage &image, const QTransform &inverse,
+                         int x, int y)
+{
+    const QPointF p = inverse.map (QPointF (x + 0.5, y + 0.5));
+
+    if (std::fabs (p.x ()) < EdgeEpsilon ||
+        std::fabs (p.x () - image.width ()) < EdgeEpsilon ||
+        std::fabs (p.y ()) < EdgeEpsilon ||
+        std::fabs (p.y () - image.height ()) < EdgeEpsilon)
+    {
+        return true;
+    }
+
+    return (::DistanceToInteger (p.x ()) < PixelBoundaryEpsilon ||
+            ::DistanceToInteger (p.y ()) < PixelBoundaryEpsilon);
+}
+
+// Compares kpAffineResampler with QPainter for <matrix>.
+static void Compare (const QImage &image, const QTransform &matrix_,
+                     const kpColor &backgroundColor)
+{
+    const QTransform matrix = ::TrueMatrix (matrix_, image);
+    const QRect newRect = matrix_.mapRect (image.rect ());
+
+    const QImage actual = kpAffineResampler::transform (image, matrix,
+        newRect.width (), newRect.height (), backgroundColor);
+    QVERIFY (!actual.isNull ());
+
+    const QImage expected = ::PainterTransform (image, matrix,
+        newRect.width (), newRect.height (), backgroundColor);
+    QCOMPARE (actual.size (), expected.size ());
+
+    const QTransform inverse = matrix.inverted ();
+    int numAmbiguous = 0;
+    for (int y = 0; y < actual.height (); y++)
+    {
+        const auto *actualRow = reinterpret_cast <const QRgb *> (actual.constScanLine (y));
+        const auto *expectedRow = reinterpret_cast <const QRgb *> (expected.constScanLine (y));
+        for (int x = 0; x < actual.width (); x++)
+        {
+            if (actualRow [x] == expectedRow [x]) {
+                continue;
+            }
+
+            if (!::IsAmbiguous (image, inverse, x, y))
+            {
+                qWarning () << "matrix=" << matrix << "pixel=" << QPoint (x, y)
+                            << "sample=" << inverse.map (QPointF (x + 0.5, y + 0.5));
+                QFAIL ("Differs from QPainter away from any pixel boundary");
+            }
+
+            numAmbiguous++;
+        }
+    }
+
+    // Not a requirement, just to show how often it happens.
+    if (numAmbiguous > 0) {
+        qDebug () << "matrix=" << matrix << "ambiguous differences=" << numAmbiguous;
+    }
+}
+
+
+class kpAffineResamplerTest : public QObject
+{
+Q_OBJECT
+
+private slots:
+    void testRotate_data ();
+    void testRotate ();
+
+    void testSkew_data ();
+    void testSkew ();
+
+    void testInvalidMatrix ();
+};
+
+
+void kpAffineResamplerTest::testRotate_data ()
+{
+    QTest::addColumn <double> ("angle");
+
+    for (double angle : {1.0, 7.5, 30.0, 45.0, 60.0, 89.0, 90.0, 135.0,
+                         180.0, 200.0, 270.0, 315.0, -20.0, -90.0})
+    {
+        QTest::newRow (QByteArray::number (angle).constData ()) << angle;
+    }
+}
+
+void kpAffineResamplerTest::testRotate ()
+{
+    QFETCH (double, angle);
+
+    std::mt19937 random (1);
+    const QImage image = ::RandomImage (61, 47, &random);
+
+    QTransform matrix;
+    matrix.rotate (angle);
+
+    ::Compare (image, matrix, kpColor (255, 0, 255));
+    ::Compare (image, matrix, kpColor::Invalid);
+}
+
+
+void kpAffineResamplerTest::testSkew_data ()
+{
+    QTest::addColumn <double> ("hangle");
+    QTest::addColumn <double> ("vangle");
+
+    QTest::newRow ("h10") << 10.0 << 0.0;
+    QTest::newRow ("h45") << 45.0 << 0.0;
+    QTest::newRow ("h-60") << -60.0 << 0.0;
+    QTest::newRow ("v30") << 0.0 << 30.0;
+    QTest::newRow ("v-45") << 0.0 << -45.0;
+    QTest::newRow ("h20v15") << 20.0 << 15.0;
+    QTest::newRow ("h-35v40") << -35.0 << 40.0;
+}
+
+void kpAffineResamplerTest::testSkew ()
+{
+    QFETCH (double, hangle);
+    QFETCH (double, vangle);
+
+    std::mt19937 random (2);
+    const QImage image = ::RandomImage (53, 38, &random);
+
+    // Like kpPixmapFX::skewMatrix().
+    QTransform matrix;
+    matrix.shear (std::tan (qDegreesToRadians (hangle)),
+                  std::tan (qDegreesToRadians (vangle)));
+
+    ::Compare (image, matrix, kpColor (0, 128, 0));
+    ::Compare (image, matrix, kpColor::Invalid);
+}
+
+
+// The callers fall back to QPainter for these.
+void kpAffineResamplerTest::testInvalidMatrix ()
+{
+    const QImage image (10, 10, QImage::Format_ARGB32_Premultiplied);
+
+    QVERIFY (kpAffineResampler::transform (image, QTransform (1, 2, 2, 4, 0, 0),
+        10, 10, kpColor::Invalid).isNull ());
+
+    QVERIFY (kpAffineResampler::transform (image, QTransform (1, 0, 0.001, 0, 1, 0, 0, 0, 1),
+        10, 10, kpColor::Invalid).isNull ());
+
+    QVERIFY (kpAffineResampler::transform (image, QTransform::fromTranslate (1e10, 0),
+        10, 10, kpColor::Invalid).isNull ());
+}
+
+
+QTEST_GUILESS_MAIN (kpAffineResamplerTest)
+
+#include "kpAffineResamplerTest.moc"
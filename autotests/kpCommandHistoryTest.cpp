@@ -0,0 +1,440 @@
+/*
+   Copyright (c) 2026 The KolourPaint Authors
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+   OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+   IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+   INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+   NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+   THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include "commands/kpCommandHistoryBase.h"
+
+#include <random>
+#include <vector>
+
+#include <QStandardPaths>
+#include <QTest>
+
+#include <kactioncollection.h>
+
+#include "commands/kpCommand.h"
+#include "commands/kpCommandSize.h"
+#include "document/kpDocument.h"
+#include "imagelib/kpCompressedImage.h"
+#include "mainWindow/kpMainWindow.h"
+
+
+//
+// Checks the bookkeeping of undo by replay (see
+// kpCommandHistoryBase::setUndoByReplay()): that every command left in the
+// undo list can still be undone, from a keyframe that was kept for it, as
+// the lists are trimmed.
+//
+
+static const int DocumentSize = 64;
+
+// The document holds a value, in the top-left pixel, that the commands
+// below change.  The rest of the image is a noisy function of it, so that
+// the keyframes don't compress to nothing.
+static kpImage ValueImage (quint32 value)
+{
+    kpImage image (DocumentSize, DocumentSize, QImage::Format_ARGB32_Premultiplied);
+    for (int y = 0; y < image.height (); y++)
+    {
+        auto *line = reinterpret_cast <quint32 *> (image.scanLine (y));
+        for (int x = 0; x < image.width (); x++) {
+            line [x] = (value * 2654435761u) ^ (quint32 (x) * 40503u + quint32 (y) * 977u);
+        }
+    }
+
+    reinterpret_cast <quint32 *> (image.scanLine (0)) [0] = value;
+    return image;
+}
+
+static quint32 Value (const kpImage &image)
+{
+    return reinterpret_cast <const quint32 *> (image.constScanLine (0)) [0];
+}
+
+//---------------------------------------------------------------------
+
+class kpTestCommand : public kpCommand
+{
+public:
+    enum Kind
+    {
+        // Keeps the old image.
+        NotReplayable,
+        // Keeps the old image, unless undone by replay.
+        Replayable,
+        // Replayable but inverts itself, so never undone by replay.
+        Invertible
+    };
+
+    kpTestCommand (Kind kind, quint32 parameter,
+                   kpDocument *document, kpCommandEnvironment *environ)
+        : kpCommand (environ),
+          m_kind (kind),
+          m_parameter (parameter),
+          m_document (document),
+          m_undoByReplay (false)
+    {
+        NumLive++;
+    }
+
+    ~kpTestCommand () override
+    {
+        NumLive--;
+    }
+
+    QString name () const override
+    {
+        return QString ();
+    }
+
+    SizeType size () const override
+    {
+        return ImageSize (m_oldImage);
+    }
+
+    bool isReplayable () const override
+    {
+        return (m_kind != NotReplayable);
+    }
+
+    bool setUndoByReplay () override
+    {
+        if (m_kind != Replayable) {
+            return false;
+        }
+
+        m_undoByReplay = true;
+        return true;
+    }
+
+    void execute () override
+    {
+        const kpImage image = m_document->image ();
+        if (m_kind != Invertible && !m_undoByReplay) {
+            m_oldImage = image;
+        }
+
+        const quint32 value = Value (image);
+        m_document->setImage (::ValueImage (m_kind == Invertible ?
+            value ^ m_parameter :
+            value * 31 + m_parameter));
+    }
+
+    void unexecute () override
+    {
+        if (m_undoByReplay)
+        {
+            NumBadUnexecutes++;
+            return;
+        }
+
+        if (m_kind == Invertible) {
+            m_document->setImage (::ValueImage (Value (m_document->image ()) ^ m_parameter));
+        }
+        else
+        {
+            m_document->setImage (m_oldImage);
+            m_oldImage = kpImage ();
+        }
+    }
+
+    // The number of commands not deleted yet.
+    static int NumLive;
+    // The number of times unexecute() was called on a command that should
+    // have been undone by replay.
+    static int NumBadUnexecutes;
+
+private:
+    Kind m_kind;
+    quint32 m_parameter;
+    kpDocument *m_document;
+    bool m_undoByReplay;
+    kpImage m_oldImage;
+};
+
+int kpTestCommand::NumLive = 0;
+int kpTestCommand::NumBadUnexecutes = 0;
+
+//---------------------------------------------------------------------
+
+class kpTestCommandHistory : public kpCommandHistoryBase
+{
+public:
+    kpTestCommandHistory (kpDocument *document, KActionCollection *ac)
+        : kpCommandHistoryBase (false/*don't read config*/, ac),
+          m_document (document)
+    {
+        setUndoByReplay (true);
+    }
+
+    int undoListSize () const
+    {
+        return static_cast <int> (m_undoCommandList.size ());
+    }
+
+protected:
+    kpDocument *document () const override
+    {
+        return m_document;
+    }
+
+private:
+    kpDocument *m_document;
+};
+
+//---------------------------------------------------------------------
+
+class kpCommandHistoryTest : public QObject
+{
+Q_OBJECT
+
+private slots:
+    void initTestCase ();
+    void cleanupTestCase ();
+    void init ();
+    void cleanup ();
+
+    void testUndoRedo ();
+    void testKeepsKeyframe ();
+    void testDeletesOrphans ();
+    void testRandom ();
+
+private:
+    // Adds a command and records the document value after it.
+    void addCommand (kpTestCommandHistory *history,
+                     kpTestCommand::Kind kind, quint32 parameter);
+    // Undoes every command left, checking the document value after each.
+    void undoAll (kpTestCommandHistory *history);
+
+    kpMainWindow *m_mainWindow;
+    kpDocument *m_document;
+    KActionCollection *m_actionCollection;
+
+    // The document value after each command, and where we are in that.
+    std::vector <quint32> m_values;
+    int m_position;
+};
+
+
+void kpCommandHistoryTest::initTestCase ()
+{
+    QStandardPaths::setTestModeEnabled (true);
+
+    m_mainWindow = new kpMainWindow ();
+}
+
+void kpCommandHistoryTest::cleanupTestCase ()
+{
+    delete m_mainWindow;
+}
+
+void kpCommandHistoryTest::init ()
+{
+    m_document = new kpDocument (DocumentSize, DocumentSize,
+                                 m_mainWindow->documentEnvironment ());
+    m_document->setImage (::ValueImage (1));
+
+    m_actionCollection = new KActionCollection (static_cast <QObject *> (nullptr));
+
+    m_values.assign (1, Value (m_document->image ()));
+    m_position = 0;
+
+    kpTestCommand::NumBadUnexecutes = 0;
+}
+
+void kpCommandHistoryTest::cleanup ()
+{
+    QCOMPARE (kpTestCommand::NumLive, 0);
+    QCOMPARE (kpTestCommand::NumBadUnexecutes, 0);
+
+    delete m_actionCollection;
+    delete m_document;
+}
+
+//---------------------------------------------------------------------
+
+void kpCommandHistoryTest::addCommand (kpTestCommandHistory *history,
+                                       kpTestCommand::Kind kind, quint32 parameter)
+{
+    history->addCommand (new kpTestCommand (kind, parameter,
+        m_document, m_mainWindow->commandEnvironment ()));
+
+    m_values.resize (m_position + 1);
+    m_values.push_back (Value (m_document->image ()));
+    m_position++;
+}
+
+void kpCommandHistoryTest::undoAll (kpTestCommandHistory *history)
+{
+    while (history->nextUndoCommand ())
+    {
+        history->undo ();
+        m_position--;
+
+        QVERIFY (m_position >= 0);
+        QCOMPARE (Value (m_document->image ()), m_values [m_position]);
+        QCOMPARE (m_document->image (), ::ValueImage (m_values [m_position]));
+    }
+}
+
+//---------------------------------------------------------------------
+
+void kpCommandHistoryTest::testUndoRedo ()
+{
+    {
+        kpTestCommandHistory history (m_document, m_actionCollection);
+
+        for (int i = 0; i < 20; i++) {
+            addCommand (&history, kpTestCommand::Replayable, i);
+        }
+        QVERIFY (history.undoByReplaySavedSize () > 0);
+
+        undoAll (&history);
+        QCOMPARE (m_position, 0);
+
+        while (history.nextRedoCommand ())
+        {
+            history.redo ();
+            m_position++;
+            QCOMPARE (Value (m_document->image ()), m_values [m_position]);
+        }
+
+        undoAll (&history);
+        QCOMPARE (m_position, 0);
+    }
+}
+
+// Commands that are undone by replay keep the commands back to their
+// keyframe, even past undoMaxLimit().
+void kpCommandHistoryTest::testKeepsKeyframe ()
+{
+    {
+        kpTestCommandHistory history (m_document, m_actionCollection);
+        history.setUndoMinLimit (1);
+        history.setUndoMaxLimit (2);
+
+        // Keyframes are kept before commands 0 and 8.
+        for (int i = 0; i < 12; i++) {
+            addCommand (&history, kpTestCommand::Replayable, i);
+        }
+
+        // (commands 8 to 11)
+        QCOMPARE (history.undoListSize (), 4);
+
+        undoAll (&history);
+        QCOMPARE (m_position, 12 - 4);
+    }
+}
+
+// Commands whose keyframe was deleted are deleted too.
+void kpCommandHistoryTest::testDeletesOrphans ()
+{
+    {
+        kpTestCommandHistory history (m_document, m_actionCollection);
+        history.setUndoMinLimit (1);
+        history.setUndoMaxLimit (100);
+
+        // Move all keyframes to disk.
+        history.setUndoMaxLimitSizeLimit (1);
+        history.setUndoMaxLimitDiskSizeLimit (1024 * 1048576);
+
+        // Keyframes are kept before commands 0 and 8.
+        for (int i = 0; i < 12; i++) {
+            addCommand (&history, kpTestCommand::Replayable, i);
+        }
+        QCOMPARE (history.undoListSize (), 12);
+
+        // Only leave room for one keyframe.  Deleting command 0 deletes the
+        // keyframe of commands 1 to 7, so they can't be undone any more.
+        const kpCommandSize::SizeType keyframeSize =
+            kpCommandSize::ImageSize (kpCompressedImage (m_document->image ()));
+        history.setUndoMaxLimitDiskSizeLimit (keyframeSize * 3 / 2);
+
+        // (commands 8 to 11)
+        QCOMPARE (history.undoListSize (), 4);
+
+        undoAll (&history);
+        QCOMPARE (m_position, 12 - 4);
+    }
+}
+
+// Random commands, undos and redos, under random limits.
+void kpCommandHistoryTest::testRandom ()
+{
+    std::mt19937 random (5);
+
+    for (int round = 0; round < 100; round++)
+    {
+        m_document->setImage (::ValueImage (1));
+        m_values.assign (1, Value (m_document->image ()));
+        m_position = 0;
+
+        kpTestCommandHistory history (m_document, m_actionCollection);
+        history.setUndoMinLimit (1 + static_cast <int> (random () % 10));
+        history.setUndoMaxLimit (5 + static_cast <int> (random () % 40));
+        history.setUndoMaxLimitSizeLimit (
+            kpCommandSize::SizeType (random () % 20) * DocumentSize * DocumentSize * 4);
+        history.setUndoMaxLimitDiskSizeLimit (
+            kpCommandSize::SizeType (random () % 4) * DocumentSize * DocumentSize * 10);
+
+        for (int step = 0; step < 200; step++)
+        {
+            const int action = static_cast <int> (random () % 10);
+            if (action < 5)
+            {
+                addCommand (&history,
+                    static_cast <kpTestCommand::Kind> (random () % 3),
+                    static_cast <quint32> (random ()));
+            }
+            else if (action < 8)
+            {
+                if (history.nextUndoCommand ())
+                {
+                    history.undo ();
+                    m_position--;
+                }
+            }
+            else
+            {
+                if (history.nextRedoCommand ())
+                {
+                    history.redo ();
+                    m_position++;
+                }
+            }
+
+            QCOMPARE (Value (m_document->image ()), m_values [m_position]);
+            QVERIFY (history.undoListSize () <= m_position);
+        }
+
+        undoAll (&history);
+    }
+}
+
+
+QTEST_MAIN (kpCommandHistoryTest)
+
+#include "kpCommandHistoryTest.moc"
@@ -0,0 +1,381 @@
+/*
+   Copyright (c) 2026 The KolourPaint Authors
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+   OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+   IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+   INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+   NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+   THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include "imagelib/effects/kpEffectHSV.h"
+
+#include <cmath>
+#include <random>
+
+#include <QDebug>
+#include <QImage>
+#include <QTest>
+
+
+//
+// Checks kpEffectHSV against the per-pixel QImage::pixel()/setPixel() code
+// that it replaced, which is copied below.  The results must be identical,
+// pixel for pixel.
+//
+
+namespace Reference
+{
+
+static void ColorToHSV(unsigned int c, float* pHue, float* pSaturation, float* pValue)
+{
+    int r = qRed(c);
+    int g = qGreen(c);
+    int b = qBlue(c);
+    int min{};
+    if(b >= g && b >= r)
+    {
+        // Blue
+        min = qMin(r, g);
+        if(b != min)
+        {
+            *pHue = static_cast<float> (r - g) / ((b - min) * 6) + static_cast<float> (2) / 3;
+            *pSaturation = 1.0f - static_cast<float> (min) / static_cast<float> (b);
+        }
+        else
+        {
+            *pHue = 0;
+            *pSaturation = 0;
+        }
+        *pValue = static_cast<float> (b) / 255;
+    }
+    else if(g >= r)
+    {
+        // Green
+        min = qMin(b, r);
+        if(g != min)
+        {
+            *pHue = static_cast<float> (b - r) / ((g - min) * 6) + static_cast<float> (1) / 3;
+            *pSaturation = 1.0f - static_cast<float> (min) / static_cast<float> (g);
+        }
+        else
+        {
+            *pHue = 0;
+            *pSaturation = 0;
+        }
+        *pValue = static_cast<float> (g) / 255;
+    }
+    else
+    {
+        // Red
+        min = qMin(g, b);
+        if(r != min)
+        {
+            *pHue = static_cast<float> (g - b) / ((r - min) * 6);
+            if(*pHue < 0) {
+                (*pHue) += 1.0f;
+            }
+            *pSaturation = 1.0f - static_cast<float> (min) / static_cast<float> (r);
+        }
+        else
+        {
+            *pHue = 0;
+            *pSaturation = 0;
+        }
+        *pValue = static_cast<float> (r) / 255;
+    }
+}
+
+static unsigned int HSVToColor(int alpha, float hue, float saturation, float value)
+{
+    hue *= 5.999999f;
+    int h = static_cast<int> (hue);
+    float f = hue - h;
+    float p = value * (1.0 - saturation);
+    float q = value * (1.0 - ((h & 1) == 0 ? 1.0 - f : f) * saturation);
+    switch(h)
+    {
+        case 0: return qRgba(static_cast<int> (value * 255.999999),
+                             static_cast<int> (q * 255.999999),
+                             static_cast<int> (p * 255.999999), alpha);
+
+        case 1: return qRgba(static_cast<int> (q * 255.999999),
+                             static_cast<int> (value * 255.999999),
+                             static_cast<int> (p * 255.999999), alpha);
+
+        case 2: return qRgba(static_cast<int> (p * 255.999999),
+                             static_cast<int> (value * 255.999999),
+                             static_cast<int> (q * 255.999999), alpha);
+
+        case 3: return qRgba(static_cast<int> (p * 255.999999),
+                             static_cast<int> (q * 255.999999),
+                             static_cast<int> (value * 255.999999), alpha);
+
+        case 4: return qRgba(static_cast<int> (q * 255.999999),
+                             static_cast<int> (p * 255.999999),
+                             static_cast<int> (value * 255.999999), alpha);
+
+        case 5: return qRgba(static_cast<int> (value * 255.999999),
+                             static_cast<int> (p * 255.999999),
+                             static_cast<int> (q * 255.999999), alpha);
+    }
+    return qRgba(0, 0, 0, alpha);
+}
+
+static QRgb AdjustHSVInternal (QRgb pix, double hueDiv360, double saturation, double value)
+{
+    float h, s, v;
+    ColorToHSV(pix, &h, &s, &v);
+
+    const int alpha = qAlpha(pix);
+
+    h += static_cast<float> (hueDiv360);
+    h -= std::floor(h);
+
+    s = qMax(0.0f, qMin(static_cast<float>(1), s + static_cast<float> (saturation)));
+
+    v = qMax(0.0f, qMin(static_cast<float>(1), v + static_cast<float> (value)));
+
+    return HSVToColor(alpha, h, s, v);
+}
+
+static void AdjustHSV (QImage* pImage, double hue, double saturation, double value)
+{
+    hue /= 360;
+
+    if (pImage->depth () > 8)
+    {
+        for (int y = 0; y < pImage->height (); y++)
+        {
+            for (int x = 0; x < pImage->width (); x++)
+            {
+                QRgb pix = pImage->pixel (x, y);
+                pix = AdjustHSVInternal (pix, hue, saturation, value);
+                pImage->setPixel (x, y, pix);
+            }
+        }
+    }
+    else
+    {
+        for (int i = 0; i < pImage->colorCount (); i++)
+        {
+            QRgb pix = pImage->color (i);
+            pix = AdjustHSVInternal (pix, hue, saturation, value);
+            pImage->setColor (i, pix);
+        }
+    }
+}
+
+}  // namespace Reference
+
+
+struct Setting
+{
+    double hue, saturation, value;
+};
+
+// Includes the extremes of the HSV dialog and the values that hit the
+// special cases of the engine (no change, full desaturation, black, white).
+static const Setting Settings [] =
+{
+    {0, 0, 0},
+    {180, 0, 0},
+    {-180, 0, 0},
+    {359.9, 0, 0},
+    {1, 0.01, -0.01},
+    {37.5, 0.25, 0.1},
+    {-90, -0.5, 0.3},
+    {120, 1, 0},
+    {0, -1, 0},
+    {0, 0, 1},
+    {0, 0, -1},
+    {-240, 0.7, -0.7},
+    {300, -0.05, 0.05}
+};
+
+
+// Returns an image of <format> with every RGB value, in a random order
+// within each row, and (unless <format> has no alpha) random alpha values.
+static QImage AllColorsImage (QImage::Format format, std::mt19937 *random)
+{
+    QImage image (4096, 4096, format);
+    for (int y = 0; y < image.height (); y++)
+    {
+        auto *row = reinterpret_cast <QRgb *> (image.scanLine (y));
+        for (int x = 0; x < image.width (); x++)
+        {
+            const QRgb rgb = static_cast <QRgb> (y * image.width () + x);
+            const int alpha = static_cast <int> ((*random) () & 0xFF);
+
+            if (format == QImage::Format_ARGB32_Premultiplied) {
+                row [x] = qPremultiply (qRgba (qRed (rgb), qGreen (rgb), qBlue (rgb), alpha));
+            }
+            else if (format == QImage::Format_ARGB32) {
+                row [x] = (static_cast <QRgb> (alpha) << 24) | rgb;
+            }
+            else {
+                row [x] = 0xFF000000 | rgb;
+            }
+        }
+
+        // Shuffle so that the colour cache sees realistic misses, not runs.
+        for (int x = image.width () - 1; x > 0; x--) {
+            qSwap (row [x], row [(*random) () % (x + 1)]);
+        }
+    }
+
+    return image;
+}
+
+// Returns an image of a few colours, which the colour cache catches.
+static QImage FewColorsImage (QImage::Format format, std::mt19937 *random)
+{
+    QRgb colors [7];
+    for (auto &color : colors) {
+        color = qPremultiply (static_cast <QRgb> ((*random) ()));
+    }
+
+    QImage image (333, 257, format);
+    for (int y = 0; y < image.height (); y++)
+    {
+        for (int x = 0; x < image.width (); x++) {
+            image.setPixel (x, y, colors [(x / 5 + y / 3) % 7]);
+        }
+    }
+
+    return image;
+}
+
+
+class kpEffectHSVTest : public QObject
+{
+Q_OBJECT
+
+private slots:
+    void testApplyEffect_data ();
+    void testApplyEffect ();
+
+    void testFewColors ();
+
+    void testApplyToPixels ();
+};
+
+
+void kpEffectHSVTest::testApplyEffect_data ()
+{
+    QTest::addColumn <int> ("format");
+
+    QTest::newRow ("ARGB32_Premultiplied") << int (QImage::Format_ARGB32_Premultiplied);
+    QTest::newRow ("ARGB32") << int (QImage::Format_ARGB32);
+    QTest::newRow ("RGB32") << int (QImage::Format_RGB32);
+}
+
+// Every RGB value, under every setting.
+void kpEffectHSVTest::testApplyEffect ()
+{
+    QFETCH (int, format);
+
+    std::mt19937 random (format);
+    const QImage image = ::AllColorsImage (static_cast <QImage::Format> (format), &random);
+
+    for (const auto &setting : Settings)
+    {
+        QImage expected = image;
+        Reference::AdjustHSV (&expected, setting.hue, setting.saturation, setting.value);
+
+        const QImage actual = kpEffectHSV::applyEffect (image,
+            setting.hue, setting.saturation, setting.value);
+
+        QCOMPARE (actual.format (), expected.format ());
+        for (int y = 0; y < image.height (); y++)
+        {
+            const auto *expectedRow = reinterpret_cast <const QRgb *> (expected.constScanLine (y));
+            const auto *actualRow = reinterpret_cast <const QRgb *> (actual.constScanLine (y));
+            for (int x = 0; x < image.width (); x++)
+            {
+                if (actualRow [x] != expectedRow [x])
+                {
+                    qWarning () << "hue=" << setting.hue << "saturation=" << setting.saturation
+                                << "value=" << setting.value
+                                << "pixel=" << QString::number (image.pixel (x, y), 16)
+                                << "expected=" << QString::number (expectedRow [x], 16)
+                                << "actual=" << QString::number (actualRow [x], 16);
+                    QFAIL ("Result differs from the per-pixel code");
+                }
+            }
+        }
+    }
+}
+
+// Mostly hits the colour cache.
+void kpEffectHSVTest::testFewColors ()
+{
+    std::mt19937 random (1);
+
+    for (int i = 0; i < 20; i++)
+    {
+        const QImage image = ::FewColorsImage (QImage::Format_ARGB32_Premultiplied, &random);
+
+        for (const auto &setting : Settings)
+        {
+            QImage expected = image;
+            Reference::AdjustHSV (&expected, setting.hue, setting.saturation, setting.value);
+
+            QCOMPARE (kpEffectHSV::applyEffect (image,
+                          setting.hue, setting.saturation, setting.value),
+                      expected);
+        }
+    }
+}
+
+// Like testApplyEffect(), for the pixel runs of kpEffectPipeline, at every
+// length up to a few vectors so that the leftover pixels are covered.
+void kpEffectHSVTest::testApplyToPixels ()
+{
+    std::mt19937 random (2);
+
+    for (const auto &setting : Settings)
+    {
+        for (int i = 0; i < 20000; i++)
+        {
+            const int count = 1 + static_cast <int> (random () % 12);
+
+            QRgb pixels [12], expected [12];
+            for (int x = 0; x < count; x++)
+            {
+                pixels [x] = static_cast <QRgb> (random ());
+                expected [x] = Reference::AdjustHSVInternal (pixels [x],
+                    setting.hue / 360, setting.saturation, setting.value);
+            }
+
+            kpEffectHSV::applyToPixels (pixels, count,
+                setting.hue, setting.saturation, setting.value);
+
+            for (int x = 0; x < count; x++) {
+                QCOMPARE (pixels [x], expected [x]);
+            }
+        }
+    }
+}
+
+
+QTEST_GUILESS_MAIN (kpEffectHSVTest)
+
+#include "kpEffectHSVTest.moc"
@@ -42,14 +42,11 @@ kpEffectClearCommand::kpEffectClearCommand (bool actOnSelection,
     : kpCommand (environ),
       m_actOnSelection (actOnSelection),
       m_newColor (newColor),
-      m_oldImagePtr (nullptr)
+      m_undoByReplay (false)
 {
 }
 
-kpEffectClearCommand::~kpEffectClearCommand ()
-{
-    delete m_oldImagePtr;
-}
+kpEffectClearCommand::~kpEffectClearCommand () = default;
 
 
 // public virtual [base kpCommand]
@@ -64,7 +61,33 @@ QString kpEffectClearCommand::name () const
 // public virtual [base kpCommand]
 kpCommandSize::SizeType kpEffectClearCommand::size () const
 {
-    return ImageSize (m_oldImagePtr);
+    return ImageSize (m_oldImage);
+}
+
+// public virtual [base kpCommand]
+void kpEffectClearCommand::spill (kpSpillFile *file)
+{
+    m_oldImage.spill (file);
+}
+
+// public virtual [base kpCommand]
+kpCommandSize::SizeType kpEffectClearCommand::spilledSize () const
+{
+    return kpCommandSize::SpilledImageSize (m_oldImage);
+}
+
+
+// public virtual [base kpCommand]
+bool kpEffectClearCommand::isReplayable () const
+{
+    return !m_actOnSelection;
+}
+
+// public virtual [base kpCommand]
+bool kpEffectClearCommand::setUndoByReplay ()
+{
+    m_undoByReplay = true;
+    return true;
 }
 
 
@@ -75,8 +98,9 @@ void kpEffectClearCommand::execute ()
     Q_ASSERT (doc);
 
 
-    m_oldImagePtr = new kpImage ();
-    *m_oldImagePtr = doc->image (m_actOnSelection);
+    if (!m_undoByReplay) {
+        m_oldImage = doc->image (m_actOnSelection);
+    }
 
 
     // REFACTOR: Would like to derive entire class from kpEffectCommandBase but
@@ -101,10 +125,9 @@ void kpEffectClearCommand::unexecute ()
     Q_ASSERT (doc);
 
 
-    doc->setImage (m_actOnSelection, *m_oldImagePtr);
+    doc->setImage (m_actOnSelection, m_oldImage.image ());
 
 
-    delete m_oldImagePtr;
-    m_oldImagePtr = nullptr;
+    m_oldImage = kpCompressedImage ();
 }
 
@@ -33,7 +33,7 @@
 #include "commands/kpCommand.h"
 
 #include "imagelib/kpColor.h"
-#include "imagelib/kpImage.h"
+#include "imagelib/kpCompressedImage.h"
 
 
 class kpEffectClearCommand : public kpCommand
@@ -47,6 +47,11 @@ public:
     QString name () const override;
 
     SizeType size () const override;
+    void spill (kpSpillFile *file) override;
+    SizeType spilledSize () const override;
+
+    bool isReplayable () const override;
+    bool setUndoByReplay () override;
 
     void execute () override;
     void unexecute () override;
@@ -55,7 +60,9 @@ private:
     bool m_actOnSelection;
 
     kpColor m_newColor;
-    kpImage *m_oldImagePtr;
+
+    bool m_undoByReplay;
+    kpCompressedImage m_oldImage;
 };
 
 
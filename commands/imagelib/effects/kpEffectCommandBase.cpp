@@ -31,6 +31,7 @@
 #include "kpDefs.h"
 #include "document/kpDocument.h"
 #include "generic/kpSetOverrideCursorSaver.h"
+#include "imagelib/kpCompressedImage.h"
 
 #include <KLocalizedString>
 
@@ -41,7 +42,8 @@ struct kpEffectCommandBasePrivate
     QString name;
     bool actOnSelection{false};
 
-    kpImage oldImage;
+    bool undoByReplay{false};
+    kpCompressedImage oldImage;
 };
 
 kpEffectCommandBase::kpEffectCommandBase (const QString &name,
@@ -73,6 +75,37 @@ kpCommandSize::SizeType kpEffectCommandBase::size () const
     return ImageSize (d->oldImage);
 }
 
+// public virtual [base kpCommand]
+void kpEffectCommandBase::spill (kpSpillFile *file)
+{
+    d->oldImage.spill (file);
+}
+
+// public virtual [base kpCommand]
+kpCommandSize::SizeType kpEffectCommandBase::spilledSize () const
+{
+    return kpCommandSize::SpilledImageSize (d->oldImage);
+}
+
+
+// public virtual [base kpCommand]
+bool kpEffectCommandBase::isReplayable () const
+{
+    return !d->actOnSelection;
+}
+
+// public virtual [base kpCommand]
+bool kpEffectCommandBase::setUndoByReplay ()
+{
+    // Inverting the image again is cheaper than replaying.
+    if (isInvertible ()) {
+        return false;
+    }
+
+    d->undoByReplay = true;
+    return true;
+}
+
 
 // public virtual [base kpCommand]
 void kpEffectCommandBase::execute ()
@@ -85,7 +118,7 @@ void kpEffectCommandBase::execute ()
 
     const kpImage oldImage = doc->image (d->actOnSelection);
 
-    if (!isInvertible ())
+    if (!isInvertible () && !d->undoByReplay)
     {
         d->oldImage = oldImage;
     }
@@ -109,7 +142,7 @@ void kpEffectCommandBase::unexecute ()
 
     if (!isInvertible ())
     {
-        newImage = d->oldImage;
+        newImage = d->oldImage.image ();
     }
     else
     {
@@ -119,6 +152,6 @@ void kpEffectCommandBase::unexecute ()
     doc->setImage (d->actOnSelection, newImage);
 
 
-    d->oldImage = kpImage ();
+    d->oldImage = kpCompressedImage ();
 }
 
@@ -46,6 +46,11 @@ public:
 
     QString name () const override;
     SizeType size () const override;
+    void spill (kpSpillFile *file) override;
+    SizeType spilledSize () const override;
+
+    bool isReplayable () const override;
+    bool setUndoByReplay () override;
 
 public:
     void execute () override;
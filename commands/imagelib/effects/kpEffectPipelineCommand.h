@@ -0,0 +1,66 @@
+/*
+   Copyright (c) 2026 The KolourPaint Authors
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+   OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+   IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+   INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+   NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+   THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef kpEffectPipelineCommand_H
+#define kpEffectPipelineCommand_H
+
+
+#include "kpEffectCommandBase.h"
+#include "imagelib/kpImage.h"
+#include "imagelib/effects/kpEffectPipeline.h"
+
+
+//
+// Applies a chain of effects as a single command: one pass over the image
+// and one old image to undo.
+//
+class kpEffectPipelineCommand : public kpEffectCommandBase
+{
+public:
+    kpEffectPipelineCommand (const QString &name,
+                             const kpEffectPipeline &pipeline,
+                             bool actOnSelection,
+                             kpCommandEnvironment *environ);
+    ~kpEffectPipelineCommand () override;
+
+
+    //
+    // kpEffectCommandBase interface
+    //
+
+public:
+    bool isInvertible () const override;
+
+protected:
+    kpImage applyEffect (const kpImage &image) override;
+
+protected:
+    kpEffectPipeline m_pipeline;
+};
+
+
+#endif  // kpEffectPipelineCommand_H
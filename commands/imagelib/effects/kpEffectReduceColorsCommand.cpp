@@ -36,29 +36,37 @@
 
 //---------------------------------------------------------------------
 
-kpEffectReduceColorsCommand::kpEffectReduceColorsCommand (int depth, bool dither,
+kpEffectReduceColorsCommand::kpEffectReduceColorsCommand (int depth,
+        kpColorQuantizer::DitherMode ditherMode,
         bool actOnSelection,
         kpCommandEnvironment *environ)
-    : kpEffectCommandBase (commandName (depth, dither), actOnSelection, environ),
-      m_depth (depth), m_dither (dither)
+    : kpEffectCommandBase (commandName (depth, ditherMode), actOnSelection, environ),
+      m_depth (depth), m_ditherMode (ditherMode)
 {
 }
 
 //---------------------------------------------------------------------
 
 // public
-QString kpEffectReduceColorsCommand::commandName (int depth, int dither) const
+QString kpEffectReduceColorsCommand::commandName (int depth,
+        kpColorQuantizer::DitherMode ditherMode) const
 {
     switch (depth) {
-    case 1: if (dither) {
+    case 1: if (ditherMode == kpColorQuantizer::FloydSteinbergDither) {
             return i18n ("Reduce to Monochrome (Dithered)");
         }
+        if (ditherMode == kpColorQuantizer::OrderedDither) {
+            return i18n ("Reduce to Monochrome (Ordered Dither)");
+        }
         return i18n ("Reduce to Monochrome");
 
     case 8:
-        if (dither) {
+        if (ditherMode == kpColorQuantizer::FloydSteinbergDither) {
             return i18n ("Reduce to 256 Color (Dithered)");
         }
+        if (ditherMode == kpColorQuantizer::OrderedDither) {
+            return i18n ("Reduce to 256 Color (Ordered Dither)");
+        }
         return i18n ("Reduce to 256 Color");
 
     default: return {};
@@ -74,7 +82,7 @@ QString kpEffectReduceColorsCommand::commandName (int depth, int dither) const
 // protected virtual [base kpEffectCommandBase]
 kpImage kpEffectReduceColorsCommand::applyEffect (const kpImage &image)
 {
-    return kpEffectReduceColors::applyEffect (image, m_depth, m_dither);
+    return kpEffectReduceColors::applyEffect (image, m_depth, m_ditherMode);
 }
 
 //---------------------------------------------------------------------
@@ -32,17 +32,19 @@
 
 #include "kpEffectCommandBase.h"
 #include "imagelib/kpImage.h"
+#include "imagelib/kpColorQuantizer.h"
 
 
 class kpEffectReduceColorsCommand : public kpEffectCommandBase
 {
 public:
     // depth must be 1 or 8
-    kpEffectReduceColorsCommand (int depth, bool dither,
+    kpEffectReduceColorsCommand (int depth,
+                                 kpColorQuantizer::DitherMode ditherMode,
                                  bool actOnSelection,
                                  kpCommandEnvironment *environ);
 
-    QString commandName (int depth, int dither) const;
+    QString commandName (int depth, kpColorQuantizer::DitherMode ditherMode) const;
 
     //
     // kpEffectCommandBase interface
@@ -52,7 +54,7 @@ protected:
     kpImage applyEffect (const kpImage &image) override;
 
     int m_depth;
-    bool m_dither;
+    kpColorQuantizer::DitherMode m_ditherMode;
 };
 
 
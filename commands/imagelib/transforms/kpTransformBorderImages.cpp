@@ -0,0 +1,201 @@
+/*
+   Copyright (c) 2026 The KolourPaint Authors
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+   OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+   IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+   INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+   NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+   THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#define DEBUG_KP_TRANSFORM_BORDER_IMAGES 0
+
+
+#include "kpTransformBorderImages.h"
+
+#include "kpLogCategories.h"
+
+#include "pixmapfx/kpPixmapFX.h"
+
+#include <algorithm>
+
+
+//---------------------------------------------------------------------
+
+kpTransformBorderImages::kpTransformBorderImages () = default;
+
+//---------------------------------------------------------------------
+
+kpTransformBorderImages::kpTransformBorderImages (const kpImage &image,
+        const QRect &keptRect)
+    : m_imageSize (image.size ()),
+      m_keptRect (keptRect.intersected (image.rect ()))
+{
+#if DEBUG_KP_TRANSFORM_BORDER_IMAGES
+    qCDebug(kpLogCommands) << "kpTransformBorderImages::<ctor>(image.rect="
+                           << image.rect () << ",keptRect=" << keptRect
+                           << ") clipped=" << m_keptRect;
+#endif
+
+    if (m_keptRect.isEmpty ())
+    {
+        saveStrip (image, image.rect ());
+        return;
+    }
+
+    const int width = image.width (), height = image.height ();
+
+    // Above
+    saveStrip (image, QRect (0, 0, width, m_keptRect.top ()));
+    // Left
+    saveStrip (image, QRect (0, m_keptRect.top (),
+                             m_keptRect.left (), m_keptRect.height ()));
+    // Right
+    saveStrip (image, QRect (m_keptRect.right () + 1, m_keptRect.top (),
+                             width - 1 - m_keptRect.right (), m_keptRect.height ()));
+    // Below
+    saveStrip (image, QRect (0, m_keptRect.bottom () + 1,
+                             width, height - 1 - m_keptRect.bottom ()));
+}
+
+//---------------------------------------------------------------------
+
+// private
+void kpTransformBorderImages::saveStrip (const kpImage &image, const QRect &rect)
+{
+    if (rect.isEmpty ()) {
+        return;
+    }
+
+    Strip strip;
+    strip.rect = rect;
+
+    // Is every pixel the same?  Only worth checking for the document format,
+    // whose pixel values restore() can write back as is.
+    bool isSinglePixel = (image.format () == QImage::Format_ARGB32_Premultiplied);
+    if (isSinglePixel)
+    {
+        strip.pixel = reinterpret_cast <const QRgb *> (
+            image.constScanLine (rect.top ())) [rect.left ()];
+
+        for (int y = rect.top (); y <= rect.bottom () && isSinglePixel; y++)
+        {
+            const auto *line = reinterpret_cast <const QRgb *> (image.constScanLine (y));
+            isSinglePixel = std::all_of (line + rect.left (), line + rect.right () + 1,
+                [&strip] (QRgb pixel) { return pixel == strip.pixel; });
+        }
+    }
+
+    if (!isSinglePixel) {
+        strip.image = kpPixmapFX::getPixmapAt (image, rect);
+    }
+
+#if DEBUG_KP_TRANSFORM_BORDER_IMAGES
+    qCDebug(kpLogCommands) << "\tstrip rect=" << rect
+                           << " isSinglePixel=" << isSinglePixel;
+#endif
+
+    m_strips.append (strip);
+}
+
+//---------------------------------------------------------------------
+
+// public
+kpCommandSize::SizeType kpTransformBorderImages::size () const
+{
+    kpCommandSize::SizeType total = 0;
+    for (const Strip &strip : m_strips) {
+        total += static_cast <kpCommandSize::SizeType> (sizeof (Strip)) +
+                 kpCommandSize::ImageSize (strip.image);
+    }
+
+    return total;
+}
+
+//---------------------------------------------------------------------
+
+// public
+void kpTransformBorderImages::spill (kpSpillFile *file)
+{
+    for (Strip &strip : m_strips) {
+        strip.image.spill (file);
+    }
+}
+
+// public
+kpCommandSize::SizeType kpTransformBorderImages::spilledSize () const
+{
+    kpCommandSize::SizeType total = 0;
+    for (const Strip &strip : m_strips) {
+        total += kpCommandSize::SpilledImageSize (strip.image);
+    }
+
+    return total;
+}
+
+//---------------------------------------------------------------------
+
+// public
+QSize kpTransformBorderImages::imageSize () const
+{
+    return m_imageSize;
+}
+
+//---------------------------------------------------------------------
+
+// public
+QRect kpTransformBorderImages::keptRect () const
+{
+    return m_keptRect;
+}
+
+//---------------------------------------------------------------------
+
+// public
+kpImage kpTransformBorderImages::restore (const kpImage &keptImage) const
+{
+    kpImage image (m_imageSize, QImage::Format_ARGB32_Premultiplied);
+
+    if (!m_keptRect.isEmpty ())
+    {
+        Q_ASSERT (keptImage.width () >= m_keptRect.width () &&
+                  keptImage.height () >= m_keptRect.height ());
+
+        kpPixmapFX::setPixmapAt (&image, m_keptRect, keptImage);
+    }
+
+    for (const Strip &strip : m_strips)
+    {
+        if (!strip.image.isNull ())
+        {
+            kpPixmapFX::setPixmapAt (&image, strip.rect, strip.image.image ());
+            continue;
+        }
+
+        for (int y = strip.rect.top (); y <= strip.rect.bottom (); y++)
+        {
+            auto *line = reinterpret_cast <QRgb *> (image.scanLine (y));
+            std::fill (line + strip.rect.left (), line + strip.rect.right () + 1,
+                       strip.pixel);
+        }
+    }
+
+    return image;
+}
@@ -0,0 +1,95 @@
+/*
+   Copyright (c) 2026 The KolourPaint Authors
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+   OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+   IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+   INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+   NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+   THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef kpTransformBorderImages_H
+#define kpTransformBorderImages_H
+
+
+#include <QRect>
+#include <QSize>
+#include <QVector>
+
+#include "commands/kpCommandSize.h"
+#include "imagelib/kpCompressedImage.h"
+#include "imagelib/kpImage.h"
+
+
+//
+// Saves, for undo, the pixels of an image that lie outside a rectangle
+// that a crop or resize keeps.  The command only needs to keep these
+// instead of the whole old image, since the kept part is still in the
+// document.
+//
+// The pixels are saved as up to 4 strips: the rows above and below the
+// kept rectangle and, beside it, the rest of the rows that it covers.
+// A strip whose pixels are all the same is saved as just that pixel value,
+// which is usual for the margins of scans and screenshots.
+//
+class kpTransformBorderImages
+{
+public:
+    kpTransformBorderImages ();
+
+    // Saves the pixels of <image> outside <keptRect>.  <keptRect> may extend
+    // past <image> (e.g. when enlarging), in which case only the part inside
+    // <image> is kept.
+    kpTransformBorderImages (const kpImage &image, const QRect &keptRect);
+
+    kpCommandSize::SizeType size () const;
+
+    // Moves the saved strips out of memory (see kpCompressedImage::spill()).
+    void spill (kpSpillFile *file);
+    kpCommandSize::SizeType spilledSize () const;
+
+    // The size of the image passed to the ctor.
+    QSize imageSize () const;
+
+    // The part of the image passed to the ctor that was not saved.
+    QRect keptRect () const;
+
+    // Returns an image of size imageSize() with the saved strips and, in
+    // keptRect(), the top-left pixels of <keptImage>.
+    //
+    // <keptImage> must be at least as big as keptRect().
+    kpImage restore (const kpImage &keptImage) const;
+
+private:
+    struct Strip
+    {
+        QRect rect;
+        // (only used if <image> is null)
+        QRgb pixel{};
+        kpCompressedImage image;
+    };
+
+    void saveStrip (const kpImage &image, const QRect &rect);
+
+    QSize m_imageSize;
+    QRect m_keptRect;
+    QVector <Strip> m_strips;
+};
+
+
+#endif  // kpTransformBorderImages_H
@@ -97,6 +97,16 @@ kpCommandSize::SizeType kpTransformFlipCommand::size () const
 //---------------------------------------------------------------------
 // public virtual [base kpCommand]
 
+bool kpTransformFlipCommand::isReplayable () const
+{
+    // (but flipping again is cheaper than replaying, so it's still undone
+    //  that way)
+    return !m_actOnSelection;
+}
+
+//---------------------------------------------------------------------
+// public virtual [base kpCommand]
+
 void kpTransformFlipCommand::execute ()
 {
     flip ();
@@ -128,7 +138,10 @@ void kpTransformFlipCommand::flip ()
     }
     else
     {
-        doc->setImage(doc->image().mirrored(m_horiz, m_vert));
+        // Flip in place -- it's its own inverse, so there's no need to keep
+        // a copy of the old image for undo.
+        kpPixmapFX::flip (doc->imagePointer (), m_horiz, m_vert);
+        doc->slotContentsChanged (doc->rect ());
     }
 
     QApplication::restoreOverrideCursor ();
@@ -46,6 +46,8 @@ public:
 
     SizeType size () const override;
 
+    bool isReplayable () const override;
+
     void execute () override;
     void unexecute () override;
 
@@ -58,10 +58,12 @@
 kpTransformResizeScaleCommand::kpTransformResizeScaleCommand (bool actOnSelection,
         int newWidth, int newHeight,
         Type type,
-        kpCommandEnvironment *environ)
+        kpCommandEnvironment *environ,
+        kpImageScaler::Filter smoothScaleFilter)
     : kpCommand (environ),
       m_actOnSelection (actOnSelection),
       m_type (type),
+      m_smoothScaleFilter (smoothScaleFilter),
       m_backgroundColor (environ->backgroundColor ()),
       m_oldSelectionPtr (nullptr)
 {
@@ -132,11 +134,24 @@ QString kpTransformResizeScaleCommand::name () const
 kpCommandSize::SizeType kpTransformResizeScaleCommand::size () const
 {
     return ImageSize (m_oldImage) +
-           ImageSize (m_oldRightImage) +
-           ImageSize (m_oldBottomImage) +
+           m_oldBorderImages.size () +
            SelectionSize (m_oldSelectionPtr);
 }
 
+// public virtual [base kpCommand]
+void kpTransformResizeScaleCommand::spill (kpSpillFile *file)
+{
+    m_oldImage.spill (file);
+    m_oldBorderImages.spill (file);
+}
+
+// public virtual [base kpCommand]
+kpCommandSize::SizeType kpTransformResizeScaleCommand::spilledSize () const
+{
+    return kpCommandSize::SpilledImageSize (m_oldImage) +
+           m_oldBorderImages.spilledSize ();
+}
+
 
 // public
 int kpTransformResizeScaleCommand::newWidth () const
@@ -287,19 +302,9 @@ void kpTransformResizeScaleCommand::execute ()
             QApplication::setOverrideCursor (Qt::WaitCursor);
 
 
-            if (m_newWidth < m_oldWidth)
-            {
-                m_oldRightImage = document ()->getImageAt (
-                    QRect (m_newWidth, 0,
-                        m_oldWidth - m_newWidth, m_oldHeight));
-            }
-
-            if (m_newHeight < m_oldHeight)
-            {
-                m_oldBottomImage = document ()->getImageAt (
-                    QRect (0, m_newHeight,
-                        m_newWidth, m_oldHeight - m_newHeight));
-            }
+            // (saves nothing if the document is only getting bigger)
+            m_oldBorderImages = kpTransformBorderImages (document ()->image (),
+                QRect (0, 0, m_newWidth, m_newHeight));
 
             document ()->resize (m_newWidth, m_newHeight, m_backgroundColor);
 
@@ -319,8 +324,10 @@ void kpTransformResizeScaleCommand::execute ()
             m_oldImage = oldImage;
         }
 
-        kpImage newImage = kpPixmapFX::scale (oldImage, m_newWidth, m_newHeight,
-                                               m_type == SmoothScale);
+        kpImage newImage = (m_type == SmoothScale) ?
+            kpImageScaler::scale (oldImage, m_newWidth, m_newHeight,
+                                  m_smoothScaleFilter) :
+            kpPixmapFX::scale (oldImage, m_newWidth, m_newHeight);
 
 
         if (!m_oldSelectionPtr && document ()->selection ())
@@ -410,26 +417,9 @@ void kpTransformResizeScaleCommand::unexecute ()
             QApplication::setOverrideCursor (Qt::WaitCursor);
 
 
-            kpImage newImage (m_oldWidth, m_oldHeight, QImage::Format_ARGB32_Premultiplied);
-
-            kpPixmapFX::setPixmapAt (&newImage, QPoint (0, 0),
-                                     doc->image ());
-
-            if (m_newWidth < m_oldWidth)
-            {
-                kpPixmapFX::setPixmapAt (&newImage,
-                                        QPoint (m_newWidth, 0),
-                                        m_oldRightImage);
-            }
-
-            if (m_newHeight < m_oldHeight)
-            {
-                kpPixmapFX::setPixmapAt (&newImage,
-                                        QPoint (0, m_newHeight),
-                                        m_oldBottomImage);
-            }
-
-            doc->setImage (newImage);
+            Q_ASSERT (m_oldBorderImages.imageSize () == QSize (m_oldWidth, m_oldHeight));
+            doc->setImage (m_oldBorderImages.restore (doc->image ()));
+            m_oldBorderImages = kpTransformBorderImages ();
 
 
             QApplication::restoreOverrideCursor ();
@@ -444,7 +434,7 @@ void kpTransformResizeScaleCommand::unexecute ()
         kpImage oldImage;
 
         if (!m_isLosslessScale) {
-            oldImage = m_oldImage;
+            oldImage = m_oldImage.image ();
         } else {
             oldImage = kpPixmapFX::scale (doc->image (m_actOnSelection),
                                           m_oldWidth, m_oldHeight);
@@ -34,7 +34,9 @@
 
 #include "imagelib/kpColor.h"
 #include "commands/kpCommand.h"
-#include "imagelib/kpImage.h"
+#include "imagelib/kpCompressedImage.h"
+#include "imagelib/transforms/kpImageScaler.h"
+#include "kpTransformBorderImages.h"
 
 
 class QSize;
@@ -53,14 +55,18 @@ public:
         Resize, Scale, SmoothScale
     };
 
+    // <smoothScaleFilter> is only used if <type> is SmoothScale.
     kpTransformResizeScaleCommand (bool actOnSelection,
         int newWidth, int newHeight,
         Type type,
-        kpCommandEnvironment *environ);
+        kpCommandEnvironment *environ,
+        kpImageScaler::Filter smoothScaleFilter = kpImageScaler::Bilinear);
     ~kpTransformResizeScaleCommand () override;
 
     QString name () const override;
     SizeType size () const override;
+    void spill (kpSpillFile *file) override;
+    SizeType spilledSize () const override;
 
 public:
     int newWidth () const;
@@ -86,13 +92,16 @@ protected:
     bool m_actOnSelection;
     int m_newWidth, m_newHeight;
     Type m_type;
+    kpImageScaler::Filter m_smoothScaleFilter;
     bool m_isLosslessScale;
     bool m_scaleSelectionWithImage;
     kpColor m_backgroundColor;
 
     int m_oldWidth, m_oldHeight;
     bool m_actOnTextSelection;
-    kpImage m_oldImage, m_oldRightImage, m_oldBottomImage;
+    kpCompressedImage m_oldImage;
+    // (for Resize: the pixels cut off the right and bottom)
+    kpTransformBorderImages m_oldBorderImages;
     kpAbstractSelection *m_oldSelectionPtr;
 };
 
@@ -40,6 +40,8 @@
 #include "views/manager/kpViewManager.h"
 #include "kpLogCategories.h"
 
+#include <cmath>
+
 #include <QApplication>
 #include <QPolygon>
 #include <QTransform>
@@ -48,6 +50,24 @@
 
 //--------------------------------------------------------------------------------
 
+// Returns whether rotating by <angle> (0 <= angle < 360) turns the image
+// upside down, which kpPixmapFX::rotate() can do in place.
+static bool IsHalfTurn (double angle)
+{
+    return std::fabs (angle - 180) < kpPixmapFX::AngleInDegreesEpsilon;
+}
+
+//--------------------------------------------------------------------------------
+
+// Turns the document image upside down, in place.  This is its own inverse.
+static void HalfTurnDocumentImage (kpDocument *doc, const kpColor &backgroundColor)
+{
+    kpPixmapFX::rotate (doc->imagePointer (), 180, backgroundColor);
+    doc->slotContentsChanged (doc->rect ());
+}
+
+//--------------------------------------------------------------------------------
+
 kpTransformRotateCommand::kpTransformRotateCommand (bool actOnSelection,
         double angle,
         kpCommandEnvironment *environ)
@@ -56,6 +76,7 @@ kpTransformRotateCommand::kpTransformRotateCommand (bool actOnSelection,
       m_angle (angle),
       m_backgroundColor (environ->backgroundColor (actOnSelection)),
       m_losslessRotation (kpPixmapFX::isLosslessRotation (angle)),
+      m_undoByReplay (false),
       m_oldSelectionPtr (nullptr)
 {
 }
@@ -82,6 +103,37 @@ kpCommandSize::SizeType kpTransformRotateCommand::size () const
            SelectionSize (m_oldSelectionPtr);
 }
 
+// public virtual [base kpCommand]
+void kpTransformRotateCommand::spill (kpSpillFile *file)
+{
+    m_oldImage.spill (file);
+}
+
+// public virtual [base kpCommand]
+kpCommandSize::SizeType kpTransformRotateCommand::spilledSize () const
+{
+    return kpCommandSize::SpilledImageSize (m_oldImage);
+}
+
+
+// public virtual [base kpCommand]
+bool kpTransformRotateCommand::isReplayable () const
+{
+    return !m_actOnSelection;
+}
+
+// public virtual [base kpCommand]
+bool kpTransformRotateCommand::setUndoByReplay ()
+{
+    // Lossless rotations are undone by rotating back.
+    if (m_losslessRotation) {
+        return false;
+    }
+
+    m_undoByReplay = true;
+    return true;
+}
+
 
 // public virtual [base kpCommand]
 void kpTransformRotateCommand::execute ()
@@ -93,7 +145,18 @@ void kpTransformRotateCommand::execute ()
     QApplication::setOverrideCursor (Qt::WaitCursor);
 
 
-    if (!m_losslessRotation) {
+    // The document image can be rotated by 180 degrees in place, without
+    // holding the old and new images at the same time.
+    if (!m_actOnSelection && ::IsHalfTurn (m_angle))
+    {
+        ::HalfTurnDocumentImage (doc, m_backgroundColor);
+
+        QApplication::restoreOverrideCursor ();
+        return;
+    }
+
+
+    if (!m_losslessRotation && !m_undoByReplay) {
         m_oldImage = doc->image (m_actOnSelection);
     }
 
@@ -188,12 +251,21 @@ void kpTransformRotateCommand::unexecute ()
     QApplication::setOverrideCursor (Qt::WaitCursor);
 
 
+    if (!m_actOnSelection && ::IsHalfTurn (m_angle))
+    {
+        ::HalfTurnDocumentImage (doc, m_backgroundColor);
+
+        QApplication::restoreOverrideCursor ();
+        return;
+    }
+
+
     kpImage oldImage;
 
     if (!m_losslessRotation)
     {
-        oldImage = m_oldImage;
-        m_oldImage = kpImage ();
+        oldImage = m_oldImage.image ();
+        m_oldImage = kpCompressedImage ();
     }
     else
     {
@@ -32,7 +32,7 @@
 
 #include "imagelib/kpColor.h"
 #include "commands/kpCommand.h"
-#include "imagelib/kpImage.h"
+#include "imagelib/kpCompressedImage.h"
 
 
 class kpAbstractImageSelection;
@@ -49,6 +49,11 @@ public:
     QString name () const override;
 
     SizeType size () const override;
+    void spill (kpSpillFile *file) override;
+    SizeType spilledSize () const override;
+
+    bool isReplayable () const override;
+    bool setUndoByReplay () override;
 
     void execute () override;
     void unexecute () override;
@@ -60,7 +65,8 @@ private:
     kpColor m_backgroundColor;
 
     bool m_losslessRotation;
-    kpImage m_oldImage;
+    bool m_undoByReplay;
+    kpCompressedImage m_oldImage;
     kpAbstractImageSelection *m_oldSelectionPtr;
 };
 
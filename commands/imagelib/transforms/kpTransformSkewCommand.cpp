@@ -59,6 +59,7 @@ kpTransformSkewCommand::kpTransformSkewCommand (bool actOnSelection,
       m_actOnSelection (actOnSelection),
       m_hangle (hangle), m_vangle (vangle),
       m_backgroundColor (environ->backgroundColor (actOnSelection)),
+      m_undoByReplay (false),
       m_oldSelectionPtr (nullptr)
 {
 }
@@ -85,6 +86,32 @@ kpCommandSize::SizeType kpTransformSkewCommand::size () const
            SelectionSize (m_oldSelectionPtr);
 }
 
+// public virtual [base kpCommand]
+void kpTransformSkewCommand::spill (kpSpillFile *file)
+{
+    m_oldImage.spill (file);
+}
+
+// public virtual [base kpCommand]
+kpCommandSize::SizeType kpTransformSkewCommand::spilledSize () const
+{
+    return kpCommandSize::SpilledImageSize (m_oldImage);
+}
+
+
+// public virtual [base kpCommand]
+bool kpTransformSkewCommand::isReplayable () const
+{
+    return !m_actOnSelection;
+}
+
+// public virtual [base kpCommand]
+bool kpTransformSkewCommand::setUndoByReplay ()
+{
+    m_undoByReplay = true;
+    return true;
+}
+
 
 // public virtual [base kpCommand]
 void kpTransformSkewCommand::execute ()
@@ -103,7 +130,9 @@ void kpTransformSkewCommand::execute ()
 
     if (!m_actOnSelection)
     {
-        m_oldImage = doc->image (m_actOnSelection);
+        if (!m_undoByReplay) {
+            m_oldImage = doc->image (m_actOnSelection);
+        }
 
         doc->setImage (newImage);
     }
@@ -178,8 +207,8 @@ void kpTransformSkewCommand::unexecute ()
 
     if (!m_actOnSelection)
     {
-        doc->setImage (m_oldImage);
-        m_oldImage = kpImage ();
+        doc->setImage (m_oldImage.image ());
+        m_oldImage = kpCompressedImage ();
     }
     else
     {
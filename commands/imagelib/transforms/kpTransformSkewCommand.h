@@ -31,7 +31,7 @@
 
 
 #include "imagelib/kpColor.h"
-#include "imagelib/kpImage.h"
+#include "imagelib/kpCompressedImage.h"
 #include "commands/kpCommand.h"
 
 
@@ -49,6 +49,11 @@ public:
     QString name () const override;
 
     SizeType size () const override;
+    void spill (kpSpillFile *file) override;
+    SizeType spilledSize () const override;
+
+    bool isReplayable () const override;
+    bool setUndoByReplay () override;
 
     void execute () override;
     void unexecute () override;
@@ -58,7 +63,9 @@ private:
     int m_hangle, m_vangle;
 
     kpColor m_backgroundColor;
-    kpImage m_oldImage;
+
+    bool m_undoByReplay;
+    kpCompressedImage m_oldImage;
     kpAbstractImageSelection *m_oldSelectionPtr;
 };
 
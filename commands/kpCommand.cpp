@@ -43,6 +43,30 @@ kpCommand::kpCommand (kpCommandEnvironment *environ)
 kpCommand::~kpCommand () = default;
 
 
+// public virtual
+void kpCommand::spill (kpSpillFile * /*file*/)
+{
+}
+
+// public virtual
+kpCommandSize::SizeType kpCommand::spilledSize () const
+{
+    return 0;
+}
+
+// public virtual
+bool kpCommand::isReplayable () const
+{
+    return false;
+}
+
+// public virtual
+bool kpCommand::setUndoByReplay ()
+{
+    return false;
+}
+
+
 kpCommandEnvironment *kpCommand::environ () const
 {
     return m_environ;
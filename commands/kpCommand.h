@@ -40,6 +40,7 @@ class kpAbstractImageSelection;
 class kpAbstractSelection;
 class kpCommandEnvironment;
 class kpDocument;
+class kpSpillFile;
 class kpMainWindow;
 class kpTextSelection;
 class kpViewManager;
@@ -68,6 +69,40 @@ public:
     // kpCommandSize.
     virtual SizeType size () const = 0;
 
+    // Moves the data kept for undo/redo out of memory, into <file>, so that
+    // it no longer counts towards size().  It is read back when needed by
+    // execute() or unexecute().
+    //
+    // Called by the command history on old commands, instead of deleting
+    // them, if spilling is enabled.  Implement this with
+    // kpCompressedImage::spill().  The default implementation moves nothing.
+    virtual void spill (kpSpillFile *file);
+
+    // Returns the number of bytes that spill() moved into the file and that
+    // are still there (i.e. not yet read back by execute() or unexecute()).
+    //
+    // Implement this with kpCommandSize::SpilledImageSize().  The default
+    // implementation returns 0.
+    virtual SizeType spilledSize () const;
+
+    // Returns whether execute() only changes the document image, in the
+    // same way every time it is given the same image.  The command history
+    // can then undo the command by going back to an earlier document image
+    // and executing the commands after that one again
+    // (see kpCommandHistoryBase::setUndoByReplay()).
+    //
+    // The default implementation returns false.
+    virtual bool isReplayable () const;
+
+    // Tells a replayable command that it will be undone by replaying, so
+    // that execute() need not keep anything for unexecute(), which will not
+    // be called.  Called before the first execute().
+    //
+    // Returns false, changing nothing, if the command would not have kept
+    // anything anyway (e.g. it undoes itself by inverting the image).  The
+    // default implementation returns false.
+    virtual bool setUndoByReplay ();
+
     virtual void execute () = 0;
     virtual void unexecute () = 0;
 
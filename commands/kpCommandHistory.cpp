@@ -46,6 +46,13 @@ kpCommandHistory::kpCommandHistory (bool doReadConfig, kpMainWindow *mainWindow)
 kpCommandHistory::~kpCommandHistory () = default;
 
 
+// protected virtual [base kpCommandHistoryBase]
+kpDocument *kpCommandHistory::document () const
+{
+    return m_mainWindow ? m_mainWindow->document () : nullptr;
+}
+
+
 static bool NextUndoCommandIsCreateBorder (kpCommandHistory *commandHistory)
 {
     Q_ASSERT (commandHistory);
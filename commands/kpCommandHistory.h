@@ -98,6 +98,8 @@ public slots:
     void redo () override;
 
 protected:
+    kpDocument *document () const override;
+
     kpMainWindow *m_mainWindow;
 };
 
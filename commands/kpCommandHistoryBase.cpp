@@ -33,7 +33,9 @@
 
 #include <climits>
 
+#include <QHash>
 #include <QLinkedList>
+#include <QLocale>
 #include <QMenu>
 
 #include <KSharedConfig>
@@ -50,25 +52,31 @@
 #include "environments/commands/kpCommandEnvironment.h"
 #include "kpDefs.h"
 #include "document/kpDocument.h"
+#include "generic/kpSpillFile.h"
+#include "imagelib/kpCompressedImage.h"
 #include "mainWindow/kpMainWindow.h"
 #include "tools/kpTool.h"
 
 //---------------------------------------------------------------------
 
-//template <typename T>
-static void ClearPointerList (QLinkedList <kpCommand *> *listPtr)
-{
-    if (!listPtr)
-        return;
-
-    qDeleteAll (listPtr->begin (), listPtr->end ());
-
-    listPtr->clear ();
-}
+// Undo by replay keeps a new keyframe rather than have to execute this many
+// commands again to undo one.
+static const int MaxReplayLength = 8;
 
 
 struct kpCommandHistoryBasePrivate
 {
+    // Where commands are moved to, if they don't fit in memory.
+    QSharedPointer <kpSpillFile> spillFile;
+
+    bool undoByReplay{false};
+
+    // The commands that are undone by replay, with the memory that this
+    // saves for each.
+    QHash <kpCommand *, kpCommandSize::SizeType> replayedCommands;
+
+    // The document image before each replayed command that starts a replay.
+    QHash <kpCommand *, kpCompressedImage> keyframes;
 };
 
 
@@ -101,6 +109,9 @@ kpCommandHistoryBase::kpCommandHistoryBase (bool doReadConfig,
     m_undoMinLimit = 10;
     m_undoMaxLimit = 500;
     m_undoMaxLimitSizeLimit = 16 * 1048576;
+    m_undoMaxLimitDiskSizeLimit = 0;
+
+    d->spillFile = QSharedPointer <kpSpillFile> (new kpSpillFile ());
 
 
     m_documentRestoredPosition = 0;
@@ -113,8 +124,8 @@ kpCommandHistoryBase::kpCommandHistoryBase (bool doReadConfig,
 
 kpCommandHistoryBase::~kpCommandHistoryBase ()
 {
-    ::ClearPointerList (&m_undoCommandList);
-    ::ClearPointerList (&m_redoCommandList);
+    clearCommandList (&m_undoCommandList);
+    clearCommandList (&m_redoCommandList);
 
     delete d;
 }
@@ -224,6 +235,68 @@ void kpCommandHistoryBase::setUndoMaxLimitSizeLimit (kpCommandSize::SizeType siz
 }
 
 
+// public
+kpCommandSize::SizeType kpCommandHistoryBase::undoMaxLimitDiskSizeLimit () const
+{
+    return m_undoMaxLimitDiskSizeLimit;
+}
+
+// public
+void kpCommandHistoryBase::setUndoMaxLimitDiskSizeLimit (kpCommandSize::SizeType sizeLimit)
+{
+#if DEBUG_KP_COMMAND_HISTORY
+    qCDebug(kpLogCommands) << "kpCommandHistoryBase::setUndoMaxLimitDiskSizeLimit("
+               << sizeLimit << ")";
+#endif
+
+    if (sizeLimit < 0 ||
+        sizeLimit > (64 * kpCommandSize::SizeType (1073741824))/*"ought to be enough for anybody"*/)
+    {
+        qCCritical(kpLogCommands) << "kpCommandHistoryBase::setUndoMaxLimitDiskSizeLimit("
+                   << sizeLimit << ")";
+        return;
+    }
+
+    if (sizeLimit == m_undoMaxLimitDiskSizeLimit) {
+        return;
+    }
+
+    m_undoMaxLimitDiskSizeLimit = sizeLimit;
+    trimCommandListsUpdateActions ();
+}
+
+
+// public
+bool kpCommandHistoryBase::undoByReplay () const
+{
+    return d->undoByReplay;
+}
+
+// public
+void kpCommandHistoryBase::setUndoByReplay (bool yes)
+{
+#if DEBUG_KP_COMMAND_HISTORY
+    qCDebug(kpLogCommands) << "kpCommandHistoryBase::setUndoByReplay("
+               << yes << ")";
+#endif
+
+    d->undoByReplay = yes;
+}
+
+
+// public
+kpCommandSize::SizeType kpCommandHistoryBase::undoByReplaySavedSize () const
+{
+    kpCommandSize::SizeType size = 0;
+
+    for (const kpCommandSize::SizeType saved : d->replayedCommands) {
+        size += saved;
+    }
+
+    return size;
+}
+
+
 // public
 void kpCommandHistoryBase::readConfig ()
 {
@@ -237,6 +310,10 @@ void kpCommandHistoryBase::readConfig ()
     setUndoMaxLimitSizeLimit (
         cfg.readEntry <kpCommandSize::SizeType> (kpSettingUndoMaxLimitSizeLimit,
                                                  undoMaxLimitSizeLimit ()));
+    setUndoMaxLimitDiskSizeLimit (
+        cfg.readEntry <kpCommandSize::SizeType> (kpSettingUndoMaxLimitDiskSizeLimit,
+                                                 undoMaxLimitDiskSizeLimit ()));
+    setUndoByReplay (cfg.readEntry (kpSettingUndoByReplay, undoByReplay ()));
 
     trimCommandListsUpdateActions ();
 }
@@ -253,6 +330,9 @@ void kpCommandHistoryBase::writeConfig ()
     cfg.writeEntry (kpSettingUndoMaxLimit, undoMaxLimit ());
     cfg.writeEntry <kpCommandSize::SizeType> (
         kpSettingUndoMaxLimitSizeLimit, undoMaxLimitSizeLimit ());
+    cfg.writeEntry <kpCommandSize::SizeType> (
+        kpSettingUndoMaxLimitDiskSizeLimit, undoMaxLimitDiskSizeLimit ());
+    cfg.writeEntry (kpSettingUndoByReplay, undoByReplay ());
 
     cfg.sync ();
 }
@@ -267,12 +347,37 @@ void kpCommandHistoryBase::addCommand (kpCommand *command, bool execute)
                << ",execute=" << execute << ")"
 #endif
 
+    kpDocument *doc = document ();
+    if (execute && d->undoByReplay && doc &&
+        command->isReplayable () && command->setUndoByReplay ())
+    {
+        const int length = replayLength ();
+        if (length < 0 || length >= MaxReplayLength)
+        {
+            d->keyframes.insert (command, kpCompressedImage (doc->image ()));
+            d->replayedCommands.insert (command, 0);
+        }
+        else
+        {
+            d->replayedCommands.insert (command,
+                kpCommandSize::ImageSize (doc->image ()));
+        }
+
+    #if DEBUG_KP_COMMAND_HISTORY
+        const kpCommandSize::SizeType savedSize = undoByReplaySavedSize ();
+        qCDebug(kpLogCommands) << "kpCommandHistoryBase::addCommand() undo by replay:"
+                   << "keyframe=" << d->keyframes.contains (command)
+                   << "saved=" << savedSize
+                   << "(" << savedSize / 1048576 << "MB)";
+    #endif
+    }
+
     if (execute) {
         command->execute ();
     }
 
     m_undoCommandList.push_front (command);
-    ::ClearPointerList (&m_redoCommandList);
+    clearCommandList (&m_redoCommandList);
 
 #if DEBUG_KP_COMMAND_HISTORY
     qCDebug(kpLogCommands) << "\tdocumentRestoredPosition=" << m_documentRestoredPosition;
@@ -300,8 +405,8 @@ void kpCommandHistoryBase::clear ()
     qCDebug(kpLogCommands) << "kpCommandHistoryBase::clear()";
 #endif
 
-    ::ClearPointerList (&m_undoCommandList);
-    ::ClearPointerList (&m_redoCommandList);
+    clearCommandList (&m_undoCommandList);
+    clearCommandList (&m_redoCommandList);
 
     m_documentRestoredPosition = 0;
 
@@ -322,7 +427,19 @@ void kpCommandHistoryBase::undoInternal ()
         return;
     }
 
-    undoCommand->unexecute ();
+    if (d->replayedCommands.contains (undoCommand))
+    {
+        if (!replayUndo ())
+        {
+            qCCritical(kpLogCommands) << "kpCommandHistoryBase::undoInternal() no keyframe for"
+                       << undoCommand->name ();
+            return;
+        }
+    }
+    else
+    {
+        undoCommand->unexecute ();
+    }
 
 
     m_undoCommandList.erase (m_undoCommandList.begin ());
@@ -356,6 +473,19 @@ void kpCommandHistoryBase::redoInternal ()
         return;
     }
 
+    // Its keyframe may have been deleted while it was in the redo list.
+    kpDocument *doc = document ();
+    if (doc && d->replayedCommands.contains (redoCommand) &&
+        !d->keyframes.contains (redoCommand))
+    {
+        const int length = replayLength ();
+        if (length < 0 || length >= MaxReplayLength)
+        {
+            d->keyframes.insert (redoCommand, kpCompressedImage (doc->image ()));
+            d->replayedCommands.insert (redoCommand, 0);
+        }
+    }
+
     redoCommand->execute ();
 
 
@@ -462,7 +592,18 @@ QString kpCommandHistoryBase::undoActionToolTip () const
 {
     kpCommand *undoCommand = nextUndoCommand ();
 
-    return (undoCommand) ? i18n ("Undo: %1", undoCommand->name ()) : i18n ("Undo");
+    QString toolTip = (undoCommand) ? i18n ("Undo: %1", undoCommand->name ()) : i18n ("Undo");
+
+    // (see setUndoByReplay())
+    const kpCommandSize::SizeType savedSize = undoByReplaySavedSize ();
+    if (savedSize > 0)
+    {
+        toolTip += QLatin1Char ('\n') +
+            i18n ("Undo by replaying is saving %1 MB",
+                  QLocale ().toString (double (savedSize) / 1048576, 'f', 1));
+    }
+
+    return toolTip;
 }
 
 // protected
@@ -504,7 +645,8 @@ void kpCommandHistoryBase::trimCommandList (QLinkedList <kpCommand *> *commandLi
     qCDebug(kpLogCommands) << "\tsize=" << commandList->size ()
                << "    undoMinLimit=" << m_undoMinLimit
                << " undoMaxLimit=" << m_undoMaxLimit
-               << " undoMaxLimitSizeLimit=" << m_undoMaxLimitSizeLimit;
+               << " undoMaxLimitSizeLimit=" << m_undoMaxLimitSizeLimit
+               << " undoMaxLimitDiskSizeLimit=" << m_undoMaxLimitDiskSizeLimit;
 #endif
     if (static_cast<int> (commandList->size ()) <= m_undoMinLimit)
     {
@@ -523,6 +665,13 @@ void kpCommandHistoryBase::trimCommandList (QLinkedList <kpCommand *> *commandLi
     int upto = 0;
 
     kpCommandSize::SizeType sizeSoFar = 0;
+    // (the spill file is shared by both lists, so only count this one's)
+    kpCommandSize::SizeType spilledSizeSoFar = 0;
+
+    // Replayed commands can't be undone without the keyframe that they are
+    // replayed from (see setUndoByReplay()), so the commands back to it are
+    // kept, even if that goes over the limits by a few commands.
+    bool needsKeyframe = false;
 
     while (it != commandList->end ())
     {
@@ -530,7 +679,30 @@ void kpCommandHistoryBase::trimCommandList (QLinkedList <kpCommand *> *commandLi
 
         if (sizeSoFar <= m_undoMaxLimitSizeLimit)
         {
-            sizeSoFar += (*it)->size ();
+            auto keyframeIt = d->keyframes.find (*it);
+            const bool hasKeyframe = (keyframeIt != d->keyframes.end ());
+
+            kpCommandSize::SizeType size = (*it)->size ();
+            if (hasKeyframe) {
+                size += kpCommandSize::ImageSize (*keyframeIt);
+            }
+
+            // Rather than deleting this and all older commands, try moving
+            // this one to disk.
+            if (sizeSoFar + size > m_undoMaxLimitSizeLimit &&
+                spilledSizeSoFar + size <= m_undoMaxLimitDiskSizeLimit)
+            {
+                (*it)->spill (d->spillFile.data ());
+                size = (*it)->size ();
+
+                if (hasKeyframe)
+                {
+                    keyframeIt->spill (d->spillFile.data ());
+                    size += kpCommandSize::ImageSize (*keyframeIt);
+                }
+            }
+
+            sizeSoFar += size;
         }
 
     #if DEBUG_KP_COMMAND_HISTORY && 0
@@ -540,7 +712,7 @@ void kpCommandHistoryBase::trimCommandList (QLinkedList <kpCommand *> *commandLi
                    << "    sizeSoFar=" << sizeSoFar;
     #endif
 
-        if (upto >= m_undoMinLimit)
+        if (upto >= m_undoMinLimit && !needsKeyframe)
         {
             if (upto >= m_undoMaxLimit ||
                 sizeSoFar > m_undoMaxLimitSizeLimit)
@@ -548,20 +720,78 @@ void kpCommandHistoryBase::trimCommandList (QLinkedList <kpCommand *> *commandLi
             #if DEBUG_KP_COMMAND_HISTORY && 0
                 qCDebug(kpLogCommands) << "\t\t\tkill";
             #endif
-                delete (*it);
-                it = m_undoCommandList.erase (it);
+                deleteCommand (*it);
+                it = commandList->erase (it);
                 advanceIt = false;
             }
         }
 
-        if (advanceIt) {
+        if (advanceIt)
+        {
+            spilledSizeSoFar += spilledSize (*it);
+
+            // (the redo list doesn't need this as it is trimmed from the
+            //  newest command)
+            if (commandList == &m_undoCommandList)
+            {
+                if (d->keyframes.contains (*it) || !(*it)->isReplayable ()) {
+                    needsKeyframe = false;
+                }
+                else if (d->replayedCommands.contains (*it)) {
+                    needsKeyframe = true;
+                }
+            }
+
             it++;
         }
         upto++;
     }
 
+    // The commands moved to disk are the oldest ones.  Delete those until
+    // the rest fit (e.g. after the limit was lowered).
+    while (spilledSizeSoFar > m_undoMaxLimitDiskSizeLimit &&
+           static_cast<int> (commandList->size ()) > m_undoMinLimit)
+    {
+    #if DEBUG_KP_COMMAND_HISTORY && 0
+        qCDebug(kpLogCommands) << "\t\tkill for disk size=" << spilledSizeSoFar;
+    #endif
+        spilledSizeSoFar -= spilledSize (commandList->last ());
+        deleteCommand (commandList->takeLast ());
+    }
+
+    // That may have deleted the keyframe that some replayed commands are
+    // replayed from, so delete them too.  These are the oldest commands left,
+    // up to the next keyframe or unreplayable command.
+    //
+    // (commands in the redo list get a new keyframe when redone instead)
+    if (commandList == &m_undoCommandList)
+    {
+        int numOrphans = 0, numReplayable = 0;
+
+        QLinkedList <kpCommand *>::const_iterator orphanIt = commandList->constEnd ();
+        while (orphanIt != commandList->constBegin ())
+        {
+            --orphanIt;
+
+            if (!(*orphanIt)->isReplayable () || d->keyframes.contains (*orphanIt)) {
+                break;
+            }
+
+            numReplayable++;
+            if (d->replayedCommands.contains (*orphanIt)) {
+                numOrphans = numReplayable;
+            }
+        }
+
+        for (int i = 0; i < numOrphans; i++) {
+            deleteCommand (commandList->takeLast ());
+        }
+    }
+
 #if DEBUG_KP_COMMAND_HISTORY
-    qCDebug(kpLogCommands) << "\ttook " << timer.elapsed () << "ms";
+    qCDebug(kpLogCommands) << "\ttook " << timer.elapsed () << "ms"
+               << " spilled=" << spilledSizeSoFar
+               << " (all lists=" << d->spillFile->liveSize () << ")";
 #endif
 }
 
@@ -678,6 +908,104 @@ void kpCommandHistoryBase::updateActions ()
 }
 
 
+// protected virtual
+kpDocument *kpCommandHistoryBase::document () const
+{
+    return nullptr;
+}
+
+// protected
+int kpCommandHistoryBase::replayLength () const
+{
+    int length = 0;
+
+    for (kpCommand *command : m_undoCommandList)
+    {
+        if (!command->isReplayable ()) {
+            return -1;
+        }
+
+        length++;
+
+        if (d->keyframes.contains (command)) {
+            return length;
+        }
+    }
+
+    return -1;
+}
+
+// protected
+bool kpCommandHistoryBase::replayUndo ()
+{
+#if DEBUG_KP_COMMAND_HISTORY
+    qCDebug(kpLogCommands) << "kpCommandHistoryBase::replayUndo() length="
+               << replayLength ();
+    QTime timer; timer.start ();
+#endif
+
+    kpDocument *doc = document ();
+    const int length = replayLength ();
+    if (!doc || length < 0) {
+        return false;
+    }
+
+    // Go back to the nearest keyframe, which was kept before the command
+    // <length - 1> commands before the next undo command...
+    QLinkedList <kpCommand *>::iterator it = m_undoCommandList.begin ();
+    it += length - 1;
+
+    doc->setImage (d->keyframes [*it].image ());
+
+    // ...and execute that command and the ones after it again, up to (but
+    // not including) the next undo command.
+    while (it != m_undoCommandList.begin ())
+    {
+        (*it)->execute ();
+        --it;
+    }
+
+#if DEBUG_KP_COMMAND_HISTORY
+    qCDebug(kpLogCommands) << "\ttook " << timer.elapsed () << "ms";
+#endif
+
+    return true;
+}
+
+
+// protected
+kpCommandSize::SizeType kpCommandHistoryBase::spilledSize (kpCommand *command) const
+{
+    kpCommandSize::SizeType size = command->spilledSize ();
+
+    const auto keyframeIt = d->keyframes.constFind (command);
+    if (keyframeIt != d->keyframes.constEnd ()) {
+        size += kpCommandSize::SpilledImageSize (*keyframeIt);
+    }
+
+    return size;
+}
+
+// protected
+void kpCommandHistoryBase::deleteCommand (kpCommand *command)
+{
+    d->replayedCommands.remove (command);
+    d->keyframes.remove (command);
+
+    delete command;
+}
+
+// protected
+void kpCommandHistoryBase::clearCommandList (QLinkedList <kpCommand *> *commandList)
+{
+    for (kpCommand *command : *commandList) {
+        deleteCommand (command);
+    }
+
+    commandList->clear ();
+}
+
+
 // public
 kpCommand *kpCommandHistoryBase::nextUndoCommand () const
 {
@@ -710,7 +1038,7 @@ void kpCommandHistoryBase::setNextUndoCommand (kpCommand *command)
         return;
     }
 
-    delete *m_undoCommandList.begin ();
+    deleteCommand (*m_undoCommandList.begin ());
     *m_undoCommandList.begin () = command;
 
     trimCommandListsUpdateActions ();
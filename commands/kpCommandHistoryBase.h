@@ -56,6 +56,10 @@ class kpViewManager;
 // could also be useful for other apps:
 // - nextUndoCommand()/nextRedoCommand()
 // - undo/redo history limited by both number and size
+// - commands that don't fit in that size can be moved to disk instead of
+//   being deleted (see setUndoMaxLimitDiskSizeLimit())
+// - replayable commands can be undone from keyframes of the document instead
+//   of keeping their own copies of it (see setUndoByReplay())
 //
 // Features not required by KolourPaint (e.g. commandExecuted()) are not
 // implemented and undo limit == redo limit.  So compared to
@@ -83,6 +87,32 @@ public:
     kpCommandSize::SizeType undoMaxLimitSizeLimit () const;
     void setUndoMaxLimitSizeLimit (kpCommandSize::SizeType sizeLimit);
 
+    // Size of the commands moved, from memory, to a temporary file once they
+    // exceed undoMaxLimitSizeLimit().  Like the other limits, this applies
+    // to the undo and redo lists separately.  0 disables this (the
+    // default), so that those commands are deleted instead.  It is opt-in,
+    // through the "Max Limit Disk Size Limit" setting.
+    kpCommandSize::SizeType undoMaxLimitDiskSizeLimit () const;
+    void setUndoMaxLimitDiskSizeLimit (kpCommandSize::SizeType sizeLimit);
+
+    // If enabled, replayable commands (see kpCommand::isReplayable()) do not
+    // keep the document image for undo.  Instead, a keyframe of the document
+    // image is kept before the first command of every run of them, and
+    // every few commands after that.  A command is undone by going back to
+    // the nearest keyframe and executing the commands between it and the
+    // command again.  Off by default.
+    //
+    // Commands added while this is enabled keep being undone by replay
+    // after it is disabled.
+    bool undoByReplay () const;
+    void setUndoByReplay (bool yes);
+
+    // Returns the memory that undo by replay currently saves: the size,
+    // before compression, of the document images that the commands in the
+    // history would otherwise have kept.  This is shown in the tooltip of
+    // the Undo action.
+    kpCommandSize::SizeType undoByReplaySavedSize () const;
+
 public:
     // Read and write above config
     void readConfig ();
@@ -117,6 +147,26 @@ protected:
     void trimCommandLists ();
     void updateActions ();
 
+    // Returns the document that replayable commands are replayed on, or
+    // nullptr if there is none, which disables undo by replay.  The default
+    // implementation returns nullptr.
+    virtual kpDocument *document () const;
+
+    // Returns how many commands, starting with the next undo command, have
+    // to be executed from the nearest keyframe to get back to the current
+    // document image, or -1 if they can't be replayed.
+    int replayLength () const;
+    // Undoes the next undo command by restoring the nearest keyframe and
+    // executing the commands after it again.
+    bool replayUndo ();
+
+    // Returns the number of bytes of <command>, and of its keyframe, that
+    // are in the spill file (see setUndoMaxLimitDiskSizeLimit()).
+    kpCommandSize::SizeType spilledSize (kpCommand *command) const;
+
+    void deleteCommand (kpCommand *command);
+    void clearCommandList (QLinkedList <kpCommand *> *commandList);
+
 public:
     kpCommand *nextUndoCommand () const;
     kpCommand *nextRedoCommand () const;
@@ -138,6 +188,7 @@ protected:
 
     int m_undoMinLimit, m_undoMaxLimit;
     kpCommandSize::SizeType m_undoMaxLimitSizeLimit;
+    kpCommandSize::SizeType m_undoMaxLimitDiskSizeLimit;
 
     // What you have to do to get back to the document's unmodified state:
     // * -x: must Undo x times
@@ -30,6 +30,8 @@
 
 
 #include "commands/kpCommandSize.h"
+#include "imagelib/kpCompressedImage.h"
+#include "imagelib/kpImageDelta.h"
 #include "layers/selections/kpAbstractSelection.h"
 
 #include <QImage>
@@ -112,6 +114,30 @@ kpCommandSize::SizeType kpCommandSize::ImageSize (const kpImage *image)
     return kpCommandSize::PixmapSize (image);
 }
 
+// public static
+kpCommandSize::SizeType kpCommandSize::ImageSize (const kpCompressedImage &image)
+{
+    return static_cast<kpCommandSize::SizeType> (image.byteCount ());
+}
+
+// public static
+kpCommandSize::SizeType kpCommandSize::ImageSize (const kpImageDelta &delta)
+{
+    return static_cast<kpCommandSize::SizeType> (delta.byteCount ());
+}
+
+// public static
+kpCommandSize::SizeType kpCommandSize::SpilledImageSize (const kpCompressedImage &image)
+{
+    return static_cast<kpCommandSize::SizeType> (image.spilledByteCount ());
+}
+
+// public static
+kpCommandSize::SizeType kpCommandSize::SpilledImageSize (const kpImageDelta &delta)
+{
+    return static_cast<kpCommandSize::SizeType> (delta.spilledByteCount ());
+}
+
 
 // public static
 kpCommandSize::SizeType kpCommandSize::SelectionSize (const kpAbstractSelection &sel)
@@ -38,6 +38,8 @@ class QPolygon;
 class QString;
 
 class kpAbstractSelection;
+class kpCompressedImage;
+class kpImageDelta;
 
 
 //
@@ -74,6 +76,12 @@ public:
 
     static SizeType ImageSize (const kpImage &image);
     static SizeType ImageSize (const kpImage *image);
+    // (what is actually held, not the size of the decompressed image)
+    static SizeType ImageSize (const kpCompressedImage &image);
+    static SizeType ImageSize (const kpImageDelta &delta);
+    // (what has been moved to a kpSpillFile)
+    static SizeType SpilledImageSize (const kpCompressedImage &image);
+    static SizeType SpilledImageSize (const kpImageDelta &delta);
 
     static SizeType SelectionSize (const kpAbstractSelection &sel);
     static SizeType SelectionSize (const kpAbstractSelection *sel);
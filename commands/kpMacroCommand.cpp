@@ -87,6 +87,27 @@ kpCommandSize::SizeType kpMacroCommand::size () const
 
 //---------------------------------------------------------------------
 
+// public virtual [base kpCommand]
+void kpMacroCommand::spill (kpSpillFile *file)
+{
+    foreach (kpCommand *cmd, m_commandList) {
+        cmd->spill (file);
+    }
+}
+
+// public virtual [base kpCommand]
+kpCommandSize::SizeType kpMacroCommand::spilledSize () const
+{
+    SizeType s = 0;
+    foreach (kpCommand *cmd, m_commandList) {
+        s += cmd->spilledSize ();
+    }
+
+    return s;
+}
+
+//---------------------------------------------------------------------
+
 // public virtual [base kpCommand]
 void kpMacroCommand::execute ()
 {
@@ -48,6 +48,9 @@ public:
 
     SizeType size () const override;
 
+    void spill (kpSpillFile *file) override;
+    SizeType spilledSize () const override;
+
     void execute () override;
     void unexecute () override;
 
@@ -33,8 +33,9 @@
 
 #include "document/kpDocument.h"
 #include "imagelib/kpImage.h"
+#include "imagelib/kpImageDelta.h"
+#include "imagelib/kpSavedImageTiles.h"
 #include "pixmapfx/kpPixmapFX.h"
-#include "tools/kpTool.h"
 #include "views/manager/kpViewManager.h"
 
 #include <QRect>
@@ -42,7 +43,13 @@
 
 struct kpToolFlowCommandPrivate
 {
-    kpImage image;
+    // The tiles of the document image that the stroke draws on, from
+    // before it did, until finalize().
+    kpSavedImageTiles oldTiles;
+
+    // The pixels changed by the stroke, from finalize(): their old values
+    // while executed and their new values while unexecuted.
+    kpImageDelta changedPixels;
     QRect boundingRect;
 };
 
@@ -51,7 +58,6 @@ kpToolFlowCommand::kpToolFlowCommand (const QString &name, kpCommandEnvironment
     : kpNamedCommand (name, environ),
       d (new kpToolFlowCommandPrivate ())
 {
-    d->image = document ()->image ();
 }
 
 kpToolFlowCommand::~kpToolFlowCommand ()
@@ -63,7 +69,19 @@ kpToolFlowCommand::~kpToolFlowCommand ()
 // public virtual [base kpCommand]
 kpCommandSize::SizeType kpToolFlowCommand::size () const
 {
-    return ImageSize (d->image);
+    return ImageSize (d->changedPixels);
+}
+
+// public virtual [base kpCommand]
+void kpToolFlowCommand::spill (kpSpillFile *file)
+{
+    d->changedPixels.spill (file);
+}
+
+// public virtual [base kpCommand]
+kpCommandSize::SizeType kpToolFlowCommand::spilledSize () const
+{
+    return kpCommandSize::SpilledImageSize (d->changedPixels);
 }
 
 
@@ -83,16 +101,19 @@ void kpToolFlowCommand::unexecute ()
 // private
 void kpToolFlowCommand::swapOldAndNew ()
 {
-    if (d->boundingRect.isValid ())
+    if (!d->changedPixels.isNull ())
     {
-        const kpImage oldImage = document ()->getImageAt (d->boundingRect);
-
-        document ()->setImageAt (d->image, d->boundingRect.topLeft ());
-
-        d->image = oldImage;
+        d->changedPixels.swap (document ()->imagePointer ());
+        document ()->slotContentsChanged (d->changedPixels.rect ());
     }
 }
 
+// public
+void kpToolFlowCommand::saveOldPixels (const QRect &rect)
+{
+    d->oldTiles.saveTiles (*document ()->imagePointer (), rect);
+}
+
 // public
 void kpToolFlowCommand::updateBoundingRect (const QPoint &point)
 {
@@ -119,22 +140,27 @@ void kpToolFlowCommand::finalize ()
 {
     if (d->boundingRect.isValid ())
     {
-        // Store only the needed part of doc image.
-        d->image = kpTool::neededPixmap (d->image, d->boundingRect);
+        // Store only the pixels that the stroke changed.
+        d->changedPixels = kpImageDelta (
+            d->oldTiles.copy (d->boundingRect, *document ()->imagePointer ()),
+            document ()->getImageAt (d->boundingRect),
+            d->boundingRect.topLeft ());
     }
     else
     {
-        d->image = kpImage ();
+        d->changedPixels = kpImageDelta ();
     }
+
+    d->oldTiles = kpSavedImageTiles ();
 }
 
 // public
 void kpToolFlowCommand::cancel ()
 {
-    if (d->boundingRect.isValid ())
+    if (!d->changedPixels.isNull ())
     {
         viewManager ()->setFastUpdates ();
-        document ()->setImageAt (d->image, d->boundingRect.topLeft ());
+        swapOldAndNew ();
         viewManager ()->restoreFastUpdates ();
     }
 }
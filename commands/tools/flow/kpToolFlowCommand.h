@@ -44,11 +44,17 @@ public:
     ~kpToolFlowCommand () override;
 
     kpCommandSize::SizeType size () const override;
+    void spill (kpSpillFile *file) override;
+    SizeType spilledSize () const override;
 
     void execute () override;
     void unexecute () override;
 
     // interface for kpToolFlowBase
+
+    // Must be called with every rect of the document, before drawing on it.
+    void saveOldPixels (const QRect &rect);
+
     void updateBoundingRect (const QPoint &point);
     void updateBoundingRect (const QRect &rect);
     void finalize ();
@@ -34,6 +34,7 @@
 #include "imagelib/kpColor.h"
 #include "kpDefs.h"
 #include "document/kpDocument.h"
+#include "imagelib/kpCompressedImage.h"
 #include "imagelib/kpImage.h"
 #include "kpLogCategories.h"
 
@@ -45,7 +46,8 @@
 
 struct kpToolFloodFillCommandPrivate
 {
-    kpImage oldImage;
+    // Only used if kpFloodFill::saveChangedPixels() can't save the pixels.
+    kpCompressedImage oldImage;
     bool fillEntireImage{false};
 };
 
@@ -53,10 +55,12 @@ struct kpToolFloodFillCommandPrivate
 
 kpToolFloodFillCommand::kpToolFloodFillCommand (int x, int y,
         const kpColor &color, int processedColorSimilarity,
+        bool contiguous,
         kpCommandEnvironment *environ)
 
     : kpCommand (environ),
-      kpFloodFill (document ()->imagePointer (), x, y, color, processedColorSimilarity),
+      kpFloodFill (document ()->imagePointer (), x, y, color, processedColorSimilarity,
+                   contiguous),
       d (new kpToolFloodFillCommandPrivate ())
 {
     d->fillEntireImage = false;
@@ -74,7 +78,7 @@ kpToolFloodFillCommand::~kpToolFloodFillCommand ()
 // public virtual [base kpCommand]
 QString kpToolFloodFillCommand::name () const
 {
-    return i18n ("Flood Fill");
+    return kpFloodFill::isContiguous () ? i18n ("Flood Fill") : i18n ("Replace Color");
 }
 
 //---------------------------------------------------------------------
@@ -85,6 +89,18 @@ kpCommandSize::SizeType kpToolFloodFillCommand::size () const
     return kpFloodFill::size () + ImageSize (d->oldImage);
 }
 
+// public virtual [base kpCommand]
+void kpToolFloodFillCommand::spill (kpSpillFile *file)
+{
+    d->oldImage.spill (file);
+}
+
+// public virtual [base kpCommand]
+kpCommandSize::SizeType kpToolFloodFillCommand::spilledSize () const
+{
+    return kpCommandSize::SpilledImageSize (d->oldImage);
+}
+
 //---------------------------------------------------------------------
 
 // public
@@ -118,7 +134,9 @@ void kpToolFloodFillCommand::execute ()
         {
             QApplication::setOverrideCursor (Qt::WaitCursor);
             {
-                d->oldImage = doc->getImageAt (rect);
+                if (!kpFloodFill::saveChangedPixels ()) {
+                    d->oldImage = doc->getImageAt (rect);
+                }
 
                 kpFloodFill::fill ();
                 doc->slotContentsChanged (rect);
@@ -157,9 +175,16 @@ void kpToolFloodFillCommand::unexecute ()
         QRect rect = kpFloodFill::boundingRect ();
         if (rect.isValid ())
         {
-            doc->setImageAt (d->oldImage, rect.topLeft ());
+            if (d->oldImage.isNull ())
+            {
+                kpFloodFill::restoreChangedPixels ();
+            }
+            else
+            {
+                doc->setImageAt (d->oldImage.image (), rect.topLeft ());
 
-            d->oldImage = kpImage ();
+                d->oldImage = kpCompressedImage ();
+            }
 
             doc->slotContentsChanged (rect);
         }
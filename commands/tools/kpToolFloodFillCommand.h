@@ -43,14 +43,18 @@ struct kpToolFloodFillCommandPrivate;
 class kpToolFloodFillCommand : public kpCommand, public kpFloodFill
 {
 public:
+    // See kpFloodFill for <contiguous>.
     kpToolFloodFillCommand (int x, int y,
                             const kpColor &color, int processedColorSimilarity,
+                            bool contiguous,
                             kpCommandEnvironment *environ);
     ~kpToolFloodFillCommand () override;
 
     QString name () const override;
 
     kpCommandSize::SizeType size () const override;
+    void spill (kpSpillFile *file) override;
+    SizeType spilledSize () const override;
 
     // Optimization hack: filling a fresh, unmodified document does not require
     //                    reading any pixels - just set the whole document to
@@ -34,6 +34,7 @@
 #include "document/kpDocument.h"
 #include "kpDefs.h"
 #include "imagelib/kpImage.h"
+#include "imagelib/kpImageDelta.h"
 #include "tools/polygonal/kpToolPolygonalBase.h"
 
 
@@ -48,7 +49,9 @@ struct kpToolPolygonalCommandPrivate
     int penWidth{};
     kpColor bcolor;
 
-    kpImage oldImage;
+    // The pixels changed by the shape: their old values while executed and
+    // their new values while unexecuted.
+    kpImageDelta changedPixels;
 };
 
 kpToolPolygonalCommand::kpToolPolygonalCommand (const QString &name,
@@ -82,7 +85,19 @@ kpToolPolygonalCommand::~kpToolPolygonalCommand ()
 kpCommandSize::SizeType kpToolPolygonalCommand::size () const
 {
     return PolygonSize (d->points) +
-           ImageSize (d->oldImage);
+           ImageSize (d->changedPixels);
+}
+
+// public virtual [base kpCommand]
+void kpToolPolygonalCommand::spill (kpSpillFile *file)
+{
+    d->changedPixels.spill (file);
+}
+
+// public virtual [base kpCommand]
+kpCommandSize::SizeType kpToolPolygonalCommand::spilledSize () const
+{
+    return kpCommandSize::SpilledImageSize (d->changedPixels);
 }
 
 // public virtual [base kpCommand]
@@ -91,12 +106,18 @@ void kpToolPolygonalCommand::execute ()
     kpDocument *doc = document ();
     Q_ASSERT (doc);
 
-    // Store Undo info.
-    Q_ASSERT (d->oldImage.isNull ());
-    d->oldImage = doc->getImageAt (d->boundingRect);
+    // Redo?
+    if (!d->changedPixels.isNull ())
+    {
+        d->changedPixels.swap (doc->imagePointer ());
+        doc->slotContentsChanged (d->changedPixels.rect ());
+        return;
+    }
+
+    const kpImage oldImage = doc->getImageAt (d->boundingRect);
 
     // Invoke shape drawing function passed in ctor.
-    kpImage image = d->oldImage;
+    kpImage image = oldImage;
 
     QPolygon pointsTranslated = d->points;
     pointsTranslated.translate (-d->boundingRect.x (), -d->boundingRect.y ());
@@ -107,6 +128,9 @@ void kpToolPolygonalCommand::execute ()
         d->bcolor,
         true/*final shape*/);
 
+    // Store Undo info.
+    d->changedPixels = kpImageDelta (oldImage, image, d->boundingRect.topLeft ());
+
     doc->setImageAt (image, d->boundingRect.topLeft ());
 }
 
@@ -116,9 +140,10 @@ void kpToolPolygonalCommand::unexecute ()
     kpDocument *doc = document ();
     Q_ASSERT (doc);
 
-    Q_ASSERT (!d->oldImage.isNull ());
-    doc->setImageAt (d->oldImage, d->boundingRect.topLeft ());
-
-    d->oldImage = kpImage ();
+    if (!d->changedPixels.isNull ())
+    {
+        d->changedPixels.swap (doc->imagePointer ());
+        doc->slotContentsChanged (d->changedPixels.rect ());
+    }
 }
 
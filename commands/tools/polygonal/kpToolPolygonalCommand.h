@@ -55,6 +55,8 @@ public:
     ~kpToolPolygonalCommand () override;
 
     kpCommandSize::SizeType size () const override;
+    void spill (kpSpillFile *file) override;
+    SizeType spilledSize () const override;
 
     void execute () override;
     void unexecute () override;
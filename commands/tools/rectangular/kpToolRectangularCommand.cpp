@@ -34,6 +34,7 @@
 #include "imagelib/kpColor.h"
 #include "kpDefs.h"
 #include "document/kpDocument.h"
+#include "imagelib/kpImageDelta.h"
 #include "imagelib/kpPainter.h"
 #include "pixmapfx/kpPixmapFX.h"
 #include "layers/tempImage/kpTempImage.h"
@@ -55,7 +56,9 @@ struct kpToolRectangularCommandPrivate
     int penWidth{};
     kpColor bcolor;
 
-    kpImage oldImage;
+    // The pixels changed by the shape: their old values while executed and
+    // their new values while unexecuted.
+    kpImageDelta changedPixels;
 };
 
 kpToolRectangularCommand::kpToolRectangularCommand (const QString &name,
@@ -86,7 +89,19 @@ kpToolRectangularCommand::~kpToolRectangularCommand ()
 // public virtual [base kpCommand]
 kpCommandSize::SizeType kpToolRectangularCommand::size () const
 {
-    return ImageSize (d->oldImage);
+    return ImageSize (d->changedPixels);
+}
+
+// public virtual [base kpCommand]
+void kpToolRectangularCommand::spill (kpSpillFile *file)
+{
+    d->changedPixels.spill (file);
+}
+
+// public virtual [base kpCommand]
+kpCommandSize::SizeType kpToolRectangularCommand::spilledSize () const
+{
+    return kpCommandSize::SpilledImageSize (d->changedPixels);
 }
 
 
@@ -96,19 +111,26 @@ void kpToolRectangularCommand::execute ()
     kpDocument *doc = document ();
     Q_ASSERT (doc);
 
-    // Store Undo info.
-    // OPT: For a pure rectangle, can do better if there is no bcolor, by only
-    //      saving 4 pixmaps corresponding to the pixels dirtied by the 4 edges.
-    Q_ASSERT (d->oldImage.isNull ());
-    d->oldImage = doc->getImageAt (d->rect);
+    // Redo?
+    if (!d->changedPixels.isNull ())
+    {
+        d->changedPixels.swap (doc->imagePointer ());
+        doc->slotContentsChanged (d->changedPixels.rect ());
+        return;
+    }
+
+    const kpImage oldImage = doc->getImageAt (d->rect);
 
     // Invoke shape drawing function passed in ctor.
-    kpImage image = d->oldImage;
+    kpImage image = oldImage;
     (*d->drawShapeFunc) (&image,
         0, 0, d->rect.width (), d->rect.height (),
         d->fcolor, d->penWidth,
         d->bcolor);
 
+    // Store Undo info.
+    d->changedPixels = kpImageDelta (oldImage, image, d->rect.topLeft ());
+
     doc->setImageAt (image, d->rect.topLeft ());
 }
 
@@ -118,9 +140,10 @@ void kpToolRectangularCommand::unexecute ()
     kpDocument *doc = document ();
     Q_ASSERT (doc);
 
-    Q_ASSERT (!d->oldImage.isNull ());
-    doc->setImageAt (d->oldImage, d->rect.topLeft ());
-
-    d->oldImage = kpImage ();
+    if (!d->changedPixels.isNull ())
+    {
+        d->changedPixels.swap (doc->imagePointer ());
+        doc->slotContentsChanged (d->changedPixels.rect ());
+    }
 }
 
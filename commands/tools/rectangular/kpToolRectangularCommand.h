@@ -49,6 +49,8 @@ public:
     ~kpToolRectangularCommand () override;
 
     kpCommandSize::SizeType size () const override;
+    void spill (kpSpillFile *file) override;
+    SizeType spilledSize () const override;
 
     void execute () override;
     void unexecute () override;
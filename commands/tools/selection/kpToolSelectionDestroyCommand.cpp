@@ -67,6 +67,18 @@ kpCommandSize::SizeType kpToolSelectionDestroyCommand::size () const
            SelectionSize (m_oldSelectionPtr);
 }
 
+// public virtual [base kpCommand]
+void kpToolSelectionDestroyCommand::spill (kpSpillFile *file)
+{
+    m_oldDocImage.spill (file);
+}
+
+// public virtual [base kpCommand]
+kpCommandSize::SizeType kpToolSelectionDestroyCommand::spilledSize () const
+{
+    return kpCommandSize::SpilledImageSize (m_oldDocImage);
+}
+
 //---------------------------------------------------------------------
 
 // public virtual [base kpCommand]
@@ -132,7 +144,7 @@ void kpToolSelectionDestroyCommand::unexecute ()
     #if DEBUG_KP_TOOL_SELECTION
         qCDebug(kpLogCommands) << "\tunpush oldDocImage onto doc first";
     #endif
-        doc->setImageAt (m_oldDocImage, m_oldSelectionPtr->topLeft ());
+        doc->setImageAt (m_oldDocImage.image (), m_oldSelectionPtr->topLeft ());
     }
 
 #if DEBUG_KP_TOOL_SELECTION
@@ -30,7 +30,7 @@
 #define kpToolSelectionDestroyCommand_H
 
 
-#include "imagelib/kpImage.h"
+#include "imagelib/kpCompressedImage.h"
 #include "commands/kpNamedCommand.h"
 
 
@@ -45,13 +45,15 @@ public:
     ~kpToolSelectionDestroyCommand () override;
 
     kpCommandSize::SizeType size () const override;
+    void spill (kpSpillFile *file) override;
+    SizeType spilledSize () const override;
 
     void execute () override;
     void unexecute () override;
 
 private:
     bool m_pushOntoDocument;
-    kpImage m_oldDocImage;
+    kpCompressedImage m_oldDocImage;
     kpAbstractSelection *m_oldSelectionPtr;
 
     int m_textRow, m_textCol;
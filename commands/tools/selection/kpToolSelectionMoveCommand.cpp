@@ -35,7 +35,6 @@
 #include "environments/commands/kpCommandEnvironment.h"
 #include "kpDefs.h"
 #include "document/kpDocument.h"
-#include "tools/kpTool.h"
 #include "widgets/toolbars/options/kpToolWidgetOpaqueOrTransparent.h"
 #include "views/manager/kpViewManager.h"
 
@@ -78,6 +77,18 @@ kpCommandSize::SizeType kpToolSelectionMoveCommand::size () const
            PolygonSize (m_copyOntoDocumentPoints);
 }
 
+// public virtual [base kpCommand]
+void kpToolSelectionMoveCommand::spill (kpSpillFile *file)
+{
+    m_oldDocumentImage.spill (file);
+}
+
+// public virtual [base kpCommand]
+kpCommandSize::SizeType kpToolSelectionMoveCommand::spilledSize () const
+{
+    return kpCommandSize::SpilledImageSize (m_oldDocumentImage);
+}
+
 
 // public virtual [base kpCommand]
 void kpToolSelectionMoveCommand::execute ()
@@ -131,7 +142,7 @@ void kpToolSelectionMoveCommand::unexecute ()
     vm->setQueueUpdates ();
 
     if (!m_oldDocumentImage.isNull ()) {
-        doc->setImageAt (m_oldDocumentImage, m_documentBoundingRect.topLeft ());
+        doc->setImageAt (m_oldDocumentImage.image (), m_documentBoundingRect.topLeft ());
     }
 
 #if DEBUG_KP_TOOL_SELECTION && 1
@@ -192,13 +203,13 @@ void kpToolSelectionMoveCommand::copyOntoDocument ()
     // to be consistent with the requirement on other selection operations.
     Q_ASSERT (sel && sel->hasContent ());
 
-    if (m_oldDocumentImage.isNull ()) {
-        m_oldDocumentImage = doc->image ();
-    }
-
     QRect selBoundingRect = sel->boundingRect ();
     m_documentBoundingRect = m_documentBoundingRect.united (selBoundingRect);
 
+    if (m_oldDocumentImage.isNull ()) {
+        m_oldDocumentTiles.saveTiles (*doc->imagePointer (), selBoundingRect);
+    }
+
     doc->selectionCopyOntoDocument ();
 
     m_copyOntoDocumentPoints.putPoints (m_copyOntoDocumentPoints.count (),
@@ -210,10 +221,12 @@ void kpToolSelectionMoveCommand::copyOntoDocument ()
 // public
 void kpToolSelectionMoveCommand::finalize ()
 {
-    if (!m_oldDocumentImage.isNull () && !m_documentBoundingRect.isNull ())
+    if (m_oldDocumentImage.isNull () && !m_documentBoundingRect.isNull ())
     {
-        m_oldDocumentImage = kpTool::neededPixmap (m_oldDocumentImage,
-                                                    m_documentBoundingRect);
+        m_oldDocumentImage = m_oldDocumentTiles.copy (m_documentBoundingRect,
+            *document ()->imagePointer ());
     }
+
+    m_oldDocumentTiles = kpSavedImageTiles ();
 }
 
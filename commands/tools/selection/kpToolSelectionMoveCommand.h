@@ -34,7 +34,8 @@
 #include <QPolygon>
 #include <QRect>
 
-#include "imagelib/kpImage.h"
+#include "imagelib/kpCompressedImage.h"
+#include "imagelib/kpSavedImageTiles.h"
 #include "commands/kpNamedCommand.h"
 
 
@@ -50,6 +51,8 @@ public:
     kpAbstractSelection *originalSelectionClone () const;
 
     kpCommandSize::SizeType size () const override;
+    void spill (kpSpillFile *file) override;
+    SizeType spilledSize () const override;
 
     void execute () override;
     void unexecute () override;
@@ -62,7 +65,11 @@ public:
 private:
     QPoint m_startPoint, m_endPoint;
 
-    kpImage m_oldDocumentImage;
+    // The tiles of the document image under each copyOntoDocument(), saved
+    // before they are first drawn on, until finalize() keeps just the part
+    // in <m_documentBoundingRect> in <m_oldDocumentImage>.
+    kpSavedImageTiles m_oldDocumentTiles;
+    kpCompressedImage m_oldDocumentImage;
 
     // area of document affected (not the bounding rect of the sel)
     QRect m_documentBoundingRect;
@@ -32,6 +32,7 @@
 #include "kpEffectsDialog.h"
 
 #include "kpDefs.h"
+#include "commands/imagelib/effects/kpEffectPipelineCommand.h"
 #include "document/kpDocument.h"
 #include "widgets/imagelib/effects/kpEffectBalanceWidget.h"
 #include "widgets/imagelib/effects/kpEffectBlurSharpenWidget.h"
@@ -52,6 +53,8 @@
 #include <QGroupBox>
 #include <QLabel>
 #include <QLayout>
+#include <QPushButton>
+#include <QStandardItemModel>
 #include <QTimer>
 #include <QImage>
 
@@ -61,6 +64,24 @@ int kpEffectsDialog::s_lastWidth = 640;
 int kpEffectsDialog::s_lastHeight = 620;
 
 
+// Returns whether effect <which> (in the order of the effects combo box) is
+// per-pixel, so can be chained with kpEffectPipeline.
+static bool IsPipelineEffect (int which)
+{
+    // sync: order in kpEffectsDialog constructor.
+    switch (which)
+    {
+    case 0:  // Balance
+    case 4:  // Hue, Saturation, Value
+    case 5:  // Invert
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+
 kpEffectsDialog::kpEffectsDialog (bool actOnSelection,
                                   kpTransformDialogEnvironment *_env,
                                   QWidget *parent,
@@ -74,6 +95,8 @@ kpEffectsDialog::kpEffectsDialog (bool actOnSelection,
                            parent),
       m_delayedUpdateTimer (new QTimer (this)),
       m_effectsComboBox (nullptr),
+      m_addToChainButton (nullptr),
+      m_chainLabel (nullptr),
       m_settingsGroupBox (nullptr),
       m_settingsLayout (nullptr),
       m_effectWidget (nullptr)
@@ -100,9 +123,11 @@ kpEffectsDialog::kpEffectsDialog (bool actOnSelection,
 
     QWidget *effectContainer = new QWidget (mainWidget ());
 
-    auto *containerLayout = new QHBoxLayout (effectContainer);
+    auto *containerLayout = new QVBoxLayout (effectContainer);
     containerLayout->setContentsMargins(0, 0, 0, 0);
 
+    auto *effectLayout = new QHBoxLayout ();
+
     QLabel *label = new QLabel (i18n ("&Effect:"), effectContainer);
 
     m_effectsComboBox = new QComboBox (effectContainer);
@@ -118,8 +143,20 @@ kpEffectsDialog::kpEffectsDialog (bool actOnSelection,
     m_effectsComboBox->addItem (i18n ("Reduce Colors"));
     m_effectsComboBox->addItem (i18n ("Soften & Sharpen"));
 
-    containerLayout->addWidget (label);
-    containerLayout->addWidget (m_effectsComboBox, 1);
+    m_addToChainButton = new QPushButton (i18n ("&Then..."), effectContainer);
+    m_addToChainButton->setToolTip (
+        i18n ("Keep this effect and add another one after it."
+              " They are applied together, as a single step."));
+
+    effectLayout->addWidget (label);
+    effectLayout->addWidget (m_effectsComboBox, 1);
+    effectLayout->addWidget (m_addToChainButton);
+    containerLayout->addLayout (effectLayout);
+
+    m_chainLabel = new QLabel (effectContainer);
+    m_chainLabel->setWordWrap (true);
+    m_chainLabel->hide ();
+    containerLayout->addWidget (m_chainLabel);
 
     label->setBuddy (m_effectsComboBox);
 
@@ -133,6 +170,8 @@ kpEffectsDialog::kpEffectsDialog (bool actOnSelection,
 
     connect (m_effectsComboBox, static_cast<void (QComboBox::*)(int)>(&QComboBox::activated),
              this, &kpEffectsDialog::selectEffect);
+    connect (m_addToChainButton, &QPushButton::clicked,
+             this, &kpEffectsDialog::slotAddToChain);
 
 
     selectEffect (defaultSelectedEffect);
@@ -164,6 +203,10 @@ kpEffectsDialog::~kpEffectsDialog ()
 // public virtual [base kpTransformPreviewDialog]
 bool kpEffectsDialog::isNoOp () const
 {
+    if (!m_chain.isEmpty ()) {
+        return false;
+    }
+
     if (!m_effectWidget) {
         return true;
     }
@@ -174,6 +217,20 @@ bool kpEffectsDialog::isNoOp () const
 // public
 kpEffectCommandBase *kpEffectsDialog::createCommand () const
 {
+    if (!m_chain.isEmpty ())
+    {
+        QStringList names = m_chainEffectNames;
+        if (m_effectWidget && !m_effectWidget->isNoOp ()) {
+            names.append (m_effectsComboBox->currentText ());
+        }
+
+        return new kpEffectPipelineCommand (
+            names.join (i18nc ("@item:intext separator between effect names", ", ")),
+            pipeline (),
+            m_actOnSelection,
+            m_environ->commandEnvironment ());
+    }
+
     if (!m_effectWidget) {
         return nullptr;
     }
@@ -182,6 +239,19 @@ kpEffectCommandBase *kpEffectsDialog::createCommand () const
 }
 
 
+// protected
+kpEffectPipeline kpEffectsDialog::pipeline () const
+{
+    kpEffectPipeline ret = m_chain;
+
+    if (m_effectWidget && !m_effectWidget->isNoOp ()) {
+        m_effectWidget->addToPipeline (&ret);
+    }
+
+    return ret;
+}
+
+
 // protected virtual [base kpTransformPreviewDialog]
 QSize kpEffectsDialog::newDimensions () const
 {
@@ -194,19 +264,27 @@ QSize kpEffectsDialog::newDimensions () const
 }
 
 // protected virtual [base kpTransformPreviewDialog]
-QImage kpEffectsDialog::transformPixmap (const QImage &pixmap,
-                                         int targetWidth, int targetHeight) const
+kpPreviewRenderer::RenderFunction kpEffectsDialog::transformFunction () const
 {
-    QImage pixmapWithEffect;
+    kpEffectWidgetBase::EffectFunction effect;
 
-    if (m_effectWidget && !m_effectWidget->isNoOp ()) {
-        pixmapWithEffect = m_effectWidget->applyEffect (pixmap);
+    if (!m_chain.isEmpty ())
+    {
+        const kpEffectPipeline pipeline = this->pipeline ();
+        effect = [pipeline] (const kpImage &image)
+        {
+            return pipeline.apply (image);
+        };
     }
-    else {
-        pixmapWithEffect = pixmap;
+    else if (m_effectWidget && !m_effectWidget->isNoOp ()) {
+        effect = m_effectWidget->effectFunction ();
     }
 
-    return kpPixmapFX::scale (pixmapWithEffect, targetWidth, targetHeight);
+    return [effect] (const QImage &pixmap, int targetWidth, int targetHeight)
+    {
+        const QImage pixmapWithEffect = effect ? effect (pixmap) : pixmap;
+        return kpPixmapFX::scale (pixmapWithEffect, targetWidth, targetHeight);
+    };
 }
 
 
@@ -279,6 +357,8 @@ void kpEffectsDialog::selectEffect (int which)
     }
 #undef CREATE_EFFECT_WIDGET
 
+    m_addToChainButton->setEnabled (::IsPipelineEffect (which));
+
 
     if (m_effectWidget)
     {
@@ -370,3 +450,38 @@ void kpEffectsDialog::slotDelayedUpdate ()
 }
 
 
+// protected slot
+void kpEffectsDialog::slotAddToChain ()
+{
+#if DEBUG_KP_EFFECTS_DIALOG
+    qCDebug(kpLogDialogs) << "kpEffectsDialog::slotAddToChain()"
+               << " effect=" << selectedEffect ();
+#endif
+
+    if (!m_effectWidget || m_effectWidget->isNoOp ()) {
+        return;
+    }
+
+    if (!m_effectWidget->addToPipeline (&m_chain)) {
+        return;
+    }
+
+    m_chainEffectNames.append (m_effectsComboBox->currentText ());
+
+    m_chainLabel->setText (i18n ("Before this effect: %1",
+        m_chainEffectNames.join (i18nc ("@item:intext separator between effect names", ", "))));
+    m_chainLabel->show ();
+
+    // The rest of the effects can't be applied in the same pass.
+    auto *model = qobject_cast <QStandardItemModel *> (m_effectsComboBox->model ());
+    if (model)
+    {
+        for (int i = 0; i < m_effectsComboBox->count (); i++) {
+            model->item (i)->setEnabled (::IsPipelineEffect (i));
+        }
+    }
+
+    // Start the next effect from its default settings (this also updates
+    // the preview).
+    selectEffect (selectedEffect ());
+}
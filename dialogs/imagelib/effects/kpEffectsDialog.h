@@ -30,12 +30,17 @@
 #define KP_EFFECTS_DIALOG_H
 
 
+#include <QStringList>
+
 #include "dialogs/imagelib/transforms/kpTransformPreviewDialog.h"
+#include "imagelib/effects/kpEffectPipeline.h"
 
 
 class QComboBox;
 class QGroupBox;
 class QImage;
+class QLabel;
+class QPushButton;
 class QTimer;
 class QVBoxLayout;
 
@@ -61,8 +66,7 @@ public:
 
 protected:
     QSize newDimensions () const override;
-    QImage transformPixmap (const QImage &pixmap,
-                                     int targetWidth, int targetHeight) const override;
+    kpPreviewRenderer::RenderFunction transformFunction () const override;
 
 public:
     int selectedEffect () const;
@@ -75,16 +79,29 @@ protected slots:
 
     void slotDelayedUpdate ();
 
+    // Adds the current effect to the chain and starts on the next one.
+    void slotAddToChain ();
+
 protected:
+    // Returns the chain, followed by the current effect.
+    kpEffectPipeline pipeline () const;
+
     static int s_lastWidth, s_lastHeight;
 
     QTimer *m_delayedUpdateTimer;
 
     QComboBox *m_effectsComboBox;
+    QPushButton *m_addToChainButton;
+    QLabel *m_chainLabel;
     QGroupBox *m_settingsGroupBox;
     QVBoxLayout *m_settingsLayout;
 
     kpEffectWidgetBase *m_effectWidget;
+
+    // The per-pixel effects to apply, in a single pass, before the current
+    // one (see kpEffectPipeline).
+    kpEffectPipeline m_chain;
+    QStringList m_chainEffectNames;
 };
 
 
@@ -66,6 +66,7 @@ kpTransformPreviewDialog::kpTransformPreviewDialog (Features features,
       m_afterTransformDimensionsLabel (nullptr),
       m_previewGroupBox (nullptr),
       m_previewPixmapLabel (nullptr),
+      m_previewRenderer (nullptr),
       m_gridLayout (nullptr),
       m_environ (_env)
 {
@@ -177,6 +178,10 @@ void kpTransformPreviewDialog::createPreviewGroupBox ()
     connect (m_previewPixmapLabel, &kpResizeSignallingLabel::resized,
              this, &kpTransformPreviewDialog::updatePreview);
 
+    m_previewRenderer = new kpPreviewRenderer (this);
+    connect (m_previewRenderer, &kpPreviewRenderer::rendered,
+             this, &kpTransformPreviewDialog::slotPreviewRendered);
+
     QPushButton *updatePushButton = new QPushButton (i18n ("&Update"),
                                                      m_previewGroupBox);
     connect (updatePushButton, &QPushButton::clicked,
@@ -314,6 +319,13 @@ void kpTransformPreviewDialog::updateShrunkenDocumentPixmap ()
                                                m_oldWidth,
                                                m_oldHeight);
 
+        const int shrunkenWidth = scaleDimension (m_oldWidth,
+            keepsAspectScale,
+            1, m_previewPixmapLabel->width ());
+        const int shrunkenHeight = scaleDimension (m_oldHeight,
+            keepsAspectScale,
+            1, m_previewPixmapLabel->height ());
+
         kpImage image;
 
         if (m_actOnSelection)
@@ -328,17 +340,13 @@ void kpTransformPreviewDialog::updateShrunkenDocumentPixmap ()
         }
         else
         {
-            image = doc->image ();
+            // Start from the cached shrunken copy of the document that's
+            // closest to the preview size, instead of the whole image.
+            image = doc->imagePyramidLevel (shrunkenWidth, shrunkenHeight);
         }
 
         m_shrunkenDocumentPixmap = kpPixmapFX::scale (
-            image,
-            scaleDimension (m_oldWidth,
-                            keepsAspectScale,
-                            1, m_previewPixmapLabel->width ()),
-            scaleDimension (m_oldHeight,
-                            keepsAspectScale,
-                            1, m_previewPixmapLabel->height ()));
+            image, shrunkenWidth, shrunkenHeight);
 
         m_previewPixmapLabelSizeWhenUpdatedPixmap = m_previewPixmapLabel->size ();
     }
@@ -391,21 +399,30 @@ void kpTransformPreviewDialog::updatePreview ()
                                            1,  // min
                                            m_previewPixmapLabel->height ());  // max
 
-        // TODO: Some effects work directly on QImage; so could cache the
-        //       QImage so that transformPixmap() is faster
-        QImage transformedShrunkenDocumentPixmap =
-            transformPixmap (m_shrunkenDocumentPixmap, targetWidth, targetHeight);
+        // (shows the result in slotPreviewRendered())
+        m_previewRenderer->render (m_shrunkenDocumentPixmap,
+            targetWidth, targetHeight,
+            transformFunction ());
+
+        m_previewPixmapLabel->setCursor (Qt::BusyCursor);
+    }
+}
 
-        QImage previewPixmap (m_previewPixmapLabel->width (),
-                              m_previewPixmapLabel->height (), QImage::Format_ARGB32_Premultiplied);
-        previewPixmap.fill(QColor(Qt::transparent).rgba());
-        kpPixmapFX::setPixmapAt (&previewPixmap,
-                                 (previewPixmap.width () - transformedShrunkenDocumentPixmap.width ()) / 2,
-                                 (previewPixmap.height () - transformedShrunkenDocumentPixmap.height ()) / 2,
-                                 transformedShrunkenDocumentPixmap);
+// private slot
+void kpTransformPreviewDialog::slotPreviewRendered (
+        const QImage &transformedShrunkenDocumentPixmap, bool isFinal)
+{
+    QImage previewPixmap (m_previewPixmapLabel->width (),
+                          m_previewPixmapLabel->height (), QImage::Format_ARGB32_Premultiplied);
+    previewPixmap.fill(QColor(Qt::transparent).rgba());
+    kpPixmapFX::setPixmapAt (&previewPixmap,
+                             (previewPixmap.width () - transformedShrunkenDocumentPixmap.width ()) / 2,
+                             (previewPixmap.height () - transformedShrunkenDocumentPixmap.height ()) / 2,
+                             transformedShrunkenDocumentPixmap);
 
 #if DEBUG_KP_TRANSFORM_PREVIEW_DIALOG
-    qCDebug(kpLogDialogs) << "kpTransformPreviewDialog::updatePreview ():"
+    qCDebug(kpLogDialogs) << "kpTransformPreviewDialog::slotPreviewRendered ():"
+               << "   isFinal=" << isFinal
                << "   shrunkenDocumentPixmap: w="
                << m_shrunkenDocumentPixmap.width ()
                << " h="
@@ -425,10 +442,11 @@ void kpTransformPreviewDialog::updatePreview ()
                << endl;
 #endif
 
-        m_previewPixmapLabel->setPixmap (QPixmap::fromImage(previewPixmap));
+    m_previewPixmapLabel->setPixmap (QPixmap::fromImage(previewPixmap));
 
-        // immediate update esp. for expensive previews
-        m_previewPixmapLabel->repaint ();
+    if (isFinal) {
+        m_previewPixmapLabel->unsetCursor ();
+    }
 
 #if DEBUG_KP_TRANSFORM_PREVIEW_DIALOG
     qCDebug(kpLogDialogs) << "\tafter QLabel::setPixmap() previewPixmapLabel: w="
@@ -437,7 +455,6 @@ void kpTransformPreviewDialog::updatePreview ()
                << m_previewPixmapLabel->height ()
                << endl;
 #endif
-    }
 }
 
 
@@ -33,6 +33,8 @@
 #include <QDialog>
 #include <QPixmap>
 
+#include "generic/kpPreviewRenderer.h"
+
 
 class QLabel;
 class QGridLayout;
@@ -88,8 +90,12 @@ protected:
     }
 
     virtual QSize newDimensions () const = 0;
-    virtual QImage transformPixmap (const QImage &pixmap,
-                                    int targetWidth, int targetHeight) const = 0;
+
+    // Returns a function that transforms the document, shrunken to fit the
+    // preview, with the current settings.  It runs on a worker thread (see
+    // kpPreviewRenderer) so must capture the settings instead of reading
+    // the widgets.
+    virtual kpPreviewRenderer::RenderFunction transformFunction () const = 0;
 
 public:
     // Use to avoid excessive, expensive preview pixmap label recalcuations,
@@ -114,6 +120,11 @@ private:
 protected slots:
     void updatePreview ();
 
+private slots:
+    void slotPreviewRendered (const QImage &transformedShrunkenDocumentPixmap,
+                              bool isFinal);
+
+protected slots:
     // Call this whenever a value (e.g. an angle) changes
     // and the Dimensions & Preview need to be updated
     virtual void slotUpdate ();
@@ -135,6 +146,7 @@ protected:
     kpResizeSignallingLabel *m_previewPixmapLabel;
     QSize m_previewPixmapLabelSizeWhenUpdatedPixmap;
     QImage m_shrunkenDocumentPixmap;
+    kpPreviewRenderer *m_previewRenderer;
 
     QGridLayout *m_gridLayout;
     int m_gridNumRows;
@@ -65,6 +65,7 @@
 
 #define kpSettingResizeScaleLastKeepAspect "Resize Scale - Last Keep Aspect"
 #define kpSettingResizeScaleScaleType "Resize Scale - ScaleType"
+#define kpSettingResizeScaleSmoothScaleFilter "Resize Scale - Smooth Scale Filter"
 
 //---------------------------------------------------------------------
 
@@ -118,6 +119,12 @@ kpTransformResizeScaleDialog::kpTransformResizeScaleDialog (
     m_lastType = static_cast<kpTransformResizeScaleCommand::Type>
                    (cfg.readEntry(kpSettingResizeScaleScaleType,
                                   static_cast<int>(kpTransformResizeScaleCommand::Resize)));
+    const int filterIndex = m_smoothScaleFilterCombo->findData (
+        cfg.readEntry(kpSettingResizeScaleSmoothScaleFilter,
+                      static_cast<int>(kpImageScaler::Bilinear)));
+    if (filterIndex >= 0) {
+        m_smoothScaleFilterCombo->setCurrentIndex (filterIndex);
+    }
 
     slotActOnChanged ();
 
@@ -232,7 +239,10 @@ QGroupBox *kpTransformResizeScaleDialog::createOperationGroupBox (QWidget *baseW
 
                   "<li><b>Smooth Scale</b>: This is the same as"
                   " <i>Scale</i> except that it blends neighboring"
-                  " pixels to produce a smoother looking picture.</li>"
+                  " pixels to produce a smoother looking picture."
+                  " <i>Area Average</i> is best for shrinking by a lot;"
+                  " <i>Lanczos</i> gives sharper results than"
+                  " <i>Bilinear</i>.</li>"
               "</ul>"
               "</qt>"));
 
@@ -257,10 +267,20 @@ QGroupBox *kpTransformResizeScaleDialog::createOperationGroupBox (QWidget *baseW
     resizeScaleButtonGroup->addButton (m_smoothScaleButton);
 
 
+    m_smoothScaleFilterCombo = new QComboBox (operationGroupBox);
+    m_smoothScaleFilterCombo->addItem (i18n ("Bilinear"),
+        static_cast<int>(kpImageScaler::Bilinear));
+    m_smoothScaleFilterCombo->addItem (i18n ("Area Average"),
+        static_cast<int>(kpImageScaler::AreaAverage));
+    m_smoothScaleFilterCombo->addItem (i18n ("Lanczos"),
+        static_cast<int>(kpImageScaler::Lanczos3));
+
+
     auto *operationLayout = new QGridLayout (operationGroupBox );
     operationLayout->addWidget (m_resizeButton, 0, 0, Qt::AlignCenter);
     operationLayout->addWidget (m_scaleButton, 0, 1, Qt::AlignCenter);
     operationLayout->addWidget (m_smoothScaleButton, 0, 2, Qt::AlignCenter);
+    operationLayout->addWidget (m_smoothScaleFilterCombo, 1, 2, Qt::AlignCenter);
 
     connect (m_resizeButton, &QToolButton::toggled,
              this, &kpTransformResizeScaleDialog::slotTypeChanged);
@@ -519,6 +539,9 @@ void kpTransformResizeScaleDialog::slotActOnChanged ()
 void kpTransformResizeScaleDialog::slotTypeChanged ()
 {
     m_lastType = type ();
+
+    m_smoothScaleFilterCombo->setEnabled (
+        m_lastType == kpTransformResizeScaleCommand::SmoothScale);
 }
 
 //---------------------------------------------------------------------
@@ -677,6 +700,15 @@ kpTransformResizeScaleCommand::Type kpTransformResizeScaleDialog::type () const
 //---------------------------------------------------------------------
 // public
 
+kpImageScaler::Filter kpTransformResizeScaleDialog::smoothScaleFilter () const
+{
+    return static_cast<kpImageScaler::Filter>
+        (m_smoothScaleFilterCombo->currentData ().toInt ());
+}
+
+//---------------------------------------------------------------------
+// public
+
 bool kpTransformResizeScaleDialog::isNoOp () const
 {
     return (imageWidth () == originalWidth () &&
@@ -830,6 +862,7 @@ void kpTransformResizeScaleDialog::accept ()
 
     cfg.writeEntry(kpSettingResizeScaleLastKeepAspect, m_keepAspectRatioCheckBox->isChecked());
     cfg.writeEntry(kpSettingResizeScaleScaleType, static_cast<int>(m_lastType));
+    cfg.writeEntry(kpSettingResizeScaleSmoothScaleFilter, static_cast<int>(smoothScaleFilter ()));
     cfg.sync();
 }
 
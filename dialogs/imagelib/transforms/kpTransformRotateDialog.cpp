@@ -236,12 +236,17 @@ QSize kpTransformRotateDialog::newDimensions () const
 }
 
 // private virtual [base kpTransformPreviewDialog]
-QImage kpTransformRotateDialog::transformPixmap (const QImage &image,
-                                                 int targetWidth, int targetHeight) const
+kpPreviewRenderer::RenderFunction kpTransformRotateDialog::transformFunction () const
 {
-    return kpPixmapFX::rotate (image, angle (),
-                               m_environ->backgroundColor (m_actOnSelection),
-                               targetWidth, targetHeight);
+    const int angle = this->angle ();
+    const kpColor backgroundColor = m_environ->backgroundColor (m_actOnSelection);
+
+    return [=] (const QImage &image, int targetWidth, int targetHeight)
+    {
+        return kpPixmapFX::rotate (image, angle,
+                                   backgroundColor,
+                                   targetWidth, targetHeight);
+    };
 }
 
 
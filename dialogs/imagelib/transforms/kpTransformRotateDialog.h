@@ -66,8 +66,7 @@ public:
 
 private:
     QSize newDimensions () const override;
-    QImage transformPixmap (const QImage &pixmap,
-                                    int targetWidth, int targetHeight) const override;
+    kpPreviewRenderer::RenderFunction transformFunction () const override;
 
 private slots:
     void slotAngleCustomRadioButtonToggled (bool isChecked);
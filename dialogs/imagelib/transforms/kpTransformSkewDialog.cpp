@@ -168,15 +168,21 @@ QSize kpTransformSkewDialog::newDimensions () const
 }
 
 // private virtual [base kpTransformPreviewDialog]
-QImage kpTransformSkewDialog::transformPixmap (const QImage &image,
-                                           int targetWidth, int targetHeight) const
+kpPreviewRenderer::RenderFunction kpTransformSkewDialog::transformFunction () const
 {
-    return kpPixmapFX::skew (image,
-                             horizontalAngleForPixmapFX (),
-                             verticalAngleForPixmapFX (),
-                             m_environ->backgroundColor (m_actOnSelection),
-                             targetWidth,
-                             targetHeight);
+    const int horizontalAngle = horizontalAngleForPixmapFX ();
+    const int verticalAngle = verticalAngleForPixmapFX ();
+    const kpColor backgroundColor = m_environ->backgroundColor (m_actOnSelection);
+
+    return [=] (const QImage &image, int targetWidth, int targetHeight)
+    {
+        return kpPixmapFX::skew (image,
+                                 horizontalAngle,
+                                 verticalAngle,
+                                 backgroundColor,
+                                 targetWidth,
+                                 targetHeight);
+    };
 }
 
 
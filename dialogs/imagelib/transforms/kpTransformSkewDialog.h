@@ -50,8 +50,7 @@ private:
     void createAngleGroupBox ();
 
     QSize newDimensions () const override;
-    QImage transformPixmap (const QImage &image,
-                                    int targetWidth, int targetHeight) const override;
+    kpPreviewRenderer::RenderFunction transformFunction () const override;
 
     void updateLastAngles ();
 
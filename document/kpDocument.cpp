@@ -353,6 +353,14 @@ kpImage kpDocument::image (bool ofSelection) const
 
 //---------------------------------------------------------------------
 
+// public
+kpImage kpDocument::imagePyramidLevel (int width, int height) const
+{
+    return d->imagePyramid.level (*m_image, width, height);
+}
+
+//---------------------------------------------------------------------
+
 // public
 kpImage *kpDocument::imagePointer () const
 {
@@ -437,6 +445,8 @@ void kpDocument::resize (int w, int h, const kpColor &backgroundColor)
 
 void kpDocument::slotContentsChanged (const QRect &rect)
 {
+    d->imagePyramid.clear ();
+
     setModified ();
     emit contentsChanged (rect);
 }
@@ -445,6 +455,8 @@ void kpDocument::slotContentsChanged (const QRect &rect)
 
 void kpDocument::slotSizeChanged (const QSize &newSize)
 {
+    d->imagePyramid.clear ();
+
     setModified ();
     emit sizeChanged (newSize.width(), newSize.height());
     emit sizeChanged (newSize);
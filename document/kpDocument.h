@@ -199,6 +199,12 @@ public:
     //
     // ASSUMPTION: For <ofSelection> == true only, an image selection exists.
     kpImage image (bool ofSelection = false) const;
+
+    // Returns the document's image (ignoring any selection) scaled down by
+    // a power of 2, to the smallest size that is still at least
+    // <width> x <height>.  The result is kept until the image changes, so
+    // reopening a preview dialog doesn't have to shrink image() again.
+    kpImage imagePyramidLevel (int width, int height) const;
     kpImage *imagePointer () const;
 
     void setImage (const kpImage &image);
@@ -30,6 +30,9 @@
 #define kpDocumentPrivate_H
 
 
+#include "imagelib/kpImagePyramid.h"
+
+
 class kpDocumentEnvironment;
 
 
@@ -41,6 +44,11 @@ struct kpDocumentPrivate
     }
 
     kpDocumentEnvironment *environ;
+
+    // Shrunken copies of the document image for previews
+    // (see kpDocument::imagePyramidLevel()).  Cleared whenever the image
+    // changes.
+    kpImagePyramid imagePyramid;
 };
 
 
@@ -167,6 +167,7 @@ void kpDocument::openNew (const QUrl &url)
 #endif
 
     m_image->fill(QColor(Qt::white).rgb());
+    d->imagePyramid.clear ();
 
     setURL (url, false/*not from url*/);
 
@@ -210,6 +211,7 @@ bool kpDocument::open (const QUrl &url, bool newDocSameNameIfNotExist)
     {
         delete m_image;
         m_image = new kpImage (newPixmap);
+        d->imagePyramid.clear ();
 
         setURL (url, true/*is from url*/);
         *m_saveOptions = newSaveOptions;
@@ -237,7 +237,9 @@ bool kpDocument::savePixmapToDevice (const QImage &image,
         //              seems to support it for QImage.
         imageToSave = kpEffectReduceColors::convertImageDepth (imageToSave,
                                            saveOptions.colorDepth (),
-                                           saveOptions.dither ());
+                                           saveOptions.dither () ?
+                                               kpColorQuantizer::FloydSteinbergDither :
+                                               kpColorQuantizer::NoDither);
     }
 
 
@@ -0,0 +1,98 @@
+/*
+   Copyright (c) 2026 The KolourPaint Authors
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+   OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+   IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+   INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+   NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+   THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include "kpParallel.h"
+
+#include <QThreadPool>
+#include <QVector>
+#include <QtConcurrentMap>
+
+
+namespace kpParallel
+{
+
+
+int idealThreadCount ()
+{
+    return qMax (1, QThreadPool::globalInstance ()->maxThreadCount ());
+}
+
+
+void forEach (int count, const std::function <void (int)> &func)
+{
+    if (count <= 0) {
+        return;
+    }
+
+    if (count == 1 || idealThreadCount () == 1)
+    {
+        for (int i = 0; i < count; i++) {
+            func (i);
+        }
+        return;
+    }
+
+    QVector <int> indexes (count);
+    for (int i = 0; i < count; i++) {
+        indexes [i] = i;
+    }
+
+    QtConcurrent::blockingMap (indexes, [&func] (int &i) { func (i); });
+}
+
+
+void forRanges (int begin, int end, int minRangeSize,
+                const std::function <void (int, int)> &func)
+{
+    const int total = end - begin;
+    if (total <= 0) {
+        return;
+    }
+
+    minRangeSize = qMax (1, minRangeSize);
+
+    // A few more ranges than threads so that a slow range doesn't leave the
+    // other threads idle for long.
+    const int maxRanges = idealThreadCount () * 4;
+    const int numRanges = qBound (1, total / minRangeSize, maxRanges);
+    if (numRanges == 1)
+    {
+        func (begin, end);
+        return;
+    }
+
+    const int rangeSize = (total + numRanges - 1) / numRanges;
+    forEach ((total + rangeSize - 1) / rangeSize,
+        [&] (int i)
+        {
+            const int rangeBegin = begin + i * rangeSize;
+            func (rangeBegin, qMin (end, rangeBegin + rangeSize));
+        });
+}
+
+
+}  // namespace kpParallel
@@ -0,0 +1,61 @@
+/*
+   Copyright (c) 2026 The KolourPaint Authors
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+   OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+   IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+   INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+   NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+   THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef KP_PARALLEL_H
+#define KP_PARALLEL_H
+
+
+#include <functional>
+
+
+//
+// Runs independent pieces of CPU-bound work (e.g. bands of image rows) on
+// QThreadPool::globalInstance() and waits for them to finish.
+//
+// The work functions must not touch any QWidget or QPixmap since they don't
+// run on the GUI thread.  Reading a QImage from several threads at once is
+// fine but each thread must only write to its own rows.
+//
+namespace kpParallel
+{
+    // Returns the number of pieces that work should usually be split into.
+    int idealThreadCount ();
+
+    // Calls <func> (i) for every i from 0 to <count> - 1 inclusive, in no
+    // particular order, and returns once they have all returned.
+    void forEach (int count, const std::function <void (int)> &func);
+
+    // Splits [<begin>, <end>) into consecutive ranges of at least
+    // <minRangeSize> items (except possibly the last) and calls
+    // <func> (rangeBegin, rangeEnd) for each.  Small inputs are processed on
+    // the calling thread, with a single call.
+    void forRanges (int begin, int end, int minRangeSize,
+                    const std::function <void (int, int)> &func);
+}
+
+
+#endif  // KP_PARALLEL_H
@@ -0,0 +1,229 @@
+/*
+   Copyright (c) 2026 The KolourPaint Authors
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+   OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+   IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+   INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+   NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+   THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#define DEBUG_KP_PREVIEW_RENDERER 0
+
+
+#include "kpPreviewRenderer.h"
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
+#include <QtConcurrentRun>
+
+#include "kpLogCategories.h"
+
+//---------------------------------------------------------------------
+
+// If a full render takes longer than this, the next request starts with a
+// quick pass.
+static const int QuickPassThresholdMsecs = 40;
+
+// Images smaller than this (in either dimension) aren't worth a quick pass.
+static const int MinQuickPassImageSize = 64;
+
+//---------------------------------------------------------------------
+
+struct kpPreviewRendererRequest
+{
+    QImage image;
+    int targetWidth, targetHeight;
+    kpPreviewRenderer::RenderFunction renderFunction;
+    int id;
+};
+
+struct kpPreviewRendererPrivate
+{
+    QFutureWatcher <void> watcher;
+
+    bool hasPendingRequest{false};
+    kpPreviewRendererRequest pendingRequest;
+
+    int lastRequestID{0};
+    // The request whose results are wanted.  Read by the worker thread to
+    // give up early.
+    QAtomicInt currentRequestID{0};
+
+    // Written by the worker thread.
+    QAtomicInt lastFullRenderMsecs{0};
+};
+
+//---------------------------------------------------------------------
+
+// Runs <request> on the worker thread.
+static void RunRequest (kpPreviewRenderer *renderer, kpPreviewRendererPrivate *d,
+                        const kpPreviewRendererRequest &request)
+{
+    const auto isStale = [&] ()
+    {
+        return (request.id != d->currentRequestID.loadAcquire ());
+    };
+
+    if (isStale ()) {
+        return;
+    }
+
+    const QImage &image = request.image;
+    if (d->lastFullRenderMsecs.loadAcquire () > QuickPassThresholdMsecs &&
+        image.width () >= MinQuickPassImageSize &&
+        image.height () >= MinQuickPassImageSize)
+    {
+        const QImage smallImage = image.scaled (image.width () / 2, image.height () / 2,
+            Qt::IgnoreAspectRatio, Qt::FastTransformation);
+        const QImage quickImage = request.renderFunction (smallImage,
+            qMax (1, request.targetWidth / 2), qMax (1, request.targetHeight / 2));
+
+        if (isStale ()) {
+            return;
+        }
+
+        emit renderer->renderedOnWorkerThread (
+            quickImage.scaled (request.targetWidth, request.targetHeight,
+                Qt::IgnoreAspectRatio, Qt::FastTransformation),
+            false/*not final*/, request.id);
+    }
+
+    QElapsedTimer timer;
+    timer.start ();
+
+    const QImage fullImage = request.renderFunction (image,
+        request.targetWidth, request.targetHeight);
+
+    d->lastFullRenderMsecs.storeRelease (static_cast <int> (timer.elapsed ()));
+#if DEBUG_KP_PREVIEW_RENDERER
+    qCDebug(kpLogMisc) << "kpPreviewRenderer: request" << request.id
+              << "took" << timer.elapsed () << "ms";
+#endif
+
+    if (isStale ()) {
+        return;
+    }
+
+    emit renderer->renderedOnWorkerThread (fullImage, true/*final*/, request.id);
+}
+
+//---------------------------------------------------------------------
+
+kpPreviewRenderer::kpPreviewRenderer (QObject *parent)
+    : QObject (parent),
+      d (new kpPreviewRendererPrivate ())
+{
+    connect (this, &kpPreviewRenderer::renderedOnWorkerThread,
+             this, &kpPreviewRenderer::slotRenderedOnWorkerThread,
+             Qt::QueuedConnection);
+    connect (&d->watcher, &QFutureWatcher <void>::finished,
+             this, &kpPreviewRenderer::startPendingRequest);
+}
+
+//---------------------------------------------------------------------
+
+kpPreviewRenderer::~kpPreviewRenderer ()
+{
+    cancel ();
+    d->watcher.waitForFinished ();
+
+    delete d;
+}
+
+//---------------------------------------------------------------------
+
+// public
+void kpPreviewRenderer::render (const QImage &image, int targetWidth, int targetHeight,
+                                const RenderFunction &renderFunction)
+{
+    kpPreviewRendererRequest &request = d->pendingRequest;
+    request.image = image;
+    request.targetWidth = targetWidth;
+    request.targetHeight = targetHeight;
+    request.renderFunction = renderFunction;
+    request.id = ++d->lastRequestID;
+#if DEBUG_KP_PREVIEW_RENDERER
+    qCDebug(kpLogMisc) << "kpPreviewRenderer::render() request" << request.id
+              << "target=" << targetWidth << "x" << targetHeight
+              << "running=" << d->watcher.isRunning ();
+#endif
+
+    d->hasPendingRequest = true;
+    d->currentRequestID.storeRelease (request.id);
+
+    if (!d->watcher.isRunning ()) {
+        startPendingRequest ();
+    }
+}
+
+//---------------------------------------------------------------------
+
+// public
+void kpPreviewRenderer::cancel ()
+{
+    d->hasPendingRequest = false;
+    d->pendingRequest = kpPreviewRendererRequest ();
+    d->currentRequestID.storeRelease (++d->lastRequestID);
+}
+
+//---------------------------------------------------------------------
+
+// public
+bool kpPreviewRenderer::isBusy () const
+{
+    return (d->hasPendingRequest || d->watcher.isRunning ());
+}
+
+//---------------------------------------------------------------------
+
+// private slot
+void kpPreviewRenderer::slotRenderedOnWorkerThread (const QImage &image, bool isFinal,
+                                                    int requestID)
+{
+    // (a newer request was made after this result was sent)
+    if (requestID != d->currentRequestID.loadAcquire ()) {
+        return;
+    }
+
+    emit rendered (image, isFinal);
+}
+
+//---------------------------------------------------------------------
+
+// private slot
+void kpPreviewRenderer::startPendingRequest ()
+{
+    if (!d->hasPendingRequest) {
+        return;
+    }
+
+    const kpPreviewRendererRequest request = d->pendingRequest;
+    d->hasPendingRequest = false;
+    d->pendingRequest = kpPreviewRendererRequest ();
+
+    d->watcher.setFuture (QtConcurrent::run ([this, request] ()
+    {
+        ::RunRequest (this, d, request);
+    }));
+}
+
+//---------------------------------------------------------------------
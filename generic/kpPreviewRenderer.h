@@ -0,0 +1,91 @@
+/*
+   Copyright (c) 2026 The KolourPaint Authors
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+   OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+   IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+   INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+   NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+   THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef KP_PREVIEW_RENDERER_H
+#define KP_PREVIEW_RENDERER_H
+
+
+#include <functional>
+
+#include <QImage>
+#include <QObject>
+
+
+//
+// Renders previews (e.g. of an effect on a shrunken copy of the document)
+// on a worker thread, so that the GUI keeps up while the user drags a
+// slider.
+//
+// Only the latest request matters: a new request replaces one that hasn't
+// started yet and makes the results of the running one be dropped.  When
+// rendering is slow, a quick pass at half the resolution is shown first.
+//
+class kpPreviewRenderer : public QObject
+{
+Q_OBJECT
+
+public:
+    // Transforms <image> into an image of <targetWidth> x <targetHeight>.
+    //
+    // This is called on a worker thread, so it must capture everything it
+    // needs by value and must not touch any QWidget or QPixmap.
+    typedef std::function <QImage (const QImage &image,
+                                   int targetWidth, int targetHeight)> RenderFunction;
+
+    explicit kpPreviewRenderer (QObject *parent = nullptr);
+    // Waits for the render in progress, if any, but drops its result.
+    ~kpPreviewRenderer () override;
+
+    // Starts rendering <image> with <renderFunction> and returns
+    // immediately.  See rendered().
+    void render (const QImage &image, int targetWidth, int targetHeight,
+                 const RenderFunction &renderFunction);
+
+    // Drops the current request.
+    void cancel ();
+
+    // Returns whether the current request hasn't been fully rendered yet.
+    bool isBusy () const;
+
+signals:
+    // Emitted for the quick pass, if any, with <isFinal> false and <image>
+    // scaled up to the target size.  Then emitted with <isFinal> true.
+    void rendered (const QImage &image, bool isFinal);
+
+    // (private: from the worker thread)
+    void renderedOnWorkerThread (const QImage &image, bool isFinal, int requestID);
+
+private slots:
+    void slotRenderedOnWorkerThread (const QImage &image, bool isFinal, int requestID);
+    void startPendingRequest ();
+
+private:
+    struct kpPreviewRendererPrivate *d;
+};
+
+
+#endif  // KP_PREVIEW_RENDERER_H
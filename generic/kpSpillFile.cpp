@@ -0,0 +1,258 @@
+/*
+   Copyright (c) 2026 The KolourPaint Authors
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+   OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+   IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+   INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+   NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+   THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#define DEBUG_KP_SPILL_FILE 0
+
+
+#include "kpSpillFile.h"
+
+#include "kpLogCategories.h"
+
+#include <QByteArray>
+#include <QDir>
+#include <QTemporaryFile>
+
+
+// Don't bother compacting the file to reclaim less than this.
+static const qint64 CompactMinUnusedSize = 16 * 1048576;
+
+//---------------------------------------------------------------------
+
+kpSpillFile::Block::Block (const QSharedPointer <kpSpillFile> &file,
+                           quint64 id, qint64 size)
+    : m_file (file),
+      m_id (id),
+      m_size (size)
+{
+}
+
+kpSpillFile::Block::~Block ()
+{
+    m_file->release (m_id);
+}
+
+//---------------------------------------------------------------------
+
+// public
+qint64 kpSpillFile::Block::size () const
+{
+    return m_size;
+}
+
+// public
+bool kpSpillFile::Block::read (const std::function <void (const uchar *data)> &func) const
+{
+    return m_file->read (m_id, func);
+}
+
+//---------------------------------------------------------------------
+
+kpSpillFile::kpSpillFile ()
+    : m_file (nullptr),
+      m_nextID (0),
+      m_liveSize (0)
+{
+}
+
+kpSpillFile::~kpSpillFile ()
+{
+    // (QTemporaryFile removes the file)
+    delete m_file;
+}
+
+//---------------------------------------------------------------------
+
+// public
+QSharedPointer <const kpSpillFile::Block> kpSpillFile::write (const void *data, qint64 size)
+{
+    if (size <= 0) {
+        return {};
+    }
+
+    if (!m_file)
+    {
+        m_file = new QTemporaryFile (QDir::tempPath () +
+                                     QLatin1String ("/kolourpaint-XXXXXX"));
+        if (!m_file->open ())
+        {
+            qCCritical(kpLogMisc) << "kpSpillFile::write() could not create"
+                                  << m_file->fileName () << ":" << m_file->errorString ();
+            delete m_file;
+            m_file = nullptr;
+            return {};
+        }
+    }
+    else
+    {
+        const qint64 unusedSize = fileSize () - m_liveSize;
+        if (unusedSize >= CompactMinUnusedSize && unusedSize > m_liveSize) {
+            compact ();
+        }
+    }
+
+    const qint64 offset = m_file->size ();
+    if (!m_file->seek (offset) ||
+        m_file->write (static_cast <const char *> (data), size) != size ||
+        !m_file->flush ())
+    {
+        qCCritical(kpLogMisc) << "kpSpillFile::write(" << size << ") failed:"
+                              << m_file->errorString ();
+        m_file->resize (offset);
+        return {};
+    }
+
+    const quint64 id = m_nextID++;
+    m_entries.insert (id, Entry {offset, size});
+    m_liveSize += size;
+
+#if DEBUG_KP_SPILL_FILE
+    qCDebug(kpLogMisc) << "kpSpillFile::write(" << size << ") id=" << id
+                       << " liveSize=" << m_liveSize << " fileSize=" << fileSize ();
+#endif
+
+    return QSharedPointer <const Block> (new Block (sharedFromThis (), id, size));
+}
+
+//---------------------------------------------------------------------
+
+// public
+qint64 kpSpillFile::liveSize () const
+{
+    return m_liveSize;
+}
+
+// public
+qint64 kpSpillFile::fileSize () const
+{
+    return m_file ? m_file->size () : 0;
+}
+
+//---------------------------------------------------------------------
+
+// private
+bool kpSpillFile::read (quint64 id, const std::function <void (const uchar *data)> &func)
+{
+    const auto it = m_entries.constFind (id);
+    if (it == m_entries.constEnd ()) {
+        return false;
+    }
+
+    const Entry entry = *it;
+
+    uchar *data = m_file->map (entry.offset, entry.size);
+    if (data)
+    {
+        func (data);
+        m_file->unmap (data);
+        return true;
+    }
+
+    // Can't map e.g. the address space is full.  Read it in instead.
+    if (!m_file->seek (entry.offset)) {
+        return false;
+    }
+
+    const QByteArray buffer = m_file->read (entry.size);
+    if (buffer.size () != entry.size)
+    {
+        qCCritical(kpLogMisc) << "kpSpillFile::read(" << id << ") failed:"
+                              << m_file->errorString ();
+        return false;
+    }
+
+    func (reinterpret_cast <const uchar *> (buffer.constData ()));
+    return true;
+}
+
+//---------------------------------------------------------------------
+
+// private
+void kpSpillFile::release (quint64 id)
+{
+    const auto it = m_entries.find (id);
+    Q_ASSERT (it != m_entries.end ());
+
+    m_liveSize -= it->size;
+    m_entries.erase (it);
+
+    if (m_entries.isEmpty ()) {
+        m_file->resize (0);
+    }
+}
+
+//---------------------------------------------------------------------
+
+// private
+void kpSpillFile::compact ()
+{
+#if DEBUG_KP_SPILL_FILE
+    qCDebug(kpLogMisc) << "kpSpillFile::compact() liveSize=" << m_liveSize
+                       << " fileSize=" << fileSize ();
+#endif
+
+    auto *newFile = new QTemporaryFile (m_file->fileTemplate ());
+    if (!newFile->open ())
+    {
+        delete newFile;
+        return;
+    }
+
+    QHash <quint64, Entry> newEntries;
+    newEntries.reserve (m_entries.size ());
+
+    for (auto it = m_entries.constBegin (); it != m_entries.constEnd (); ++it)
+    {
+        const Entry newEntry {newFile->pos (), it->size};
+
+        bool wroteData = false;
+        const bool readData = read (it.key (),
+            [&] (const uchar *data)
+            {
+                wroteData = (newFile->write (reinterpret_cast <const char *> (data),
+                                             newEntry.size) == newEntry.size);
+            });
+
+        if (!readData || !wroteData)
+        {
+            // Keep using the old file.
+            delete newFile;
+            return;
+        }
+
+        newEntries.insert (it.key (), newEntry);
+    }
+
+    if (!newFile->flush ())
+    {
+        delete newFile;
+        return;
+    }
+
+    delete m_file;
+    m_file = newFile;
+    m_entries = newEntries;
+}
@@ -0,0 +1,109 @@
+/*
+   Copyright (c) 2026 The KolourPaint Authors
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+   OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+   IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+   INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+   NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+   THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef KP_SPILL_FILE_H
+#define KP_SPILL_FILE_H
+
+
+#include <functional>
+
+#include <QEnableSharedFromThis>
+#include <QHash>
+#include <QSharedPointer>
+
+
+class QTemporaryFile;
+
+
+//
+// A temporary file to move data that is kept around, but rarely needed,
+// out of memory (e.g. the undo images of old commands).
+//
+// The file is created on the first write() and is deleted with this object.
+// Space is given back as blocks are released, by occasionally compacting
+// the file.
+//
+// Must be created with QSharedPointer, since blocks keep the file alive.
+//
+class kpSpillFile : public QEnableSharedFromThis <kpSpillFile>
+{
+public:
+    // Data written to the file.  Its space is released when the last
+    // reference to it goes away.
+    class Block
+    {
+    public:
+        ~Block ();
+
+        qint64 size () const;
+
+        // Calls <func> with the data, memory-mapped if possible.  The
+        // pointer is only valid during the call.
+        //
+        // Returns false, without calling <func>, if the data can't be read
+        // back.
+        bool read (const std::function <void (const uchar *data)> &func) const;
+
+    private:
+        friend class kpSpillFile;
+        Block (const QSharedPointer <kpSpillFile> &file, quint64 id, qint64 size);
+
+        QSharedPointer <kpSpillFile> m_file;
+        quint64 m_id;
+        qint64 m_size;
+    };
+
+    kpSpillFile ();
+    ~kpSpillFile ();
+
+    // Appends <size> bytes of <data>.  Returns null if they could not be
+    // written e.g. the disk is full.
+    QSharedPointer <const Block> write (const void *data, qint64 size);
+
+    // Returns the number of bytes held by blocks that are still referenced.
+    qint64 liveSize () const;
+
+    // Returns the size of the file, including space not reclaimed yet.
+    qint64 fileSize () const;
+
+private:
+    bool read (quint64 id, const std::function <void (const uchar *data)> &func);
+    void release (quint64 id);
+    void compact ();
+
+    struct Entry
+    {
+        qint64 offset;
+        qint64 size;
+    };
+
+    QTemporaryFile *m_file;
+    QHash <quint64, Entry> m_entries;
+    quint64 m_nextID;
+    qint64 m_liveSize;
+};
+
+
+#endif  // KP_SPILL_FILE_H
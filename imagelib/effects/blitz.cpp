@@ -63,6 +63,7 @@ ImageMagick Studio.
 */
 
 #include "blitz.h"
+#include "kpConvolutionKernel.h"
 
 #include <QColor>
 #include <cmath>
@@ -70,10 +71,6 @@ ImageMagick Studio.
 #define M_SQ2PI 2.50662827463100024161235523934010416269302368164062
 #define M_EPSILON 1.0e-6
 
-#define CONVOLVE_ACC(weight, pixel) \
-    r+=((weight))*(qRed((pixel))); g+=((weight))*(qGreen((pixel))); \
-    b+=((weight))*(qBlue((pixel)));
-
 //--------------------------------------------------------------------------------
 
 inline QRgb convertFromPremult(QRgb p)
@@ -419,10 +416,8 @@ int defaultConvolveMatrixSize(float radius, float sigma, bool quality)
 
 QImage convolve(QImage &img, int matrix_size, float *matrix)
 {
-    int i, x, y, w, h, matrix_x, matrix_y;
-    int edge = matrix_size/2;
-    QRgb *dest, *src, *s, **scanblock;
-    float *m, *normalize_matrix, normalize;
+    int i, w, h;
+    float *normalize_matrix, normalize;
 
     if(!(matrix_size % 2)){
         qWarning("Blitz::convolve(): kernel width must be an odd number!");
@@ -436,17 +431,6 @@ QImage convolve(QImage &img, int matrix_size, float *matrix)
         return(img);
     }
 
-    if(img.format() == QImage::Format_ARGB32_Premultiplied) {
-        img = img.convertToFormat(QImage::Format_ARGB32);
-    }
-    else if(img.depth() < 32){ 
-        img = img.convertToFormat(img.hasAlphaChannel() ?
-                                  QImage::Format_ARGB32 :
-                                  QImage::Format_RGB32);
-    }
-    QImage buffer(w, h, img.format());
-
-    scanblock = new QRgb* [matrix_size];
     normalize_matrix = new float[matrix_size*matrix_size];
 
     // create normalized matrix
@@ -462,97 +446,9 @@ QImage convolve(QImage &img, int matrix_size, float *matrix)
         normalize_matrix[i] = normalize*matrix[i];
     }
 
-    // apply
-
-    {
-        //
-        //
-        // Non-MMX version
-        //
-        //
-
-        float r, g, b;
-        for(y=0; y < h; ++y){
-            src = (QRgb *)img.scanLine(y);
-            dest = (QRgb *)buffer.scanLine(y);
-            // Read in scanlines to pixel neighborhood. If the scanline is outside
-            // the image use the top or bottom edge.
-            for(x=y-edge, i=0; x <= y+edge; ++i, ++x){
-                scanblock[i] = (QRgb *)
-                    img.scanLine((x < 0) ? 0 : (x > h-1) ? h-1 : x);
-            }
-            // Now we are about to start processing scanlines. First handle the
-            // part where the pixel neighborhood extends off the left edge.
-            for(x=0; x-edge < 0 ; ++x){
-                r = g = b = 0.0;
-                m = normalize_matrix;
-                for(matrix_y = 0; matrix_y < matrix_size; ++matrix_y){
-                    s = scanblock[matrix_y];
-                    matrix_x = -edge;
-                    while(x+matrix_x < 0){
-                        CONVOLVE_ACC(*m, *s);
-                        ++matrix_x; ++m;
-                    }
-                    while(matrix_x <= edge){
-                        CONVOLVE_ACC(*m, *s);
-                        ++matrix_x; ++m; ++s;
-                    }
-                }
-                r = r < 0.0f ? 0.0f : r > 255.0f ? 255.0f : r + 0.5f;
-                g = g < 0.0f ? 0.0f : g > 255.0f ? 255.0f : g + 0.5f;
-                b = b < 0.0f ? 0.0f : b > 255.0f ? 255.0f : b + 0.5f;
-                *dest++ = qRgba(static_cast<unsigned char> (r), static_cast<unsigned char> (g),
-                                static_cast<unsigned char> (b), qAlpha(*src++));
-            }
-            // Okay, now process the middle part where the entire neighborhood
-            // is on the image.
-            for(; x+edge < w; ++x){
-                m = normalize_matrix;
-                r = g = b = 0.0;
-                for(matrix_y = 0; matrix_y < matrix_size; ++matrix_y){
-                    s = scanblock[matrix_y] + (x-edge);
-                    for(matrix_x = -edge; matrix_x <= edge; ++matrix_x, ++m, ++s){
-                        CONVOLVE_ACC(*m, *s);
-                    }
-                }
-                r = r < 0.0f ? 0.0f : r > 255.0f ? 255.0f : r + 0.5f;
-                g = g < 0.0f ? 0.0f : g > 255.0f ? 255.0f : g + 0.5f;
-                b = b < 0.0f ? 0.0f : b > 255.0f ? 255.0f : b + 0.5f;
-                *dest++ = qRgba(static_cast<unsigned char> (r), static_cast<unsigned char> (g),
-                                static_cast<unsigned char> (b), qAlpha(*src++));
-            }
-            // Finally process the right part where the neighborhood extends off
-            // the right edge of the image
-            for(; x < w; ++x){
-                r = g = b = 0.0;
-                m = normalize_matrix;
-                for(matrix_y = 0; matrix_y < matrix_size; ++matrix_y){
-                    s = scanblock[matrix_y];
-                    s += x-edge;
-                    matrix_x = -edge;
-                    while(x+matrix_x < w){
-                        CONVOLVE_ACC(*m, *s);
-                        ++matrix_x;
-                        ++m;
-                        ++s;
-                    }
-                    --s;
-                    while(matrix_x <= edge){
-                        CONVOLVE_ACC(*m, *s);
-                        ++matrix_x;
-                        ++m;
-                    }
-                }
-                r = r < 0.0f ? 0.0f : r > 255.0f ? 255.0f : r + 0.5f;
-                g = g < 0.0f ? 0.0f : g > 255.0f ? 255.0f : g + 0.5f;
-                b = b < 0.0f ? 0.0f : b > 255.0f ? 255.0f : b + 0.5f;
-                *dest++ = qRgba(static_cast<unsigned char> (r), static_cast<unsigned char> (g),
-                                static_cast<unsigned char> (b), qAlpha(*src++));
-            }
-        }
-    }
+    // apply (converts to unpremultiplied ARGB32 or RGB32 first)
+    QImage buffer(kpConvolutionKernel(matrix_size, normalize_matrix).apply(img));
 
-    delete[] scanblock;
     delete[] normalize_matrix;
     return(buffer);
 }
@@ -0,0 +1,385 @@
+/*
+   Copyright (c) 2026 The KolourPaint Authors
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+   OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+   IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+   INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+   NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+   THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#define DEBUG_KP_BOX_BLUR 0
+
+
+#include "kpBoxBlur.h"
+#include "blitz.h"
+
+#include <QVector>
+
+#if defined (__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+#include "kpLogCategories.h"
+
+#include "generic/kpParallel.h"
+
+
+//---------------------------------------------------------------------
+
+// Every channel sum must fit in 31 bits (see Divider), so a window may hold
+// at most this many pixels of 255 * 255.
+static const int MaxWindowArea = 0x7FFFFFFF / (255 * 255);
+
+//---------------------------------------------------------------------
+
+struct kpBoxBlurTables
+{
+    // unpremultiplied [alpha * 256 + c] is the unpremultiplied value of
+    // premultiplied channel <c>, exactly as Blitz's convertFromPremult()
+    // computes it (including its wraparound if c > alpha).
+    uchar unpremultiplied [256 * 256];
+
+    // squareRoot [n] = floor (sqrt (n))
+    uchar squareRoot [255 * 255 + 1];
+
+    kpBoxBlurTables ()
+    {
+        for (int c = 0; c < 256; c++) {
+            unpremultiplied [c] = 0;
+        }
+        for (int alpha = 1; alpha < 256; alpha++)
+        {
+            for (int c = 0; c < 256; c++) {
+                unpremultiplied [alpha * 256 + c] = static_cast <uchar> (255 * c / alpha);
+            }
+        }
+
+        int root = 0;
+        for (int n = 0; n <= 255 * 255; n++)
+        {
+            if ((root + 1) * (root + 1) <= n) {
+                root++;
+            }
+            squareRoot [n] = static_cast <uchar> (root);
+        }
+    }
+};
+
+static const kpBoxBlurTables &Tables ()
+{
+    static const kpBoxBlurTables tables;
+    return tables;
+}
+
+//---------------------------------------------------------------------
+
+// Divides sums of less than 2^31 by <divisor>, rounding down like integer
+// division, with a multiply and a shift.
+struct Divider
+{
+    explicit Divider (quint32 divisor = 1)
+    {
+        int log2 = 0;
+        while ((quint32 (1) << log2) < divisor) {
+            log2++;
+        }
+
+        shift = 31 + log2;
+        multiplier = static_cast <quint32> (
+            ((quint64 (1) << shift) + divisor - 1) / divisor);
+    }
+
+    quint32 multiplier;
+    int shift;
+};
+
+//---------------------------------------------------------------------
+
+// The 4 channel sums of a pixel or window, in the order blue, green, red,
+// alpha.
+#if defined (__SSE2__)
+
+typedef __m128i Lanes;
+
+static inline Lanes LanesZero ()
+{
+    return _mm_setzero_si128 ();
+}
+
+static inline Lanes LanesLoad (const quint32 *p)
+{
+    return _mm_loadu_si128 (reinterpret_cast <const __m128i *> (p));
+}
+
+static inline void LanesStore (quint32 *p, Lanes v)
+{
+    _mm_storeu_si128 (reinterpret_cast <__m128i *> (p), v);
+}
+
+static inline Lanes LanesAdd (Lanes lhs, Lanes rhs)
+{
+    return _mm_add_epi32 (lhs, rhs);
+}
+
+static inline Lanes LanesSubtract (Lanes lhs, Lanes rhs)
+{
+    return _mm_sub_epi32 (lhs, rhs);
+}
+
+static inline Lanes LanesDivide (Lanes v, const Divider &divider)
+{
+    const __m128i multiplier = _mm_set1_epi32 (static_cast <int> (divider.multiplier));
+    const __m128i shift = _mm_cvtsi32_si128 (divider.shift);
+
+    // _mm_mul_epu32() only multiplies lanes 0 and 2.
+    const __m128i even = _mm_srl_epi64 (_mm_mul_epu32 (v, multiplier), shift);
+    const __m128i odd = _mm_srl_epi64 (
+        _mm_mul_epu32 (_mm_srli_epi64 (v, 32), multiplier), shift);
+    return _mm_or_si128 (even, _mm_slli_epi64 (odd, 32));
+}
+
+#else
+
+struct Lanes
+{
+    quint32 v [4];
+};
+
+static inline Lanes LanesZero ()
+{
+    const Lanes ret = {{0, 0, 0, 0}};
+    return ret;
+}
+
+static inline Lanes LanesLoad (const quint32 *p)
+{
+    const Lanes ret = {{p [0], p [1], p [2], p [3]}};
+    return ret;
+}
+
+static inline void LanesStore (quint32 *p, Lanes v)
+{
+    for (int i = 0; i < 4; i++) {
+        p [i] = v.v [i];
+    }
+}
+
+static inline Lanes LanesAdd (Lanes lhs, Lanes rhs)
+{
+    for (int i = 0; i < 4; i++) {
+        lhs.v [i] += rhs.v [i];
+    }
+    return lhs;
+}
+
+static inline Lanes LanesSubtract (Lanes lhs, Lanes rhs)
+{
+    for (int i = 0; i < 4; i++) {
+        lhs.v [i] -= rhs.v [i];
+    }
+    return lhs;
+}
+
+static inline Lanes LanesDivide (Lanes v, const Divider &divider)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        v.v [i] = static_cast <quint32> (
+            (quint64 (v.v [i]) * divider.multiplier) >> divider.shift);
+    }
+    return v;
+}
+
+#endif
+
+//---------------------------------------------------------------------
+
+// Writes the squared unpremultiplied colour channels, and the alpha, of
+// <count> premultiplied pixels to <out>.
+static void SquarePixels (const kpBoxBlurTables &tables,
+                          const QRgb *pixels, int count, quint32 *out)
+{
+    for (int i = 0; i < count; i++)
+    {
+        const QRgb p = pixels [i];
+        const uchar *unpremultiplied = tables.unpremultiplied + qAlpha (p) * 256;
+
+        const quint32 b = unpremultiplied [qBlue (p)];
+        const quint32 g = unpremultiplied [qGreen (p)];
+        const quint32 r = unpremultiplied [qRed (p)];
+
+        out [0] = b * b;
+        out [1] = g * g;
+        out [2] = r * r;
+        out [3] = quint32 (qAlpha (p));
+        out += 4;
+    }
+}
+
+//---------------------------------------------------------------------
+
+// Adds (if <sign> > 0) or subtracts row <y> of <image> to/from the column
+// sums, <squared> being scratch space for a row.
+static void UpdateColumnSums (const kpBoxBlurTables &tables,
+                              const QImage &image, int y, int sign,
+                              quint32 *columnSums, quint32 *squared)
+{
+    const int width = image.width ();
+    const auto *row = reinterpret_cast <const QRgb *> (image.constScanLine (y));
+
+    // Output column x is centred on input column x + 1 (see the header).
+    ::SquarePixels (tables, row + 1, width - 1, squared);
+    ::SquarePixels (tables, row + width - 1, 1, squared + (width - 1) * 4);
+
+    for (int x = 0; x < width; x++)
+    {
+        const Lanes sums = LanesLoad (columnSums + x * 4);
+        const Lanes pixel = LanesLoad (squared + x * 4);
+        LanesStore (columnSums + x * 4,
+            sign > 0 ? LanesAdd (sums, pixel) : LanesSubtract (sums, pixel));
+    }
+}
+
+//---------------------------------------------------------------------
+
+// Blurs rows [<beginY>, <endY>) of <image> into the destination image,
+// whose pixels are at <destBits>.
+static void BlurRows (const QImage &image, int radius,
+                      uchar *destBits, int destBytesPerLine,
+                      int beginY, int endY)
+{
+    const kpBoxBlurTables &tables = ::Tables ();
+
+    const int width = image.width (), height = image.height ();
+    const int maxWindowWidth = qMin (2 * radius + 1, width);
+
+    QVector <quint32> columnSums (width * 4, 0);
+    QVector <quint32> squared (width * 4);
+
+    // Divides by the number of pixels in the window, indexed by the window
+    // width, for the current window height.
+    QVector <Divider> dividers (maxWindowWidth + 1);
+    int dividersWindowHeight = -1;
+
+    quint32 lanes [4];
+
+    // Start with rows [beginY - radius, beginY + radius).
+    for (int y = qMax (0, beginY - radius); y < qMin (height, beginY + radius); y++) {
+        ::UpdateColumnSums (tables, image, y, +1, columnSums.data (), squared.data ());
+    }
+
+    for (int y = beginY; y < endY; y++)
+    {
+        // Slide the window down to rows [y - radius, y + radius].
+        if (y + radius < height) {
+            ::UpdateColumnSums (tables, image, y + radius, +1,
+                columnSums.data (), squared.data ());
+        }
+        if (y > beginY && y - radius - 1 >= 0) {
+            ::UpdateColumnSums (tables, image, y - radius - 1, -1,
+                columnSums.data (), squared.data ());
+        }
+
+        const int windowHeight = qMin (height - 1, y + radius) - qMax (0, y - radius) + 1;
+        if (windowHeight != dividersWindowHeight)
+        {
+            for (int windowWidth = 1; windowWidth <= maxWindowWidth; windowWidth++) {
+                dividers [windowWidth] = Divider (quint32 (windowWidth * windowHeight));
+            }
+            dividersWindowHeight = windowHeight;
+        }
+
+        const quint32 *sums = columnSums.constData ();
+        auto *destRow = reinterpret_cast <QRgb *> (destBits + y * destBytesPerLine);
+
+        Lanes window = LanesZero ();
+        for (int x = 0; x < qMin (width, radius); x++) {
+            window = LanesAdd (window, LanesLoad (sums + x * 4));
+        }
+
+        for (int x = 0; x < width; x++)
+        {
+            // Slide the window right to columns [x - radius, x + radius].
+            if (x + radius < width) {
+                window = LanesAdd (window, LanesLoad (sums + (x + radius) * 4));
+            }
+            if (x - radius - 1 >= 0) {
+                window = LanesSubtract (window, LanesLoad (sums + (x - radius - 1) * 4));
+            }
+
+            const int windowWidth = qMin (width - 1, x + radius) - qMax (0, x - radius) + 1;
+            LanesStore (lanes, LanesDivide (window, dividers [windowWidth]));
+
+            destRow [x] = qRgba (tables.squareRoot [lanes [2]],
+                                 tables.squareRoot [lanes [1]],
+                                 tables.squareRoot [lanes [0]],
+                                 static_cast <int> (lanes [3]));
+        }
+    }
+}
+
+//---------------------------------------------------------------------
+
+// public static
+QImage kpBoxBlur::blur (const QImage &image, int radius)
+{
+#if DEBUG_KP_BOX_BLUR
+    qCDebug(kpLogImagelib) << "kpBoxBlur::blur(image.size=" << image.size ()
+              << ",radius=" << radius << ")";
+#endif
+
+    if (image.isNull ()) {
+        return image;
+    }
+
+    const int width = image.width (), height = image.height ();
+    if (image.format () != QImage::Format_ARGB32_Premultiplied ||
+        radius < 0 ||
+        qMin (2 * radius + 1, width) * qMin (2 * radius + 1, height) > ::MaxWindowArea)
+    {
+    #if DEBUG_KP_BOX_BLUR
+        qCDebug(kpLogImagelib) << "\tusing Blitz::blur()";
+    #endif
+        QImage copy (image);
+        return Blitz::blur (copy, radius);
+    }
+
+    QImage dest (width, height, QImage::Format_ARGB32);
+    if (dest.isNull ()) {
+        return dest;
+    }
+
+    // (QImage::scanLine() detaches, which isn't thread-safe)
+    uchar *destBits = dest.bits ();
+    const int destBytesPerLine = dest.bytesPerLine ();
+
+    // Each band of rows first sums the <radius> rows above it so don't make
+    // the bands too thin.
+    kpParallel::forRanges (0, height, qMax (32, 8 * radius),
+        [&] (int beginY, int endY)
+        {
+            ::BlurRows (image, radius, destBits, destBytesPerLine, beginY, endY);
+        });
+
+    return dest;
+}
+
+//---------------------------------------------------------------------
@@ -0,0 +1,63 @@
+/*
+   Copyright (c) 2026 The KolourPaint Authors
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+   OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+   IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+   INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+   NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+   THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef KP_BOX_BLUR_H
+#define KP_BOX_BLUR_H
+
+
+#include <QImage>
+
+
+//
+// Blurs an image by averaging each pixel with its neighbours in a
+// (2 * radius + 1) x (2 * radius + 1) square (clipped to the image), using
+// running sums down the columns and then along the rows so that the cost
+// doesn't depend on the radius.  Bands of rows are blurred on
+// kpParallel's threads.
+//
+// For ARGB32_Premultiplied images (i.e. all document images), the result is
+// the same as Blitz::blur()'s (which is O(radius) per pixel and
+// single-threaded):
+//
+//   - the colour channels are averaged as squares of their unpremultiplied
+//     values and then square-rooted;
+//   - output pixel (x, y) is centred on input pixel (x + 1, y).  The last
+//     column is centred on itself, whereas Blitz::blur() reads past the end
+//     of the scanline there;
+//   - the result is Format_ARGB32 (not premultiplied).
+//
+// Other formats, and radii too big for 32-bit sums, are passed to
+// Blitz::blur().
+//
+class kpBoxBlur
+{
+public:
+    static QImage blur (const QImage &image, int radius);
+};
+
+
+#endif  // KP_BOX_BLUR_H
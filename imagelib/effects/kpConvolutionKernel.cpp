@@ -0,0 +1,444 @@
+/*
+   Copyright (c) 2026 The KolourPaint Authors
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+   OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+   IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+   INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+   NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+   THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#define DEBUG_KP_CONVOLUTION_KERNEL 0
+
+
+#include "kpConvolutionKernel.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <QRect>
+
+#if defined (__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+#include "kpLogCategories.h"
+
+#include "generic/kpParallel.h"
+
+
+//---------------------------------------------------------------------
+
+// Big enough to amortize the <size> / 2 pixels of border that each tile
+// reads, small enough for a tile's rows to stay in the cache.
+static const int TileWidth = 256;
+static const int TileHeight = 64;
+
+//---------------------------------------------------------------------
+
+// The blue, green, red and alpha of a pixel (or sums of them), as floats.
+#if defined (__SSE2__)
+
+typedef __m128 Pixel;
+
+static inline Pixel PixelZero ()
+{
+    return _mm_setzero_ps ();
+}
+
+static inline Pixel PixelLoad (const float *p)
+{
+    return _mm_loadu_ps (p);
+}
+
+static inline void PixelStore (float *p, Pixel v)
+{
+    _mm_storeu_ps (p, v);
+}
+
+static inline Pixel PixelMultiplyAdd (Pixel sum, float weight, Pixel v)
+{
+    return _mm_add_ps (sum, _mm_mul_ps (_mm_set1_ps (weight), v));
+}
+
+static inline Pixel PixelFromRgb (QRgb rgb)
+{
+    const __m128i zero = _mm_setzero_si128 ();
+    const __m128i bytes = _mm_cvtsi32_si128 (static_cast <int> (rgb));
+    return _mm_cvtepi32_ps (
+        _mm_unpacklo_epi16 (_mm_unpacklo_epi8 (bytes, zero), zero));
+}
+
+// Rounds and clamps the colour channels of <v>, taking the alpha from <alpha>.
+static inline QRgb PixelToRgb (Pixel v, QRgb alpha)
+{
+    v = _mm_max_ps (v, _mm_setzero_ps ());
+    v = _mm_min_ps (_mm_add_ps (v, _mm_set1_ps (0.5f)), _mm_set1_ps (255.5f));
+
+    __m128i bytes = _mm_cvttps_epi32 (v);
+    bytes = _mm_packs_epi32 (bytes, bytes);
+    bytes = _mm_packus_epi16 (bytes, bytes);
+
+    return (static_cast <QRgb> (_mm_cvtsi128_si32 (bytes)) & 0x00FFFFFF) |
+           (alpha & 0xFF000000);
+}
+
+#else
+
+struct Pixel
+{
+    float v [4];
+};
+
+static inline Pixel PixelZero ()
+{
+    const Pixel ret = {{0, 0, 0, 0}};
+    return ret;
+}
+
+static inline Pixel PixelLoad (const float *p)
+{
+    const Pixel ret = {{p [0], p [1], p [2], p [3]}};
+    return ret;
+}
+
+static inline void PixelStore (float *p, Pixel v)
+{
+    for (int i = 0; i < 4; i++) {
+        p [i] = v.v [i];
+    }
+}
+
+static inline Pixel PixelMultiplyAdd (Pixel sum, float weight, Pixel v)
+{
+    for (int i = 0; i < 4; i++) {
+        sum.v [i] += weight * v.v [i];
+    }
+    return sum;
+}
+
+static inline Pixel PixelFromRgb (QRgb rgb)
+{
+    const Pixel ret = {{float (qBlue (rgb)), float (qGreen (rgb)),
+                        float (qRed (rgb)), float (qAlpha (rgb))}};
+    return ret;
+}
+
+// Rounds and clamps the colour channels of <v>, taking the alpha from <alpha>.
+static inline QRgb PixelToRgb (Pixel v, QRgb alpha)
+{
+    int channels [3];
+    for (int i = 0; i < 3; i++)
+    {
+        const float c = v.v [i];
+        channels [i] = c < 0.0f ? 0 : c > 255.0f ? 255 : static_cast <int> (c + 0.5f);
+    }
+
+    return qRgba (channels [2], channels [1], channels [0], qAlpha (alpha));
+}
+
+#endif
+
+//---------------------------------------------------------------------
+
+// Converts <count> pixels of <row>, starting from column <x> and repeating
+// the edge pixels for columns off the image, to Pixel's in <out>.
+static void LoadRow (const QRgb *row, int width, int x, int count, float *out)
+{
+    int i = 0;
+
+    const Pixel left = ::PixelFromRgb (row [0]);
+    for (; i < count && x + i < 0; i++) {
+        ::PixelStore (out + i * 4, left);
+    }
+
+    const int insideEnd = qMin (count, width - x);
+    for (; i < insideEnd; i++) {
+        ::PixelStore (out + i * 4, ::PixelFromRgb (row [x + i]));
+    }
+
+    const Pixel right = ::PixelFromRgb (row [width - 1]);
+    for (; i < count; i++) {
+        ::PixelStore (out + i * 4, right);
+    }
+}
+
+//---------------------------------------------------------------------
+
+// sums [i] += weight * pixels [i] for <count> Pixel's.
+static void AccumulateRow (float *sums, const float *pixels, int count,
+                           float weight)
+{
+    if (weight == 0) {
+        return;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        ::PixelStore (sums + i * 4,
+            ::PixelMultiplyAdd (::PixelLoad (sums + i * 4), weight,
+                                ::PixelLoad (pixels + i * 4)));
+    }
+}
+
+//---------------------------------------------------------------------
+
+kpConvolutionKernel::kpConvolutionKernel (int size, const float *weights)
+    : m_size (size),
+      m_weights (size * size),
+      m_isSeparable (false),
+      m_extraCentreWeight (0)
+{
+    Q_ASSERT (size > 0 && size % 2 == 1);
+
+    std::copy (weights, weights + size * size, m_weights.begin ());
+
+    findSeparableWeights ();
+
+#if DEBUG_KP_CONVOLUTION_KERNEL
+    qCDebug(kpLogImagelib) << "kpConvolutionKernel::<ctor>(size=" << size << ")"
+              << " isSeparable=" << m_isSeparable
+              << " extraCentreWeight=" << m_extraCentreWeight;
+#endif
+}
+
+//---------------------------------------------------------------------
+
+// public
+int kpConvolutionKernel::size () const
+{
+    return m_size;
+}
+
+//---------------------------------------------------------------------
+
+// public
+float kpConvolutionKernel::weight (int x, int y) const
+{
+    return m_weights [y * m_size + x];
+}
+
+//---------------------------------------------------------------------
+
+// public
+bool kpConvolutionKernel::isSeparable () const
+{
+    return m_isSeparable;
+}
+
+//---------------------------------------------------------------------
+
+// private
+void kpConvolutionKernel::findSeparableWeights ()
+{
+    if (m_size < 3) {
+        return;
+    }
+
+    const int centre = m_size / 2;
+
+    // Factor out the biggest weight that is in neither the centre row nor
+    // the centre column, since the centre weight is allowed not to fit.
+    int pivotX = -1, pivotY = -1;
+    float maxWeight = 0;
+    for (int y = 0; y < m_size; y++)
+    {
+        for (int x = 0; x < m_size; x++)
+        {
+            if (x == centre && y == centre) {
+                continue;
+            }
+
+            const float w = std::fabs (weight (x, y));
+            maxWeight = qMax (maxWeight, w);
+
+            if (x != centre && y != centre &&
+                (pivotX < 0 || w > std::fabs (weight (pivotX, pivotY))))
+            {
+                pivotX = x;
+                pivotY = y;
+            }
+        }
+    }
+
+    const float pivot = weight (pivotX, pivotY);
+    if (pivot == 0) {
+        return;
+    }
+
+    QVector <float> columnWeights (m_size), rowWeights (m_size);
+    for (int i = 0; i < m_size; i++)
+    {
+        columnWeights [i] = weight (pivotX, i);
+        rowWeights [i] = weight (i, pivotY) / pivot;
+    }
+
+    const float tolerance = maxWeight * 1e-6f;
+    for (int y = 0; y < m_size; y++)
+    {
+        for (int x = 0; x < m_size; x++)
+        {
+            if (x == centre && y == centre) {
+                continue;
+            }
+
+            if (std::fabs (weight (x, y) - columnWeights [y] * rowWeights [x]) >
+                    tolerance)
+            {
+                return;
+            }
+        }
+    }
+
+    m_isSeparable = true;
+    m_columnWeights = columnWeights;
+    m_rowWeights = rowWeights;
+    m_extraCentreWeight = weight (centre, centre) -
+        columnWeights [centre] * rowWeights [centre];
+}
+
+//---------------------------------------------------------------------
+
+// private
+void kpConvolutionKernel::applyToTile (const QImage &image, const QRect &tile,
+                                       uchar *destBits, int destBytesPerLine) const
+{
+    const int edge = m_size / 2;
+    const int width = image.width (), height = image.height ();
+    const int tileWidth = tile.width (), tileHeight = tile.height ();
+
+    // The tile's pixels plus <edge> more on each side, so that the loops
+    // below don't have to check for the edges of the image.
+    const int sourceWidth = tileWidth + 2 * edge;
+    const int sourceHeight = tileHeight + 2 * edge;
+    QVector <float> source (sourceWidth * sourceHeight * 4);
+    for (int y = 0; y < sourceHeight; y++)
+    {
+        const int imageY = qBound (0, tile.top () - edge + y, height - 1);
+        ::LoadRow (reinterpret_cast <const QRgb *> (image.constScanLine (imageY)),
+                   width, tile.left () - edge, sourceWidth,
+                   source.data () + y * sourceWidth * 4);
+    }
+
+    // Horizontal pass, for every row of <source>.
+    QVector <float> rowSums;
+    if (m_isSeparable)
+    {
+        rowSums.fill (0, sourceHeight * tileWidth * 4);
+        for (int y = 0; y < sourceHeight; y++)
+        {
+            for (int x = 0; x < m_size; x++)
+            {
+                ::AccumulateRow (rowSums.data () + y * tileWidth * 4,
+                                 source.constData () + (y * sourceWidth + x) * 4,
+                                 tileWidth, m_rowWeights [x]);
+            }
+        }
+    }
+
+    QVector <float> sums (tileWidth * 4);
+    for (int y = 0; y < tileHeight; y++)
+    {
+        sums.fill (0);
+
+        if (m_isSeparable)
+        {
+            for (int ky = 0; ky < m_size; ky++)
+            {
+                ::AccumulateRow (sums.data (),
+                                 rowSums.constData () + (y + ky) * tileWidth * 4,
+                                 tileWidth, m_columnWeights [ky]);
+            }
+
+            ::AccumulateRow (sums.data (),
+                             source.constData () + ((y + edge) * sourceWidth + edge) * 4,
+                             tileWidth, m_extraCentreWeight);
+        }
+        else
+        {
+            for (int ky = 0; ky < m_size; ky++)
+            {
+                for (int kx = 0; kx < m_size; kx++)
+                {
+                    ::AccumulateRow (sums.data (),
+                                     source.constData () + ((y + ky) * sourceWidth + kx) * 4,
+                                     tileWidth, weight (kx, ky));
+                }
+            }
+        }
+
+        const auto *imageRow = reinterpret_cast <const QRgb *> (
+            image.constScanLine (tile.top () + y)) + tile.left ();
+        auto *destRow = reinterpret_cast <QRgb *> (
+            destBits + (tile.top () + y) * destBytesPerLine) + tile.left ();
+        for (int x = 0; x < tileWidth; x++) {
+            destRow [x] = ::PixelToRgb (::PixelLoad (sums.constData () + x * 4),
+                                        imageRow [x]);
+        }
+    }
+}
+
+//---------------------------------------------------------------------
+
+// public
+QImage kpConvolutionKernel::apply (const QImage &image) const
+{
+#if DEBUG_KP_CONVOLUTION_KERNEL
+    qCDebug(kpLogImagelib) << "kpConvolutionKernel::apply(image.size=" << image.size ()
+              << ") size=" << m_size << " isSeparable=" << m_isSeparable;
+#endif
+
+    if (image.isNull ()) {
+        return image;
+    }
+
+    QImage source = image;
+    if (source.format () != QImage::Format_ARGB32 &&
+        source.format () != QImage::Format_RGB32)
+    {
+        source = source.convertToFormat (source.hasAlphaChannel () ?
+                                             QImage::Format_ARGB32 :
+                                             QImage::Format_RGB32);
+    }
+
+    QImage dest (source.size (), source.format ());
+    if (dest.isNull ()) {
+        return dest;
+    }
+
+    uchar *destBits = dest.bits ();
+    const int destBytesPerLine = dest.bytesPerLine ();
+
+    const int tilesAcross = (source.width () + TileWidth - 1) / TileWidth;
+    const int tilesDown = (source.height () + TileHeight - 1) / TileHeight;
+    kpParallel::forEach (tilesAcross * tilesDown,
+        [&] (int i)
+        {
+            const QRect tile = QRect ((i % tilesAcross) * TileWidth,
+                                      (i / tilesAcross) * TileHeight,
+                                      TileWidth, TileHeight) &
+                               source.rect ();
+            applyToTile (source, tile, destBits, destBytesPerLine);
+        });
+
+    return dest;
+}
+
+//---------------------------------------------------------------------
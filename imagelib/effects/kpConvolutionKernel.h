@@ -0,0 +1,90 @@
+/*
+   Copyright (c) 2026 The KolourPaint Authors
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+   OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+   IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+   INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+   NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+   THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef KP_CONVOLUTION_KERNEL_H
+#define KP_CONVOLUTION_KERNEL_H
+
+
+#include <QImage>
+#include <QVector>
+
+
+//
+// A square matrix of weights to convolve images with, e.g. for sharpening
+// or embossing.  An effect needs only:
+//
+//     return kpConvolutionKernel (size, weights).apply (image);
+//
+// The image is processed in tiles on kpParallel's threads.  Pixels off the
+// edges of the image are taken to be copies of the nearest edge pixel.
+//
+// If the kernel is separable (column [y] * row [x], except perhaps for the
+// centre weight), which is worked out by the constructor, apply() does a
+// horizontal and a vertical pass instead of <size> * <size> multiplies per
+// pixel.
+//
+class kpConvolutionKernel
+{
+public:
+    // <weights> holds the <size> x <size> weights row by row.  <size> must
+    // be odd.  The weights are used as is, without normalizing them.
+    kpConvolutionKernel (int size, const float *weights);
+
+    int size () const;
+    float weight (int x, int y) const;
+
+    bool isSeparable () const;
+
+    // Returns <image> with each of its unpremultiplied red, green and blue
+    // channels replaced by the weighted sum of the pixels around it (rounded
+    // and clamped to [0, 255]), keeping its alpha.
+    //
+    // The result is Format_ARGB32, or Format_RGB32 if <image> has no alpha
+    // channel.
+    QImage apply (const QImage &image) const;
+
+private:
+    void findSeparableWeights ();
+
+    // Writes <tile> of the result into the image of the same size as
+    // <image> whose pixels are at <destBits>.
+    void applyToTile (const QImage &image, const QRect &tile,
+                      uchar *destBits, int destBytesPerLine) const;
+
+    int m_size;
+    QVector <float> m_weights;
+
+    // If m_isSeparable, weight (x, y) is
+    // m_columnWeights [y] * m_rowWeights [x], plus m_extraCentreWeight at
+    // the centre.
+    bool m_isSeparable;
+    QVector <float> m_columnWeights, m_rowWeights;
+    float m_extraCentreWeight;
+};
+
+
+#endif  // KP_CONVOLUTION_KERNEL_H
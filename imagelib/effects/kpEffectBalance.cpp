@@ -108,6 +108,39 @@ static inline QRgb brightnessContrastGammaForRGB (QRgb rgb,
 }
 
 
+// public static
+void kpEffectBalance::channelTables (int channels,
+        int brightness, int contrast, int gamma,
+        quint8 *red, quint8 *green, quint8 *blue)
+{
+    for (int i = 0; i < 256; i++)
+    {
+        auto applied = static_cast<quint8> (brightnessContrastGamma (i, brightness, contrast, gamma));
+
+        if (channels & kpEffectBalance::Red) {
+            red [i] = applied;
+        }
+        else {
+            red [i] = static_cast<quint8> (i);
+        }
+
+        if (channels & kpEffectBalance::Green) {
+            green [i] = applied;
+        }
+        else {
+            green [i] = static_cast<quint8> (i);
+        }
+
+        if (channels & kpEffectBalance::Blue) {
+            blue [i] = applied;
+        }
+        else {
+            blue [i] = static_cast<quint8> (i);
+        }
+    }
+}
+
+
 // public static
 kpImage kpEffectBalance::applyEffect (const kpImage &image,
         int channels,
@@ -132,32 +165,8 @@ kpImage kpEffectBalance::applyEffect (const kpImage &image,
     quint8 transformRed [256],
             transformGreen [256],
             transformBlue [256];
-
-    for (int i = 0; i < 256; i++)
-    {
-        auto applied = static_cast<quint8> (brightnessContrastGamma (i, brightness, contrast, gamma));
-
-        if (channels & kpEffectBalance::Red) {
-            transformRed [i] = applied;
-        }
-        else {
-            transformRed [i] = static_cast<quint8> (i);
-        }
-
-        if (channels & kpEffectBalance::Green) {
-            transformGreen [i] = applied;
-        }
-        else {
-            transformGreen [i] = static_cast<quint8> (i);
-        }
-
-        if (channels & kpEffectBalance::Blue) {
-            transformBlue [i] = applied;
-        }
-        else {
-            transformBlue [i] = static_cast<quint8> (i);
-        }
-    }
+    channelTables (channels, brightness, contrast, gamma,
+        transformRed, transformGreen, transformBlue);
 
 #if DEBUG_KP_EFFECT_BALANCE
     qCDebug(kpLogImagelib) << "\tbuild lookup=" << timer.restart ();
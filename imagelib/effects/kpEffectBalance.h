@@ -47,6 +47,13 @@ public:
     static kpImage applyEffect (const kpImage &image,
         int channels,
         int brightness, int contrast, int gamma);
+
+    // Fills the 256-entry <red>, <green> and <blue> tables that
+    // applyEffect() maps each channel of QImage::pixel() through.
+    // For kpEffectPipeline.
+    static void channelTables (int channels,
+        int brightness, int contrast, int gamma,
+        quint8 *red, quint8 *green, quint8 *blue);
 };
 
 
@@ -30,6 +30,7 @@
 
 #include "kpEffectBlurSharpen.h"
 #include "blitz.h"
+#include "kpBoxBlur.h"
 
 #include "kpLogCategories.h"
 
@@ -83,8 +84,7 @@ static QImage BlurQImage(const QImage &qimage, int strength)
                << " radius=" << radius;
 #endif
 
-    QImage img(qimage);
-    return Blitz::blur(img, qRound(radius));
+    return kpBoxBlur::blur (qimage, qRound (radius));
 }
 
 //---------------------------------------------------------------------
@@ -174,8 +174,7 @@ kpImage kpEffectBlurSharpen::applyEffect (const kpImage &image,
     }
 
     if (type == MakeConfidential) {
-        QImage img(image);
-        return Blitz::blur(img, qMin(20, img.width() / 2));
+        return kpBoxBlur::blur (image, qMin (20, image.width () / 2));
     }
 
     return kpImage();
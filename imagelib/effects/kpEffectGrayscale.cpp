@@ -73,3 +73,11 @@ kpImage kpEffectGrayscale::applyEffect (const kpImage &image)
 
     return qimage;
 }
+
+// public static
+void kpEffectGrayscale::applyToPixels (QRgb *pixels, int count)
+{
+    for (int i = 0; i < count; i++) {
+        pixels [i] = toGray (pixels [i]);
+    }
+}
@@ -41,6 +41,10 @@ class kpEffectGrayscale
 {
 public:
     static kpImage applyEffect (const kpImage &image);
+
+    // Converts <count> pixels in place, exactly like applyEffect() converts
+    // the values returned by QImage::pixel().  For kpEffectPipeline.
+    static void applyToPixels (QRgb *pixels, int count);
 };
 
 
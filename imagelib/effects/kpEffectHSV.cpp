@@ -33,9 +33,15 @@
 
 #include <QBitmap>
 #include <QImage>
+#include <QVector>
+
+#if defined (__SSE2__)
+    #include <emmintrin.h>
+#endif
 
 #include "kpLogCategories.h"
 
+#include "generic/kpParallel.h"
 #include "pixmapfx/kpPixmapFX.h"
 
 
@@ -151,11 +157,357 @@ static QRgb AdjustHSVInternal (QRgb pix, double hueDiv360, double saturation, do
     return ::HSVToColor(alpha, h, s, v);
 }
 
+#if defined (__SSE2__)
+
+// floor() of each lane of <v>, which must be within the range of an int.
+static inline __m128 FloorFloats (__m128 v)
+{
+    const __m128 truncated = _mm_cvtepi32_ps (_mm_cvttps_epi32 (v));
+    return _mm_sub_ps (truncated,
+        _mm_and_ps (_mm_cmpgt_ps (truncated, v), _mm_set1_ps (1.0f)));
+}
+
+// Returns <ifTrue> in the lanes where <mask> is set and <ifFalse> elsewhere.
+static inline __m128i Select (__m128i mask, __m128i ifTrue, __m128i ifFalse)
+{
+    return _mm_or_si128 (_mm_and_si128 (mask, ifTrue),
+                         _mm_andnot_si128 (mask, ifFalse));
+}
+
+static inline __m128 Select (__m128 mask, __m128 ifTrue, __m128 ifFalse)
+{
+    return _mm_or_ps (_mm_and_ps (mask, ifTrue), _mm_andnot_ps (mask, ifFalse));
+}
+
+static inline __m128d Select (__m128d mask, __m128d ifTrue, __m128d ifFalse)
+{
+    return _mm_or_pd (_mm_and_pd (mask, ifTrue), _mm_andnot_pd (mask, ifFalse));
+}
+
+// static_cast <int> (<x> * 255.999999) for the 4 floats, whose double
+// precision lanes 0 and 1 are <lo> and lanes 2 and 3 are <hi>.
+static inline __m128i ScaleToInts (__m128d lo, __m128d hi)
+{
+    const __m128d scale = _mm_set1_pd (255.999999);
+    return _mm_unpacklo_epi64 (_mm_cvttpd_epi32 (_mm_mul_pd (lo, scale)),
+                               _mm_cvttpd_epi32 (_mm_mul_pd (hi, scale)));
+}
+
+// Rounds each lane of <lo> and <hi> (as for ScaleToInts()) to float and
+// back again.
+static inline void RoundToFloats (__m128d *lo, __m128d *hi)
+{
+    const __m128 floats = _mm_movelh_ps (_mm_cvtpd_ps (*lo), _mm_cvtpd_ps (*hi));
+    *lo = _mm_cvtps_pd (floats);
+    *hi = _mm_cvtps_pd (_mm_movehl_ps (floats, floats));
+}
+
+// AdjustHSVInternal() for 4 pixels at a time, giving exactly the same
+// results: every float and double operation of ColorToHSV(),
+// AdjustHSVInternal() and HSVToColor() is done in the same precision and
+// order.
+static void AdjustHSV4 (QRgb *pixels, float hueDiv360, float saturation, float value)
+{
+    const __m128i px = _mm_loadu_si128 (reinterpret_cast <const __m128i *> (pixels));
+    const __m128i byteMask = _mm_set1_epi32 (0xFF);
+    const __m128i r = _mm_and_si128 (_mm_srli_epi32 (px, 16), byteMask);
+    const __m128i g = _mm_and_si128 (_mm_srli_epi32 (px, 8), byteMask);
+    const __m128i b = _mm_and_si128 (px, byteMask);
+
+
+    //
+    // ColorToHSV()
+    //
+
+    // "b >= g && b >= r", "g >= r" (if not blue) and "otherwise".
+    const __m128i isBlue = _mm_andnot_si128 (
+        _mm_or_si128 (_mm_cmpgt_epi32 (g, b), _mm_cmpgt_epi32 (r, b)),
+        _mm_set1_epi32 (-1));
+    const __m128i isGreen = _mm_andnot_si128 (isBlue,
+        _mm_andnot_si128 (_mm_cmpgt_epi32 (r, g), _mm_set1_epi32 (-1)));
+    const __m128i isRed = _mm_andnot_si128 (_mm_or_si128 (isBlue, isGreen),
+                                            _mm_set1_epi32 (-1));
+
+    const __m128i rgMin = ::Select (_mm_cmpgt_epi32 (r, g), g, r);
+    const __m128i max = ::Select (isBlue, b, ::Select (isGreen, g, r));
+    const __m128i min = ::Select (_mm_cmpgt_epi32 (rgMin, b), b, rgMin);
+    const __m128i hueNumerator = ::Select (isBlue, _mm_sub_epi32 (r, g),
+        ::Select (isGreen, _mm_sub_epi32 (b, r), _mm_sub_epi32 (g, b)));
+    const __m128 hueOffset = _mm_castsi128_ps (_mm_or_si128 (
+        _mm_and_si128 (isBlue, _mm_castps_si128 (_mm_set1_ps (static_cast <float> (2) / 3))),
+        _mm_and_si128 (isGreen, _mm_castps_si128 (_mm_set1_ps (static_cast <float> (1) / 3)))));
+
+    const __m128i range = _mm_sub_epi32 (max, min);
+    const __m128 hasHue = _mm_castsi128_ps (_mm_andnot_si128 (
+        _mm_cmpeq_epi32 (range, _mm_setzero_si128 ()), _mm_set1_epi32 (-1)));
+    const __m128 maxFloat = _mm_cvtepi32_ps (max);
+
+    // (0/0's in the lanes without a hue are masked out)
+    __m128 h = _mm_div_ps (_mm_cvtepi32_ps (hueNumerator),
+        _mm_cvtepi32_ps (_mm_add_epi32 (_mm_slli_epi32 (range, 2),
+                                        _mm_slli_epi32 (range, 1))));
+    // (the offset is 0 for red, so this leaves it alone)
+    h = _mm_add_ps (h, hueOffset);
+    h = _mm_add_ps (h, _mm_and_ps (
+        _mm_and_ps (_mm_castsi128_ps (isRed), _mm_cmplt_ps (h, _mm_setzero_ps ())),
+        _mm_set1_ps (1.0f)));
+    h = _mm_and_ps (hasHue, h);
+
+    __m128 s = _mm_sub_ps (_mm_set1_ps (1.0f),
+                           _mm_div_ps (_mm_cvtepi32_ps (min), maxFloat));
+    s = _mm_and_ps (hasHue, s);
+
+    __m128 v = _mm_div_ps (maxFloat, _mm_set1_ps (255.0f));
+
+
+    //
+    // AdjustHSVInternal()
+    //
+
+    h = _mm_add_ps (h, _mm_set1_ps (hueDiv360));
+    h = _mm_sub_ps (h, ::FloorFloats (h));
+
+    s = _mm_max_ps (_mm_min_ps (_mm_add_ps (s, _mm_set1_ps (saturation)),
+                                _mm_set1_ps (1.0f)),
+                    _mm_setzero_ps ());
+    v = _mm_max_ps (_mm_min_ps (_mm_add_ps (v, _mm_set1_ps (value)),
+                                _mm_set1_ps (1.0f)),
+                    _mm_setzero_ps ());
+
+
+    //
+    // HSVToColor()
+    //
+
+    const __m128 hue6 = _mm_mul_ps (h, _mm_set1_ps (5.999999f));
+    const __m128i sector = _mm_cvttps_epi32 (hue6);
+    const __m128 f = _mm_sub_ps (hue6, _mm_cvtepi32_ps (sector));
+
+    const __m128i isEven = _mm_cmpeq_epi32 (
+        _mm_and_si128 (sector, _mm_set1_epi32 (1)), _mm_setzero_si128 ());
+
+    const __m128d one = _mm_set1_pd (1.0);
+
+    __m128d vLanes [2], sLanes [2], fLanes [2], pLanes [2], qLanes [2];
+    vLanes [0] = _mm_cvtps_pd (v);
+    vLanes [1] = _mm_cvtps_pd (_mm_movehl_ps (v, v));
+    sLanes [0] = _mm_cvtps_pd (s);
+    sLanes [1] = _mm_cvtps_pd (_mm_movehl_ps (s, s));
+    fLanes [0] = _mm_cvtps_pd (f);
+    fLanes [1] = _mm_cvtps_pd (_mm_movehl_ps (f, f));
+    const __m128d evenLanes [2] = {
+        _mm_castsi128_pd (_mm_unpacklo_epi32 (isEven, isEven)),
+        _mm_castsi128_pd (_mm_unpackhi_epi32 (isEven, isEven))
+    };
+
+    for (int i = 0; i < 2; i++)
+    {
+        pLanes [i] = _mm_mul_pd (vLanes [i], _mm_sub_pd (one, sLanes [i]));
+
+        const __m128d t = ::Select (evenLanes [i],
+                                    _mm_sub_pd (one, fLanes [i]), fLanes [i]);
+        qLanes [i] = _mm_mul_pd (vLanes [i],
+            _mm_sub_pd (one, _mm_mul_pd (t, sLanes [i])));
+    }
+
+    // <p> and <q> are floats.
+    ::RoundToFloats (&pLanes [0], &pLanes [1]);
+    ::RoundToFloats (&qLanes [0], &qLanes [1]);
+
+    const __m128i V = ::ScaleToInts (vLanes [0], vLanes [1]);
+    const __m128i P = ::ScaleToInts (pLanes [0], pLanes [1]);
+    const __m128i Q = ::ScaleToInts (qLanes [0], qLanes [1]);
+
+    const auto isSector = [sector] (int i) {
+        return _mm_cmpeq_epi32 (sector, _mm_set1_epi32 (i));
+    };
+
+    // Sectors 0-5 give (red, green, blue) =
+    // (V, Q, P), (Q, V, P), (P, V, Q), (P, Q, V), (Q, P, V) and (V, P, Q).
+    const __m128i outR = ::Select (_mm_or_si128 (isSector (0), isSector (5)), V,
+        ::Select (_mm_or_si128 (isSector (1), isSector (4)), Q, P));
+    const __m128i outG = ::Select (_mm_or_si128 (isSector (1), isSector (2)), V,
+        ::Select (_mm_or_si128 (isSector (0), isSector (3)), Q, P));
+    const __m128i outB = ::Select (_mm_or_si128 (isSector (3), isSector (4)), V,
+        ::Select (_mm_or_si128 (isSector (2), isSector (5)), Q, P));
+
+    const __m128i out = _mm_or_si128 (
+        _mm_and_si128 (px, _mm_set1_epi32 (static_cast <int> (0xFF000000))),
+        _mm_or_si128 (_mm_slli_epi32 (outR, 16),
+                      _mm_or_si128 (_mm_slli_epi32 (outG, 8), outB)));
+    _mm_storeu_si128 (reinterpret_cast <__m128i *> (pixels), out);
+}
+
+#endif  // __SSE2__
+
+// Remembers the results of AdjustHSVInternal() for recently seen colours
+// since drawings tend to have lots of pixels of the same few colours.
+struct AdjustHSVCache
+{
+    enum { Size = 1024 };
+
+    AdjustHSVCache ()
+        : rgbs (Size, 0xFFFFFFFF),
+          results (Size)
+    {
+    }
+
+    static int slot (QRgb rgb)
+    {
+        return static_cast <int> ((rgb * 2654435761u) >> 22);
+    }
+
+    // Indexed by slot().  The alpha of <rgbs> and <results> is 0, except
+    // for the empty slots in <rgbs>.
+    QVector <QRgb> rgbs, results;
+};
+
+// Adjusts the first <count> (at most 4) of <pixels> like
+// AdjustHSVInternal().
+static void AdjustHSVUpTo4 (QRgb *pixels, int count,
+                            float hueDiv360, float saturation, float value)
+{
+#if defined (__SSE2__)
+    if (count == 4)
+    {
+        ::AdjustHSV4 (pixels, hueDiv360, saturation, value);
+        return;
+    }
+
+    QRgb padded [4] = {pixels [0], pixels [0], pixels [0], pixels [0]};
+    for (int i = 0; i < count; i++) {
+        padded [i] = pixels [i];
+    }
+    ::AdjustHSV4 (padded, hueDiv360, saturation, value);
+    for (int i = 0; i < count; i++) {
+        pixels [i] = padded [i];
+    }
+#else
+    for (int i = 0; i < count; i++) {
+        pixels [i] = ::AdjustHSVInternal (pixels [i], hueDiv360, saturation, value);
+    }
+#endif
+}
+
+// Adjusts <count> pixels of a Format_ARGB32, Format_ARGB32_Premultiplied
+// or Format_RGB32 scanline in place, exactly like AdjustHSVInternal().
+// <alphaBits> are OR-ed into every result (like QImage::setPixel()).
+//
+// For the premultiplied format, this operates on the premultiplied values,
+// like AdjustHSVInternal() on QImage::pixel().
+//
+// Looks up and remembers the results in <cache>, unless it is 0.  Returns
+// the number of pixels that were found in <cache>.
+static int AdjustHSVScanline (QRgb *pixels, int count, QRgb alphaBits,
+                              float hueDiv360, float saturation, float value,
+                              AdjustHSVCache *cache)
+{
+    if (!cache)
+    {
+        for (int x = 0; x < count; x += 4) {
+            ::AdjustHSVUpTo4 (pixels + x, qMin (4, count - x),
+                              hueDiv360, saturation, value);
+        }
+
+        if (alphaBits)
+        {
+            for (int x = 0; x < count; x++) {
+                pixels [x] |= alphaBits;
+            }
+        }
+
+        return 0;
+    }
+
+    // The pixels not in the cache, up to 4 at a time.
+    QRgb missed [4];
+    int missedX [4];
+    int numMissed = 0;
+
+    const auto adjustMissed = [&] ()
+    {
+        ::AdjustHSVUpTo4 (missed, numMissed, hueDiv360, saturation, value);
+
+        for (int i = 0; i < numMissed; i++)
+        {
+            const QRgb rgb = pixels [missedX [i]] & 0x00FFFFFF;
+            const int slot = AdjustHSVCache::slot (rgb);
+            cache->rgbs [slot] = rgb;
+            cache->results [slot] = missed [i] & 0x00FFFFFF;
+
+            pixels [missedX [i]] = missed [i] | alphaBits;
+        }
+
+        numMissed = 0;
+    };
+
+    int numHits = 0;
+    for (int x = 0; x < count; x++)
+    {
+        const QRgb rgb = pixels [x] & 0x00FFFFFF;
+        const int slot = AdjustHSVCache::slot (rgb);
+        if (cache->rgbs [slot] == rgb)
+        {
+            pixels [x] = cache->results [slot] | (pixels [x] & 0xFF000000) | alphaBits;
+            numHits++;
+            continue;
+        }
+
+        missed [numMissed] = pixels [x];
+        missedX [numMissed] = x;
+        if (++numMissed == 4) {
+            adjustMissed ();
+        }
+    }
+
+    if (numMissed > 0) {
+        adjustMissed ();
+    }
+
+    return numHits;
+}
+
 static void AdjustHSV (QImage* pImage, double hue, double saturation, double value)
 {
     hue /= 360;
 
-    if (pImage->depth () > 8)
+    const QImage::Format format = pImage->format ();
+    if (format == QImage::Format_ARGB32 ||
+        format == QImage::Format_ARGB32_Premultiplied ||
+        format == QImage::Format_RGB32)
+    {
+        const QRgb alphaBits = (format == QImage::Format_RGB32) ? 0xFF000000 : 0;
+        const int width = pImage->width ();
+
+        uchar *bits = pImage->bits ();
+        const int bytesPerLine = pImage->bytesPerLine ();
+
+        kpParallel::forRanges (0, pImage->height (), 32,
+            [&] (int beginY, int endY)
+            {
+                AdjustHSVCache cache;
+                bool useCache = true;
+                for (int y = beginY; y < endY; y++)
+                {
+                    // Photos have too many colours for the cache to pay
+                    // off but check again every so often, in case this
+                    // part of the image is different.
+                    const bool tryCache = useCache || (y - beginY) % 16 == 0;
+
+                    const int numHits = ::AdjustHSVScanline (
+                        reinterpret_cast <QRgb *> (bits + y * bytesPerLine),
+                        width, alphaBits,
+                        static_cast <float> (hue), static_cast <float> (saturation),
+                        static_cast <float> (value),
+                        tryCache ? &cache : nullptr);
+
+                    if (tryCache) {
+                        useCache = (numHits >= width / 4);
+                    }
+                }
+            });
+    }
+    else if (pImage->depth () > 8)
     {
         for (int y = 0; y < pImage->height (); y++)
         {
@@ -187,3 +539,13 @@ kpImage kpEffectHSV::applyEffect (const kpImage &image,
     return qimage;
 }
 
+// public static
+void kpEffectHSV::applyToPixels (QRgb *pixels, int count,
+                                 double hue, double saturation, double value)
+{
+    ::AdjustHSVScanline (pixels, count, 0/*alphaBits*/,
+        static_cast <float> (hue / 360), static_cast <float> (saturation),
+        static_cast <float> (value),
+        nullptr/*no cache*/);
+}
+
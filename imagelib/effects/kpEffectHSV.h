@@ -38,6 +38,11 @@ class kpEffectHSV
 public:
     static kpImage applyEffect (const kpImage &image,
         double hue, double saturation, double value);
+
+    // Adjusts <count> pixels in place, exactly like applyEffect() adjusts
+    // the values returned by QImage::pixel().  For kpEffectPipeline.
+    static void applyToPixels (QRgb *pixels, int count,
+        double hue, double saturation, double value);
 };
 
 
@@ -0,0 +1,505 @@
+/*
+   Copyright (c) 2026 The KolourPaint Authors
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+   OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+   IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+   INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+   NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+   THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#define DEBUG_KP_EFFECT_PIPELINE 0
+
+
+#include "kpEffectPipeline.h"
+
+#include <algorithm>
+
+#include "kpLogCategories.h"
+
+#include "generic/kpParallel.h"
+#include "imagelib/effects/kpEffectBalance.h"
+#include "imagelib/effects/kpEffectGrayscale.h"
+#include "imagelib/effects/kpEffectHSV.h"
+#include "imagelib/effects/kpEffectInvert.h"
+
+//---------------------------------------------------------------------
+
+// One step of kpEffectPipeline::apply(), on the values that QImage::pixel()
+// would return.
+struct kpEffectPipelineKernel
+{
+    enum Type
+    {
+        // Maps the red, green and blue through <tables> [0], [1] and [2].
+        ChannelTables,
+
+        Grayscale,
+
+        // Uses <hue>, <saturation> and <value>.
+        HSV,
+
+        // Inverts the unpremultiplied colour, like QImage::invertPixels()
+        // does for Format_ARGB32_Premultiplied.
+        InvertPremultiplied
+    };
+
+    Type type;
+    quint8 tables [3][256];
+    double hue, saturation, value;
+};
+
+//---------------------------------------------------------------------
+
+// Pixels are pushed through all the kernels this many at a time, so that
+// they stay in the cache from one kernel to the next.
+static const int ChunkSize = 256;
+
+//---------------------------------------------------------------------
+
+static void RunKernel (const kpEffectPipelineKernel &kernel,
+                       QRgb *pixels, int count)
+{
+    switch (kernel.type)
+    {
+    case kpEffectPipelineKernel::ChannelTables:
+        for (int i = 0; i < count; i++)
+        {
+            const QRgb rgb = pixels [i];
+            pixels [i] = qRgba (kernel.tables [0][qRed (rgb)],
+                                kernel.tables [1][qGreen (rgb)],
+                                kernel.tables [2][qBlue (rgb)],
+                                qAlpha (rgb));
+        }
+        break;
+
+    case kpEffectPipelineKernel::Grayscale:
+        kpEffectGrayscale::applyToPixels (pixels, count);
+        break;
+
+    case kpEffectPipelineKernel::HSV:
+        kpEffectHSV::applyToPixels (pixels, count,
+            kernel.hue, kernel.saturation, kernel.value);
+        break;
+
+    case kpEffectPipelineKernel::InvertPremultiplied:
+        for (int i = 0; i < count; i++) {
+            pixels [i] = qPremultiply (qUnpremultiply (pixels [i]) ^ 0x00FFFFFF);
+        }
+        break;
+    }
+}
+
+//---------------------------------------------------------------------
+
+static void RunKernels (const QVector <kpEffectPipelineKernel> &kernels,
+                        QRgb *pixels, int count)
+{
+    for (const kpEffectPipelineKernel &kernel : kernels) {
+        ::RunKernel (kernel, pixels, count);
+    }
+}
+
+//---------------------------------------------------------------------
+
+// Remembers the results of the kernels for recently seen pixels, since
+// drawings tend to have lots of pixels of the same few colours.  Only
+// worth it for the slow kernels (see kpEffectHSV's cache).
+struct kpEffectPipelineCache
+{
+    enum { Size = 1024 };
+
+    kpEffectPipelineCache ()
+        // (no pixel is ~0 when widened)
+        : pixels (Size, ~quint64 (0)),
+          results (Size)
+    {
+    }
+
+    static int slot (QRgb rgb)
+    {
+        return static_cast <int> ((rgb * 2654435761u) >> 22);
+    }
+
+    QVector <quint64> pixels;
+    QVector <QRgb> results;
+};
+
+//---------------------------------------------------------------------
+
+// Applies <kernels> to the <count> pixels of <in>, writing them to <out>.
+// <alphaBits> are OR-ed into every pixel first (like QImage::pixel()).
+//
+// Looks up and remembers the results in <cache>, unless it is 0.  Returns
+// the number of pixels that were found in <cache>.
+static int ApplyKernelsToChunk (const QVector <kpEffectPipelineKernel> &kernels,
+                                const QRgb *in, QRgb *out, int count,
+                                QRgb alphaBits,
+                                kpEffectPipelineCache *cache)
+{
+    if (!cache)
+    {
+        for (int x = 0; x < count; x++) {
+            out [x] = in [x] | alphaBits;
+        }
+        ::RunKernels (kernels, out, count);
+        return 0;
+    }
+
+    QRgb missed [ChunkSize];
+    int missedX [ChunkSize];
+    int numMissed = 0;
+    int numHits = 0;
+
+    for (int x = 0; x < count; x++)
+    {
+        const QRgb rgb = in [x] | alphaBits;
+        const int slot = kpEffectPipelineCache::slot (rgb);
+        if (cache->pixels [slot] == rgb)
+        {
+            out [x] = cache->results [slot];
+            numHits++;
+            continue;
+        }
+
+        missed [numMissed] = rgb;
+        missedX [numMissed] = x;
+        numMissed++;
+    }
+
+    if (numMissed == 0) {
+        return numHits;
+    }
+
+    ::RunKernels (kernels, missed, numMissed);
+
+    for (int i = 0; i < numMissed; i++)
+    {
+        const QRgb rgb = in [missedX [i]] | alphaBits;
+        const int slot = kpEffectPipelineCache::slot (rgb);
+        cache->pixels [slot] = rgb;
+        cache->results [slot] = missed [i];
+
+        out [missedX [i]] = missed [i];
+    }
+
+    return numHits;
+}
+
+//---------------------------------------------------------------------
+
+kpEffectPipeline::kpEffectPipeline () = default;
+
+//---------------------------------------------------------------------
+
+// public
+void kpEffectPipeline::addBalance (int channels,
+        int brightness, int contrast, int gamma)
+{
+    Effect effect {};
+    effect.type = Effect::Balance;
+    effect.channels = channels;
+    effect.brightness = brightness;
+    effect.contrast = contrast;
+    effect.gamma = gamma;
+    m_effects.append (effect);
+}
+
+//---------------------------------------------------------------------
+
+// public
+void kpEffectPipeline::addGrayscale ()
+{
+    Effect effect {};
+    effect.type = Effect::Grayscale;
+    m_effects.append (effect);
+}
+
+//---------------------------------------------------------------------
+
+// public
+void kpEffectPipeline::addHSV (double hue, double saturation, double value)
+{
+    Effect effect {};
+    effect.type = Effect::HSV;
+    effect.hue = hue;
+    effect.saturation = saturation;
+    effect.value = value;
+    m_effects.append (effect);
+}
+
+//---------------------------------------------------------------------
+
+// public
+void kpEffectPipeline::addInvert (int channels)
+{
+    Effect effect {};
+    effect.type = Effect::Invert;
+    effect.channels = channels;
+    m_effects.append (effect);
+}
+
+//---------------------------------------------------------------------
+
+// public
+bool kpEffectPipeline::isEmpty () const
+{
+    return m_effects.isEmpty ();
+}
+
+//---------------------------------------------------------------------
+
+// public
+int kpEffectPipeline::count () const
+{
+    return m_effects.count ();
+}
+
+//---------------------------------------------------------------------
+
+// public
+bool kpEffectPipeline::isInvertible () const
+{
+    // (inverting different channels, one after the other, is invertible too
+    //  but for premultiplied pixels only approximately)
+    return (m_effects.count () == 1 && m_effects [0].type == Effect::Invert);
+}
+
+//---------------------------------------------------------------------
+
+// private
+QVector <kpEffectPipelineKernel> kpEffectPipeline::kernels (
+        QImage::Format format) const
+{
+    QVector <kpEffectPipelineKernel> kernels;
+
+    // Maps the channels through <red>, <green> and <blue>, after the
+    // previous kernel's tables, if it has some.
+    const auto addChannelTables = [&kernels] (const quint8 *red,
+                                              const quint8 *green,
+                                              const quint8 *blue)
+    {
+        const quint8 *newTables [3] = {red, green, blue};
+
+        if (kernels.isEmpty () ||
+            kernels.last ().type != kpEffectPipelineKernel::ChannelTables)
+        {
+            kpEffectPipelineKernel kernel {};
+            kernel.type = kpEffectPipelineKernel::ChannelTables;
+            for (int c = 0; c < 3; c++) {
+                std::copy (newTables [c], newTables [c] + 256, kernel.tables [c]);
+            }
+            kernels.append (kernel);
+            return;
+        }
+
+        kpEffectPipelineKernel &kernel = kernels.last ();
+        for (int c = 0; c < 3; c++)
+        {
+            for (int i = 0; i < 256; i++) {
+                kernel.tables [c][i] = newTables [c][kernel.tables [c][i]];
+            }
+        }
+    };
+
+    for (const Effect &effect : m_effects)
+    {
+        switch (effect.type)
+        {
+        case Effect::Balance:
+        {
+            quint8 red [256], green [256], blue [256];
+            kpEffectBalance::channelTables (effect.channels,
+                effect.brightness, effect.contrast, effect.gamma,
+                red, green, blue);
+            addChannelTables (red, green, blue);
+            break;
+        }
+
+        case Effect::Grayscale:
+        {
+            kpEffectPipelineKernel kernel {};
+            kernel.type = kpEffectPipelineKernel::Grayscale;
+            kernels.append (kernel);
+            break;
+        }
+
+        case Effect::HSV:
+        {
+            kpEffectPipelineKernel kernel {};
+            kernel.type = kpEffectPipelineKernel::HSV;
+            kernel.hue = effect.hue;
+            kernel.saturation = effect.saturation;
+            kernel.value = effect.value;
+            kernels.append (kernel);
+            break;
+        }
+
+        case Effect::Invert:
+        {
+            // kpEffectInvert::applyEffect() leaves inverting all the
+            // channels to QImage::invertPixels(), which doesn't invert
+            // premultiplied values directly.
+            if (effect.channels == kpEffectInvert::RGB &&
+                format == QImage::Format_ARGB32_Premultiplied)
+            {
+                kpEffectPipelineKernel kernel {};
+                kernel.type = kpEffectPipelineKernel::InvertPremultiplied;
+                kernels.append (kernel);
+                break;
+            }
+
+            quint8 identity [256], inverted [256];
+            for (int i = 0; i < 256; i++)
+            {
+                identity [i] = static_cast <quint8> (i);
+                inverted [i] = static_cast <quint8> (255 - i);
+            }
+            addChannelTables (
+                (effect.channels & kpEffectInvert::Red) ? inverted : identity,
+                (effect.channels & kpEffectInvert::Green) ? inverted : identity,
+                (effect.channels & kpEffectInvert::Blue) ? inverted : identity);
+            break;
+        }
+        }
+    }
+
+    return kernels;
+}
+
+//---------------------------------------------------------------------
+
+// public
+kpImage kpEffectPipeline::apply (const kpImage &image) const
+{
+#if DEBUG_KP_EFFECT_PIPELINE
+    qCDebug(kpLogImagelib) << "kpEffectPipeline::apply() numEffects=" << m_effects.count ()
+              << "format=" << image.format ();
+#endif
+
+    if (m_effects.isEmpty () || image.isNull ()) {
+        return image;
+    }
+
+    const QImage::Format format = image.format ();
+    if (format != QImage::Format_ARGB32 &&
+        format != QImage::Format_ARGB32_Premultiplied &&
+        format != QImage::Format_RGB32)
+    {
+        // Document images are never in these formats: just apply the
+        // effects one after the other.
+        kpImage result = image;
+        for (const Effect &effect : m_effects)
+        {
+            switch (effect.type)
+            {
+            case Effect::Balance:
+                result = kpEffectBalance::applyEffect (result, effect.channels,
+                    effect.brightness, effect.contrast, effect.gamma);
+                break;
+
+            case Effect::Grayscale:
+                result = kpEffectGrayscale::applyEffect (result);
+                break;
+
+            case Effect::HSV:
+                result = kpEffectHSV::applyEffect (result,
+                    effect.hue, effect.saturation, effect.value);
+                break;
+
+            case Effect::Invert:
+                result = kpEffectInvert::applyEffect (result, effect.channels);
+                break;
+            }
+        }
+        return result;
+    }
+
+
+    const QVector <kpEffectPipelineKernel> kernels = this->kernels (format);
+#if DEBUG_KP_EFFECT_PIPELINE
+    qCDebug(kpLogImagelib) << "\tnumKernels=" << kernels.count ();
+#endif
+
+    bool canUseCache = false;
+    for (const kpEffectPipelineKernel &kernel : kernels)
+    {
+        if (kernel.type == kpEffectPipelineKernel::HSV) {
+            canUseCache = true;
+        }
+    }
+
+    // (like QImage::pixel() and QImage::setPixel())
+    const QRgb alphaBits = (format == QImage::Format_RGB32) ? 0xFF000000 : 0;
+    const int width = image.width ();
+
+    // Write straight into a new image instead of copying <image> first.
+    QImage result (image.size (), format);
+    result.setDotsPerMeterX (image.dotsPerMeterX ());
+    result.setDotsPerMeterY (image.dotsPerMeterY ());
+    result.setOffset (image.offset ());
+    for (const QString &key : image.textKeys ()) {
+        result.setText (key, image.text (key));
+    }
+
+    if (result.isNull ()) {
+        return result;
+    }
+
+    // The workers must not call the non-const QImage::scanLine(), which
+    // would detach <result> from each thread at once.
+    uchar *resultBits = result.bits ();
+    const int resultBytesPerLine = result.bytesPerLine ();
+
+    kpParallel::forRanges (0, image.height (), 32,
+        [&] (int beginY, int endY)
+        {
+            kpEffectPipelineCache cache;
+            bool useCache = canUseCache;
+            for (int y = beginY; y < endY; y++)
+            {
+                // Photos have too many colours for the cache to pay off but
+                // check again every so often, in case this part of the
+                // image is different.
+                const bool tryCache = canUseCache &&
+                    (useCache || (y - beginY) % 16 == 0);
+
+                const QRgb *in = reinterpret_cast <const QRgb *> (image.constScanLine (y));
+                QRgb *out = reinterpret_cast <QRgb *> (resultBits + y * resultBytesPerLine);
+
+                int numHits = 0;
+                for (int x = 0; x < width; x += ChunkSize)
+                {
+                    numHits += ::ApplyKernelsToChunk (kernels,
+                        in + x, out + x, qMin (ChunkSize, width - x),
+                        alphaBits,
+                        tryCache ? &cache : nullptr);
+                }
+
+                if (tryCache) {
+                    useCache = (numHits >= width / 4);
+                }
+            }
+        });
+
+    return result;
+}
+
+//---------------------------------------------------------------------
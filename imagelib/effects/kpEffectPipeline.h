@@ -0,0 +1,96 @@
+/*
+   Copyright (c) 2026 The KolourPaint Authors
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+   OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+   IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+   INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+   NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+   THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef kpEffectPipeline_H
+#define kpEffectPipeline_H
+
+
+#include <QVector>
+
+#include "imagelib/kpImage.h"
+
+
+struct kpEffectPipelineKernel;
+
+
+//
+// A chain of per-pixel effects, applied to an image in a single pass.
+//
+// Running Balance, then Hue/Saturation/Value, then Invert as separate
+// effects reads and writes the whole image 3 times.  Here, each chunk of
+// a scanline goes through every effect while it is still in the cache
+// and adjacent channel table effects (Balance and Invert) are merged into
+// one set of tables.  The rows are split across kpParallel's threads.
+//
+// The result is exactly the same as applying each effect's applyEffect()
+// in turn.
+//
+class kpEffectPipeline
+{
+public:
+    kpEffectPipeline ();
+
+    // The effects are applied in the order that they are added, with the
+    // same arguments as their applyEffect().
+    void addBalance (int channels, int brightness, int contrast, int gamma);
+    void addGrayscale ();
+    void addHSV (double hue, double saturation, double value);
+    void addInvert (int channels);
+
+    bool isEmpty () const;
+    int count () const;
+
+    // Returns true if applying the pipeline twice gives the original
+    // image (as for kpEffectCommandBase::isInvertible()).
+    bool isInvertible () const;
+
+    kpImage apply (const kpImage &image) const;
+
+private:
+    // Returns the steps that apply the effects to the pixels of an image
+    // of <format> (Format_ARGB32, Format_ARGB32_Premultiplied or
+    // Format_RGB32).
+    QVector <kpEffectPipelineKernel> kernels (QImage::Format format) const;
+
+    struct Effect
+    {
+        enum Type
+        {
+            Balance, Grayscale, HSV, Invert
+        };
+
+        Type type;
+        int channels;
+        int brightness, contrast, gamma;
+        double hue, saturation, value;
+    };
+
+    QVector <Effect> m_effects;
+};
+
+
+#endif  // kpEffectPipeline_H
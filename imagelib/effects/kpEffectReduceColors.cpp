@@ -66,14 +66,15 @@ static QImage::Format DepthToFormat (int depth)
 //---------------------------------------------------------------------
 
 // public static
-QImage kpEffectReduceColors::convertImageDepth (const QImage &image, int depth, bool dither)
+QImage kpEffectReduceColors::convertImageDepth (const QImage &image, int depth,
+        kpColorQuantizer::DitherMode ditherMode)
 {
 #if DEBUG_KP_EFFECT_REDUCE_COLORS
     qCDebug(kpLogImagelib) << "kpeffectreducecolors.cpp:ConvertImageDepth() changing image (w=" << image.width ()
                << ",h=" << image.height ()
                << ") depth from " << image.depth ()
                 << " to " << depth
-                << " (dither=" << dither << ")"
+                << " (ditherMode=" << ditherMode << ")"
                 << endl;
 #endif
 
@@ -98,88 +99,29 @@ QImage kpEffectReduceColors::convertImageDepth (const QImage &image, int depth,
 #endif
 
 
-    // Hack around Qt's braindead QImage::convertToFormat(QImage::Format_MonoLSB, ...)
-    // (with dithering off) which produces pathetic results with an image that
-    // only has 2 colors - sometimes it just gives a completely black
-    // result (try yellow and white as input).  Instead, we simply preserve
-    // the 2 colours.
-    //
-    // One use case is resaving a "color monochrome" image (<= 2 colors but
-    // not necessarily black & white).
-    if (depth == 1 && !dither)
+    // Qt's QImage::convertToFormat(QImage::Format_MonoLSB, ...) (with
+    // dithering off) produces pathetic results with an image that only has
+    // 2 colors - sometimes it just gives a completely black result (try
+    // yellow and white as input) - and its 8-bit palettes are fixed or
+    // slow to choose.  kpColorQuantizer preserves images that already fit
+    // (e.g. when resaving a "color monochrome" image) and chooses a palette
+    // from the image otherwise.
+    if (depth == 1)
     {
     #if DEBUG_KP_EFFECT_REDUCE_COLORS
-        qCDebug(kpLogImagelib) << "\tinvoking convert-to-depth 1 hack";
+        qCDebug(kpLogImagelib) << "\tinvoking kpColorQuantizer::convertToMonochrome()";
     #endif
-        QRgb color0 = 0, color1 = 0;
-        bool color0Valid = false, color1Valid = false;
-
-        bool moreThan2Colors = false;
-
-        QImage monoImage (image.width (), image.height (), QImage::Format_MonoLSB);
-        monoImage.setColorCount (2);
+        return kpColorQuantizer::convertToMonochrome (image, ditherMode);
+    }
+    if (depth == 8)
+    {
     #if DEBUG_KP_EFFECT_REDUCE_COLORS
-        qCDebug(kpLogImagelib) << "\t\tinitialising output image w=" << monoImage.width ()
-                   << ",h=" << monoImage.height ()
-                   << ",d=" << monoImage.depth ();
+        qCDebug(kpLogImagelib) << "\tinvoking kpColorQuantizer::convertToIndexed8()";
     #endif
-        for (int y = 0; y < image.height (); y++)
-        {
-            for (int x = 0; x < image.width (); x++)
-            {
-                // (this can be transparent)
-                QRgb imagePixel = image.pixel (x, y);
-
-                if (color0Valid && imagePixel == color0) {
-                    monoImage.setPixel (x, y, 0);
-                }
-                else if (color1Valid && imagePixel == color1) {
-                    monoImage.setPixel (x, y, 1);
-                }
-                else if (!color0Valid) {
-                    color0 = imagePixel;
-                    color0Valid = true;
-                    monoImage.setPixel (x, y, 0);
-                #if DEBUG_KP_EFFECT_REDUCE_COLORS
-                    qCDebug(kpLogImagelib) << "\t\t\tcolor0=" << (int *) color0
-                               << " at x=" << x << ",y=" << y;
-                #endif
-                }
-                else if (!color1Valid)
-                {
-                    color1 = imagePixel;
-                    color1Valid = true;
-                    monoImage.setPixel (x, y, 1);
-                #if DEBUG_KP_EFFECT_REDUCE_COLORS
-                    qCDebug(kpLogImagelib) << "\t\t\tcolor1=" << (int *) color1
-                               << " at x=" << x << ",y=" << y;
-                #endif
-                }
-                else
-                {
-                #if DEBUG_KP_EFFECT_REDUCE_COLORS
-                    qCDebug(kpLogImagelib) << "\t\t\timagePixel=" << (int *) imagePixel
-                               << " at x=" << x << ",y=" << y
-                               << " moreThan2Colors - abort hack";
-                #endif
-                    moreThan2Colors = true;
-
-                    // Dijkstra, this is clearer than double break'ing or
-                    // a check in both loops
-                    goto exit_loop;
-                }
-            }
-        }
-    exit_loop:
-
-        if (!moreThan2Colors)
-        {
-            monoImage.setColor (0, color0Valid ? color0 : 0xFFFFFF);
-            monoImage.setColor (1, color1Valid ? color1 : 0x000000);
-            return monoImage;
-        }
+        return kpColorQuantizer::convertToIndexed8 (image, 256, ditherMode);
     }
 
+    const bool dither = (ditherMode != kpColorQuantizer::NoDither);
     QImage retImage = image.convertToFormat (::DepthToFormat (depth),
         Qt::AutoColor |
         (dither ? Qt::DiffuseDither : Qt::ThresholdDither) |
@@ -208,7 +150,8 @@ QImage kpEffectReduceColors::convertImageDepth (const QImage &image, int depth,
 //---------------------------------------------------------------------
 
 // public static
-void kpEffectReduceColors::applyEffect (QImage *destPtr, int depth, bool dither)
+void kpEffectReduceColors::applyEffect (QImage *destPtr, int depth,
+        kpColorQuantizer::DitherMode ditherMode)
 {
     if (!destPtr) {
         return;
@@ -219,7 +162,7 @@ void kpEffectReduceColors::applyEffect (QImage *destPtr, int depth, bool dither)
         return;
     }
 
-    *destPtr = convertImageDepth(*destPtr, depth, dither);
+    *destPtr = convertImageDepth(*destPtr, depth, ditherMode);
 
     // internally we always use QImage::Format_ARGB32_Premultiplied and
     // this effect is just an "effect" in that it changes the image (the look) somehow
@@ -230,10 +173,11 @@ void kpEffectReduceColors::applyEffect (QImage *destPtr, int depth, bool dither)
 
 //---------------------------------------------------------------------
 
-QImage kpEffectReduceColors::applyEffect (const QImage &pm, int depth, bool dither)
+QImage kpEffectReduceColors::applyEffect (const QImage &pm, int depth,
+        kpColorQuantizer::DitherMode ditherMode)
 {
     QImage ret = pm;
-    applyEffect (&ret, depth, dither);
+    applyEffect (&ret, depth, ditherMode);
     return ret;
 }
 
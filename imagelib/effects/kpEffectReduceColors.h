@@ -31,6 +31,8 @@
 
 #include <QImage>
 
+#include "imagelib/kpColorQuantizer.h"
+
 // The <depth> specified must be supported by QImage.
 class kpEffectReduceColors
 {
@@ -41,10 +43,13 @@ public:
     //      
     //            Also, this can increase the image depth while applyEffect()
     //            will not.
-    static QImage convertImageDepth (const QImage &image, int depth, bool dither);
+    static QImage convertImageDepth (const QImage &image, int depth,
+                                     kpColorQuantizer::DitherMode ditherMode);
 
-    static void applyEffect (QImage *destPixmapPtr, int depth, bool dither);
-    static QImage applyEffect (const QImage &pm, int depth, bool dither);
+    static void applyEffect (QImage *destPixmapPtr, int depth,
+                             kpColorQuantizer::DitherMode ditherMode);
+    static QImage applyEffect (const QImage &pm, int depth,
+                               kpColorQuantizer::DitherMode ditherMode);
 };
 
 
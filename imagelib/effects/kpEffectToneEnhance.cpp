@@ -31,10 +31,16 @@
 
 #include "kpEffectToneEnhance.h"
 
+#include <algorithm>
+
 #include <QImage>
+#include <QList>
+#include <QMutex>
+#include <QVector>
 
 #include "kpLogCategories.h"
 
+#include "generic/kpParallel.h"
 #include "pixmapfx/kpPixmapFX.h"
 
 
@@ -71,6 +77,34 @@ inline unsigned int AdjustTone(unsigned int color, unsigned int oldTone, unsigne
 
 //---------------------------------------------------------------------
 
+// The tone maps of an image, for a granularity.
+struct kpEffectToneEnhanceToneMaps
+{
+  int nGranularity;
+  int areaWid, areaHgt;
+
+  // nGranularity * nGranularity maps of TONE_MAP_SIZE entries, map (u, v)
+  // starting at entry (nGranularity * v + u) * TONE_MAP_SIZE.
+  QVector <unsigned int> maps;
+};
+
+//---------------------------------------------------------------------
+
+// Effect previews apply the effect to the same image over and over, with
+// different settings.  Since the tone maps don't depend on the "amount",
+// remember the last few.
+struct kpEffectToneEnhanceCacheEntry
+{
+  qint64 imageCacheKey;
+  kpEffectToneEnhanceToneMaps toneMaps;
+};
+
+static QMutex ToneMapsCacheMutex;
+static QList <kpEffectToneEnhanceCacheEntry> ToneMapsCache;
+static const int ToneMapsCacheMaxEntries = 2;
+
+//---------------------------------------------------------------------
+
 class kpEffectToneEnhanceApplier
 {
   public:
@@ -80,77 +114,54 @@ class kpEffectToneEnhanceApplier
     void BalanceImageTone(QImage* pImage, double granularity, double amount);
 
   protected:
-    int m_nToneMapGranularity, m_areaWid, m_areaHgt;
-    unsigned int m_nComputedWid, m_nComputedHgt;
-    // LOTODO: Use less error-prone QTL containers instead.
-    unsigned int* m_pHistogram;
-    unsigned int** m_pToneMaps;
-
-    void DeleteToneMaps();
-    unsigned int* MakeToneMap(QImage* pImage, int x, int y, int nGranularity);
-    void ComputeToneMaps(QImage* pImage, int nGranularity);
-    unsigned int InterpolateNewTone(QImage* pImage, unsigned int oldTone, int x, int y, int nGranularity);
+    kpEffectToneEnhanceToneMaps m_toneMaps;
+
+    void GetRegionOrigin(const QImage &image, int u, int v, int* pX, int* pY) const;
+    void ComputeToneMaps(const QImage &image, int nGranularity);
+    void MakeToneMap(const unsigned int* pHistogram, unsigned int* pToneMap) const;
 };
 
 //---------------------------------------------------------------------
 
 kpEffectToneEnhanceApplier::kpEffectToneEnhanceApplier ()
 {
-  m_nToneMapGranularity = 0;
-  m_areaWid = 0;
-  m_areaHgt = 0;
-  m_nComputedWid = 0;
-  m_nComputedHgt = 0;
-  m_pHistogram = new unsigned int[TONE_MAP_SIZE];
-  m_pToneMaps = nullptr;
+  m_toneMaps.nGranularity = 0;
+  m_toneMaps.areaWid = 0;
+  m_toneMaps.areaHgt = 0;
 }
 
 //---------------------------------------------------------------------
 
-kpEffectToneEnhanceApplier::~kpEffectToneEnhanceApplier ()
-{
-  DeleteToneMaps();
-  delete[] m_pHistogram;
-}
+kpEffectToneEnhanceApplier::~kpEffectToneEnhanceApplier () = default;
 
 //---------------------------------------------------------------------
 
 // protected
-void kpEffectToneEnhanceApplier::DeleteToneMaps()
+void kpEffectToneEnhanceApplier::GetRegionOrigin(const QImage &image, int u, int v, int* pX, int* pY) const
 {
-  int nToneMaps = m_nToneMapGranularity * m_nToneMapGranularity;
-  for(int i = 0; i < nToneMaps; i++) {
-      delete[] m_pToneMaps[i];
-  }
-  delete[] m_pToneMaps;
-  m_pToneMaps = nullptr;
-  m_nToneMapGranularity = 0;
-}
+    const int nGranularity = m_toneMaps.nGranularity;
+    const int areaWid = m_toneMaps.areaWid, areaHgt = m_toneMaps.areaHgt;
 
-//---------------------------------------------------------------------
-
-// protected
-unsigned int* kpEffectToneEnhanceApplier::MakeToneMap(QImage* pImage, int u, int v, int nGranularity)
-{
     // Compute the region to make the tone map for
     int xx, yy;
     if(nGranularity > 1)
     {
-        xx = u * (pImage->width() - 1) / (nGranularity - 1) - m_areaWid / 2;
+        xx = u * (image.width() - 1) / (nGranularity - 1) - areaWid / 2;
         if(xx < 0) {
             xx = 0;
         }
-        else if(xx + m_areaWid > pImage->width()) {
-            xx = pImage->width() - m_areaWid;
+        else if(xx + areaWid > image.width()) {
+            xx = image.width() - areaWid;
         }
 
-        yy = v * (pImage->width() - 1) / (nGranularity - 1) - m_areaHgt / 2;
+        // (the width, not the height, has always been used here)
+        yy = v * (image.width() - 1) / (nGranularity - 1) - areaHgt / 2;
 
         if(yy < 0) {
             yy = 0;
         }
-        else if(yy + m_areaHgt > pImage->height()) {
-            yy = pImage->height() - m_areaHgt;
+        else if(yy + areaHgt > image.height()) {
+            yy = image.height() - areaHgt;
         }
     }
     else
@@ -159,99 +170,134 @@ unsigned int* kpEffectToneEnhanceApplier::MakeToneMap(QImage* pImage, int u, int
         yy = 0;
     }
 
-  // Make a tone histogram for the region
-  memset(m_pHistogram, '\0', sizeof(unsigned int) * TONE_MAP_SIZE);
-  int x, y;
-  unsigned int tone;
-  for(y = 0; y < m_areaHgt; y++)
-  {
-    for(x = 0; x < m_areaWid; x++)
-    {
-      tone = ComputeTone(pImage->pixel(xx + x, yy + y));
-      m_pHistogram[tone >> TONE_DROP_BITS]++;
-    }
-  }
+    *pX = xx;
+    *pY = yy;
+}
+
+//---------------------------------------------------------------------
 
+// protected
+void kpEffectToneEnhanceApplier::MakeToneMap(const unsigned int* pHistogram, unsigned int* pToneMap) const
+{
   // Forward sum the tone histogram
+  unsigned int sums[TONE_MAP_SIZE];
+  sums[0] = pHistogram[0];
   int i{};
   for(i = 1; i < TONE_MAP_SIZE; i++) {
-      m_pHistogram[i] += m_pHistogram[i - 1];
+      sums[i] = sums[i - 1] + pHistogram[i];
   }
 
   // Compute the forward contribution to the tone map
-  auto total = m_pHistogram[i - 1];
-  auto *pToneMap = new unsigned int[TONE_MAP_SIZE];
+  auto total = sums[i - 1];
   for(i = 0; i < TONE_MAP_SIZE; i++) {
-      pToneMap[i] = static_cast<uint> (static_cast<unsigned long long int> (m_pHistogram[i] * MAX_TONE_VALUE / total));
+      pToneMap[i] = static_cast<uint> (static_cast<unsigned long long int> (sums[i] * MAX_TONE_VALUE / total));
   }
-/*
-  // Undo the forward sum and reverse sum the tone histogram
-  m_pHistogram[TONE_MAP_SIZE - 1] -= m_pHistogram[TONE_MAP_SIZE - 2];
-  for(i = TONE_MAP_SIZE - 2; i > 0; i--)
-  {
-    m_pHistogram[i] -= m_pHistogram[i - 1];
-    m_pHistogram[i] += m_pHistogram[i + 1];
-  }
-  m_pHistogram[0] += m_pHistogram[1];
-*/
-  return pToneMap;
 }
 
 //---------------------------------------------------------------------
 
-// protected
-void kpEffectToneEnhanceApplier::ComputeToneMaps(QImage* pImage, int nGranularity)
+// Returns the sorted, distinct values of <values>.
+static QVector <int> SortedUnique (QVector <int> values)
 {
-  if(nGranularity == m_nToneMapGranularity && pImage->width() ==
-          static_cast<int> (m_nComputedWid) && pImage->height() == static_cast<int> (m_nComputedHgt))
-  {
-    return; // We've already computed tone maps for this granularity
-  }
-  DeleteToneMaps();
-  m_pToneMaps = new unsigned int*[nGranularity * nGranularity];
-  m_nToneMapGranularity = nGranularity;
-  m_nComputedWid = static_cast<unsigned int> (pImage->width());
-  m_nComputedHgt = static_cast<unsigned int> (pImage->height());
-  int u, v;
-  for(v = 0; v < nGranularity; v++)
-  {
-      for(u = 0; u < nGranularity; u++) {
-          m_pToneMaps[nGranularity * v + u] = MakeToneMap(pImage, u, v, nGranularity);
-      }
-  }
+  std::sort (values.begin (), values.end ());
+  values.erase (std::unique (values.begin (), values.end ()), values.end ());
+  return values;
 }
 
 //---------------------------------------------------------------------
 
 // protected
-unsigned int kpEffectToneEnhanceApplier::InterpolateNewTone(QImage* pImage, unsigned int oldTone, int x, int y, int nGranularity)
+void kpEffectToneEnhanceApplier::ComputeToneMaps(const QImage &image, int nGranularity)
 {
-  oldTone = (oldTone >> TONE_DROP_BITS);
-  if(m_nToneMapGranularity <= 1) {
-      return m_pToneMaps[0][oldTone];
+  const int wid = image.width(), hgt = image.height();
+  m_toneMaps.nGranularity = nGranularity;
+
+  // The regions overlap, so rather than making a histogram of each region,
+  // cut the image into blocks along all the edges of the regions, make a
+  // histogram of each block (reading every pixel once), and add up the
+  // blocks in each region using prefix sums of the block histograms.
+  QVector <int> regionX(nGranularity), regionY(nGranularity);
+  QVector <int> edgesX, edgesY;
+  edgesX << 0 << wid;
+  edgesY << 0 << hgt;
+  for(int i = 0; i < nGranularity; i++)
+  {
+      GetRegionOrigin(image, i, i, &regionX[i], &regionY[i]);
+      edgesX << regionX[i] << regionX[i] + m_toneMaps.areaWid;
+      edgesY << regionY[i] << regionY[i] + m_toneMaps.areaHgt;
   }
-  auto u = x * (nGranularity - 1) / pImage->width();
-  auto v = y * (nGranularity - 1) / pImage->height();
-  auto x1y1 = m_pToneMaps[m_nToneMapGranularity * v + u][oldTone];
-  auto x2y1 = m_pToneMaps[m_nToneMapGranularity * v + u + 1][oldTone];
-  auto x1y2 = m_pToneMaps[m_nToneMapGranularity * (v + 1) + u][oldTone];
-  auto x2y2 = m_pToneMaps[m_nToneMapGranularity * (v + 1) + u + 1][oldTone];
-  auto hFac = x - (u * (pImage->width() - 1) / (nGranularity - 1));
-  if(hFac > m_areaWid) {
-      hFac = m_areaWid;
+  edgesX = ::SortedUnique(edgesX);
+  edgesY = ::SortedUnique(edgesY);
+  const int nBlocksX = edgesX.size() - 1, nBlocksY = edgesY.size() - 1;
+
+  QVector <int> blockOfX(wid);
+  for(int b = 0; b < nBlocksX; b++) {
+      std::fill(blockOfX.begin() + edgesX[b], blockOfX.begin() + edgesX[b + 1], b);
   }
-  unsigned int y1 = (x1y1 * (static_cast<unsigned int> (m_areaWid) - static_cast<unsigned int> (hFac))
-                     + x2y1 * static_cast<unsigned int> (hFac)) / static_cast<unsigned int> (m_areaWid);
 
-  unsigned int y2 = (x1y2 * (static_cast<unsigned int> (m_areaWid) - static_cast<unsigned int> (hFac))
-                     + x2y2 * static_cast<unsigned int> (hFac)) / static_cast<unsigned int> (m_areaWid);
+  // sums[((nBlocksX + 1) * j + i) * TONE_MAP_SIZE + tone] is the number of
+  // pixels with <tone> (>> TONE_DROP_BITS) in the blocks above and to the
+  // left of edge (i, j).
+  const int sumsStride = (nBlocksX + 1) * TONE_MAP_SIZE;
+  QVector <unsigned int> sums(sumsStride * (nBlocksY + 1), 0);
+  unsigned int *pSums = sums.data();
+
+  kpParallel::forEach(nBlocksY, [&](int b)
+  {
+      unsigned int *pRowSums = pSums + sumsStride * (b + 1);
+      for(int y = edgesY[b]; y < edgesY[b + 1]; y++)
+      {
+          const auto *pLine = reinterpret_cast<const QRgb *> (image.constScanLine(y));
+          for(int x = 0; x < wid; x++)
+          {
+              const unsigned int tone = ComputeTone(pLine[x]);
+              pRowSums[(blockOfX[x] + 1) * TONE_MAP_SIZE + (tone >> TONE_DROP_BITS)]++;
+          }
+      }
 
-  int vFac = y - (v * (pImage->height() - 1) / (nGranularity - 1));
-  if(vFac > m_areaHgt) {
-      vFac = m_areaHgt;
+      // Sum along the row of blocks
+      for(int i = 1; i <= nBlocksX; i++)
+      {
+          for(int t = 0; t < TONE_MAP_SIZE; t++) {
+              pRowSums[i * TONE_MAP_SIZE + t] += pRowSums[(i - 1) * TONE_MAP_SIZE + t];
+          }
+      }
+  });
+
+  // Sum down the rows of blocks
+  for(int j = 1; j <= nBlocksY; j++)
+  {
+      unsigned int *pRowSums = pSums + sumsStride * j;
+      const unsigned int *pPrevRowSums = pRowSums - sumsStride;
+      for(int i = 0; i < sumsStride; i++) {
+          pRowSums[i] += pPrevRowSums[i];
+      }
   }
-  return (y1 * (static_cast<unsigned int> (m_areaHgt) - static_cast<unsigned int> (vFac))
-          + y2 * static_cast<unsigned int> (vFac)) / static_cast<unsigned int> (m_areaHgt);
+
+  m_toneMaps.maps.resize(nGranularity * nGranularity * TONE_MAP_SIZE);
+  unsigned int *pMaps = m_toneMaps.maps.data();
+
+  kpParallel::forEach(nGranularity * nGranularity, [&](int i)
+  {
+      const int u = i % nGranularity, v = i / nGranularity;
+      const int x0 = static_cast<int> (std::lower_bound(edgesX.begin(), edgesX.end(), regionX[u]) - edgesX.begin());
+      const int x1 = static_cast<int> (std::lower_bound(edgesX.begin(), edgesX.end(), regionX[u] + m_toneMaps.areaWid) - edgesX.begin());
+      const int y0 = static_cast<int> (std::lower_bound(edgesY.begin(), edgesY.end(), regionY[v]) - edgesY.begin());
+      const int y1 = static_cast<int> (std::lower_bound(edgesY.begin(), edgesY.end(), regionY[v] + m_toneMaps.areaHgt) - edgesY.begin());
+
+      const unsigned int *pTopLeft = pSums + sumsStride * y0 + x0 * TONE_MAP_SIZE;
+      const unsigned int *pTopRight = pSums + sumsStride * y0 + x1 * TONE_MAP_SIZE;
+      const unsigned int *pBottomLeft = pSums + sumsStride * y1 + x0 * TONE_MAP_SIZE;
+      const unsigned int *pBottomRight = pSums + sumsStride * y1 + x1 * TONE_MAP_SIZE;
+
+      // Make a tone histogram for the region
+      unsigned int histogram[TONE_MAP_SIZE];
+      for(int t = 0; t < TONE_MAP_SIZE; t++) {
+          histogram[t] = pBottomRight[t] - pBottomLeft[t] - pTopRight[t] + pTopLeft[t];
+      }
+
+      MakeToneMap(histogram, pMaps + i * TONE_MAP_SIZE);
+  });
 }
 
 //---------------------------------------------------------------------
@@ -262,27 +308,124 @@ void kpEffectToneEnhanceApplier::BalanceImageTone(QImage* pImage, double granula
     if(pImage->width() < MIN_IMAGE_DIM || pImage->height() < MIN_IMAGE_DIM) {
         return; // the image is not big enough to perform this operation
     }
+
+  const QImage::Format originalFormat = pImage->format();
+  if(originalFormat != QImage::Format_ARGB32 &&
+     originalFormat != QImage::Format_ARGB32_Premultiplied &&
+     originalFormat != QImage::Format_RGB32)
+  {
+      *pImage = pImage->convertToFormat(QImage::Format_ARGB32);
+  }
+
+  const int wid = pImage->width(), hgt = pImage->height();
+
   int nGranularity = static_cast<int> (granularity * (MAX_GRANULARITY - 2)) + 1;
-  m_areaWid = pImage->width() / nGranularity;
-  if(m_areaWid < MIN_IMAGE_DIM) {
-      m_areaWid = MIN_IMAGE_DIM;
+  m_toneMaps.areaWid = wid / nGranularity;
+  if(m_toneMaps.areaWid < MIN_IMAGE_DIM) {
+      m_toneMaps.areaWid = MIN_IMAGE_DIM;
   }
-  m_areaHgt = pImage->height() / nGranularity;
-  if(m_areaHgt < MIN_IMAGE_DIM) {
-      m_areaHgt = MIN_IMAGE_DIM;
+  m_toneMaps.areaHgt = hgt / nGranularity;
+  if(m_toneMaps.areaHgt < MIN_IMAGE_DIM) {
+      m_toneMaps.areaHgt = MIN_IMAGE_DIM;
   }
-  ComputeToneMaps(pImage, nGranularity);
-  int x, y;
-  unsigned int oldTone, newTone, col;
-  for(y = 0; y < pImage->height(); y++)
+
+  // (the image's cacheKey() changes as soon as we modify it below)
+  const qint64 imageCacheKey = pImage->cacheKey();
+  bool isCached = false;
+  {
+      QMutexLocker lock(&::ToneMapsCacheMutex);
+      for(int i = 0; i < ::ToneMapsCache.size(); i++)
+      {
+          if(::ToneMapsCache[i].imageCacheKey == imageCacheKey &&
+             ::ToneMapsCache[i].toneMaps.nGranularity == nGranularity)
+          {
+              m_toneMaps = ::ToneMapsCache[i].toneMaps;
+              ::ToneMapsCache.move(i, 0);
+              isCached = true;
+              break;
+          }
+      }
+  }
+  if(!isCached)
+  {
+      ComputeToneMaps(*pImage, nGranularity);
+
+      QMutexLocker lock(&::ToneMapsCacheMutex);
+      const kpEffectToneEnhanceCacheEntry entry = {imageCacheKey, m_toneMaps};
+      ::ToneMapsCache.prepend(entry);
+      while(::ToneMapsCache.size() > ::ToneMapsCacheMaxEntries) {
+          ::ToneMapsCache.removeLast();
+      }
+  }
+
+  // The tone maps to interpolate between and how far between them each
+  // column and row is (see the old InterpolateNewTone()).
+  const unsigned int areaWid = static_cast<unsigned int> (m_toneMaps.areaWid);
+  const unsigned int areaHgt = static_cast<unsigned int> (m_toneMaps.areaHgt);
+  QVector <int> mapX(wid), mapY(hgt);
+  QVector <unsigned int> hFacs(wid), vFacs(hgt);
+  if(nGranularity > 1)
   {
-      for(x = 0; x < pImage->width(); x++)
+      for(int x = 0; x < wid; x++)
       {
-          col = pImage->pixel(x, y);
-          oldTone = ComputeTone(col);
-          newTone = InterpolateNewTone(pImage, oldTone, x, y, nGranularity);
-          pImage->setPixel(x, y, AdjustTone(col, oldTone, newTone, amount));
+          mapX[x] = x * (nGranularity - 1) / wid;
+          hFacs[x] = static_cast<unsigned int> (qMin(m_toneMaps.areaWid,
+              x - (mapX[x] * (wid - 1) / (nGranularity - 1))));
       }
+      for(int y = 0; y < hgt; y++)
+      {
+          mapY[y] = y * (nGranularity - 1) / hgt;
+          vFacs[y] = static_cast<unsigned int> (qMin(m_toneMaps.areaHgt,
+              y - (mapY[y] * (hgt - 1) / (nGranularity - 1))));
+      }
+  }
+
+  const unsigned int alphaBits = (pImage->format() == QImage::Format_RGB32) ? 0xFF000000 : 0;
+  const unsigned int *pMaps = m_toneMaps.maps.constData();
+
+  uchar *bits = pImage->bits();
+  const int bytesPerLine = pImage->bytesPerLine();
+
+  kpParallel::forRanges(0, hgt, 16, [&](int beginY, int endY)
+  {
+      for(int y = beginY; y < endY; y++)
+      {
+          auto *pLine = reinterpret_cast<QRgb *> (bits + y * bytesPerLine);
+          const unsigned int *pMapsY1 = pMaps + nGranularity * mapY[y] * TONE_MAP_SIZE;
+          const unsigned int *pMapsY2 = pMapsY1 + nGranularity * TONE_MAP_SIZE;
+          const unsigned int vFac = vFacs[y];
+
+          for(int x = 0; x < wid; x++)
+          {
+              const unsigned int col = pLine[x] | alphaBits;
+              const unsigned int oldTone = ComputeTone(col);
+              const unsigned int toneIndex = oldTone >> TONE_DROP_BITS;
+
+              unsigned int newTone;
+              if(nGranularity <= 1)
+              {
+                  newTone = pMaps[toneIndex];
+              }
+              else
+              {
+                  const unsigned int *pX1Y1 = pMapsY1 + mapX[x] * TONE_MAP_SIZE;
+                  const unsigned int *pX1Y2 = pMapsY2 + mapX[x] * TONE_MAP_SIZE;
+                  const unsigned int hFac = hFacs[x];
+
+                  unsigned int y1 = (pX1Y1[toneIndex] * (areaWid - hFac)
+                                     + pX1Y1[TONE_MAP_SIZE + toneIndex] * hFac) / areaWid;
+                  unsigned int y2 = (pX1Y2[toneIndex] * (areaWid - hFac)
+                                     + pX1Y2[TONE_MAP_SIZE + toneIndex] * hFac) / areaWid;
+                  newTone = (y1 * (areaHgt - vFac) + y2 * vFac) / areaHgt;
+              }
+
+              pLine[x] = AdjustTone(col, oldTone, newTone, amount);
+          }
+      }
+  });
+
+  if(pImage->format() != originalFormat) {
+      *pImage = pImage->convertToFormat(originalFormat);
   }
 }
 
@@ -298,7 +441,6 @@ kpImage kpEffectToneEnhance::applyEffect (const kpImage &image,
 
   QImage qimage(image);
 
-  // OPT: Cache the calculated values?
   kpEffectToneEnhanceApplier applier;
   applier.BalanceImageTone (&qimage, granularity, amount);
 
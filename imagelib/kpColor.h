@@ -125,6 +125,35 @@ public:
     //        Color Similarity within 10%
     bool isSimilarTo (const kpColor &rhs, int processedSimilarity) const;
 
+    //
+    // Batch versions of isSimilarTo(), for scanning whole scanlines
+    // (see kpPixmapFX::getRgbaScanlineImage()).  Implemented in
+    // kpColor_Similarity.cpp, using SSE2 or AVX2 where the CPU supports them.
+    //
+    // This color must be valid.
+    //
+
+    // Sets bit (i % 32) of <mask> [i / 32] if
+    // "kpColor (pixels [i]).isSimilarTo (*this, processedSimilarity)" and
+    // clears it otherwise, for 0 <= i < <count>.  The unused bits of the last
+    // of the (count + 31) / 32 words are cleared.
+    void similarityMask (const QRgb *pixels, int count, int processedSimilarity,
+                         quint32 *mask) const;
+
+    // Returns the number of pixels, counting from the start of <pixels>,
+    // that are similar to this color before the first one that isn't.
+    // Stops reading at the first dissimilar pixel (give or take a block).
+    int countSimilar (const QRgb *pixels, int count, int processedSimilarity) const;
+
+    // Returns the index of the first bit at or after <i>, in a mask returned
+    // by similarityMask(), that is set (if <value>) or clear (otherwise),
+    // or <count> if there is none.
+    static int findInSimilarityMask (const quint32 *mask, int count, int i,
+                                     bool value);
+    // Returns the index of the last such bit at or before <i>, or -1.
+    static int findLastInSimilarityMask (const quint32 *mask, int i,
+                                         bool value);
+
     bool isValid () const;
 
     int red () const;
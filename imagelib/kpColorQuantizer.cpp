@@ -0,0 +1,724 @@
+/*
+   Copyright (c) 2026 The KolourPaint Authors
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+   OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+   IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+   INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+   NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+   THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#define DEBUG_KP_COLOR_QUANTIZER 0
+
+
+#include "kpColorQuantizer.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+#include <QHash>
+#include <QVector>
+
+#include "kpLogCategories.h"
+
+#include "generic/kpParallel.h"
+
+
+//---------------------------------------------------------------------
+
+// When the palette doesn't hold all the colors, pixels with less alpha
+// than this become transparent and the rest become opaque.
+static const int AlphaThreshold = 128;
+
+// Median cut and the inverse color map work on colors with this many bits
+// per channel.
+static const int HistogramBits = 5;
+static const int HistogramSide = 1 << HistogramBits;
+static const int HistogramSize = HistogramSide * HistogramSide * HistogramSide;
+
+static const int MinRowsPerThread = 32;
+
+// Dither thresholds from 0 to 63, in an order that spreads them out.
+static const int BayerMatrix [8][8] =
+{
+    { 0, 32,  8, 40,  2, 34, 10, 42},
+    {48, 16, 56, 24, 50, 18, 58, 26},
+    {12, 44,  4, 36, 14, 46,  6, 38},
+    {60, 28, 52, 20, 62, 30, 54, 22},
+    { 3, 35, 11, 43,  1, 33,  9, 41},
+    {51, 19, 59, 27, 49, 17, 57, 25},
+    {15, 47,  7, 39, 13, 45,  5, 37},
+    {63, 31, 55, 23, 61, 29, 53, 21}
+};
+
+//---------------------------------------------------------------------
+
+// Index into a histogram or inverse color map, of 8-bit channels.
+static inline int HistogramIndex (int red, int green, int blue)
+{
+    const int shift = 8 - HistogramBits;
+    return ((red >> shift) << (2 * HistogramBits)) |
+           ((green >> shift) << HistogramBits) |
+           (blue >> shift);
+}
+
+//---------------------------------------------------------------------
+
+static inline bool IsTransparent (QRgb rgba)
+{
+    return qAlpha (rgba) < AlphaThreshold;
+}
+
+//---------------------------------------------------------------------
+
+static inline const QRgb *ConstRgbLine (const QImage &image, int y)
+{
+    return reinterpret_cast <const QRgb *> (image.constScanLine (y));
+}
+
+//---------------------------------------------------------------------
+
+// Sets pixel <x> of a Format_Indexed8 or (zero-filled) Format_MonoLSB
+// scanline.
+static inline void SetIndex (uchar *line, int x, int index, bool isMono)
+{
+    if (isMono)
+    {
+        if (index) {
+            line [x >> 3] |= static_cast <uchar> (1 << (x & 7));
+        }
+    }
+    else
+    {
+        line [x] = static_cast <uchar> (index);
+    }
+}
+
+//---------------------------------------------------------------------
+
+// Returns a zero-filled image of <format> (Indexed8 or MonoLSB).
+static QImage CreateIndexedImage (const QSize &size, QImage::Format format,
+                                  const QVector <QRgb> &colorTable)
+{
+    QImage image (size, format);
+    image.setColorTable (colorTable);
+    // (SetIndex() only sets bits)
+    image.fill (0);
+    return image;
+}
+
+//---------------------------------------------------------------------
+
+// Fills <colors> with the distinct colors of <image> (Format_ARGB32) in
+// order of appearance, and <colorIndexes> with their indexes in <colors>.
+// Returns false if there are more than <maxColors>.
+static bool FindColors (const QImage &image, int maxColors,
+                        QVector <QRgb> *colors,
+                        QHash <QRgb, int> *colorIndexes)
+{
+    colors->clear ();
+    colorIndexes->clear ();
+
+    for (int y = 0; y < image.height (); y++)
+    {
+        const QRgb *line = ::ConstRgbLine (image, y);
+        for (int x = 0; x < image.width (); x++)
+        {
+            // (neighbouring pixels tend to be the same)
+            if (x > 0 && line [x] == line [x - 1]) {
+                continue;
+            }
+
+            if (colorIndexes->contains (line [x])) {
+                continue;
+            }
+
+            if (colors->size () == maxColors) {
+                return false;
+            }
+
+            colorIndexes->insert (line [x], colors->size ());
+            colors->append (line [x]);
+        }
+    }
+
+    return true;
+}
+
+//---------------------------------------------------------------------
+
+static void MapExactColors (const QImage &image,
+                            const QHash <QRgb, int> &colorIndexes,
+                            QImage *destImage)
+{
+    const bool isMono = (destImage->format () == QImage::Format_MonoLSB);
+
+    uchar *destBits = destImage->bits ();
+    const int destBytesPerLine = destImage->bytesPerLine ();
+
+    kpParallel::forRanges (0, image.height (), MinRowsPerThread,
+        [&] (int beginY, int endY)
+        {
+            for (int y = beginY; y < endY; y++)
+            {
+                const QRgb *line = ::ConstRgbLine (image, y);
+                uchar *destLine = destBits + y * destBytesPerLine;
+
+                int index = 0;
+                for (int x = 0; x < image.width (); x++)
+                {
+                    if (x == 0 || line [x] != line [x - 1]) {
+                        index = colorIndexes.value (line [x]);
+                    }
+                    ::SetIndex (destLine, x, index, isMono);
+                }
+            }
+        });
+}
+
+//---------------------------------------------------------------------
+
+// The opaque pixels of an image, counted by their top HistogramBits bits.
+struct kpColorQuantizerHistogram
+{
+    kpColorQuantizerHistogram ()
+        : counts (HistogramSize, 0),
+          sums (3 * HistogramSize, 0),
+          hasTransparentPixels (false)
+    {
+    }
+
+    QVector <quint32> counts;
+    // The sums of the full-precision red, green and blue of the pixels.
+    QVector <quint64> sums;
+
+    bool hasTransparentPixels;
+};
+
+//---------------------------------------------------------------------
+
+// A box in the histogram, inclusive of <low> and <high>.
+struct kpColorQuantizerBox
+{
+    int low [3], high [3];
+    quint64 count;
+};
+
+//---------------------------------------------------------------------
+
+// Calls <func> (histogram index, red, green, blue) for every bin in <box>.
+template <typename Func>
+static void ForEachBin (const kpColorQuantizerBox &box, Func func)
+{
+    for (int r = box.low [0]; r <= box.high [0]; r++)
+    {
+        for (int g = box.low [1]; g <= box.high [1]; g++)
+        {
+            for (int b = box.low [2]; b <= box.high [2]; b++) {
+                func ((r << (2 * HistogramBits)) | (g << HistogramBits) | b, r, g, b);
+            }
+        }
+    }
+}
+
+//---------------------------------------------------------------------
+
+// Shrinks <box> to the bins that have pixels and sets its count.
+static void ShrinkBox (const kpColorQuantizerHistogram &histogram,
+                       kpColorQuantizerBox *box)
+{
+    int low [3] = {HistogramSide, HistogramSide, HistogramSide};
+    int high [3] = {-1, -1, -1};
+    quint64 count = 0;
+
+    ::ForEachBin (*box, [&] (int i, int r, int g, int b)
+    {
+        if (histogram.counts [i] == 0) {
+            return;
+        }
+
+        const int rgb [3] = {r, g, b};
+        for (int c = 0; c < 3; c++)
+        {
+            low [c] = qMin (low [c], rgb [c]);
+            high [c] = qMax (high [c], rgb [c]);
+        }
+        count += histogram.counts [i];
+    });
+
+    if (count > 0)
+    {
+        std::copy (low, low + 3, box->low);
+        std::copy (high, high + 3, box->high);
+    }
+    box->count = count;
+}
+
+//---------------------------------------------------------------------
+
+static int LongestSide (const kpColorQuantizerBox &box)
+{
+    int longest = 0;
+    for (int c = 1; c < 3; c++)
+    {
+        if (box.high [c] - box.low [c] > box.high [longest] - box.low [longest]) {
+            longest = c;
+        }
+    }
+    return longest;
+}
+
+//---------------------------------------------------------------------
+
+// Splits <box> across its longest side, at the median pixel.
+static void SplitBox (const kpColorQuantizerHistogram &histogram,
+                      const kpColorQuantizerBox &box,
+                      kpColorQuantizerBox *lowBox, kpColorQuantizerBox *highBox)
+{
+    const int side = ::LongestSide (box);
+    Q_ASSERT (box.high [side] > box.low [side]);
+
+    quint64 planeCounts [HistogramSide] = {};
+    ::ForEachBin (box, [&] (int i, int r, int g, int b)
+    {
+        const int rgb [3] = {r, g, b};
+        planeCounts [rgb [side]] += histogram.counts [i];
+    });
+
+    // Leave at least one plane for <highBox>.
+    int cut = box.low [side];
+    quint64 lowCount = planeCounts [cut];
+    while (cut + 1 < box.high [side] && lowCount * 2 < box.count)
+    {
+        cut++;
+        lowCount += planeCounts [cut];
+    }
+
+    *lowBox = box;
+    lowBox->high [side] = cut;
+    ::ShrinkBox (histogram, lowBox);
+
+    *highBox = box;
+    highBox->low [side] = cut + 1;
+    ::ShrinkBox (histogram, highBox);
+}
+
+//---------------------------------------------------------------------
+
+// Returns up to <maxColors> opaque colors that represent <histogram> well.
+static QVector <QRgb> MedianCut (const kpColorQuantizerHistogram &histogram,
+                                 int maxColors)
+{
+    QVector <kpColorQuantizerBox> boxes;
+
+    kpColorQuantizerBox all = {{0, 0, 0},
+        {HistogramSide - 1, HistogramSide - 1, HistogramSide - 1}, 0};
+    ::ShrinkBox (histogram, &all);
+    if (all.count > 0) {
+        boxes.append (all);
+    }
+
+    while (boxes.size () < maxColors)
+    {
+        // Split the box with the most pixels, favoring long ones.
+        int best = -1;
+        quint64 bestPriority = 0;
+        for (int i = 0; i < boxes.size (); i++)
+        {
+            const kpColorQuantizerBox &box = boxes [i];
+            const int side = ::LongestSide (box);
+            const quint64 priority = box.count *
+                static_cast <quint64> (box.high [side] - box.low [side]);
+            if (priority > bestPriority)
+            {
+                best = i;
+                bestPriority = priority;
+            }
+        }
+
+        if (best < 0) {
+            break;
+        }
+
+        kpColorQuantizerBox lowBox, highBox;
+        ::SplitBox (histogram, boxes [best], &lowBox, &highBox);
+        boxes [best] = lowBox;
+        boxes.append (highBox);
+    }
+
+    QVector <QRgb> colors;
+    for (const kpColorQuantizerBox &box : boxes)
+    {
+        quint64 sums [3] = {0, 0, 0};
+        ::ForEachBin (box, [&] (int i, int, int, int)
+        {
+            for (int c = 0; c < 3; c++) {
+                sums [c] += histogram.sums [3 * i + c];
+            }
+        });
+
+        int rgb [3];
+        for (int c = 0; c < 3; c++) {
+            rgb [c] = static_cast <int> ((sums [c] + box.count / 2) / box.count);
+        }
+        colors.append (qRgb (rgb [0], rgb [1], rgb [2]));
+    }
+
+    return colors;
+}
+
+//---------------------------------------------------------------------
+
+// Returns, for each histogram bin, the index of the color in <colors> that
+// is closest to the middle of the bin.
+static QVector <uchar> MakeInverseColorMap (const QVector <QRgb> &colors)
+{
+    QVector <uchar> inverseMap (HistogramSize);
+    uchar *map = inverseMap.data ();
+
+    const int shift = 8 - HistogramBits;
+    const int halfBin = 1 << (shift - 1);
+
+    kpParallel::forEach (HistogramSide, [&] (int r)
+    {
+        for (int g = 0; g < HistogramSide; g++)
+        {
+            for (int b = 0; b < HistogramSide; b++)
+            {
+                const int red = (r << shift) + halfBin;
+                const int green = (g << shift) + halfBin;
+                const int blue = (b << shift) + halfBin;
+
+                int closest = 0, closestDistance = INT_MAX;
+                for (int i = 0; i < colors.size (); i++)
+                {
+                    const int dr = qRed (colors [i]) - red;
+                    const int dg = qGreen (colors [i]) - green;
+                    const int db = qBlue (colors [i]) - blue;
+                    const int distance = dr * dr + dg * dg + db * db;
+                    if (distance < closestDistance)
+                    {
+                        closest = i;
+                        closestDistance = distance;
+                    }
+                }
+
+                map [(r << (2 * HistogramBits)) | (g << HistogramBits) | b] =
+                    static_cast <uchar> (closest);
+            }
+        }
+    });
+
+    return inverseMap;
+}
+
+//---------------------------------------------------------------------
+
+// Maps the pixels of <image> (Format_ARGB32) to <colors> using
+// <inverseMap> (see MakeInverseColorMap()).  Transparent pixels become
+// <transparentIndex>.
+static void MapToPalette (const QImage &image,
+                          const QVector <QRgb> &colors,
+                          const QVector <uchar> &inverseMap,
+                          int transparentIndex,
+                          kpColorQuantizer::DitherMode ditherMode,
+                          QImage *destImage)
+{
+    const int width = image.width ();
+    const uchar *map = inverseMap.constData ();
+
+    switch (ditherMode)
+    {
+    case kpColorQuantizer::NoDither:
+    case kpColorQuantizer::OrderedDither:
+    {
+        // How far apart the colors are, roughly, for the ordered dither to
+        // push pixels by up to half of.
+        const double spread = 255.0 / std::cbrt (static_cast <double> (colors.size ()));
+        int offsets [8][8];
+        for (int y = 0; y < 8; y++)
+        {
+            for (int x = 0; x < 8; x++)
+            {
+                offsets [y][x] = (ditherMode == kpColorQuantizer::OrderedDither) ?
+                    qRound (((BayerMatrix [y][x] + 0.5) / 64 - 0.5) * spread) :
+                    0;
+            }
+        }
+
+        uchar *destBits = destImage->bits ();
+        const int destBytesPerLine = destImage->bytesPerLine ();
+
+        kpParallel::forRanges (0, image.height (), MinRowsPerThread,
+            [&] (int beginY, int endY)
+            {
+                for (int y = beginY; y < endY; y++)
+                {
+                    const QRgb *line = ::ConstRgbLine (image, y);
+                    uchar *destLine = destBits + y * destBytesPerLine;
+                    for (int x = 0; x < width; x++)
+                    {
+                        if (::IsTransparent (line [x]))
+                        {
+                            destLine [x] = static_cast <uchar> (transparentIndex);
+                            continue;
+                        }
+
+                        const int offset = offsets [y & 7][x & 7];
+                        destLine [x] = map [::HistogramIndex (
+                            qBound (0, qRed (line [x]) + offset, 255),
+                            qBound (0, qGreen (line [x]) + offset, 255),
+                            qBound (0, qBlue (line [x]) + offset, 255))];
+                    }
+                }
+            });
+        break;
+    }
+
+    case kpColorQuantizer::FloydSteinbergDither:
+    {
+        // The errors (* 16) still to be added to the pixels of this row and
+        // the next, with a pixel of padding on either side.
+        QVector <int> errors (2 * (width + 2) * 3, 0);
+        int *thisErrors = errors.data ();
+        int *nextErrors = thisErrors + (width + 2) * 3;
+
+        for (int y = 0; y < image.height (); y++)
+        {
+            const QRgb *line = ::ConstRgbLine (image, y);
+            uchar *destLine = destImage->scanLine (y);
+
+            std::fill (nextErrors, nextErrors + (width + 2) * 3, 0);
+
+            // Go back and forth so that the errors don't all drift one way.
+            const int dir = (y % 2 == 0) ? +1 : -1;
+            for (int i = 0; i < width; i++)
+            {
+                const int x = (dir > 0) ? i : width - 1 - i;
+                if (::IsTransparent (line [x]))
+                {
+                    destLine [x] = static_cast <uchar> (transparentIndex);
+                    continue;
+                }
+
+                const int rgb [3] = {qRed (line [x]), qGreen (line [x]), qBlue (line [x])};
+                int *pixelErrors = thisErrors + (x + 1) * 3;
+
+                int wanted [3];
+                for (int c = 0; c < 3; c++) {
+                    wanted [c] = qBound (0, rgb [c] + ((pixelErrors [c] + 8) >> 4), 255);
+                }
+
+                const int index = map [::HistogramIndex (wanted [0], wanted [1], wanted [2])];
+                destLine [x] = static_cast <uchar> (index);
+
+                const int got [3] = {qRed (colors [index]), qGreen (colors [index]),
+                                     qBlue (colors [index])};
+                for (int c = 0; c < 3; c++)
+                {
+                    const int error = wanted [c] - got [c];
+                    pixelErrors [dir * 3 + c] += error * 7;
+                    nextErrors [(x + 1 - dir) * 3 + c] += error * 3;
+                    nextErrors [(x + 1) * 3 + c] += error * 5;
+                    nextErrors [(x + 1 + dir) * 3 + c] += error;
+                }
+            }
+
+            std::swap (thisErrors, nextErrors);
+        }
+        break;
+    }
+    }
+}
+
+//---------------------------------------------------------------------
+
+// public static
+QImage kpColorQuantizer::convertToIndexed8 (const QImage &image, int maxColors,
+                                            DitherMode ditherMode)
+{
+#if DEBUG_KP_COLOR_QUANTIZER
+    qCDebug(kpLogImagelib) << "kpColorQuantizer::convertToIndexed8(size=" << image.size ()
+              << ",maxColors=" << maxColors << ",ditherMode=" << ditherMode << ")";
+#endif
+
+    maxColors = qBound (2, maxColors, 256);
+
+    const QImage argbImage = image.convertToFormat (QImage::Format_ARGB32);
+
+    QVector <QRgb> colors;
+    QHash <QRgb, int> colorIndexes;
+    if (::FindColors (argbImage, maxColors, &colors, &colorIndexes))
+    {
+    #if DEBUG_KP_COLOR_QUANTIZER
+        qCDebug(kpLogImagelib) << "\tkeeping all" << colors.size () << "colors";
+    #endif
+        QImage destImage = ::CreateIndexedImage (argbImage.size (),
+            QImage::Format_Indexed8, colors);
+        ::MapExactColors (argbImage, colorIndexes, &destImage);
+        return destImage;
+    }
+    colorIndexes.clear ();
+
+
+    kpColorQuantizerHistogram histogram;
+    for (int y = 0; y < argbImage.height (); y++)
+    {
+        const QRgb *line = ::ConstRgbLine (argbImage, y);
+        for (int x = 0; x < argbImage.width (); x++)
+        {
+            if (::IsTransparent (line [x]))
+            {
+                histogram.hasTransparentPixels = true;
+                continue;
+            }
+
+            const int i = ::HistogramIndex (qRed (line [x]), qGreen (line [x]),
+                                            qBlue (line [x]));
+            histogram.counts [i]++;
+            histogram.sums [3 * i + 0] += qRed (line [x]);
+            histogram.sums [3 * i + 1] += qGreen (line [x]);
+            histogram.sums [3 * i + 2] += qBlue (line [x]);
+        }
+    }
+
+    colors = ::MedianCut (histogram,
+        histogram.hasTransparentPixels ? maxColors - 1 : maxColors);
+    const QVector <uchar> inverseMap = ::MakeInverseColorMap (colors);
+#if DEBUG_KP_COLOR_QUANTIZER
+    qCDebug(kpLogImagelib) << "\tmedian cut chose" << colors.size () << "colors"
+              << "hasTransparentPixels=" << histogram.hasTransparentPixels;
+#endif
+
+    QVector <QRgb> colorTable = colors;
+    const int transparentIndex = colorTable.size ();
+    if (histogram.hasTransparentPixels) {
+        colorTable.append (qRgba (0, 0, 0, 0));
+    }
+
+    QImage destImage = ::CreateIndexedImage (argbImage.size (),
+        QImage::Format_Indexed8, colorTable);
+    ::MapToPalette (argbImage, colors, inverseMap, transparentIndex,
+                    ditherMode, &destImage);
+    return destImage;
+}
+
+//---------------------------------------------------------------------
+
+// public static
+QImage kpColorQuantizer::convertToMonochrome (const QImage &image,
+                                              DitherMode ditherMode)
+{
+#if DEBUG_KP_COLOR_QUANTIZER
+    qCDebug(kpLogImagelib) << "kpColorQuantizer::convertToMonochrome(size=" << image.size ()
+              << ",ditherMode=" << ditherMode << ")";
+#endif
+
+    const QImage argbImage = image.convertToFormat (QImage::Format_ARGB32);
+    const int width = argbImage.width ();
+
+    if (ditherMode == NoDither)
+    {
+        QVector <QRgb> colors;
+        QHash <QRgb, int> colorIndexes;
+        if (::FindColors (argbImage, 2, &colors, &colorIndexes))
+        {
+        #if DEBUG_KP_COLOR_QUANTIZER
+            qCDebug(kpLogImagelib) << "\tkeeping all" << colors.size () << "colors";
+        #endif
+            // (the unused entries are the same as they have always been)
+            const QVector <QRgb> colorTable = {
+                colors.size () > 0 ? colors [0] : 0xFFFFFF,
+                colors.size () > 1 ? colors [1] : 0x000000};
+            QImage destImage = ::CreateIndexedImage (argbImage.size (),
+                QImage::Format_MonoLSB, colorTable);
+            ::MapExactColors (argbImage, colorIndexes, &destImage);
+            return destImage;
+        }
+    }
+
+
+    const QVector <QRgb> colorTable = {qRgb (255, 255, 255), qRgb (0, 0, 0)};
+    QImage destImage = ::CreateIndexedImage (argbImage.size (),
+        QImage::Format_MonoLSB, colorTable);
+
+    if (ditherMode == FloydSteinbergDither)
+    {
+        // (see MapToPalette())
+        QVector <int> errors (2 * (width + 2), 0);
+        int *thisErrors = errors.data ();
+        int *nextErrors = thisErrors + (width + 2);
+
+        for (int y = 0; y < argbImage.height (); y++)
+        {
+            const QRgb *line = ::ConstRgbLine (argbImage, y);
+            uchar *destLine = destImage.scanLine (y);
+
+            std::fill (nextErrors, nextErrors + (width + 2), 0);
+
+            const int dir = (y % 2 == 0) ? +1 : -1;
+            for (int i = 0; i < width; i++)
+            {
+                const int x = (dir > 0) ? i : width - 1 - i;
+
+                const int wanted = qBound (0,
+                    qGray (line [x]) + ((thisErrors [x + 1] + 8) >> 4), 255);
+                const bool isBlack = (wanted < 128);
+                ::SetIndex (destLine, x, isBlack ? 1 : 0, true/*mono*/);
+
+                const int error = wanted - (isBlack ? 0 : 255);
+                thisErrors [x + 1 + dir] += error * 7;
+                nextErrors [x + 1 - dir] += error * 3;
+                nextErrors [x + 1] += error * 5;
+                nextErrors [x + 1 + dir] += error;
+            }
+
+            std::swap (thisErrors, nextErrors);
+        }
+    }
+    else
+    {
+        uchar *destBits = destImage.bits ();
+        const int destBytesPerLine = destImage.bytesPerLine ();
+
+        kpParallel::forRanges (0, argbImage.height (), MinRowsPerThread,
+            [&] (int beginY, int endY)
+            {
+                for (int y = beginY; y < endY; y++)
+                {
+                    const QRgb *line = ::ConstRgbLine (argbImage, y);
+                    uchar *destLine = destBits + y * destBytesPerLine;
+                    for (int x = 0; x < width; x++)
+                    {
+                        const int threshold = (ditherMode == OrderedDither) ?
+                            BayerMatrix [y & 7][x & 7] * 4 + 2 :
+                            128;
+                        ::SetIndex (destLine, x, qGray (line [x]) < threshold ? 1 : 0,
+                                    true/*mono*/);
+                    }
+                }
+            });
+    }
+
+    return destImage;
+}
+
+//---------------------------------------------------------------------
@@ -0,0 +1,80 @@
+/*
+   Copyright (c) 2026 The KolourPaint Authors
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+   OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+   IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+   INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+   NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+   THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef KP_COLOR_QUANTIZER_H
+#define KP_COLOR_QUANTIZER_H
+
+
+#include <QImage>
+
+
+//
+// Reduces images to a small palette, for lowering the colour depth (see
+// kpEffectReduceColors) without depending on how QImage::convertToFormat()
+// happens to do it.
+//
+// The input image can be in any format.  Rows are mapped to the palette on
+// kpParallel's threads, except with Floyd-Steinberg dithering, where every
+// row depends on the one above.
+//
+class kpColorQuantizer
+{
+public:
+    enum DitherMode
+    {
+        NoDither,
+
+        // Error diffusion: the best looking but inherently serial.
+        FloydSteinbergDither,
+
+        // 8x8 Bayer matrix: a regular pattern, but every pixel is
+        // independent (so it doesn't crawl when the image is edited).
+        OrderedDither
+    };
+
+    // Returns <image> as Format_Indexed8 with at most <maxColors> (2-256)
+    // colors.
+    //
+    // If <image> has no more than <maxColors> distinct colors, they are
+    // kept exactly (including their alpha), without dithering.  Otherwise,
+    // the palette is chosen by median cut over the opaque (alpha >= 128)
+    // pixels and the remaining pixels become a single transparent entry.
+    static QImage convertToIndexed8 (const QImage &image, int maxColors,
+                                     DitherMode ditherMode);
+
+    // Returns <image> as Format_MonoLSB.
+    //
+    // If <ditherMode> is NoDither and <image> has no more than 2 distinct
+    // colors, they are kept exactly (e.g. for resaving a "color monochrome"
+    // image).  Otherwise, the result is black (index 1) and white
+    // (index 0), according to the brightness of each pixel.
+    static QImage convertToMonochrome (const QImage &image,
+                                       DitherMode ditherMode);
+};
+
+
+#endif  // KP_COLOR_QUANTIZER_H
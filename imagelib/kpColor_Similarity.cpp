@@ -0,0 +1,376 @@
+/*
+   Copyright (c) 2026 The KolourPaint Authors
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+   OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+   IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+   INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+   NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+   THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#define DEBUG_KP_COLOR 0
+
+
+#include "kpColor.h"
+
+#include <algorithm>
+
+#include <QtGlobal>
+
+#if defined (Q_PROCESSOR_X86) && defined (Q_CC_GNU)
+    // The SIMD kernels are compiled for their instruction sets regardless of
+    // the compiler flags, and only called if the CPU supports them.
+    #define KP_COLOR_SIMILARITY_X86 1
+    #include <immintrin.h>
+    #define KP_COLOR_TARGET(isa) __attribute__ ((target (isa)))
+#else
+    #define KP_COLOR_SIMILARITY_X86 0
+#endif
+
+#include "kpLogCategories.h"
+
+//---------------------------------------------------------------------
+
+// Fills bit i of <mask> for every pixel in <pixels> [0, count), given zeroed
+// (count + 31) / 32 words of <mask>.
+typedef void (*SimilarityMaskFunc) (const QRgb *pixels, int count,
+                                    QRgb rgba, int processedSimilarity,
+                                    quint32 *mask);
+
+//---------------------------------------------------------------------
+
+static inline bool IsSimilarRgba (QRgb lhs, QRgb rhs, int processedSimilarity)
+{
+    if (lhs == rhs) {
+        return true;
+    }
+
+    if (processedSimilarity == kpColor::Exact) {
+        return false;
+    }
+
+    const int dr = qRed (lhs) - qRed (rhs);
+    const int dg = qGreen (lhs) - qGreen (rhs);
+    const int db = qBlue (lhs) - qBlue (rhs);
+
+    return (dr * dr + dg * dg + db * db <= processedSimilarity);
+}
+
+//---------------------------------------------------------------------
+
+// Does pixels [begin, count) only, so that the SIMD kernels can leave it
+// their last few pixels.
+static void SimilarityMaskTail (const QRgb *pixels, int begin, int count,
+                                QRgb rgba, int processedSimilarity,
+                                quint32 *mask)
+{
+    for (int i = begin; i < count; i++)
+    {
+        if (::IsSimilarRgba (pixels [i], rgba, processedSimilarity)) {
+            mask [i >> 5] |= (1u << (i & 31));
+        }
+    }
+}
+
+//---------------------------------------------------------------------
+
+static void SimilarityMaskScalar (const QRgb *pixels, int count,
+                                  QRgb rgba, int processedSimilarity,
+                                  quint32 *mask)
+{
+    ::SimilarityMaskTail (pixels, 0, count, rgba, processedSimilarity, mask);
+}
+
+//---------------------------------------------------------------------
+
+#if KP_COLOR_SIMILARITY_X86
+
+// 4 pixels at a time.
+KP_COLOR_TARGET ("sse2")
+static void SimilarityMaskSSE2 (const QRgb *pixels, int count,
+                                QRgb rgba, int processedSimilarity,
+                                quint32 *mask)
+{
+    const __m128i zero = _mm_setzero_si128 ();
+    const __m128i rgbMask = _mm_set1_epi32 (0x00FFFFFF);
+    const __m128i target = _mm_set1_epi32 (static_cast <int> (rgba));
+    // 16-bit B, G, R, 0 of <rgba>, twice.
+    const __m128i target16 = _mm_unpacklo_epi8 (_mm_and_si128 (target, rgbMask), zero);
+    const __m128i limit = _mm_set1_epi32 (processedSimilarity);
+    const __m128i useDistance = (processedSimilarity == kpColor::Exact) ?
+        zero : _mm_set1_epi32 (-1);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128i pixels4 = _mm_loadu_si128 (
+            reinterpret_cast <const __m128i *> (pixels + i));
+        const __m128i rgb = _mm_and_si128 (pixels4, rgbMask);
+
+        // 16-bit channel differences of 2 pixels each.  The alpha
+        // differences are 0.
+        const __m128i diffLo = _mm_sub_epi16 (_mm_unpacklo_epi8 (rgb, zero), target16);
+        const __m128i diffHi = _mm_sub_epi16 (_mm_unpackhi_epi8 (rgb, zero), target16);
+
+        // 32-bit [db^2 + dg^2, dr^2] per pixel...
+        const __m128i squaresLo = _mm_madd_epi16 (diffLo, diffLo);
+        const __m128i squaresHi = _mm_madd_epi16 (diffHi, diffHi);
+
+        // ...summed into 32-bit elements 0 and 2...
+        const __m128i sumsLo = _mm_add_epi32 (squaresLo, _mm_srli_epi64 (squaresLo, 32));
+        const __m128i sumsHi = _mm_add_epi32 (squaresHi, _mm_srli_epi64 (squaresHi, 32));
+
+        // ...and gathered into the distances of the 4 pixels, in order.
+        const __m128i distances = _mm_castps_si128 (
+            _mm_shuffle_ps (_mm_castsi128_ps (sumsLo), _mm_castsi128_ps (sumsHi),
+                            _MM_SHUFFLE (2, 0, 2, 0)));
+
+        const __m128i similar = _mm_or_si128 (
+            _mm_cmpeq_epi32 (pixels4, target),
+            _mm_andnot_si128 (_mm_cmpgt_epi32 (distances, limit), useDistance));
+
+        // 4 divides 32 so the bits never straddle 2 words.
+        mask [i >> 5] |= static_cast <quint32> (
+            _mm_movemask_ps (_mm_castsi128_ps (similar))) << (i & 31);
+    }
+
+    ::SimilarityMaskTail (pixels, i, count, rgba, processedSimilarity, mask);
+}
+
+//---------------------------------------------------------------------
+
+// 8 pixels at a time.  Same as SimilarityMaskSSE2() but the unpacks and
+// shuffle work within each 128-bit lane, so that lane 0 ends up with the
+// distances of pixels 0-3 and lane 1 with those of pixels 4-7.
+KP_COLOR_TARGET ("avx2")
+static void SimilarityMaskAVX2 (const QRgb *pixels, int count,
+                                QRgb rgba, int processedSimilarity,
+                                quint32 *mask)
+{
+    const __m256i zero = _mm256_setzero_si256 ();
+    const __m256i rgbMask = _mm256_set1_epi32 (0x00FFFFFF);
+    const __m256i target = _mm256_set1_epi32 (static_cast <int> (rgba));
+    const __m256i target16 = _mm256_unpacklo_epi8 (_mm256_and_si256 (target, rgbMask), zero);
+    const __m256i limit = _mm256_set1_epi32 (processedSimilarity);
+    const __m256i useDistance = (processedSimilarity == kpColor::Exact) ?
+        zero : _mm256_set1_epi32 (-1);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m256i pixels8 = _mm256_loadu_si256 (
+            reinterpret_cast <const __m256i *> (pixels + i));
+        const __m256i rgb = _mm256_and_si256 (pixels8, rgbMask);
+
+        const __m256i diffLo = _mm256_sub_epi16 (_mm256_unpacklo_epi8 (rgb, zero), target16);
+        const __m256i diffHi = _mm256_sub_epi16 (_mm256_unpackhi_epi8 (rgb, zero), target16);
+
+        const __m256i squaresLo = _mm256_madd_epi16 (diffLo, diffLo);
+        const __m256i squaresHi = _mm256_madd_epi16 (diffHi, diffHi);
+
+        const __m256i sumsLo = _mm256_add_epi32 (squaresLo, _mm256_srli_epi64 (squaresLo, 32));
+        const __m256i sumsHi = _mm256_add_epi32 (squaresHi, _mm256_srli_epi64 (squaresHi, 32));
+
+        const __m256i distances = _mm256_castps_si256 (
+            _mm256_shuffle_ps (_mm256_castsi256_ps (sumsLo), _mm256_castsi256_ps (sumsHi),
+                               _MM_SHUFFLE (2, 0, 2, 0)));
+
+        const __m256i similar = _mm256_or_si256 (
+            _mm256_cmpeq_epi32 (pixels8, target),
+            _mm256_andnot_si256 (_mm256_cmpgt_epi32 (distances, limit), useDistance));
+
+        // 8 divides 32 so the bits never straddle 2 words.
+        mask [i >> 5] |= static_cast <quint32> (
+            _mm256_movemask_ps (_mm256_castsi256_ps (similar))) << (i & 31);
+    }
+
+    ::SimilarityMaskTail (pixels, i, count, rgba, processedSimilarity, mask);
+}
+
+#endif  // KP_COLOR_SIMILARITY_X86
+
+//---------------------------------------------------------------------
+
+static SimilarityMaskFunc ChooseSimilarityMaskFunc ()
+{
+#if KP_COLOR_SIMILARITY_X86
+    __builtin_cpu_init ();
+
+    if (__builtin_cpu_supports ("avx2"))
+    {
+    #if DEBUG_KP_COLOR
+        qCDebug(kpLogImagelib) << "kpColor: AVX2 similarity kernel";
+    #endif
+        return &::SimilarityMaskAVX2;
+    }
+
+    if (__builtin_cpu_supports ("sse2"))
+    {
+    #if DEBUG_KP_COLOR
+        qCDebug(kpLogImagelib) << "kpColor: SSE2 similarity kernel";
+    #endif
+        return &::SimilarityMaskSSE2;
+    }
+#endif
+
+#if DEBUG_KP_COLOR
+    qCDebug(kpLogImagelib) << "kpColor: scalar similarity kernel";
+#endif
+    return &::SimilarityMaskScalar;
+}
+
+//---------------------------------------------------------------------
+
+static inline int CountTrailingZeros (quint32 value)
+{
+#if defined (Q_CC_GNU)
+    return __builtin_ctz (value);
+#else
+    int ret = 0;
+    while (!(value & 1))
+    {
+        value >>= 1;
+        ret++;
+    }
+    return ret;
+#endif
+}
+
+static inline int HighestBit (quint32 value)
+{
+#if defined (Q_CC_GNU)
+    return 31 - __builtin_clz (value);
+#else
+    int ret = 31;
+    while (!(value & 0x80000000u))
+    {
+        value <<= 1;
+        ret--;
+    }
+    return ret;
+#endif
+}
+
+//---------------------------------------------------------------------
+
+// public
+void kpColor::similarityMask (const QRgb *pixels, int count,
+                              int processedSimilarity, quint32 *mask) const
+{
+    // Picked once, the first time any thread gets here.
+    static const SimilarityMaskFunc func = ::ChooseSimilarityMaskFunc ();
+
+    if (count <= 0) {
+        return;
+    }
+
+    std::fill (mask, mask + (count + 31) / 32, 0);
+
+    if (!isValid ())
+    {
+        qCCritical(kpLogImagelib) << "kpColor::similarityMask() called with invalid kpColor";
+        return;
+    }
+
+    (*func) (pixels, count, m_rgba, processedSimilarity, mask);
+}
+
+//---------------------------------------------------------------------
+
+// public
+int kpColor::countSimilar (const QRgb *pixels, int count,
+                           int processedSimilarity) const
+{
+    const int BlockSize = 64;
+    quint32 mask [BlockSize / 32];
+
+    for (int i = 0; i < count; i += BlockSize)
+    {
+        const int blockCount = qMin (BlockSize, count - i);
+        similarityMask (pixels + i, blockCount, processedSimilarity, mask);
+
+        const int end = kpColor::findInSimilarityMask (mask, blockCount, 0, false);
+        if (end < blockCount) {
+            return i + end;
+        }
+    }
+
+    return qMax (0, count);
+}
+
+//---------------------------------------------------------------------
+
+// public static
+int kpColor::findInSimilarityMask (const quint32 *mask, int count, int i,
+                                   bool value)
+{
+    if (i < 0) {
+        i = 0;
+    }
+
+    const int numWords = (count + 31) / 32;
+
+    int wordIndex = i >> 5;
+    if (wordIndex >= numWords) {
+        return count;
+    }
+
+    const quint32 invert = value ? 0 : ~0u;
+    quint32 word = (mask [wordIndex] ^ invert) & (~0u << (i & 31));
+    while (word == 0)
+    {
+        if (++wordIndex == numWords) {
+            return count;
+        }
+
+        word = mask [wordIndex] ^ invert;
+    }
+
+    // The unused bits of the last word are clear so, when looking for a
+    // clear bit, they may be found instead.
+    return qMin (count, wordIndex * 32 + ::CountTrailingZeros (word));
+}
+
+//---------------------------------------------------------------------
+
+// public static
+int kpColor::findLastInSimilarityMask (const quint32 *mask, int i, bool value)
+{
+    if (i < 0) {
+        return -1;
+    }
+
+    int wordIndex = i >> 5;
+
+    const quint32 invert = value ? 0 : ~0u;
+    quint32 word = (mask [wordIndex] ^ invert) & (~0u >> (31 - (i & 31)));
+    while (word == 0)
+    {
+        if (--wordIndex < 0) {
+            return -1;
+        }
+
+        word = mask [wordIndex] ^ invert;
+    }
+
+    return wordIndex * 32 + ::HighestBit (word);
+}
+
+//---------------------------------------------------------------------
@@ -0,0 +1,299 @@
+/*
+   Copyright (c) 2026 The KolourPaint Authors
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+   OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+   IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+   INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+   NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+   THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#define DEBUG_KP_COMPRESSED_IMAGE 0
+
+
+#include "kpCompressedImage.h"
+
+#include "kpLogCategories.h"
+
+#include <algorithm>
+#include <cstring>
+
+
+// Runs shorter than this are cheaper to store as literal pixels.
+static const int MinRunLength = 3;
+
+static const quint32 RunFlag = 0x80000000u;
+static const int MaxCount = 0x7FFFFFFF;
+
+//---------------------------------------------------------------------
+
+// Appends <count> literal pixels, starting at <pixels>, to <runs>.
+static void AppendLiterals (QVector <quint32> *runs, const quint32 *pixels, int count)
+{
+    if (count <= 0) {
+        return;
+    }
+
+    const int oldSize = runs->size ();
+    runs->resize (oldSize + 1 + count);
+
+    quint32 *out = runs->data () + oldSize;
+    out [0] = static_cast <quint32> (count);
+    std::memcpy (out + 1, pixels, static_cast <size_t> (count) * sizeof (quint32));
+}
+
+//---------------------------------------------------------------------
+
+// Run-length encodes the <count> pixels at <pixels> into <runs>.
+// Returns false (leaving <runs> in an undefined state) if that doesn't
+// save any space.
+static bool Encode (const quint32 *pixels, int count, QVector <quint32> *runs)
+{
+    runs->clear ();
+
+    int literalStart = 0;
+    int i = 0;
+    while (i < count)
+    {
+        const quint32 pixel = pixels [i];
+
+        int runEnd = i + 1;
+        while (runEnd < count && pixels [runEnd] == pixel) {
+            runEnd++;
+        }
+
+        if (runEnd - i >= MinRunLength)
+        {
+            ::AppendLiterals (runs, pixels + literalStart, i - literalStart);
+
+            runs->append (RunFlag | static_cast <quint32> (runEnd - i));
+            runs->append (pixel);
+
+            literalStart = runEnd;
+        }
+
+        i = runEnd;
+
+        if (runs->size () >= count) {
+            return false;
+        }
+    }
+
+    ::AppendLiterals (runs, pixels + literalStart, count - literalStart);
+
+    return (runs->size () < count);
+}
+
+//---------------------------------------------------------------------
+
+// Decodes the <count> words of <runs> into <image>, which must have the
+// size and format of the encoded image.
+static void Decode (const quint32 *runs, qint64 count, kpImage *image)
+{
+    auto *out = reinterpret_cast <quint32 *> (image->bits ());
+    const quint32 * const runsEnd = runs + count;
+
+    while (runs < runsEnd)
+    {
+        const quint32 control = *runs++;
+        const int pixelCount = static_cast <int> (control & ~RunFlag);
+
+        if (control & RunFlag)
+        {
+            std::fill (out, out + pixelCount, *runs++);
+        }
+        else
+        {
+            std::memcpy (out, runs, static_cast <size_t> (pixelCount) * sizeof (quint32));
+            runs += pixelCount;
+        }
+
+        out += pixelCount;
+    }
+
+    Q_ASSERT (out == reinterpret_cast <quint32 *> (image->bits ()) +
+                     qint64 (image->width ()) * image->height ());
+}
+
+//---------------------------------------------------------------------
+
+kpCompressedImage::kpCompressedImage ()
+    : m_format (QImage::Format_Invalid),
+      m_isEncoded (false)
+{
+}
+
+//---------------------------------------------------------------------
+
+kpCompressedImage::kpCompressedImage (const kpImage &image)
+    : m_size (image.size ()),
+      m_format (image.format ()),
+      m_isEncoded (false)
+{
+    if (image.isNull ()) {
+        return;
+    }
+
+    // (a 32-bit scanline has no padding so the pixels are contiguous)
+    const qint64 numPixels = qint64 (image.width ()) * image.height ();
+    if (image.depth () == 32 && numPixels <= MaxCount &&
+        ::Encode (reinterpret_cast <const quint32 *> (image.constBits ()),
+                  static_cast <int> (numPixels), &m_runs))
+    {
+        m_runs.squeeze ();
+        m_isEncoded = true;
+    }
+    else
+    {
+        m_runs = QVector <quint32> ();
+        m_image = image;
+    }
+
+#if DEBUG_KP_COMPRESSED_IMAGE
+    qCDebug(kpLogImagelib) << "kpCompressedImage::<ctor>(size=" << m_size
+                           << ") raw=" << numPixels * 4
+                           << " held=" << byteCount ();
+#endif
+}
+
+//---------------------------------------------------------------------
+
+// public
+bool kpCompressedImage::isNull () const
+{
+    return m_runs.isEmpty () && m_image.isNull () && !m_spilledData;
+}
+
+//---------------------------------------------------------------------
+
+// public
+QSize kpCompressedImage::size () const
+{
+    return m_size;
+}
+
+// public
+int kpCompressedImage::width () const
+{
+    return m_size.width ();
+}
+
+// public
+int kpCompressedImage::height () const
+{
+    return m_size.height ();
+}
+
+//---------------------------------------------------------------------
+
+// public
+kpImage kpCompressedImage::image () const
+{
+    if (m_spilledData)
+    {
+        kpImage image (m_size, m_format);
+
+        const bool readData = m_spilledData->read (
+            [this, &image] (const uchar *data)
+            {
+                if (m_isEncoded)
+                {
+                    ::Decode (reinterpret_cast <const quint32 *> (data),
+                              m_spilledData->size () / qint64 (sizeof (quint32)),
+                              &image);
+                }
+                else
+                {
+                    std::memcpy (image.bits (), data,
+                                 static_cast <size_t> (m_spilledData->size ()));
+                }
+            });
+
+        if (!readData)
+        {
+            qCCritical(kpLogImagelib) << "kpCompressedImage::image() could not read back"
+                                      << "spilled image - returning blank image";
+            image.fill (0);
+        }
+
+        return image;
+    }
+
+    if (!m_isEncoded) {
+        return m_image;
+    }
+
+    kpImage image (m_size, m_format);
+    ::Decode (m_runs.constData (), m_runs.size (), &image);
+    return image;
+}
+
+//---------------------------------------------------------------------
+
+// public
+qint64 kpCompressedImage::byteCount () const
+{
+    if (!m_runs.isEmpty ()) {
+        return qint64 (m_runs.size ()) * qint64 (sizeof (quint32));
+    }
+
+    return m_image.isNull () ? 0 : qint64 (m_image.bytesPerLine ()) * m_image.height ();
+}
+
+// public
+qint64 kpCompressedImage::spilledByteCount () const
+{
+    return m_spilledData ? m_spilledData->size () : 0;
+}
+
+//---------------------------------------------------------------------
+
+// public
+bool kpCompressedImage::spill (kpSpillFile *file)
+{
+    QSharedPointer <const kpSpillFile::Block> spilledData;
+
+    if (m_isEncoded && !m_runs.isEmpty ())
+    {
+        spilledData = file->write (m_runs.constData (),
+                                   qint64 (m_runs.size ()) * qint64 (sizeof (quint32)));
+    }
+    // (the color table of an indexed image would not survive)
+    else if (!m_image.isNull () && m_image.colorCount () == 0)
+    {
+        spilledData = file->write (m_image.constBits (),
+                                   qint64 (m_image.bytesPerLine ()) * m_image.height ());
+    }
+
+    if (!spilledData) {
+        return false;
+    }
+
+#if DEBUG_KP_COMPRESSED_IMAGE
+    qCDebug(kpLogImagelib) << "kpCompressedImage::spill() size=" << m_size
+                           << " bytes=" << spilledData->size ();
+#endif
+
+    m_spilledData = spilledData;
+    m_runs = QVector <quint32> ();
+    m_image = kpImage ();
+
+    return true;
+}
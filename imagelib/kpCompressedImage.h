@@ -0,0 +1,98 @@
+/*
+   Copyright (c) 2026 The KolourPaint Authors
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+   OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+   IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+   INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+   NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+   THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef KP_COMPRESSED_IMAGE_H
+#define KP_COMPRESSED_IMAGE_H
+
+
+#include <QSharedPointer>
+#include <QSize>
+#include <QVector>
+
+#include "generic/kpSpillFile.h"
+#include "imagelib/kpImage.h"
+
+
+//
+// Holds an image in less memory, for commands to keep around for undo.
+// Decompressing is done by image(), so only when the command is undone or
+// redone.
+//
+// 32-bit images are run-length encoded, pixel by pixel.  This is fast and
+// usually works very well for what commands save: areas that were painted
+// or filled, margins etc.  Images that don't get any smaller (e.g. noisy
+// photos) and other formats are held as is.
+//
+// Images can also be moved out of memory, into a kpSpillFile, with spill().
+//
+// Like kpImage, copying is cheap since the data is implicitly shared.
+//
+class kpCompressedImage
+{
+public:
+    kpCompressedImage ();
+    kpCompressedImage (const kpImage &image);
+
+    bool isNull () const;
+    QSize size () const;
+    int width () const;
+    int height () const;
+
+    // Returns the image passed to the ctor.
+    kpImage image () const;
+
+    // Returns the number of bytes of memory used to hold the image
+    // (0 once spilled).
+    qint64 byteCount () const;
+
+    // Returns the number of bytes that spill() moved to the file (0 unless
+    // spilled).
+    qint64 spilledByteCount () const;
+
+    // Moves the image data to <file>.  image() then reads it back from there.
+    //
+    // Returns false, keeping the image in memory, if it could not be written
+    // or there is nothing to move.
+    bool spill (kpSpillFile *file);
+
+private:
+    QSize m_size;
+    QImage::Format m_format;
+
+    // Run-length encoded pixels: each control word is either a run of
+    // (RunFlag | <count>) copies of the pixel after it, or <count> pixels
+    // given literally after it.  Empty if the image is held as is.
+    QVector <quint32> m_runs;
+
+    // The image, if not encoded.
+    kpImage m_image;
+
+    // Once spilled: the runs, or the image's bytes if not <m_isEncoded>.
+    QSharedPointer <const kpSpillFile::Block> m_spilledData;
+    bool m_isEncoded;
+};
+
+
+#endif  // KP_COMPRESSED_IMAGE_H
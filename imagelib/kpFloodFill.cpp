@@ -29,19 +29,23 @@
 #define DEBUG_KP_FLOOD_FILL 0
 
 
+
 #include "kpFloodFill.h"
 
+#include <algorithm>
+
 #include <QApplication>
 #include <QImage>
-#include <QLinkedList>
-#include <QList>
 #include <QPainter>
+#include <QVector>
+#include <QtGlobal>
 
 #include "kpLogCategories.h"
 
 #include "kpColor.h"
 #include "kpImage.h"
 #include "kpDefs.h"
+#include "generic/kpParallel.h"
 #include "pixmapfx/kpPixmapFX.h"
 #include "tools/kpTool.h"
 
@@ -65,7 +69,7 @@ public:
 
 //---------------------------------------------------------------------
 
-static kpCommandSize::SizeType FillLinesListSize (const QLinkedList <kpFillLine> &fillLines)
+static kpCommandSize::SizeType FillLinesListSize (const QVector <kpFillLine> &fillLines)
 {
     return (fillLines.size () * kpFillLine::size ());
 }
@@ -82,6 +86,19 @@ struct kpFloodFillPrivate
     int x{}, y{};
     kpColor color;
     int processedColorSimilarity{};
+    bool contiguous{};
+
+
+    //
+    // Set by setFillArea().
+    //
+
+    // Null means the whole image.
+    QRect fillArea;
+
+    // <fillArea>'s mask, as Format_RGB32.  Null if the whole of <fillArea>
+    // may be filled.
+    QImage fillAreaMask;
 
 
     //
@@ -95,18 +112,191 @@ struct kpFloodFillPrivate
     // Set by Step 2.
     //
 
-    QLinkedList <kpFillLine> fillLines;
-    QList < QLinkedList <kpFillLine> > fillLinesCache;
+    // Sorted by y, then x.  Lines on the same row never touch.
+    QVector <kpFillLine> fillLines;
 
     QRect boundingRect;
 
     bool prepared{};
+
+
+    //
+    // Only valid while Step 2 is running.
+    //
+
+    // kpPixmapFX::getRgbaScanlineImage() of <imagePtr>.
+    QImage readImage;
+
+    // 1 bit per pixel.  A bit is set if its pixel is not similar to
+    // colorToChange or is already part of a fill line, so that every pixel
+    // is only ever visited once.  Rows are only filled in, using
+    // kpColor::similarityMask(), once they are first reached.
+    QVector <quint32> blocked;
+    int blockedWordsPerLine{};
+    QVector <bool> blockedLineReady;
+
+    // Fill lines whose lines above and below haven't been examined yet.
+    QVector <kpFillLine> pendingLines;
+
+
+    //
+    // Set by saveChangedPixels().
+    //
+
+    bool changedPixelsSaved{};
+
+    // The old values of the pixels of <fillLines>, in order.  Empty if they
+    // were all exactly colorToChange.
+    QVector <QRgb> changedPixels;
+};
+
+//---------------------------------------------------------------------
+
+// Sets bits <x1> to <x2> inclusive.
+static void SetBits (quint32 *words, int x1, int x2)
+{
+    const int firstWord = x1 >> 5, lastWord = x2 >> 5;
+    const quint32 firstMask = ~0u << (x1 & 31);
+    const quint32 lastMask = ~0u >> (31 - (x2 & 31));
+
+    if (firstWord == lastWord)
+    {
+        words [firstWord] |= (firstMask & lastMask);
+        return;
+    }
+
+    words [firstWord] |= firstMask;
+    for (int i = firstWord + 1; i < lastWord; i++) {
+        words [i] = ~0u;
+    }
+    words [lastWord] |= lastMask;
+}
+
+//---------------------------------------------------------------------
+
+// Appends the maximal runs of pixels in row <y> that are similar to
+// <colorToChange>, from left to right.  <maskBuffer> is scratch space.
+// <pixels> starts at x = <x0> of row <y>.  If <areaMask> isn't null, only
+// pixels whose bit is also set in it are kept.
+static void AppendSimilarLines (QVector <kpFillLine> *lines,
+        QVector <quint32> *maskBuffer,
+        const QRgb *pixels, int width, int y,
+        const kpColor &colorToChange, int processedColorSimilarity,
+        int x0 = 0, const quint32 *areaMask = nullptr)
+{
+    const int numWords = (width + 31) / 32;
+    maskBuffer->resize (numWords);
+    quint32 *mask = maskBuffer->data ();
+
+    colorToChange.similarityMask (pixels, width, processedColorSimilarity, mask);
+
+    if (areaMask)
+    {
+        for (int i = 0; i < numWords; i++) {
+            mask [i] &= areaMask [i];
+        }
+    }
+
+    int x = 0;
+    while ((x = kpColor::findInSimilarityMask (mask, width, x, true)) < width)
+    {
+        const int x2 = kpColor::findInSimilarityMask (mask, width, x, false);
+        lines->append (kpFillLine (y, x0 + x, x0 + x2 - 1));
+        x = x2;
+    }
+}
+
+//---------------------------------------------------------------------
+
+// Union-find over fill line indexes.
+
+static int FindRoot (int *parent, int i)
+{
+    while (parent [i] != i)
+    {
+        parent [i] = parent [parent [i]];
+        i = parent [i];
+    }
+
+    return i;
+}
+
+static void Unite (int *parent, int i, int j)
+{
+    i = ::FindRoot (parent, i);
+    j = ::FindRoot (parent, j);
+
+    // Always keep the lowest index as the root so that the result doesn't
+    // depend on the order in which lines are united.
+    if (i < j) {
+        parent [j] = i;
+    }
+    else if (j < i) {
+        parent [i] = j;
+    }
+}
+
+//---------------------------------------------------------------------
+
+// Unites every line in [<above>, <aboveEnd>) with every line in
+// [<below>, <belowEnd>) that shares an x coordinate with it.  The ranges
+// must be the lines of 2 consecutive rows, sorted by x.
+static void UniteTouchingLines (int *parent, const kpFillLine *lines,
+        int above, int aboveEnd,
+        int below, int belowEnd)
+{
+    while (above < aboveEnd && below < belowEnd)
+    {
+        const kpFillLine &a = lines [above], &b = lines [below];
+
+        if (a.m_x2 < b.m_x1) {
+            above++;
+        }
+        else if (b.m_x2 < a.m_x1) {
+            below++;
+        }
+        else
+        {
+            ::Unite (parent, above, below);
+
+            // Advance whichever line ends first, since the other may still
+            // touch the next line of the opposite row.
+            if (a.m_x2 < b.m_x2) {
+                above++;
+            }
+            else {
+                below++;
+            }
+        }
+    }
+}
+
+//---------------------------------------------------------------------
+
+// A band of rows of the image, labelled by its own thread in
+// kpFloodFill::prepareParallel().
+struct kpFloodFillBand
+{
+    // All the maximal runs of similar pixels, sorted by y, then x.
+    QVector <kpFillLine> lines;
+
+    // Index into <lines> of the first line of each row of the band, followed
+    // by lines.size().
+    QVector <int> lineStart;
+
+    // Union-find parents of <lines>, relative to the start of <lines>.
+    QVector <int> parent;
 };
 
 //---------------------------------------------------------------------
 
+int kpFloodFill::parallelMinPixels = 16 * 1048576;
+
+//---------------------------------------------------------------------
+
 kpFloodFill::kpFloodFill (kpImage *image, int x, int y,
-                         const kpColor &color, int processedColorSimilarity)
+                         const kpColor &color, int processedColorSimilarity,
+                         bool contiguous)
     : d (new kpFloodFillPrivate ())
 {
     d->imagePtr = image;
@@ -114,6 +304,7 @@ kpFloodFill::kpFloodFill (kpImage *image, int x, int y,
     d->y = y;
     d->color = color;
     d->processedColorSimilarity = processedColorSimilarity;
+    d->contiguous = contiguous;
 
     d->prepared = false;
 }
@@ -144,17 +335,33 @@ int kpFloodFill::processedColorSimilarity () const
 //---------------------------------------------------------------------
 
 // public
-kpCommandSize::SizeType kpFloodFill::size () const
+bool kpFloodFill::isContiguous () const
 {
-    kpCommandSize::SizeType fillLinesCacheSize = 0;
-    for (const auto &linesList : d->fillLinesCache)
-    {
-        fillLinesCacheSize += ::FillLinesListSize (linesList);
-    }
+    return d->contiguous;
+}
+
+//---------------------------------------------------------------------
+
+// public
+void kpFloodFill::setFillArea (const QRect &rect, const QBitmap &mask)
+{
+    Q_ASSERT (!d->prepared);
+    Q_ASSERT (mask.isNull () || mask.size () == rect.size ());
 
+    d->fillArea = rect;
+    d->fillAreaMask = mask.isNull () ?
+        QImage () :
+        mask.toImage ().convertToFormat (QImage::Format_RGB32);
+}
+
+//---------------------------------------------------------------------
+
+// public
+kpCommandSize::SizeType kpFloodFill::size () const
+{
     return ::FillLinesListSize(d->fillLines) +
-           kpCommandSize::QImageSize(d->imagePtr) +
-           fillLinesCacheSize;
+           static_cast<kpCommandSize::SizeType> (d->changedPixels.size ()) * sizeof (QRgb) +
+           static_cast<kpCommandSize::SizeType> (d->blocked.size ()) * sizeof (quint32);
 }
 
 //---------------------------------------------------------------------
@@ -185,123 +392,371 @@ kpColor kpFloodFill::colorToChange ()
 
 //---------------------------------------------------------------------
 
-// Derived from the zSprite2 Graphics Engine
+// private
+void kpFloodFill::beginScan ()
+{
+    d->readImage = kpPixmapFX::getRgbaScanlineImage (*d->imagePtr);
+}
+
+//---------------------------------------------------------------------
 
 // private
-kpColor kpFloodFill::pixelColor (int x, int y, bool *beenHere) const
+void kpFloodFill::endScan ()
 {
-    if (beenHere) {
-        *beenHere = false;
-    }
+    // finalize memory usage
+    d->readImage = QImage ();
+    d->blocked = QVector <quint32> ();
+    d->blockedLineReady = QVector <bool> ();
+    d->pendingLines = QVector <kpFillLine> ();
+}
 
-    Q_ASSERT (y >= 0 && y < static_cast<int> (d->fillLinesCache.count ()));
+//---------------------------------------------------------------------
+
+// private
+quint32 *kpFloodFill::blockedLine (int y)
+{
+    quint32 *line = d->blocked.data () + y * d->blockedWordsPerLine;
 
-    for (const auto &line : d->fillLinesCache [y])
+    if (!d->blockedLineReady [y])
     {
-        if (x >= line.m_x1 && x <= line.m_x2)
-        {
-            if (beenHere) {
-                *beenHere = true;
-            }
-            return d->color;
+        d->colorToChange.similarityMask (
+            reinterpret_cast <const QRgb *> (d->readImage.constScanLine (y)),
+            d->readImage.width (), d->processedColorSimilarity, line);
+
+        for (int i = 0; i < d->blockedWordsPerLine; i++) {
+            line [i] = ~line [i];
         }
+
+        d->blockedLineReady [y] = true;
     }
 
-    return kpPixmapFX::getColorAtPixel (*(d->imagePtr), QPoint (x, y));
+    return line;
 }
 
 //---------------------------------------------------------------------
 
 // private
-bool kpFloodFill::shouldGoTo (int x, int y) const
+int kpFloodFill::findMinX (int y, int x)
 {
-    bool beenThere;
-    const kpColor col = pixelColor (x, y, &beenThere);
+    return kpColor::findLastInSimilarityMask (blockedLine (y), x, true) + 1;
+}
 
-    return (!beenThere && col.isSimilarTo (d->colorToChange, d->processedColorSimilarity));
+//---------------------------------------------------------------------
+
+// private
+int kpFloodFill::findMaxX (int y, int x)
+{
+    return kpColor::findInSimilarityMask (blockedLine (y),
+        d->readImage.width (), x, true) - 1;
 }
 
 //---------------------------------------------------------------------
 
 // private
-int kpFloodFill::findMinX (int y, int x) const
+void kpFloodFill::addLine (int y, int x1, int x2)
 {
-    for (;;)
+#if DEBUG_KP_FLOOD_FILL && 0
+    qCDebug(kpLogImagelib) << "kpFillCommand::fillAddLine ("
+              << y << "," << x1 << "," << x2 << ")" << endl;
+#endif
+
+    ::SetBits (blockedLine (y), x1, x2);
+
+    d->fillLines.append (kpFillLine (y, x1, x2));
+    d->pendingLines.append (kpFillLine (y, x1, x2));
+}
+
+//---------------------------------------------------------------------
+
+// private
+void kpFloodFill::findAndAddLines (const kpFillLine &fillLine, int dy)
+{
+    const int y = fillLine.m_y + dy;
+
+    // out of bounds?
+    if (y < 0 || y >= d->readImage.height ()) {
+        return;
+    }
+
+    const quint32 *line = blockedLine (y);
+
+    // Find each pixel under <fillLine> that can still be filled, 32 at a
+    // time.
+    int xnow = fillLine.m_x1;
+    while ((xnow = kpColor::findInSimilarityMask (line,
+                fillLine.m_x2 + 1, xnow, false)) <= fillLine.m_x2)
     {
-        if (x < 0) {
-            return 0;
-        }
+        // Find minimum and maximum x values
+        const int minxnow = findMinX (y, xnow);
+        const int maxxnow = findMaxX (y, xnow);
 
-        if (shouldGoTo (x, y)) {
-            x--;
-        }
-        else {
-            return x + 1;
-        }
+        // Draw line
+        addLine (y, minxnow, maxxnow);
+
+        // Move x pointer
+        xnow = maxxnow + 1;
     }
 }
 
 //---------------------------------------------------------------------
 
 // private
-int kpFloodFill::findMaxX (int y, int x) const
+bool kpFloodFill::prepareSequential (qint64 maxPixels)
 {
-    for (;;)
+    d->blockedWordsPerLine = (d->readImage.width () + 31) / 32;
+    d->blocked.resize (d->blockedWordsPerLine * d->readImage.height ());
+    d->blockedLineReady.fill (false, d->readImage.height ());
+
+    d->pendingLines.clear ();
+
+    // draw initial line
+    addLine (d->y, findMinX (d->y, d->x), findMaxX (d->y, d->x));
+
+    // Make more lines above and below each line.  Every pixel is only
+    // added once so the order in which lines are expanded doesn't matter.
+    qint64 numPixels = 0;
+    while (!d->pendingLines.isEmpty ())
     {
-        if (x > d->imagePtr->width () - 1) {
-            return d->imagePtr->width () - 1;
-        }
+        const kpFillLine fillLine = d->pendingLines.takeLast ();
 
-        if (shouldGoTo (x, y)) {
-            x++;
-        }
-        else {
-            return x - 1;
+        numPixels += fillLine.m_x2 - fillLine.m_x1 + 1;
+        if (maxPixels >= 0 && numPixels > maxPixels)
+        {
+            d->fillLines.clear ();
+            return false;
         }
+
+    #if DEBUG_KP_FLOOD_FILL && 0
+        qCDebug(kpLogImagelib) << "Expanding from y=" << fillLine.m_y
+                   << " x1=" << fillLine.m_x1
+                   << " x2=" << fillLine.m_x2
+                   << endl;
+    #endif
+
+        findAndAddLines (fillLine, -1);
+        findAndAddLines (fillLine, +1);
     }
+
+    return true;
 }
 
 //---------------------------------------------------------------------
 
 // private
-void kpFloodFill::addLine (int y, int x1, int x2)
+void kpFloodFill::prepareParallel ()
 {
-#if DEBUG_KP_FLOOD_FILL && 0
-    qCDebug(kpLogImagelib) << "kpFillCommand::fillAddLine ("
-              << y << "," << x1 << "," << x2 << ")" << endl;
+    const QImage &image = d->readImage;
+    const int width = image.width (), height = image.height ();
+    const kpColor colorToChange = d->colorToChange;
+    const int processedColorSimilarity = d->processedColorSimilarity;
+
+    const int maxBands = kpParallel::idealThreadCount () * 4;
+    const int rowsPerBand = qMax (32, (height + maxBands - 1) / maxBands);
+    const int numBands = (height + rowsPerBand - 1) / rowsPerBand;
+
+#if DEBUG_KP_FLOOD_FILL && 1
+    qCDebug(kpLogImagelib) << "\tparallel: numBands=" << numBands
+              << " rowsPerBand=" << rowsPerBand;
 #endif
 
-    d->fillLines.append (kpFillLine (y, x1, x2));
-    d->fillLinesCache [y].append (
-        kpFillLine (y/*OPT: can determine from array index*/, x1, x2));
-    d->boundingRect = d->boundingRect.united (QRect (QPoint (x1, y), QPoint (x2, y)));
+    // Label the runs of each band separately.
+    QVector <kpFloodFillBand> bands (numBands);
+    kpParallel::forEach (numBands,
+        [&] (int b)
+        {
+            kpFloodFillBand &band = bands [b];
+            QVector <quint32> maskBuffer;
+
+            const int y1 = b * rowsPerBand;
+            const int y2 = qMin (height, y1 + rowsPerBand) - 1;
+
+            band.lineStart.reserve (y2 - y1 + 2);
+            for (int y = y1; y <= y2; y++)
+            {
+                const int rowStart = band.lines.size ();
+                band.lineStart.append (rowStart);
+
+                ::AppendSimilarLines (&band.lines, &maskBuffer,
+                    reinterpret_cast <const QRgb *> (image.constScanLine (y)), width, y,
+                    colorToChange, processedColorSimilarity);
+
+                for (int i = rowStart; i < band.lines.size (); i++) {
+                    band.parent.append (i);
+                }
+
+                if (y > y1)
+                {
+                    const int prevRowStart = band.lineStart [y - y1 - 1];
+                    ::UniteTouchingLines (band.parent.data (), band.lines.constData (),
+                        prevRowStart, rowStart,
+                        rowStart, band.lines.size ());
+                }
+            }
+            band.lineStart.append (band.lines.size ());
+        });
+
+
+    // Concatenate the bands.
+    QVector <kpFillLine> lines;
+    QVector <int> parent;
+    QVector <int> lineStart;
+    lineStart.reserve (height + 1);
+    for (auto &band : bands)
+    {
+        const int offset = lines.size ();
+
+        lines += band.lines;
+        for (const int p : band.parent) {
+            parent.append (p + offset);
+        }
+        for (int i = 0; i < band.lineStart.size () - 1; i++) {
+            lineStart.append (band.lineStart [i] + offset);
+        }
+
+        band = kpFloodFillBand ();
+    }
+    lineStart.append (lines.size ());
+
+
+    // Join runs that touch across band borders.
+    for (int b = 1; b < numBands; b++)
+    {
+        const int y = b * rowsPerBand;
+        ::UniteTouchingLines (parent.data (), lines.constData (),
+            lineStart [y - 1], lineStart [y],
+            lineStart [y], lineStart [y + 1]);
+    }
+
+
+    // Keep the runs connected to the clicked pixel.
+    int seedLine = -1;
+    for (int i = lineStart [d->y]; i < lineStart [d->y + 1]; i++)
+    {
+        if (lines [i].m_x1 <= d->x && d->x <= lines [i].m_x2)
+        {
+            seedLine = i;
+            break;
+        }
+    }
+    // The clicked pixel is always similar to itself.
+    Q_ASSERT (seedLine >= 0);
+
+    const int root = ::FindRoot (parent.data (), seedLine);
+    for (int i = 0; i < lines.size (); i++)
+    {
+        if (::FindRoot (parent.data (), i) == root) {
+            d->fillLines.append (lines [i]);
+        }
+    }
 }
 
 //---------------------------------------------------------------------
 
 // private
-void kpFloodFill::findAndAddLines (const kpFillLine &fillLine, int dy)
+void kpFloodFill::prepareAllSimilar ()
 {
-    // out of bounds?
-    if (fillLine.m_y + dy < 0 || fillLine.m_y + dy >= d->imagePtr->height ()) {
+    const QImage &image = d->readImage;
+    const kpColor colorToChange = d->colorToChange;
+    const int processedColorSimilarity = d->processedColorSimilarity;
+
+    QRect area = image.rect ();
+    if (!d->fillArea.isNull ()) {
+        area = area.intersected (d->fillArea);
+    }
+    if (area.isEmpty ()) {
         return;
     }
 
-    for (int xnow = fillLine.m_x1; xnow <= fillLine.m_x2; xnow++)
+    const int maxBands = kpParallel::idealThreadCount () * 4;
+    const int rowsPerBand = qMax (32, (area.height () + maxBands - 1) / maxBands);
+    const int numBands = (area.height () + rowsPerBand - 1) / rowsPerBand;
+
+    QVector < QVector <kpFillLine> > bandLines (numBands);
+    kpParallel::forEach (numBands,
+        [&] (int b)
+        {
+            QVector <quint32> maskBuffer, areaMaskBuffer;
+
+            const int y1 = area.top () + b * rowsPerBand;
+            const int y2 = qMin (area.bottom (), y1 + rowsPerBand - 1);
+            for (int y = y1; y <= y2; y++)
+            {
+                const quint32 *areaMask = nullptr;
+                if (!d->fillAreaMask.isNull ())
+                {
+                    const QRgb *maskRow = reinterpret_cast <const QRgb *> (
+                        d->fillAreaMask.constScanLine (y - d->fillArea.y ())) +
+                        (area.x () - d->fillArea.x ());
+
+                    areaMaskBuffer.fill (0, (area.width () + 31) / 32);
+                    for (int x = 0; x < area.width (); x++)
+                    {
+                        // Qt::color1 converts to black.
+                        if (qGray (maskRow [x]) < 128) {
+                            areaMaskBuffer [x / 32] |= (1u << (x % 32));
+                        }
+                    }
+                    areaMask = areaMaskBuffer.constData ();
+                }
+
+                ::AppendSimilarLines (&bandLines [b], &maskBuffer,
+                    reinterpret_cast <const QRgb *> (image.constScanLine (y)) + area.x (),
+                    area.width (), y,
+                    colorToChange, processedColorSimilarity,
+                    area.x (), areaMask);
+            }
+        });
+
+    for (auto &lines : bandLines)
     {
-        // At current position, right colour?
-        if (shouldGoTo (xnow, fillLine.m_y + dy))
+        d->fillLines += lines;
+        lines = QVector <kpFillLine> ();
+    }
+}
+
+//---------------------------------------------------------------------
+
+// private
+void kpFloodFill::compactLines ()
+{
+    std::sort (d->fillLines.begin (), d->fillLines.end (),
+        [] (const kpFillLine &lhs, const kpFillLine &rhs)
         {
-            // Find minimum and maximum x values
-            int minxnow = findMinX (fillLine.m_y + dy, xnow);
-            int maxxnow = findMaxX (fillLine.m_y + dy, xnow);
+            return (lhs.m_y < rhs.m_y ||
+                    (lhs.m_y == rhs.m_y && lhs.m_x1 < rhs.m_x1));
+        });
 
-            // Draw line
-            addLine (fillLine.m_y + dy, minxnow, maxxnow);
+    int numLines = 0;
+    int minX = INT_MAX, maxX = INT_MIN;
+    for (const auto &line : d->fillLines)
+    {
+        minX = qMin (minX, line.m_x1);
+        maxX = qMax (maxX, line.m_x2);
 
-            // Move x pointer
-            xnow = maxxnow;
+        if (numLines > 0)
+        {
+            kpFillLine &lastLine = d->fillLines [numLines - 1];
+            if (lastLine.m_y == line.m_y && lastLine.m_x2 + 1 == line.m_x1)
+            {
+                lastLine.m_x2 = line.m_x2;
+                continue;
+            }
         }
+
+        d->fillLines [numLines++] = line;
+    }
+
+    d->fillLines.resize (numLines);
+    d->fillLines.squeeze ();
+
+    if (numLines > 0)
+    {
+        d->boundingRect = QRect (QPoint (minX, d->fillLines.first ().m_y),
+                                 QPoint (maxX, d->fillLines.last ().m_y));
+    }
+    else
+    {
+        d->boundingRect = QRect ();
     }
 }
 
@@ -320,8 +775,16 @@ void kpFloodFill::prepare ()
 
     prepareColorToChange ();
 
+    d->fillLines.clear ();
     d->boundingRect = QRect ();
 
+    // Clicked outside the image?
+    if (!d->colorToChange.isValid ())
+    {
+        d->prepared = true;  // sync with all "return true"'s
+        return;
+    }
+
 
 #if DEBUG_KP_FLOOD_FILL && 1
     qCDebug(kpLogImagelib) << "\tperforming NOP check";
@@ -336,52 +799,48 @@ void kpFloodFill::prepare ()
         return;
     }
 
-#if DEBUG_KP_FLOOD_FILL && 1
-    qCDebug(kpLogImagelib) << "\tcreating fillLinesCache";
-#endif
-
-    // ready cache
-    for (int i = 0; i < d->imagePtr->height (); i++) {
-         d->fillLinesCache.append (QLinkedList <kpFillLine> ());
-    }
-
 #if DEBUG_KP_FLOOD_FILL && 1
     qCDebug(kpLogImagelib) << "\tcreating fill lines";
 #endif
 
-    // draw initial line
-    addLine (d->y, findMinX (d->y, d->x), findMaxX (d->y, d->x));
+    beginScan ();
 
-    for (QLinkedList <kpFillLine>::ConstIterator it = d->fillLines.begin ();
-         it != d->fillLines.end ();
-         ++it)
+    const qint64 numPixels =
+        static_cast <qint64> (d->readImage.width ()) * d->readImage.height ();
+    if (!d->contiguous)
     {
-    #if DEBUG_KP_FLOOD_FILL && 0
-        qCDebug(kpLogImagelib) << "Expanding from y=" << (*it).m_y
-                   << " x1=" << (*it).m_x1
-                   << " x2=" << (*it).m_x2
-                   << endl;
-    #endif
-
-        //
-        // Make more lines above and below current line.
-        //
-        // WARNING: Adds to end of "fillLines" (the linked list we are iterating
-        //          through).  Therefore, "fillLines" must remain a linked list
-        //          - you cannot change it into a vector.  Also, do not use
-        //          "foreach" for this loop as that makes a copy of the linked
-        //          list at the start and won't see new lines.
-        //
-        findAndAddLines (*it, -1);
-        findAndAddLines (*it, +1);
+        prepareAllSimilar ();
+    }
+    else if (kpFloodFill::parallelMinPixels > 0 &&
+        numPixels >= kpFloodFill::parallelMinPixels &&
+        kpParallel::idealThreadCount () > 1)
+    {
+        // prepareParallel() always labels the whole image, so only use it
+        // for fills that are big enough to pay for that.  Past this many
+        // filled pixels, the single thread would take about as long as all
+        // the threads labelling the whole image.
+        const qint64 sequentialMaxPixels =
+            numPixels / kpParallel::idealThreadCount ();
+
+        if (!prepareSequential (sequentialMaxPixels))
+        {
+        #if DEBUG_KP_FLOOD_FILL && 1
+            qCDebug(kpLogImagelib) << "\tfill too big for a single thread";
+        #endif
+            prepareParallel ();
+        }
+    }
+    else
+    {
+        prepareSequential ();
     }
 
 #if DEBUG_KP_FLOOD_FILL && 1
     qCDebug(kpLogImagelib) << "\tfinalising memory usage";
 #endif
 
-    // finalize memory usage
-    d->fillLinesCache.clear ();
+    endScan ();
+    compactLines ();
 
     d->prepared = true;  // sync with all "return true"'s
 }
@@ -404,23 +863,44 @@ void kpFloodFill::fill()
 
     QApplication::setOverrideCursor(Qt::WaitCursor);
 
-    QPainter painter(d->imagePtr);
+    const QImage::Format format = d->imagePtr->format();
+    const bool isOpaqueOrTransparent = d->color.isValid() &&
+        (d->color.alpha() == 255 || d->color.isTransparent());
 
-    // by definition, flood fill with a fully transparent color erases the pixels
-    // and sets them to be fully transparent
-    if ( d->color.isTransparent() ) {
-      painter.setCompositionMode(QPainter::CompositionMode_Clear);
+    if ( isOpaqueOrTransparent &&
+         (format == QImage::Format_ARGB32_Premultiplied ||
+          format == QImage::Format_ARGB32) )
+    {
+      // The same pixels QPainter would produce below, written straight into
+      // the scanlines.  A fully transparent color erases the pixels.
+      const QRgb rgba = d->color.isTransparent() ? 0 : d->color.toQRgb();
+
+      for (const auto &l : d->fillLines)
+      {
+        auto *line = reinterpret_cast<QRgb *>(d->imagePtr->scanLine(l.m_y));
+        std::fill(line + l.m_x1, line + l.m_x2 + 1, rgba);
+      }
     }
-
-    painter.setPen(d->color.toQColor());
-
-    for (const auto &l : d->fillLines)
+    else
     {
-      if ( l.m_x1 == l.m_x2 ) {
-        painter.drawPoint(l.m_x1, l.m_y);
+      QPainter painter(d->imagePtr);
+
+      // by definition, flood fill with a fully transparent color erases the pixels
+      // and sets them to be fully transparent
+      if ( d->color.isTransparent() ) {
+        painter.setCompositionMode(QPainter::CompositionMode_Clear);
       }
-      else {
-        painter.drawLine(l.m_x1, l.m_y, l.m_x2, l.m_y);
+
+      painter.setPen(d->color.toQColor());
+
+      for (const auto &l : d->fillLines)
+      {
+        if ( l.m_x1 == l.m_x2 ) {
+          painter.drawPoint(l.m_x1, l.m_y);
+        }
+        else {
+          painter.drawLine(l.m_x1, l.m_y, l.m_x2, l.m_y);
+        }
       }
     }
 
@@ -428,3 +908,86 @@ void kpFloodFill::fill()
 }
 
 //---------------------------------------------------------------------
+
+// public
+bool kpFloodFill::saveChangedPixels ()
+{
+    prepare ();
+
+    const QImage::Format format = d->imagePtr->format ();
+    if (format != QImage::Format_ARGB32_Premultiplied &&
+        format != QImage::Format_ARGB32)
+    {
+        return false;
+    }
+
+    const kpImage &image = *d->imagePtr;
+    const QRgb rgbaToChange = d->colorToChange.isValid () ?
+        d->colorToChange.toQRgb () : 0;
+
+    d->changedPixels.clear ();
+
+    bool allRgbaToChange = true;
+    qint64 numPixels = 0;
+    for (const auto &l : d->fillLines)
+    {
+        const auto *line = reinterpret_cast <const QRgb *> (image.constScanLine (l.m_y));
+        for (int x = l.m_x1; x <= l.m_x2 && allRgbaToChange; x++)
+        {
+            if (line [x] != rgbaToChange) {
+                allRgbaToChange = false;
+            }
+        }
+
+        numPixels += l.m_x2 - l.m_x1 + 1;
+    }
+
+    if (!allRgbaToChange)
+    {
+        d->changedPixels.resize (static_cast <int> (numPixels));
+
+        QRgb *changedPixel = d->changedPixels.data ();
+        for (const auto &l : d->fillLines)
+        {
+            const auto *line = reinterpret_cast <const QRgb *> (image.constScanLine (l.m_y));
+            changedPixel = std::copy (line + l.m_x1, line + l.m_x2 + 1, changedPixel);
+        }
+    }
+
+    d->changedPixelsSaved = true;
+
+    return true;
+}
+
+//---------------------------------------------------------------------
+
+// public
+void kpFloodFill::restoreChangedPixels ()
+{
+    Q_ASSERT (d->changedPixelsSaved);
+
+    const QRgb rgbaToChange = d->colorToChange.isValid () ?
+        d->colorToChange.toQRgb () : 0;
+    const QRgb *changedPixel = d->changedPixels.constData ();
+
+    for (const auto &l : d->fillLines)
+    {
+        auto *line = reinterpret_cast <QRgb *> (d->imagePtr->scanLine (l.m_y));
+
+        if (d->changedPixels.isEmpty ())
+        {
+            std::fill (line + l.m_x1, line + l.m_x2 + 1, rgbaToChange);
+        }
+        else
+        {
+            const int numPixels = l.m_x2 - l.m_x1 + 1;
+            std::copy (changedPixel, changedPixel + numPixels, line + l.m_x1);
+            changedPixel += numPixels;
+        }
+    }
+
+    d->changedPixels = QVector <QRgb> ();
+    d->changedPixelsSaved = false;
+}
+
+//---------------------------------------------------------------------
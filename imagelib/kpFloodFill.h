@@ -30,6 +30,8 @@
 #define KP_FLOOD_FILL_H
 
 
+#include <QBitmap>
+
 #include "kpImage.h"
 #include "commands/kpCommandSize.h"
 
@@ -43,9 +45,13 @@ struct kpFloodFillPrivate;
 class kpFloodFill
 {
 public:
+    // If <contiguous> is set, only the region of pixels connected to (x, y)
+    // that are similar to its color is filled.  Otherwise, every pixel in
+    // the image that is similar to the color at (x, y) is replaced.
     kpFloodFill (kpImage *image, int x, int y,
                  const kpColor &color,
-                 int processedColorSimilarity);
+                 int processedColorSimilarity,
+                 bool contiguous = true);
     ~kpFloodFill ();
 
 
@@ -56,6 +62,17 @@ public:
 public:
     kpColor color () const;
     int processedColorSimilarity () const;
+    bool isContiguous () const;
+
+
+public:
+    // Non-contiguous fills only: only replaces pixels inside <rect> and,
+    // if <mask> isn't null, whose <mask> pixel is Qt::color1.  <mask> is as
+    // big as <rect> and relative to its top-left, like
+    // kpAbstractImageSelection::shapeBitmap().
+    //
+    // Must be called before Step 2.
+    void setFillArea (const QRect &rect, const QBitmap &mask = QBitmap ());
 
 
 public:
@@ -63,6 +80,14 @@ public:
     kpCommandSize::SizeType size () const;
 
 
+    // Images with at least this many pixels are scanned by several threads
+    // at once in Step 2, if the fill turns out to be big (small fills are
+    // still done by a single thread, which only visits the filled pixels).
+    // The result is identical to that of the single-threaded fill.
+    // 0 disables multithreaded filling.
+    static int parallelMinPixels;
+
+
     //
     // Step 1: Determines the colour that will be changed to color().
     //
@@ -86,18 +111,40 @@ public:
     //
 
 private:
-    kpColor pixelColor (int x, int y, bool *beenHere = nullptr) const;
-    bool shouldGoTo (int x, int y) const;
+    // Sets up the state that is only needed while Step 2 is running.
+    void beginScan ();
+    void endScan ();
+
+    // Returns row <y> of the blocked bitmap, filling it in if this is the
+    // first time that it is needed.
+    quint32 *blockedLine (int y);
 
     // Finds the minimum x value at a certain line to be filled.
-    int findMinX (int y, int x) const;
+    int findMinX (int y, int x);
 
     // Finds the maximum x value at a certain line to be filled.
-    int findMaxX (int y, int x) const;
+    int findMaxX (int y, int x);
 
     void addLine (int y, int x1, int x2);
     void findAndAddLines (const kpFillLine &fillLine, int dy);
 
+    // Only visits the pixels that get filled (and their neighbours).
+    //
+    // Gives up, returning false with no fill lines, once more than
+    // <maxPixels> pixels would be filled.  -1 means no limit.
+    bool prepareSequential (qint64 maxPixels = -1);
+
+    // Splits the image into bands of rows, finds the connected runs of
+    // similar pixels in each band on a separate thread, joins the runs
+    // across band borders and keeps those connected to the clicked pixel.
+    void prepareParallel ();
+
+    // Non-contiguous fill: every run of similar pixels in the image.
+    void prepareAllSimilar ();
+
+    // Sorts the fill lines and joins adjacent ones on the same row.
+    void compactLines ();
+
 public:
     // (may invoke Step 1's prepareColorToChange())
     void prepare ();
@@ -119,6 +166,21 @@ public:
     // (may invoke Step 2's prepare())
     void fill ();
 
+    // For undo: remembers the current values of the pixels that fill() will
+    // change, along the fill lines only (not the whole boundingRect()).
+    // If they all have exactly colorToChange(), not even their values
+    // are stored.
+    //
+    // Returns false if the image format can't be saved this way, in which
+    // case nothing is remembered and the caller must save the pixels itself.
+    //
+    // (may invoke Step 2's prepare())
+    bool saveChangedPixels ();
+
+    // Puts back the pixels remembered by saveChangedPixels() and forgets
+    // them.
+    void restoreChangedPixels ();
+
 
 private:
     kpFloodFillPrivate * const d;
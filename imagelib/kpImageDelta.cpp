@@ -0,0 +1,267 @@
+/*
+   Copyright (c) 2026 The KolourPaint Authors
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+   OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+   IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+   INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+   NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+   THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#define DEBUG_KP_IMAGE_DELTA 0
+
+
+#include "kpImageDelta.h"
+
+#include "kpLogCategories.h"
+#include "pixmapfx/kpPixmapFX.h"
+
+#include <QPoint>
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+
+// Changed pixels separated by no more than this many unchanged ones are
+// saved in the same span, since starting a new span costs 3 words.
+static const int MaxSpanGap = 3;
+
+// Words before the pixels of a span.
+static const int SpanHeaderSize = 3;
+
+//---------------------------------------------------------------------
+
+kpImageDelta::kpImageDelta () = default;
+
+//---------------------------------------------------------------------
+
+kpImageDelta::kpImageDelta (const kpImage &oldImage, const kpImage &newImage,
+                            const QPoint &topLeft)
+{
+    Q_ASSERT (oldImage.size () == newImage.size ());
+
+    if (oldImage.depth () != 32 || newImage.depth () != 32)
+    {
+        if (oldImage != newImage)
+        {
+            m_rect = QRect (topLeft, oldImage.size ());
+            m_image = oldImage;
+        }
+        return;
+    }
+
+    const int width = oldImage.width ();
+    int left = INT_MAX, right = INT_MIN, top = INT_MAX, bottom = INT_MIN;
+
+    for (int y = 0; y < oldImage.height (); y++)
+    {
+        const auto *oldLine = reinterpret_cast <const quint32 *> (oldImage.constScanLine (y));
+        const auto *newLine = reinterpret_cast <const quint32 *> (newImage.constScanLine (y));
+
+        if (std::memcmp (oldLine, newLine, static_cast <size_t> (width) * sizeof (quint32)) == 0) {
+            continue;
+        }
+
+        int x = 0;
+        for (;;)
+        {
+            while (x < width && oldLine [x] == newLine [x]) {
+                x++;
+            }
+            if (x == width) {
+                break;
+            }
+
+            // Extend the span until more than MaxSpanGap pixels in a row
+            // are unchanged.
+            const int spanBegin = x;
+            int spanEnd = x + 1;
+            x = spanEnd;
+            while (x < width)
+            {
+                if (oldLine [x] != newLine [x]) {
+                    spanEnd = ++x;
+                }
+                else if (x - spanEnd >= MaxSpanGap) {
+                    break;
+                }
+                else {
+                    x++;
+                }
+            }
+
+            const int count = spanEnd - spanBegin;
+            const int oldSize = m_spans.size ();
+            m_spans.resize (oldSize + SpanHeaderSize + count);
+
+            quint32 *span = m_spans.data () + oldSize;
+            span [0] = static_cast <quint32> (topLeft.y () + y);
+            span [1] = static_cast <quint32> (topLeft.x () + spanBegin);
+            span [2] = static_cast <quint32> (count);
+            std::memcpy (span + SpanHeaderSize, oldLine + spanBegin,
+                         static_cast <size_t> (count) * sizeof (quint32));
+
+            left = qMin (left, spanBegin);
+            right = qMax (right, spanEnd - 1);
+        }
+
+        top = qMin (top, y);
+        bottom = y;
+    }
+
+    if (m_spans.isEmpty ()) {
+        return;
+    }
+
+    m_spans.squeeze ();
+    m_rect = QRect (QPoint (left, top), QPoint (right, bottom)).translated (topLeft);
+
+#if DEBUG_KP_IMAGE_DELTA
+    qCDebug(kpLogImagelib) << "kpImageDelta::<ctor>(size=" << oldImage.size ()
+                           << ") rect=" << m_rect
+                           << " bytes=" << byteCount ();
+#endif
+}
+
+//---------------------------------------------------------------------
+
+// public
+bool kpImageDelta::isNull () const
+{
+    return m_rect.isEmpty ();
+}
+
+//---------------------------------------------------------------------
+
+// public
+QRect kpImageDelta::rect () const
+{
+    return m_rect;
+}
+
+//---------------------------------------------------------------------
+
+// public
+qint64 kpImageDelta::byteCount () const
+{
+    return qint64 (m_spans.size ()) * qint64 (sizeof (quint32)) +
+           m_image.byteCount ();
+}
+
+// public
+qint64 kpImageDelta::spilledByteCount () const
+{
+    return (m_spilledSpans ? m_spilledSpans->size () : 0) +
+           m_image.spilledByteCount ();
+}
+
+//---------------------------------------------------------------------
+
+// public
+void kpImageDelta::swap (kpImage *image)
+{
+    if (isNull ()) {
+        return;
+    }
+
+    if (!m_image.isNull ())
+    {
+        const kpImage currentImage = kpPixmapFX::getPixmapAt (*image, m_rect);
+        kpPixmapFX::setPixmapAt (image, m_rect.topLeft (), m_image.image ());
+        m_image = currentImage;
+        return;
+    }
+
+    if (m_spilledSpans)
+    {
+        QVector <quint32> spans (static_cast <int> (m_spilledSpans->size () /
+                                                    qint64 (sizeof (quint32))));
+        const bool readSpans = m_spilledSpans->read (
+            [&spans] (const uchar *data)
+            {
+                std::memcpy (spans.data (), data,
+                             static_cast <size_t> (spans.size ()) * sizeof (quint32));
+            });
+        if (!readSpans)
+        {
+            qCCritical(kpLogImagelib) << "kpImageDelta::swap() could not read back"
+                                      << "spilled pixels";
+            return;
+        }
+
+        m_spans = spans;
+        m_spilledSpans.reset ();
+    }
+
+    if (image->depth () != 32)
+    {
+        qCCritical(kpLogImagelib) << "kpImageDelta::swap() image depth="
+                                  << image->depth ();
+        return;
+    }
+
+    const int width = image->width (), height = image->height ();
+
+    quint32 *span = m_spans.data ();
+    const quint32 * const spansEnd = span + m_spans.size ();
+    while (span < spansEnd)
+    {
+        const int y = static_cast <int> (span [0]);
+        const int x = static_cast <int> (span [1]);
+        const int count = static_cast <int> (span [2]);
+        quint32 *pixels = span + SpanHeaderSize;
+        span = pixels + count;
+
+        const int begin = qMax (x, 0), end = qMin (x + count, width);
+        if (y < 0 || y >= height || begin >= end) {
+            continue;
+        }
+
+        auto *line = reinterpret_cast <quint32 *> (image->scanLine (y));
+        std::swap_ranges (line + begin, line + end, pixels + (begin - x));
+    }
+}
+
+//---------------------------------------------------------------------
+
+// public
+bool kpImageDelta::spill (kpSpillFile *file)
+{
+    if (!m_image.isNull ()) {
+        return m_image.spill (file);
+    }
+
+    if (m_spans.isEmpty ()) {
+        return false;
+    }
+
+    const QSharedPointer <const kpSpillFile::Block> spilledSpans =
+        file->write (m_spans.constData (),
+                     qint64 (m_spans.size ()) * qint64 (sizeof (quint32)));
+    if (!spilledSpans) {
+        return false;
+    }
+
+    m_spilledSpans = spilledSpans;
+    m_spans = QVector <quint32> ();
+
+    return true;
+}
@@ -0,0 +1,102 @@
+/*
+   Copyright (c) 2026 The KolourPaint Authors
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+   OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+   IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+   INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+   NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+   THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef KP_IMAGE_DELTA_H
+#define KP_IMAGE_DELTA_H
+
+
+#include <QRect>
+#include <QSharedPointer>
+#include <QVector>
+
+#include "generic/kpSpillFile.h"
+#include "imagelib/kpCompressedImage.h"
+#include "imagelib/kpImage.h"
+
+
+class QPoint;
+
+
+//
+// Saves, for undo, only the pixels that a change to part of an image
+// actually changed, rather than the whole rectangle.  A line across the
+// image changes a few pixels per row but its bounding rectangle can be the
+// whole image.
+//
+// The pixels are saved as horizontal spans of changed pixels with their
+// old values.  swap() exchanges them with the pixels in the image, in
+// place, so it both undoes and (called again) redoes the change.
+//
+// Images that aren't 32-bit are saved whole instead.
+//
+class kpImageDelta
+{
+public:
+    kpImageDelta ();
+
+    // Saves the pixels of <oldImage> that are different in <newImage>.
+    // These are the same part of an image, at <topLeft>, before and after
+    // a change.
+    kpImageDelta (const kpImage &oldImage, const kpImage &newImage,
+                  const QPoint &topLeft);
+
+    // Returns true if no pixels were changed.
+    bool isNull () const;
+
+    // Returns the bounding rectangle of the saved pixels.
+    QRect rect () const;
+
+    // Returns the number of bytes of memory used (0 once spilled).
+    qint64 byteCount () const;
+
+    // Returns the number of bytes that spill() moved to the file.
+    qint64 spilledByteCount () const;
+
+    // Exchanges the saved pixels with those in <image> (which must be the
+    // image of the change, in either state).  Pixels outside <image> are
+    // ignored.
+    //
+    // The caller must say that rect() of <image> changed.
+    void swap (kpImage *image);
+
+    // Moves the saved pixels to <file> until the next swap() (see
+    // kpCompressedImage::spill()).
+    bool spill (kpSpillFile *file);
+
+private:
+    QRect m_rect;
+
+    // For each span: y, x, the number of pixels and then the pixels.
+    QVector <quint32> m_spans;
+
+    // <m_spans>, once spilled.
+    QSharedPointer <const kpSpillFile::Block> m_spilledSpans;
+
+    // If the images weren't 32-bit, the whole of <m_rect>.
+    kpCompressedImage m_image;
+};
+
+
+#endif  // KP_IMAGE_DELTA_H
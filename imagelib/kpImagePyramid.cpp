@@ -0,0 +1,99 @@
+/*
+   Copyright (c) 2026 The KolourPaint Authors
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+   OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+   IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+   INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+   NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+   THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#define DEBUG_KP_IMAGE_PYRAMID 0
+
+
+#include "kpImagePyramid.h"
+
+#include "kpLogCategories.h"
+
+#include "imagelib/transforms/kpImageScaler.h"
+
+
+//---------------------------------------------------------------------
+
+kpImagePyramid::kpImagePyramid ()
+    : m_imageKey (0)
+{
+}
+
+//---------------------------------------------------------------------
+
+// public
+QImage kpImagePyramid::level (const QImage &image, int width, int height)
+{
+    if (image.isNull ()) {
+        return image;
+    }
+
+    if (image.cacheKey () != m_imageKey)
+    {
+    #if DEBUG_KP_IMAGE_PYRAMID
+        qCDebug(kpLogImagelib) << "kpImagePyramid::level() new image - discarding"
+                               << m_levels.size () << "levels";
+    #endif
+        m_levels.clear ();
+        m_imageKey = image.cacheKey ();
+    }
+
+    QImage ret = image;
+
+    for (int i = 0; ; i++)
+    {
+        const int halfWidth = ret.width () / 2;
+        const int halfHeight = ret.height () / 2;
+
+        // Would half of the current level be too small?
+        if (halfWidth < qMax (width, 1) || halfHeight < qMax (height, 1)) {
+            return ret;
+        }
+
+        if (i == m_levels.size ())
+        {
+        #if DEBUG_KP_IMAGE_PYRAMID
+            qCDebug(kpLogImagelib) << "kpImagePyramid::level() building level"
+                                   << i + 1 << "=" << halfWidth << "x" << halfHeight;
+        #endif
+            m_levels.append (kpImageScaler::scale (ret, halfWidth, halfHeight,
+                                                   kpImageScaler::AreaAverage));
+        }
+
+        ret = m_levels [i];
+    }
+}
+
+//---------------------------------------------------------------------
+
+// public
+void kpImagePyramid::clear ()
+{
+    m_levels.clear ();
+    m_imageKey = 0;
+}
+
+//---------------------------------------------------------------------
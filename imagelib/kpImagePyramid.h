@@ -0,0 +1,72 @@
+/*
+   Copyright (c) 2026 The KolourPaint Authors
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+   OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+   IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+   INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+   NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+   THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef KP_IMAGE_PYRAMID_H
+#define KP_IMAGE_PYRAMID_H
+
+
+#include <QImage>
+#include <QList>
+
+
+//
+// Caches successively halved copies of an image (a "mipmap pyramid"), so
+// that previews of a big image can be scaled down from a copy that is
+// already close to the wanted size, rather than from the whole image
+// every time.
+//
+// Levels are built on demand (with kpImageScaler's area average, so they
+// don't alias) and kept until clear() is called or levels of a different
+// image are asked for.
+//
+// The pyramid doesn't hold a reference to the image itself -- callers pass
+// it in each time.  This keeps e.g. the document image unshared, so that
+// editing it in place doesn't have to copy it first.
+//
+class kpImagePyramid
+{
+public:
+    kpImagePyramid ();
+
+    // Returns the smallest of <image>, <image> at half size, at quarter
+    // size etc. that is at least <width> x <height>.
+    //
+    // <image> is recognized by its QImage::cacheKey(), which changes
+    // whenever the image is modified.
+    QImage level (const QImage &image, int width, int height);
+
+    // Discards all levels.
+    void clear ();
+
+private:
+    qint64 m_imageKey;
+    // m_levels [i] is the image scaled by 1 / 2^(i + 1).
+    QList <QImage> m_levels;
+};
+
+
+#endif  // KP_IMAGE_PYRAMID_H
@@ -0,0 +1,158 @@
+/*
+   Copyright (c) 2026 The KolourPaint Authors
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+   OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+   IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+   INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+   NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+   THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include "kpLineIterator.h"
+
+#include <QtGlobal>
+
+#include <krandom.h>
+
+//---------------------------------------------------------------------
+
+kpLineIterator::kpLineIterator (const QPoint &startPoint, const QPoint &endPoint,
+        bool cardinalAdjacency,
+        double probability)
+    : m_probabilityTimes1000 (qRound (probability * 1000)),
+      m_cardinalAdjacency (cardinalAdjacency)
+{
+    Q_ASSERT (probability >= 0.0 && probability <= 1.0);
+
+    // Derived from the zSprite2 Graphics Engine.
+
+    // Difference of x and y values
+    const int dx = endPoint.x () - startPoint.x ();
+    const int dy = endPoint.y () - startPoint.y ();
+
+    // Absolute values of differences
+    m_ix = qAbs (dx);
+    m_iy = qAbs (dy);
+
+    // Larger of the x and y differences
+    m_inc = qMax (m_ix, m_iy);
+
+    m_xDir = (dx < 0) ? -1 : +1;
+    m_yDir = (dy < 0) ? -1 : +1;
+
+    // Plot location
+    m_plotX = startPoint.x ();
+    m_plotY = startPoint.y ();
+
+    m_x = m_y = 0;
+    m_stepsLeft = m_inc + 1;
+
+    m_candidates [0] = startPoint;
+    m_numCandidates = 1;
+    m_candidateIndex = 0;
+}
+
+//---------------------------------------------------------------------
+
+// private
+bool kpLineIterator::shouldDraw () const
+{
+    // (avoid KRandom::random() call)
+    return (m_probabilityTimes1000 == 1000 ||
+            (KRandom::random () % 1000) < m_probabilityTimes1000);
+}
+
+//---------------------------------------------------------------------
+
+// private
+bool kpLineIterator::step ()
+{
+    if (m_stepsLeft == 0) {
+        return false;
+    }
+
+    m_stepsLeft--;
+
+    // oldPlotX is equally as valid but would look different
+    // (but nobody will notice which one it is)
+    const int oldPlotY = m_plotY;
+    int plot = 0;
+
+    m_x += m_ix;
+    m_y += m_iy;
+
+    if (m_x > m_inc)
+    {
+        plot++;
+        m_x -= m_inc;
+        m_plotX += m_xDir;
+    }
+
+    if (m_y > m_inc)
+    {
+        plot++;
+        m_y -= m_inc;
+        m_plotY += m_yDir;
+    }
+
+    m_numCandidates = 0;
+    m_candidateIndex = 0;
+
+    if (plot)
+    {
+        if (m_cardinalAdjacency && plot == 2)
+        {
+            // MODIFIED: Every point is
+            // horizontally or vertically adjacent to another point (if there
+            // is more than 1 point, of course).  This is in contrast to the
+            // ordinary line algorithm which can create diagonal adjacencies.
+            m_candidates [m_numCandidates++] = QPoint (m_plotX, oldPlotY);
+        }
+
+        m_candidates [m_numCandidates++] = QPoint (m_plotX, m_plotY);
+    }
+
+    return true;
+}
+
+//---------------------------------------------------------------------
+
+// public
+bool kpLineIterator::next (QPoint *point)
+{
+    for (;;)
+    {
+        while (m_candidateIndex < m_numCandidates)
+        {
+            const QPoint &candidate = m_candidates [m_candidateIndex++];
+            if (shouldDraw ())
+            {
+                *point = candidate;
+                return true;
+            }
+        }
+
+        if (!step ()) {
+            return false;
+        }
+    }
+}
+
+//---------------------------------------------------------------------
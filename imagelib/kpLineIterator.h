@@ -0,0 +1,84 @@
+/*
+   Copyright (c) 2026 The KolourPaint Authors
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+   OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+   IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+   INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+   NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+   THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef KP_LINE_ITERATOR_H
+#define KP_LINE_ITERATOR_H
+
+
+#include <QPoint>
+
+
+//
+// Steps through the points of a straight line, as returned by
+// kpPainter::interpolatePoints(), one at a time without allocating any
+// memory.  See kpPainter::interpolatePoints() for the meaning of the
+// arguments.
+//
+// Usage:
+//
+//     kpLineIterator it (startPoint, endPoint);
+//     QPoint p;
+//     while (it.next (&p))
+//         ...
+//
+// Copies of an iterator continue independently from the same point (but
+// with a <probability> other than 1.0, they won't visit the same points).
+//
+class kpLineIterator
+{
+public:
+    kpLineIterator (const QPoint &startPoint, const QPoint &endPoint,
+                    bool cardinalAdjacency = false,
+                    double probability = 1.0);
+
+    // Sets <*point> to the next point and returns true or, if there are no
+    // more points, returns false.
+    bool next (QPoint *point);
+
+private:
+    bool shouldDraw () const;
+
+    // Runs the next step of Bresenham's algorithm, producing 0-2 candidate
+    // points.  Returns false if there are no more steps.
+    bool step ();
+
+    int m_probabilityTimes1000;
+    bool m_cardinalAdjacency;
+
+    int m_ix, m_iy, m_inc;
+    int m_xDir, m_yDir;
+
+    int m_plotX, m_plotY;
+    int m_x, m_y;
+    int m_stepsLeft;
+
+    QPoint m_candidates [2];
+    int m_numCandidates, m_candidateIndex;
+};
+
+
+#endif  // KP_LINE_ITERATOR_H
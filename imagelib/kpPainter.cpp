@@ -32,14 +32,16 @@
 #include "kpPainter.h"
 
 #include "kpImage.h"
+#include "kpLineIterator.h"
 #include "pixmapfx/kpPixmapFX.h"
-#include "tools/kpTool.h"
 #include "tools/flow/kpToolFlowBase.h"
 
+#include <algorithm>
 #include <cstdio>
 
 #include <QPainter>
 #include <QPolygon>
+#include <QVector>
 
 #include "kpLogCategories.h"
 #include <krandom.h>
@@ -57,14 +59,6 @@ bool kpPainter::pointsAreCardinallyAdjacent (const QPoint &p, const QPoint &q)
 
 //---------------------------------------------------------------------
 
-// Returns a random integer from 0 to 999 inclusive.
-static int RandomNumberFrom0to999 ()
-{
-    return (KRandom::random () % 1000);
-}
-
-//---------------------------------------------------------------------
-
 // public static
 QList <QPoint> kpPainter::interpolatePoints (const QPoint &startPoint,
     const QPoint &endPoint,
@@ -78,102 +72,12 @@ QList <QPoint> kpPainter::interpolatePoints (const QPoint &startPoint,
 
     QList <QPoint> ret;
 
-    Q_ASSERT (probability >= 0.0 && probability <= 1.0);
-    const int probabilityTimes1000 = qRound (probability * 1000);
-#define SHOULD_DRAW()  (probabilityTimes1000 == 1000/*avoid ::RandomNumberFrom0to999() call*/ ||  \
-                        ::RandomNumberFrom0to999 () < probabilityTimes1000)
-
-
-    // Derived from the zSprite2 Graphics Engine.
-    // "MODIFIED" comment shows deviation from zSprite2 and Bresenham's line
-    // algorithm.
-
-    const int x1 = startPoint.x (),
-        y1 = startPoint.y (),
-        x2 = endPoint.x (),
-        y2 = endPoint.y ();
-
-    // Difference of x and y values
-    const int dx = x2 - x1;
-    const int dy = y2 - y1;
-
-    // Absolute values of differences
-    const int ix = qAbs (dx);
-    const int iy = qAbs (dy);
-
-    // Larger of the x and y differences
-    const int inc = ix > iy ? ix : iy;
-
-    // Plot location
-    int plotx = x1;
-    int ploty = y1;
-
-    int x = 0;
-    int y = 0;
-
-    if (SHOULD_DRAW ()) {
-        ret.append (QPoint (plotx, ploty));
+    kpLineIterator it (startPoint, endPoint, cardinalAdjacency, probability);
+    QPoint p;
+    while (it.next (&p)) {
+        ret.append (p);
     }
 
-
-    for (int i = 0; i <= inc; i++)
-    {
-        // oldplotx is equally as valid but would look different
-        // (but nobody will notice which one it is)
-        const int oldploty = ploty;
-        int plot = 0;
-
-        x += ix;
-        y += iy;
-
-        if (x > inc)
-        {
-            plot++;
-            x -= inc;
-
-            if (dx < 0) {
-                plotx--;
-            }
-            else {
-                plotx++;
-            }
-        }
-
-        if (y > inc)
-        {
-            plot++;
-            y -= inc;
-
-            if (dy < 0) {
-                ploty--;
-            }
-            else {
-                ploty++;
-            }
-        }
-
-        if (plot)
-        {
-            if (cardinalAdjacency && plot == 2)
-            {
-                // MODIFIED: Every point is
-                // horizontally or vertically adjacent to another point (if there
-                // is more than 1 point, of course).  This is in contrast to the
-                // ordinary line algorithm which can create diagonal adjacencies.
-
-                if (SHOULD_DRAW ()) {
-                    ret.append (QPoint (plotx, oldploty));
-                }
-            }
-
-            if (SHOULD_DRAW ()) {
-                ret.append (QPoint (plotx, ploty));
-            }
-        }
-    }
-
-#undef SHOULD_DRAW
-
     return ret;
 }
 
@@ -190,214 +94,183 @@ void kpPainter::fillRect (kpImage *image,
 //---------------------------------------------------------------------
 
 
-// <rgbPainter> are operating on the original image
-// (the original image is not passed to this function).
-//
-// <image> = subset of the original image containing all the pixels in
-//           <imageRect>
-// <drawRect> = the rectangle, relative to the painters, whose pixels we
-//              want to change
-static bool ReadableImageWashRect (QPainter *rgbPainter,
-        const QImage &image,
-        const kpColor &colorToReplace,
-        const QRect &imageRect, const QRect &drawRect,
-        int processedColorSimilarity)
-{
-    bool didSomething = false;
-
-#if DEBUG_KP_PAINTER && 0
-    qCDebug(kpLogImagelib) << "kppixmapfx.cpp:WashRect(imageRect=" << imageRect
-               << ",drawRect=" << drawRect
-               << ")" << endl;
-#endif
-
-    // If you're going to pass painter pointers, those painters had better be
-    // active (i.e. QPainter::begin() has been called).
-    Q_ASSERT (!rgbPainter || rgbPainter->isActive ());
-
-// make use of scanline coherence
-#define FLUSH_LINE()                                             \
-{                                                                \
-    if (rgbPainter) {                                            \
-        if (startDrawX == x - 1)                                 \
-            rgbPainter->drawPoint (startDrawX + imageRect.x (),  \
-                y + imageRect.y ());                             \
-        else                                                     \
-            rgbPainter->drawLine (startDrawX + imageRect.x (),   \
-                y + imageRect.y (),                              \
-                x - 1 + imageRect.x (),                          \
-                y + imageRect.y ());                             \
-    }                                                            \
-    didSomething = true;                                         \
-    startDrawX = -1;                                             \
-}
-
-    const int maxY = drawRect.bottom () - imageRect.top ();
-
-    const int minX = drawRect.left () - imageRect.left ();
-    const int maxX = drawRect.right () - imageRect.left ();
-
-    for (int y = drawRect.top () - imageRect.top ();
-         y <= maxY;
-         y++)
-    {
-        int startDrawX = -1;
-
-        int x;  // for FLUSH_LINE()
-        for (x = minX; x <= maxX; x++)
-        {
-        #if DEBUG_KP_PAINTER && 0
-            fprintf (stderr, "y=%i x=%i colorAtPixel=%08X colorToReplace=%08X ... ",
-                     y, x,
-                     kpPixmapFX::getColorAtPixel (image, QPoint (x, y)).toQRgb (),
-                     colorToReplace.toQRgb ());
-        #endif
-            if (kpPixmapFX::getColorAtPixel (image, QPoint (x, y)).isSimilarTo (colorToReplace, processedColorSimilarity))
-            {
-            #if DEBUG_KP_PAINTER && 0
-                fprintf (stderr, "similar\n");
-            #endif
-                if (startDrawX < 0) {
-                    startDrawX = x;
-                }
-            }
-            else
-            {
-            #if DEBUG_KP_PAINTER && 0
-                fprintf (stderr, "different\n");
-            #endif
-                if (startDrawX >= 0) {
-                    FLUSH_LINE ();
-                }
-            }
-        }
-
-        if (startDrawX >= 0) {
-            FLUSH_LINE ();
-        }
-    }
-
-#undef FLUSH_LINE
-
-    return didSomething;
-}
-
-//---------------------------------------------------------------------
-
 struct WashPack
 {
-    QPoint startPoint, endPoint;
+    kpImage *image{};
+
     kpColor color;
-    int penWidth{}, penHeight{};
     kpColor colorToReplace;
     int processedColorSimilarity{};
 
+    // Pixel (x, y) of the document image is pixel
+    // (x - readableImageRect.x (), y - readableImageRect.y ()) of
+    // <*readableImage>, which is either <image> itself or
+    // <readableImageCopy>.
+    const QImage *readableImage{};
     QRect readableImageRect;
-    QImage readableImage;
+    QImage readableImageCopy;
+
+    // Whether <color> can be written straight into the scanlines of
+    // <image>.  Otherwise, <painter> is used.
+    bool writeDirectly{};
+    QPainter *painter{};
 };
 
 //---------------------------------------------------------------------
 
-static QRect Wash (kpImage *image,
-        const QPoint &startPoint, const QPoint &endPoint,
-        const kpColor &color, int penWidth, int penHeight,
+static void WashSetup (WashPack *pack, kpImage *image,
+        const QRect &rect,
+        const kpColor &color,
         const kpColor &colorToReplace,
-        int processedColorSimilarity,
-        QRect (*drawFunc) (QPainter * /*rgbPainter*/, void * /*data*/))
+        int processedColorSimilarity)
 {
-    WashPack pack;
-    pack.startPoint = startPoint; pack.endPoint = endPoint;
-    pack.color = color;
-    pack.penWidth = penWidth; pack.penHeight = penHeight;
-    pack.colorToReplace = colorToReplace;
-    pack.processedColorSimilarity = processedColorSimilarity;
-
-
-    // Get the rectangle that bounds the changes and the pixmap for that
-    // rectangle.
-    const QRect normalizedRect = kpPainter::normalizedRect(pack.startPoint, pack.endPoint);
-    pack.readableImageRect = kpTool::neededRect (normalizedRect,
-        qMax (pack.penWidth, pack.penHeight));
-#if DEBUG_KP_PAINTER
-    qCDebug(kpLogImagelib) << "kppainter.cpp:Wash() startPoint=" << startPoint
-              << " endPoint=" << endPoint
-              << " --> normalizedRect=" << normalizedRect
-              << " readableImageRect=" << pack.readableImageRect
-              << endl;
-#endif
-    pack.readableImage = kpPixmapFX::getPixmapAt (*image, pack.readableImageRect);
+    pack->image = image;
+    pack->color = color;
+    pack->colorToReplace = colorToReplace;
+    pack->processedColorSimilarity = processedColorSimilarity;
+
+    const QImage::Format format = image->format ();
+    const bool isRgbaFormat = (format == QImage::Format_ARGB32_Premultiplied ||
+                               format == QImage::Format_ARGB32);
+
+    // The document image can be read in place.  Every pixel is washed at
+    // most once and each row is read before it is written, so writing to
+    // it doesn't change what is read.
+    //
+    // Only a pointer is kept: another reference to <image> would make
+    // writing to it detach (copy) the whole image.
+    if (isRgbaFormat)
+    {
+        pack->readableImage = image;
+        pack->readableImageRect = image->rect ();
+    }
+    else
+    {
+        pack->readableImageCopy = kpPixmapFX::getRgbaScanlineImage (
+            kpPixmapFX::getPixmapAt (*image, rect));
+        pack->readableImage = &pack->readableImageCopy;
+        pack->readableImageRect = rect;
+    }
 
-    QPainter painter(image);
-    return (*drawFunc)(&painter, &pack);
+    // Drawing a fully transparent color with QPainter (in its default
+    // composition mode) does not change the pixels, so neither does
+    // writing directly.
+    pack->writeDirectly = isRgbaFormat &&
+        color.isValid () && (color.alpha () == 255 || color.alpha () == 0);
 }
 
 //---------------------------------------------------------------------
 
-void WashHelperSetup (QPainter *rgbPainter, const WashPack *pack)
+// Changes to <pack->color>, the pixels of row <y> of the document image,
+// from <x1> to <x2> inclusive, that are similar to <pack->colorToReplace>.
+//
+// Returns whether any pixel was similar.
+static bool WashRow (WashPack *pack, int y, int x1, int x2,
+        QVector <quint32> *maskBuffer)
 {
-    // Set the drawing colors for the painters.
+    const QRect &readableRect = pack->readableImageRect;
 
-    if (rgbPainter) {
-        rgbPainter->setPen (pack->color.toQColor());
+    // Pixels outside the image never match.
+    if (y < readableRect.top () || y > readableRect.bottom () ||
+        y >= pack->image->height () || y < 0)
+    {
+        return false;
     }
-}
 
-//---------------------------------------------------------------------
+    x1 = qMax (x1, qMax (readableRect.left (), 0));
+    x2 = qMin (x2, qMin (readableRect.right (), pack->image->width () - 1));
 
-static QRect WashLineHelper (QPainter *rgbPainter, void *data)
-{
-#if DEBUG_KP_PAINTER && 0
-    qCDebug(kpLogImagelib) << "Washing pixmap (w=" << rect.width ()
-                << ",h=" << rect.height () << ")" << endl;
-    QTime timer;
-    int convAndWashTime;
-#endif
+    const int width = x2 - x1 + 1;
+    if (width <= 0) {
+        return false;
+    }
 
-    auto *pack = static_cast <WashPack *> (data);
+    maskBuffer->resize ((width + 31) / 32);
+    const quint32 *mask = maskBuffer->constData ();
 
-    // Setup painters.
-    ::WashHelperSetup (rgbPainter, pack);
+    pack->colorToReplace.similarityMask (
+        reinterpret_cast <const QRgb *> (
+            pack->readableImage->constScanLine (y - readableRect.y ())) +
+                (x1 - readableRect.x ()),
+        width, pack->processedColorSimilarity, maskBuffer->data ());
 
+    QRgb *writeLine = nullptr;
+    if (pack->writeDirectly && pack->color.alpha () == 255) {
+        writeLine = reinterpret_cast <QRgb *> (pack->image->scanLine (y)) + x1;
+    }
 
     bool didSomething = false;
 
-    QList <QPoint> points = kpPainter::interpolatePoints (pack->startPoint, pack->endPoint);
-    for (QList <QPoint>::const_iterator pit = points.constBegin ();
-            pit != points.constEnd ();
-            ++pit)
+    // make use of scanline coherence
+    int startDrawX = 0;
+    while ((startDrawX = kpColor::findInSimilarityMask (mask, width,
+                startDrawX, true)) < width)
     {
-        // OPT: This may be reading and possibly writing pixels that were
-        //      visited on a previous iteration, since the pen is usually
-        //      bigger than 1 pixel.  Maybe we could use QRegion to determine
-        //      all the non-intersecting regions and only wash each region once.
-        //
-        //      Profiling needs to be done as QRegion is known to be a CPU hog.
-        if (::ReadableImageWashRect (rgbPainter,
-                pack->readableImage,
-                pack->colorToReplace,
-                pack->readableImageRect,
-                kpToolFlowBase::hotRectForMousePointAndBrushWidthHeight (
-                    *pit, pack->penWidth, pack->penHeight),
-                pack->processedColorSimilarity))
+        const int endDrawX = kpColor::findInSimilarityMask (mask, width,
+            startDrawX, false);
+
+        if (writeLine)
         {
-            didSomething = true;
+            std::fill (writeLine + startDrawX, writeLine + endDrawX,
+                       pack->color.toQRgb ());
+        }
+        else if (!pack->writeDirectly)
+        {
+            if (!pack->painter)
+            {
+                pack->painter = new QPainter (pack->image);
+                pack->painter->setPen (pack->color.toQColor ());
+            }
+
+            if (startDrawX == endDrawX - 1) {
+                pack->painter->drawPoint (x1 + startDrawX, y);
+            }
+            else {
+                pack->painter->drawLine (x1 + startDrawX, y, x1 + endDrawX - 1, y);
+            }
         }
+
+        didSomething = true;
+
+        startDrawX = endDrawX;
     }
 
+    return didSomething;
+}
 
-#if DEBUG_KP_PAINTER && 0
-    int ms = timer.restart ();
-    qCDebug(kpLogImagelib) << "\ttried to wash: " << ms << "ms"
-                << " (" << (ms ? (rect.width () * rect.height () / ms) : -1234)
-                << " pixels/ms)"
-                << endl;
-    convAndWashTime += ms;
-#endif
+//---------------------------------------------------------------------
 
+// Washes, in row <top> + i of the document image, the pixels from
+// <spanX1> [i] to <spanX2> [i] inclusive.
+//
+// Returns whether any pixel was similar.
+static bool WashSpans (WashPack *pack, int top,
+        const QVector <int> &spanX1, const QVector <int> &spanX2)
+{
+    Q_ASSERT (spanX1.size () == spanX2.size ());
 
-    // TODO: Rectangle may be too big.  Use QRect::united() incrementally?
-    //       Efficiency?
-    return didSomething ? pack->readableImageRect : QRect ();
+    if (!pack->colorToReplace.isValid ()) {
+        return false;
+    }
+
+    QVector <quint32> maskBuffer;
+
+    bool didSomething = false;
+    for (int i = 0; i < spanX1.size (); i++)
+    {
+        if (::WashRow (pack, top + i, spanX1 [i], spanX2 [i], &maskBuffer)) {
+            didSomething = true;
+        }
+    }
+
+    if (pack->painter)
+    {
+        pack->painter->end ();
+        delete pack->painter;
+        pack->painter = nullptr;
+    }
+
+    return didSomething;
 }
 
 //---------------------------------------------------------------------
@@ -409,56 +282,49 @@ QRect kpPainter::washLine (kpImage *image,
         const kpColor &colorToReplace,
         int processedColorSimilarity)
 {
-    return ::Wash (image,
-        QPoint (x1, y1), QPoint (x2, y2),
-        color, penWidth, penHeight,
-        colorToReplace,
-        processedColorSimilarity,
-        &::WashLineHelper);
-}
+    const kpLineIterator points (QPoint (x1, y1), QPoint (x2, y2));
+    QPoint p;
 
-//---------------------------------------------------------------------
+    // Get the rectangle that bounds the changes.
+    QRect rect;
+    for (kpLineIterator it = points; it.next (&p);)
+    {
+        rect |= kpToolFlowBase::hotRectForMousePointAndBrushWidthHeight (
+            p, penWidth, penHeight);
+    }
 
-static QRect WashRectHelper (QPainter *rgbPainter, void *data)
-{
-    auto *pack = static_cast <WashPack *> (data);
-#if DEBUG_KP_PAINTER && 0
-    qCDebug(kpLogImagelib) << "Washing pixmap (w=" << rect.width ()
-                << ",h=" << rect.height () << ")" << endl;
-    QTime timer;
-    int convAndWashTime;
+#if DEBUG_KP_PAINTER
+    qCDebug(kpLogImagelib) << "kppainter.cpp:washLine() start=" << QPoint (x1, y1)
+              << " end=" << QPoint (x2, y2)
+              << " --> rect=" << rect
+              << endl;
 #endif
 
-    // Setup painters.
-    ::WashHelperSetup (rgbPainter, pack);
-
-
-    const QRect drawRect (pack->startPoint, pack->endPoint);
-
-    bool didSomething = false;
-
-    if (::ReadableImageWashRect (rgbPainter,
-            pack->readableImage,
-            pack->colorToReplace,
-            pack->readableImageRect,
-            drawRect,
-            pack->processedColorSimilarity))
+    // Every brush position is washed at once, in one pass over <rect>,
+    // rather than once per position, so that overlapping brush positions
+    // aren't read and written again.
+    //
+    // The points form a straight, 8-connected line so, in each row, the
+    // brush positions covering it are consecutive and, together, cover a
+    // single span.
+    QVector <int> spanX1 (rect.height (), rect.right () + 1);
+    QVector <int> spanX2 (rect.height (), rect.left () - 1);
+    for (kpLineIterator it = points; it.next (&p);)
     {
-        didSomething = true;
+        const QRect hotRect = kpToolFlowBase::hotRectForMousePointAndBrushWidthHeight (
+            p, penWidth, penHeight);
+        for (int y = hotRect.top (); y <= hotRect.bottom (); y++)
+        {
+            const int i = y - rect.top ();
+            spanX1 [i] = qMin (spanX1 [i], hotRect.left ());
+            spanX2 [i] = qMax (spanX2 [i], hotRect.right ());
+        }
     }
 
+    WashPack pack;
+    ::WashSetup (&pack, image, rect, color, colorToReplace, processedColorSimilarity);
 
-#if DEBUG_KP_PAINTER && 0
-    int ms = timer.restart ();
-    qCDebug(kpLogImagelib) << "\ttried to wash: " << ms << "ms"
-                << " (" << (ms ? (rect.width () * rect.height () / ms) : -1234)
-                << " pixels/ms)"
-                << endl;
-    convAndWashTime += ms;
-#endif
-
-
-    return didSomething ? drawRect : QRect ();
+    return ::WashSpans (&pack, rect.top (), spanX1, spanX2) ? rect : QRect ();
 }
 
 //---------------------------------------------------------------------
@@ -470,19 +336,26 @@ QRect kpPainter::washRect (kpImage *image,
         const kpColor &colorToReplace,
         int processedColorSimilarity)
 {
-    return ::Wash (image,
-        QPoint (x, y), QPoint (x + width - 1, y + height - 1),
-        color, 1/*pen width*/, 1/*pen height*/,
-        colorToReplace,
-        processedColorSimilarity,
-        &::WashRectHelper);
+    const QRect rect (x, y, width, height);
+    if (rect.isEmpty ()) {
+        return {};
+    }
+
+    WashPack pack;
+    ::WashSetup (&pack, image, rect, color, colorToReplace, processedColorSimilarity);
+
+    const QVector <int> spanX1 (rect.height (), rect.left ());
+    const QVector <int> spanX2 (rect.height (), rect.right ());
+
+    return ::WashSpans (&pack, rect.top (), spanX1, spanX2) ? rect : QRect ();
 }
 
 //---------------------------------------------------------------------
 
 // public static
 void kpPainter::sprayPoints (kpImage *image,
-        const QList <QPoint> &points,
+        const QVector <QPoint> &points,
+        const QPoint &offset,
         const kpColor &color,
         int spraycanSize)
 {
@@ -513,7 +386,7 @@ void kpPainter::sprayPoints (kpImage *image,
                 continue;
             }
 
-            const QPoint p2 (p.x () + dx, p.y () + dy);
+            const QPoint p2 (p.x () + offset.x () + dx, p.y () + offset.y () + dy);
 
             painter.drawPoint(p2);
         }
@@ -30,6 +30,8 @@
 #define KP_PAINTER_H
 
 
+#include <QVector>
+
 #include "kpColor.h"
 #include "kpImage.h"
 
@@ -93,6 +95,10 @@ public:
     // a point at 'c'.
     //
     // ASSUMPTION: <probability> is between 0.0 and 1.0 inclusive.
+    //
+    // kpLineIterator returns the same points one at a time, without
+    // allocating a list, which is better for code that is run on every
+    // mouse move.
     static QList <QPoint> interpolatePoints (const QPoint &startPoint,
         const QPoint &endPoint,
         bool cardinalAdjacency = false,
@@ -123,13 +129,15 @@ public:
         const kpColor &colorToReplace,
         int processedColorSimilarity);
 
-    // For each point in <points>, sprays a random pattern of 10 dots of <color>,
-    // each within a circle of diameter <spraycanSize>, onto <image>.
+    // For each point in <points>, offset by <offset>, sprays a random pattern
+    // of 10 dots of <color>, each within a circle of diameter <spraycanSize>,
+    // onto <image>.
     //
     // ASSUMPTION: spraycanSize > 0.
     // TODO: I think this diameter is 1 or 2 off.
     static void sprayPoints (kpImage *image,
-        const QList <QPoint> &points,
+        const QVector <QPoint> &points,
+        const QPoint &offset,
         const kpColor &color,
         int spraycanSize);
 };
@@ -0,0 +1,203 @@
+/*
+   Copyright (c) 2026 The KolourPaint Authors
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+   OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+   IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+   INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+   NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+   THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include "kpSavedImageTiles.h"
+
+#include <cstring>
+
+
+//---------------------------------------------------------------------
+
+kpSavedImageTiles::kpSavedImageTiles ()
+    : m_format (QImage::Format_Invalid),
+      m_tilesAcross (0),
+      m_tilesDown (0),
+      m_numSavedTiles (0)
+{
+}
+
+//---------------------------------------------------------------------
+
+// public
+bool kpSavedImageTiles::isNull () const
+{
+    return (m_numSavedTiles == 0);
+}
+
+//---------------------------------------------------------------------
+
+// private
+int kpSavedImageTiles::tileIndex (int tileX, int tileY) const
+{
+    return tileY * m_tilesAcross + tileX;
+}
+
+//---------------------------------------------------------------------
+
+// private
+QRect kpSavedImageTiles::tileRect (int tileX, int tileY) const
+{
+    return QRect (tileX * TileSize, tileY * TileSize, TileSize, TileSize)
+        .intersected (QRect (QPoint (0, 0), m_size));
+}
+
+//---------------------------------------------------------------------
+
+// private
+QImage kpSavedImageTiles::makeTile (const QImage &image, const QRect &rect) const
+{
+    if (image.format () != m_format) {
+        return image.copy (rect).convertToFormat (m_format);
+    }
+
+    QImage tile (rect.size (), m_format);
+
+    const int rowBytes = rect.width () * 4;
+    for (int y = 0; y < rect.height (); y++)
+    {
+        std::memcpy (tile.scanLine (y),
+                     image.constScanLine (rect.y () + y) + rect.x () * 4,
+                     rowBytes);
+    }
+
+    return tile;
+}
+
+//---------------------------------------------------------------------
+
+// public
+void kpSavedImageTiles::saveTiles (const QImage &image, const QRect &rect)
+{
+    if (image.isNull ()) {
+        return;
+    }
+
+    if (m_tiles.isEmpty ())
+    {
+        m_size = image.size ();
+        m_format = (image.depth () == 32) ?
+            image.format () :
+            QImage::Format_ARGB32_Premultiplied;
+        m_tilesAcross = (image.width () + TileSize - 1) / TileSize;
+        m_tilesDown = (image.height () + TileSize - 1) / TileSize;
+        m_tiles.resize (m_tilesAcross * m_tilesDown);
+    }
+
+    Q_ASSERT (image.size () == m_size);
+
+    const QRect saveRect = rect.intersected (QRect (QPoint (0, 0), m_size));
+    if (saveRect.isEmpty ()) {
+        return;
+    }
+
+    for (int tileY = saveRect.top () / TileSize;
+         tileY <= saveRect.bottom () / TileSize;
+         tileY++)
+    {
+        for (int tileX = saveRect.left () / TileSize;
+             tileX <= saveRect.right () / TileSize;
+             tileX++)
+        {
+            QImage &tile = m_tiles [tileIndex (tileX, tileY)];
+            if (tile.isNull ())
+            {
+                tile = makeTile (image, tileRect (tileX, tileY));
+                m_numSavedTiles++;
+            }
+        }
+    }
+}
+
+//---------------------------------------------------------------------
+
+// public
+QImage kpSavedImageTiles::copy (const QRect &rect, const QImage &image) const
+{
+    if (isNull ()) {
+        return image.copy (rect);
+    }
+
+    if (!rect.isValid ()) {
+        return {};
+    }
+
+    Q_ASSERT (image.size () == m_size);
+
+    QImage ret (rect.size (), m_format);
+
+    const QRect srcRect = rect.intersected (QRect (QPoint (0, 0), m_size));
+    if (srcRect != rect) {
+        // (QImage::copy() leaves pixels outside the image as 0)
+        ret.fill (0);
+    }
+
+    if (srcRect.isEmpty ()) {
+        return ret;
+    }
+
+    for (int tileY = srcRect.top () / TileSize;
+         tileY <= srcRect.bottom () / TileSize;
+         tileY++)
+    {
+        for (int tileX = srcRect.left () / TileSize;
+             tileX <= srcRect.right () / TileSize;
+             tileX++)
+        {
+            const QRect tRect = tileRect (tileX, tileY);
+            const QRect part = tRect.intersected (srcRect);
+
+            // Read unsaved tiles straight from <image>, unless it has to be
+            // converted.
+            QImage tile = m_tiles [tileIndex (tileX, tileY)];
+            QRect tileImageRect = tRect;
+            if (tile.isNull ())
+            {
+                if (image.format () == m_format)
+                {
+                    tile = image;
+                    tileImageRect = QRect (QPoint (0, 0), m_size);
+                }
+                else {
+                    tile = makeTile (image, tRect);
+                }
+            }
+
+            const int rowBytes = part.width () * 4;
+            for (int y = part.top (); y <= part.bottom (); y++)
+            {
+                std::memcpy (ret.scanLine (y - rect.y ()) + (part.x () - rect.x ()) * 4,
+                             tile.constScanLine (y - tileImageRect.y ()) +
+                                 (part.x () - tileImageRect.x ()) * 4,
+                             rowBytes);
+            }
+        }
+    }
+
+    return ret;
+}
+
+//---------------------------------------------------------------------
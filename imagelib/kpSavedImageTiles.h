@@ -0,0 +1,84 @@
+/*
+   Copyright (c) 2026 The KolourPaint Authors
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+   OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+   IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+   INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+   NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+   THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#ifndef KP_SAVED_IMAGE_TILES_H
+#define KP_SAVED_IMAGE_TILES_H
+
+
+#include <QImage>
+#include <QRect>
+#include <QSize>
+#include <QVector>
+
+
+//
+// The tiles of an image that are about to change, saved on demand, so that
+// a command that doesn't know in advance how much of the document it will
+// draw on (e.g. a brush stroke) can undo it without copying the whole
+// document first.
+//
+// Call saveTiles() with the document image and the rect about to be drawn
+// on, before drawing.  Only the TileSize x TileSize tiles under the rect
+// that haven't already been saved are copied, so it is cheap to call for
+// every dab of a stroke.  copy() then gives the old pixels of any rect.
+//
+// Tiles are always 32-bit.  Images with fewer bits per pixel are
+// converted to QImage::Format_ARGB32_Premultiplied.
+//
+class kpSavedImageTiles
+{
+public:
+    static const int TileSize = 256;
+
+    kpSavedImageTiles ();
+
+    // Returns whether no tiles have been saved.
+    bool isNull () const;
+
+    // Saves the tiles of <image> under <rect> that haven't been saved yet.
+    // <image> must be the same size every time.
+    void saveTiles (const QImage &image, const QRect &rect);
+
+    // Returns the pixels of <rect>, as they were when their tiles were
+    // saved.  Pixels in tiles that were never saved are read from <image>
+    // (which, by the above, should not have changed there), and pixels
+    // outside the image are 0 (like QImage::copy()).
+    QImage copy (const QRect &rect, const QImage &image) const;
+
+private:
+    int tileIndex (int tileX, int tileY) const;
+    QRect tileRect (int tileX, int tileY) const;
+    QImage makeTile (const QImage &image, const QRect &rect) const;
+
+    QSize m_size;
+    QImage::Format m_format;
+    int m_tilesAcross, m_tilesDown;
+    // (row-major, null for tiles that haven't been saved)
+    QVector <QImage> m_tiles;
+    int m_numSavedTiles;
+};
+
+
+#endif  // KP_SAVED_IMAGE_TILES_H
@@ -0,0 +1,193 @@
+/*
+   Copyright (c) 2026 The KolourPaint Authors
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+   OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+   IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+   INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+   NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+   THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#define DEBUG_KP_AFFINE_RESAMPLER 0
+
+
+#include "kpAffineResampler.h"
+
+#include <cmath>
+
+#include <QTransform>
+
+#include "kpLogCategories.h"
+
+#include "generic/kpParallel.h"
+#include "imagelib/kpColor.h"
+
+
+//---------------------------------------------------------------------
+
+static const int MinRowsPerThread = 32;
+
+// Source coordinates are stepped in fixed point with this many fractional
+// bits.
+static const int FixedShift = 32;
+static const qint64 FixedOne = Q_INT64_C (1) << FixedShift;
+
+// Source coordinates (or more precisely, the sample points of the corners of
+// the destination image) must be within this far of the origin, so that
+// stepping along a row can never overflow.
+static const double MaxCoordinate = double (1 << 30);
+
+//---------------------------------------------------------------------
+
+static qint64 ToFixed (double x)
+{
+    return static_cast <qint64> (std::floor (x * double (FixedOne) + 0.5));
+}
+
+//---------------------------------------------------------------------
+
+struct kpAffineResamplerRow
+{
+    // Sample point of the first pixel of the row, and the step between
+    // pixels, all in fixed point source coordinates.
+    qint64 u, v;
+    qint64 du, dv;
+};
+
+//---------------------------------------------------------------------
+
+static void ResampleRowNearest (const QImage &src, QRgb *dest, int width,
+        kpAffineResamplerRow row, QRgb background)
+{
+    const uchar *srcBits = src.constBits ();
+    const int srcBytesPerLine = src.bytesPerLine ();
+
+    const quint64 uLimit = quint64 (src.width ()) << FixedShift;
+    const quint64 vLimit = quint64 (src.height ()) << FixedShift;
+
+    for (int x = 0; x < width; x++)
+    {
+        // Negative coordinates become huge when unsigned, so this also
+        // checks for them.
+        if (quint64 (row.u) < uLimit && quint64 (row.v) < vLimit)
+        {
+            const auto *srcLine = reinterpret_cast <const QRgb *> (
+                srcBits + (row.v >> FixedShift) * srcBytesPerLine);
+            dest [x] = srcLine [row.u >> FixedShift];
+        }
+        else
+        {
+            dest [x] = background;
+        }
+
+        row.u += row.du;
+        row.v += row.dv;
+    }
+}
+
+//---------------------------------------------------------------------
+
+// public static
+QImage kpAffineResampler::transform (const QImage &image, const QTransform &matrix,
+        int width, int height,
+        const kpColor &backgroundColor)
+{
+#if DEBUG_KP_AFFINE_RESAMPLER
+    qCDebug(kpLogImagelib) << "kpAffineResampler::transform(image.size="
+                           << image.size ()
+                           << ",width=" << width << ",height=" << height
+                           << ")";
+#endif
+
+    if (!matrix.isAffine ()) {
+        return {};
+    }
+
+    bool invertible = false;
+    const QTransform inverse = matrix.inverted (&invertible);
+    if (!invertible) {
+        return {};
+    }
+
+    // Refuse anything that could overflow when stepping, rather than
+    // clamping and getting it subtly wrong.
+    const QPointF corners [4] =
+    {
+        QPointF (0, 0), QPointF (width, 0), QPointF (0, height), QPointF (width, height)
+    };
+    for (const auto &corner : corners)
+    {
+        const QPointF p = inverse.map (corner);
+        if (!(std::fabs (p.x ()) < MaxCoordinate && std::fabs (p.y ()) < MaxCoordinate)) {
+            return {};
+        }
+    }
+
+
+    const QImage src = (image.format () == QImage::Format_ARGB32_Premultiplied) ?
+        image :
+        image.convertToFormat (QImage::Format_ARGB32_Premultiplied);
+
+    QImage dest (width, height, QImage::Format_ARGB32_Premultiplied);
+    if (dest.isNull ()) {
+        return dest;
+    }
+
+    const QRgb background = backgroundColor.isValid () ?
+        qPremultiply (backgroundColor.toQRgb ()) :
+        0;
+
+    if (src.isNull ())
+    {
+        dest.fill (background);
+        return dest;
+    }
+
+    uchar *destBits = dest.bits ();
+    const int destBytesPerLine = dest.bytesPerLine ();
+
+    const qint64 du = ::ToFixed (inverse.m11 ());
+    const qint64 dv = ::ToFixed (inverse.m12 ());
+
+    kpParallel::forRanges (0, height, MinRowsPerThread,
+        [&] (int beginY, int endY)
+        {
+            for (int y = beginY; y < endY; y++)
+            {
+                // Each row starts from its own exactly computed sample point,
+                // so that rounding errors can't build up from row to row.
+                const QPointF first = inverse.map (QPointF (0.5, y + 0.5));
+
+                kpAffineResamplerRow row {};
+                row.u = ::ToFixed (first.x ());
+                row.v = ::ToFixed (first.y ());
+                row.du = du;
+                row.dv = dv;
+
+                auto *destLine = reinterpret_cast <QRgb *> (
+                    destBits + y * destBytesPerLine);
+                ::ResampleRowNearest (src, destLine, width, row, background);
+            }
+        });
+
+    return dest;
+}
+
+//---------------------------------------------------------------------
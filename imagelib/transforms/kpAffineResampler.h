@@ -0,0 +1,72 @@
+/*
+   Copyright (c) 2026 The KolourPaint Authors
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+   OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+   IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+   INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+   NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+   THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef KP_AFFINE_RESAMPLER_H
+#define KP_AFFINE_RESAMPLER_H
+
+
+#include <QImage>
+
+
+class QTransform;
+
+class kpColor;
+
+
+//
+// Renders an image through an affine QTransform (rotate, skew and the
+// scaling that kpPixmapFX folds into them for previews), in place of
+// QPainter::drawImage() with a world transform.
+//
+// Destination pixel (x, y) samples the source at the inverse of the matrix
+// applied to its centre, (x + 0.5, y + 0.5).  Centres that don't map inside
+// the source are filled with the background color.  Source coordinates are
+// stepped along each row in 32.32 fixed point, so that matrices with
+// integer or half-integer coefficients (multiples of 90 degrees) map
+// exactly, and bands of rows are rendered on kpParallel's threads.
+//
+// Each destination pixel takes the source pixel under its sample point,
+// like QPainter without QPainter::SmoothPixmapTransform, so this never
+// invents colors that weren't in the source.
+//
+class kpAffineResampler
+{
+public:
+    // Returns a <width> x <height> ARGB32_Premultiplied image of <image>
+    // transformed by <matrix>, with the areas not covered by <image> set to
+    // <backgroundColor> (or transparent, if it's invalid).
+    //
+    // Returns a null image if <matrix> is not an invertible affine matrix or
+    // maps the result too far away from <image> for fixed point -- the caller
+    // should fall back to QPainter.
+    static QImage transform (const QImage &image, const QTransform &matrix,
+                             int width, int height,
+                             const kpColor &backgroundColor);
+};
+
+
+#endif  // KP_AFFINE_RESAMPLER_H
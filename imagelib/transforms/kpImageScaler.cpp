@@ -0,0 +1,369 @@
+/*
+   Copyright (c) 2026 The KolourPaint Authors
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+   OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+   IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+   INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+   NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+   THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#define DEBUG_KP_IMAGE_SCALER 0
+
+
+#include "kpImageScaler.h"
+
+#include <cmath>
+
+#include <QtMath>
+#include <QVector>
+
+#include "kpLogCategories.h"
+
+#include "generic/kpParallel.h"
+
+
+//---------------------------------------------------------------------
+
+static const int MinRowsPerThread = 16;
+
+// Weights are fixed point with this many fractional bits.  255 times the
+// sum of the absolute values of a window's weights (a little over 1 for
+// Lanczos3) comfortably fits in an int.
+static const int WeightBits = 14;
+static const int WeightOne = 1 << WeightBits;
+static const int WeightHalf = WeightOne / 2;
+
+//---------------------------------------------------------------------
+
+static double Sinc (double x)
+{
+    if (x == 0) {
+        return 1;
+    }
+
+    x *= M_PI;
+    return std::sin (x) / x;
+}
+
+//---------------------------------------------------------------------
+
+// Returns how far, in source pixels when not shrinking, <filter> reaches
+// on each side of the sample point.
+static double Support (kpImageScaler::Filter filter)
+{
+    switch (filter)
+    {
+    case kpImageScaler::AreaAverage:
+        return 0.5;
+    case kpImageScaler::Bilinear:
+        return 1;
+    case kpImageScaler::Lanczos3:
+        return 3;
+    }
+
+    return 1;
+}
+
+//---------------------------------------------------------------------
+
+static double FilterValue (kpImageScaler::Filter filter, double x)
+{
+    switch (filter)
+    {
+    case kpImageScaler::AreaAverage:
+        return (x > -0.5 && x <= 0.5) ? 1 : 0;
+
+    case kpImageScaler::Bilinear:
+        x = std::fabs (x);
+        return (x < 1) ? 1 - x : 0;
+
+    case kpImageScaler::Lanczos3:
+        return (std::fabs (x) < 3) ? ::Sinc (x) * ::Sinc (x / 3) : 0;
+    }
+
+    return 0;
+}
+
+//---------------------------------------------------------------------
+
+struct kpImageScalerWeights
+{
+    // Destination pixel i along the axis is the sum of source pixels
+    // first [i] to first [i] + count [i] - 1, times
+    // weights [i * maxCount] to weights [i * maxCount + count [i] - 1].
+    // The weights of each destination pixel add up to exactly WeightOne, so
+    // areas of a single color stay that color.
+    QVector <int> first, count;
+    QVector <int> weights;
+    int maxCount;
+};
+
+//---------------------------------------------------------------------
+
+static kpImageScalerWeights ComputeWeights (int srcSize, int destSize,
+        kpImageScaler::Filter filter)
+{
+    const double scale = double (srcSize) / double (destSize);
+
+    // When shrinking, stretch the filter to cover all the source pixels
+    // under each destination pixel.
+    const double filterScale = qMax (scale, 1.0);
+    const double support = ::Support (filter) * filterScale;
+
+    kpImageScalerWeights ret;
+    ret.maxCount = int (std::ceil (support)) * 2 + 1;
+    ret.first.resize (destSize);
+    ret.count.resize (destSize);
+    ret.weights.fill (0, destSize * ret.maxCount);
+
+    QVector <double> values (ret.maxCount);
+
+    for (int i = 0; i < destSize; i++)
+    {
+        const double centre = (i + 0.5) * scale;
+        const int begin = qMax (0, int (std::floor (centre - support + 0.5)));
+        const int end = qMin (srcSize, int (std::floor (centre + support + 0.5)));
+        Q_ASSERT (end - begin <= ret.maxCount);
+
+        double total = 0;
+        for (int s = begin; s < end; s++)
+        {
+            values [s - begin] = ::FilterValue (filter,
+                (s + 0.5 - centre) / filterScale);
+            total += values [s - begin];
+        }
+
+        int *weights = ret.weights.data () + i * ret.maxCount;
+
+        if (total == 0)
+        {
+            // Can't happen with the filters above but don't divide by 0.
+            ret.first [i] = qBound (0, int (centre), srcSize - 1);
+            ret.count [i] = 1;
+            weights [0] = WeightOne;
+            continue;
+        }
+
+        // Quantize, giving any rounding error to the heaviest weight.
+        int sum = 0, heaviest = 0;
+        for (int k = 0; k < end - begin; k++)
+        {
+            weights [k] = qRound (values [k] / total * WeightOne);
+            sum += weights [k];
+
+            if (weights [k] > weights [heaviest]) {
+                heaviest = k;
+            }
+        }
+        weights [heaviest] += WeightOne - sum;
+
+        // Drop the 0 weights at either end.
+        int firstUsed = 0, lastUsed = end - begin - 1;
+        while (weights [firstUsed] == 0) {
+            firstUsed++;
+        }
+        while (weights [lastUsed] == 0) {
+            lastUsed--;
+        }
+
+        for (int k = firstUsed; k <= lastUsed; k++) {
+            weights [k - firstUsed] = weights [k];
+        }
+        for (int k = lastUsed - firstUsed + 1; k < ret.maxCount; k++) {
+            weights [k] = 0;
+        }
+
+        ret.first [i] = begin + firstUsed;
+        ret.count [i] = lastUsed - firstUsed + 1;
+    }
+
+    return ret;
+}
+
+//---------------------------------------------------------------------
+
+// Returns the premultiplied pixel with the given fixed point channel sums
+// (which include WeightHalf for rounding).  Lanczos3 can overshoot, so the
+// channels are clamped -- colors to the alpha, to stay premultiplied.
+static inline QRgb Pack (int a, int r, int g, int b)
+{
+    a = qBound (0, a >> WeightBits, 255);
+    r = qBound (0, r >> WeightBits, a);
+    g = qBound (0, g >> WeightBits, a);
+    b = qBound (0, b >> WeightBits, a);
+
+    return qRgba (r, g, b, a);
+}
+
+//---------------------------------------------------------------------
+
+static void ScaleRow (const QRgb *src, QRgb *dest, int destWidth,
+        const kpImageScalerWeights &weights)
+{
+    for (int x = 0; x < destWidth; x++)
+    {
+        const QRgb *pixels = src + weights.first [x];
+        const int *w = weights.weights.constData () + x * weights.maxCount;
+        const int count = weights.count [x];
+
+        int a = WeightHalf, r = WeightHalf, g = WeightHalf, b = WeightHalf;
+        for (int k = 0; k < count; k++)
+        {
+            const QRgb pixel = pixels [k];
+            a += int (qAlpha (pixel)) * w [k];
+            r += int (qRed (pixel)) * w [k];
+            g += int (qGreen (pixel)) * w [k];
+            b += int (qBlue (pixel)) * w [k];
+        }
+
+        dest [x] = ::Pack (a, r, g, b);
+    }
+}
+
+//---------------------------------------------------------------------
+
+static QImage ScaleHorizontally (const QImage &src, int destWidth,
+        kpImageScaler::Filter filter)
+{
+    const int height = src.height ();
+    const kpImageScalerWeights weights =
+        ::ComputeWeights (src.width (), destWidth, filter);
+
+    QImage dest (destWidth, height, QImage::Format_ARGB32_Premultiplied);
+    if (dest.isNull ()) {
+        return dest;
+    }
+
+    uchar *destBits = dest.bits ();
+    const int destBytesPerLine = dest.bytesPerLine ();
+
+    kpParallel::forRanges (0, height, MinRowsPerThread,
+        [&] (int beginY, int endY)
+        {
+            for (int y = beginY; y < endY; y++)
+            {
+                ::ScaleRow (reinterpret_cast <const QRgb *> (src.constScanLine (y)),
+                            reinterpret_cast <QRgb *> (destBits + y * destBytesPerLine),
+                            destWidth, weights);
+            }
+        });
+
+    return dest;
+}
+
+//---------------------------------------------------------------------
+
+static QImage ScaleVertically (const QImage &src, int destHeight,
+        kpImageScaler::Filter filter)
+{
+    const int width = src.width ();
+    const kpImageScalerWeights weights =
+        ::ComputeWeights (src.height (), destHeight, filter);
+
+    QImage dest (width, destHeight, QImage::Format_ARGB32_Premultiplied);
+    if (dest.isNull ()) {
+        return dest;
+    }
+
+    uchar *destBits = dest.bits ();
+    const int destBytesPerLine = dest.bytesPerLine ();
+
+    kpParallel::forRanges (0, destHeight, MinRowsPerThread,
+        [&] (int beginY, int endY)
+        {
+            // Accumulate whole source rows at a time, rather than walking
+            // down each column, to read memory in order.
+            QVector <int> sums (width * 4);
+
+            for (int y = beginY; y < endY; y++)
+            {
+                sums.fill (WeightHalf);
+                int *sum = sums.data ();
+
+                const int *w = weights.weights.constData () + y * weights.maxCount;
+                for (int k = 0; k < weights.count [y]; k++)
+                {
+                    const auto *line = reinterpret_cast <const QRgb *> (
+                        src.constScanLine (weights.first [y] + k));
+                    const int weight = w [k];
+
+                    for (int x = 0; x < width; x++)
+                    {
+                        const QRgb pixel = line [x];
+                        sum [x * 4 + 0] += int (qAlpha (pixel)) * weight;
+                        sum [x * 4 + 1] += int (qRed (pixel)) * weight;
+                        sum [x * 4 + 2] += int (qGreen (pixel)) * weight;
+                        sum [x * 4 + 3] += int (qBlue (pixel)) * weight;
+                    }
+                }
+
+                auto *destLine = reinterpret_cast <QRgb *> (destBits + y * destBytesPerLine);
+                for (int x = 0; x < width; x++)
+                {
+                    destLine [x] = ::Pack (sum [x * 4 + 0], sum [x * 4 + 1],
+                                           sum [x * 4 + 2], sum [x * 4 + 3]);
+                }
+            }
+        });
+
+    return dest;
+}
+
+//---------------------------------------------------------------------
+
+// public static
+QImage kpImageScaler::scale (const QImage &image, int width, int height,
+        Filter filter)
+{
+#if DEBUG_KP_IMAGE_SCALER
+    qCDebug(kpLogImagelib) << "kpImageScaler::scale(image.size=" << image.size ()
+                           << ",width=" << width << ",height=" << height
+                           << ",filter=" << filter << ")";
+#endif
+
+    if (image.isNull () || width <= 0 || height <= 0) {
+        return {};
+    }
+
+    // (RGB32 pixels are always opaque, so they're already premultiplied)
+    QImage ret = (image.format () == QImage::Format_ARGB32_Premultiplied ||
+                  image.format () == QImage::Format_RGB32) ?
+        image :
+        image.convertToFormat (QImage::Format_ARGB32_Premultiplied);
+
+    // Shrinking the width first leaves less work for the vertical pass,
+    // which is the slower of the two.
+    if (width != ret.width ()) {
+        ret = ::ScaleHorizontally (ret, width, filter);
+    }
+
+    if (height != ret.height () && !ret.isNull ()) {
+        ret = ::ScaleVertically (ret, height, filter);
+    }
+
+    if (ret.format () != QImage::Format_ARGB32_Premultiplied) {
+        ret = ret.convertToFormat (QImage::Format_ARGB32_Premultiplied);
+    }
+
+    return ret;
+}
+
+//---------------------------------------------------------------------
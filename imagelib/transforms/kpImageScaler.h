@@ -0,0 +1,75 @@
+/*
+   Copyright (c) 2026 The KolourPaint Authors
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+   IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+   OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+   IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+   INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+   NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+   THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef KP_IMAGE_SCALER_H
+#define KP_IMAGE_SCALER_H
+
+
+#include <QImage>
+
+
+//
+// Smoothly scales images to any size, for Smooth Scale and anywhere
+// else kpPixmapFX::scale() is asked for a pretty result.
+//
+// Each axis is resampled separately: the weights of the source pixels
+// that contribute to each destination column (or row) are computed once
+// per axis, then applied to every row (or column) on kpParallel's threads.
+// When shrinking, the filter is stretched to cover all the source pixels
+// that map to a destination pixel, so large reductions average rather than
+// skip pixels (and don't alias).
+//
+// The work is done in premultiplied ARGB, so transparent pixels don't bleed
+// their color into their neighbours.
+//
+class kpImageScaler
+{
+public:
+    enum Filter
+    {
+        // Averages the source pixels under each destination pixel, weighted
+        // by how much of them it covers.  Enlarging with this is like
+        // duplicating pixels, but with blended edges.
+        AreaAverage,
+
+        // Linear interpolation between neighbouring pixels, like
+        // Qt::SmoothTransformation.
+        Bilinear,
+
+        // Windowed sinc over 3 pixels on each side.  Sharper than Bilinear,
+        // at the cost of slight halos around hard edges.
+        Lanczos3
+    };
+
+    // Returns <image> scaled to <width> x <height>, as an
+    // ARGB32_Premultiplied image.
+    static QImage scale (const QImage &image, int width, int height,
+                         Filter filter);
+};
+
+
+#endif  // KP_IMAGE_SCALER_H
@@ -50,11 +50,14 @@
 #include "widgets/toolbars/kpColorToolBar.h"
 #include "environments/commands/kpCommandEnvironment.h"
 #include "commands/kpCommandHistory.h"
+#include "commands/imagelib/transforms/kpTransformBorderImages.h"
 #include "document/kpDocument.h"
+#include "document/kpDocumentSaveOptions.h"
 #include "mainWindow/kpMainWindow.h"
 #include "imagelib/kpPainter.h"
 #include "pixmapfx/kpPixmapFX.h"
 #include "layers/selections/image/kpRectangularImageSelection.h"
+#include "generic/kpParallel.h"
 #include "generic/kpSetOverrideCursorSaver.h"
 #include "tools/kpTool.h"
 #include "views/manager/kpViewManager.h"
@@ -64,6 +67,12 @@
 #include <KLocalizedString>
 
 #include <QImage>
+#include <QImageReader>
+#include <QImageWriter>
+#include <QMimeDatabase>
+#include <QSaveFile>
+#include <QStringList>
+#include <QVector>
 
 //---------------------------------------------------------------------
 
@@ -86,10 +95,13 @@ public:
     int bottom () const;
     kpColor referenceColor () const;
     kpColor averageColor () const;
-    bool isSingleColor () const;
 
+    // <rgbaImage> must be kpPixmapFX::getRgbaScanlineImage (*image ()).
+    // Only reads the image so the four borders of the same image may be
+    // calculated at the same time, on different threads.
+    //
     // (returns true on success (even if no rect) or false on error)
-    bool calculate (int isX, int dir);
+    bool calculate (const QImage &rgbaImage, int isX, int dir);
 
     bool fillsEntireImage () const;
     bool exists () const;
@@ -102,7 +114,6 @@ private:
     QRect m_rect;
     kpColor m_referenceColor;
     int m_redSum, m_greenSum, m_blueSum;
-    bool m_isSingleColor;
 };
 
 kpTransformAutoCropBorder::kpTransformAutoCropBorder (const kpImage *imagePtr,
@@ -190,15 +201,8 @@ kpColor kpTransformAutoCropBorder::averageColor () const
 
 //---------------------------------------------------------------------
 
-bool kpTransformAutoCropBorder::isSingleColor () const
-{
-    return m_isSingleColor;
-}
-
-//---------------------------------------------------------------------
-
 // public
-bool kpTransformAutoCropBorder::calculate (int isX, int dir)
+bool kpTransformAutoCropBorder::calculate (const QImage &rgbaImage, int isX, int dir)
 {
 #if DEBUG_KP_TOOL_AUTO_CROP && 1
     qCDebug(kpLogImagelib) << "kpTransformAutoCropBorder::calculate() CALLED!";
@@ -206,31 +210,39 @@ bool kpTransformAutoCropBorder::calculate (int isX, int dir)
     int maxX = m_imagePtr->width () - 1;
     int maxY = m_imagePtr->height () - 1;
 
-    QImage qimage = *m_imagePtr;
+    const QImage &qimage = rgbaImage;
     Q_ASSERT (!qimage.isNull ());
+    Q_ASSERT (qimage.size () == m_imagePtr->size ());
 
     // (sync both branches)
     if (isX)
     {
-        int numCols = 0;
         int startX = (dir > 0) ? 0 : maxX;
 
         kpColor col = kpPixmapFX::getColorAtPixel (qimage, startX, 0);
-        for (int x = startX;
-             x >= 0 && x <= maxX;
-             x += dir)
+
+        // Every row limits the number of columns to the run of pixels,
+        // starting from <startX>, that are similar to <col>.  Only the
+        // columns that are still in the running are read.
+        int numCols = maxX + 1;
+        QVector <quint32> mask;
+        for (int y = 0; y <= maxY && numCols > 0; y++)
         {
-            int y;
-            for (y = 0; y <= maxY; y++)
+            const auto *line = reinterpret_cast <const QRgb *> (qimage.constScanLine (y));
+
+            if (dir > 0)
             {
-                if (!kpPixmapFX::getColorAtPixel (qimage, x, y).isSimilarTo (col, m_processedColorSimilarity))
-                    break;
+                numCols = col.countSimilar (line, numCols, m_processedColorSimilarity);
             }
-
-            if (y <= maxY)
-                break;
             else
-                numCols++;
+            {
+                mask.resize ((numCols + 31) / 32);
+                col.similarityMask (line + maxX + 1 - numCols, numCols,
+                    m_processedColorSimilarity, mask.data ());
+                numCols = numCols - 1 -
+                    kpColor::findLastInSimilarityMask (mask.constData (),
+                        numCols - 1, false/*dissimilar*/);
+            }
         }
 
         if (numCols)
@@ -251,14 +263,9 @@ bool kpTransformAutoCropBorder::calculate (int isX, int dir)
              y >= 0 && y <= maxY;
              y += dir)
         {
-            int x;
-            for (x = 0; x <= maxX; x++)
-            {
-                if (!kpPixmapFX::getColorAtPixel (qimage, x, y).isSimilarTo (col, m_processedColorSimilarity))
-                    break;
-            }
+            const auto *line = reinterpret_cast <const QRgb *> (qimage.constScanLine (y));
 
-            if (x <= maxX)
+            if (col.countSimilar (line, maxX + 1, m_processedColorSimilarity) <= maxX)
                 break;
             else
                 numRows++;
@@ -273,25 +280,19 @@ bool kpTransformAutoCropBorder::calculate (int isX, int dir)
     }
 
 
-    if (m_rect.isValid ())
+    if (m_rect.isValid () && m_processedColorSimilarity != 0)
     {
-        m_isSingleColor = true;
-
-        if (m_processedColorSimilarity != 0)
+        for (int y = m_rect.top (); y <= m_rect.bottom (); y++)
         {
-            for (int y = m_rect.top (); y <= m_rect.bottom (); y++)
-            {
-                for (int x = m_rect.left (); x <= m_rect.right (); x++)
-                {
-                    kpColor colAtPixel = kpPixmapFX::getColorAtPixel (qimage, x, y);
+            const auto *line = reinterpret_cast <const QRgb *> (qimage.constScanLine (y));
 
-                    if (m_isSingleColor && colAtPixel != m_referenceColor)
-                        m_isSingleColor = false;
+            for (int x = m_rect.left (); x <= m_rect.right (); x++)
+            {
+                const kpColor colAtPixel (line [x]);
 
-                    m_redSum += colAtPixel.red ();
-                    m_greenSum += colAtPixel.green ();
-                    m_blueSum += colAtPixel.blue ();
-                }
+                m_redSum += colAtPixel.red ();
+                m_greenSum += colAtPixel.green ();
+                m_blueSum += colAtPixel.blue ();
             }
         }
     }
@@ -319,15 +320,358 @@ void kpTransformAutoCropBorder::invalidate ()
     m_rect = QRect ();
     m_referenceColor = kpColor::Invalid;
     m_redSum = m_greenSum = m_blueSum = 0;
-    m_isSingleColor = false;
 }
 
+//---------------------------------------------------------------------
+
+// Images with fewer pixels than this have their borders calculated one
+// after the other, on the calling thread, since starting the threads
+// would cost more than it saves.
+static const int AutoCropParallelMinPixels = 512 * 512;
+
+// Calculates all four borders, which must have been constructed with the
+// same image.  If <concurrently>, the borders of large images are
+// calculated at the same time, on different threads.
+//
+// Returns the number of borders found or 0 if autocrop cannot proceed
+// (including when a border fills the entire image).
+static int CalculateBorders (kpTransformAutoCropBorder *leftBorder,
+        kpTransformAutoCropBorder *rightBorder,
+        kpTransformAutoCropBorder *topBorder,
+        kpTransformAutoCropBorder *botBorder,
+        bool concurrently)
+{
+    const kpImage *image = leftBorder->image ();
+    Q_ASSERT (image && !image->isNull ());
+
+    // Convert once for all four borders.
+    const QImage rgbaImage = kpPixmapFX::getRgbaScanlineImage (*image);
+
+    kpTransformAutoCropBorder * const borders [4] =
+        {leftBorder, rightBorder, topBorder, botBorder};
+    const bool isX [4] = {true/*going right*/, true/*going left*/,
+                          false/*going down*/, false/*going up*/};
+    const int dir [4] = {+1, -1, +1, -1};
+
+    if (concurrently &&
+        image->width () * image->height () >= AutoCropParallelMinPixels)
+    {
+        bool ok [4] = {};
+        kpParallel::forEach (4,
+            [&] (int i)
+            {
+                Q_ASSERT (borders [i]->image () == image);
+                ok [i] = borders [i]->calculate (rgbaImage, isX [i], dir [i]);
+            });
+
+        for (int i = 0; i < 4; i++)
+        {
+            if (!ok [i] || borders [i]->fillsEntireImage ())
+                return 0;
+        }
+    }
+    else
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            Q_ASSERT (borders [i]->image () == image);
+            if (!borders [i]->calculate (rgbaImage, isX [i], dir [i]) ||
+                borders [i]->fillsEntireImage ())
+            {
+                return 0;
+            }
+        }
+    }
+
+    return leftBorder->exists () +
+           rightBorder->exists () +
+           topBorder->exists () +
+           botBorder->exists ();
+}
+
+//---------------------------------------------------------------------
+
+// In case e.g. the user pastes a solid, coloured-in rectangle,
+// we favor killing the bottom and right regions
+// (these regions probably contain the unwanted whitespace due
+//  to the doc being bigger than the pasted selection to start with).
+//
+// We also kill if they kiss or even overlap.
+static void InvalidateConflictingBorders (kpTransformAutoCropBorder *leftBorder,
+        kpTransformAutoCropBorder *rightBorder,
+        kpTransformAutoCropBorder *topBorder,
+        kpTransformAutoCropBorder *botBorder,
+        int numRegions, int processedColorSimilarity)
+{
+    if (leftBorder->exists () && rightBorder->exists ())
+    {
+        const kpColor leftCol = leftBorder->averageColor ();
+        const kpColor rightCol = rightBorder->averageColor ();
+
+        if ((numRegions == 2 && !leftCol.isSimilarTo (rightCol, processedColorSimilarity)) ||
+            leftBorder->right () >= rightBorder->left () - 1)  // kissing or overlapping
+        {
+        #if DEBUG_KP_TOOL_AUTO_CROP
+            qCDebug(kpLogImagelib) << "\tignoring left border";
+        #endif
+            leftBorder->invalidate ();
+        }
+    }
+
+    if (topBorder->exists () && botBorder->exists ())
+    {
+        const kpColor topCol = topBorder->averageColor ();
+        const kpColor botCol = botBorder->averageColor ();
+
+        if ((numRegions == 2 && !topCol.isSimilarTo (botCol, processedColorSimilarity)) ||
+            topBorder->bottom () >= botBorder->top () - 1)  // kissing or overlapping
+        {
+        #if DEBUG_KP_TOOL_AUTO_CROP
+            qCDebug(kpLogImagelib) << "\tignoring top border";
+        #endif
+            topBorder->invalidate ();
+        }
+    }
+}
+
+//---------------------------------------------------------------------
+
+// Returns the part of <imageRect> that is not covered by any of the borders.
+static QRect ContentsRect (const QRect &imageRect,
+        const kpTransformAutoCropBorder &leftBorder,
+        const kpTransformAutoCropBorder &rightBorder,
+        const kpTransformAutoCropBorder &topBorder,
+        const kpTransformAutoCropBorder &botBorder)
+{
+    QPoint topLeft (leftBorder.exists () ?
+                        leftBorder.rect ().right () + 1 :
+                        imageRect.left (),
+                    topBorder.exists () ?
+                        topBorder.rect ().bottom () + 1 :
+                        imageRect.top ());
+    QPoint botRight (rightBorder.exists () ?
+                         rightBorder.rect ().left () - 1 :
+                         imageRect.right (),
+                     botBorder.exists () ?
+                         botBorder.rect ().top () - 1 :
+                         imageRect.bottom ());
+
+    return {topLeft, botRight};
+}
+
+//---------------------------------------------------------------------
+
+QRect kpTransformAutoCropRect (const kpImage &image, int processedColorSimilarity,
+                               bool concurrently)
+{
+    if (image.isNull ())
+        return {};
+
+    kpTransformAutoCropBorder leftBorder (&image, processedColorSimilarity),
+                         rightBorder (&image, processedColorSimilarity),
+                         topBorder (&image, processedColorSimilarity),
+                         botBorder (&image, processedColorSimilarity);
+
+    const int numRegions = ::CalculateBorders (&leftBorder, &rightBorder,
+        &topBorder, &botBorder, concurrently);
+    if (numRegions == 0)
+        return {};
+
+    ::InvalidateConflictingBorders (&leftBorder, &rightBorder,
+        &topBorder, &botBorder, numRegions, processedColorSimilarity);
+
+    return ::ContentsRect (image.rect (),
+        leftBorder, rightBorder, topBorder, botBorder);
+}
+
+//---------------------------------------------------------------------
+
+// kpTransformAutoCropFiles() starts no more files at once than fit in this
+// many bytes of decoded images (including their cropped copies), except
+// that a file that doesn't fit by itself is still done on its own.
+static const qint64 AutoCropFilesMaxBytes = Q_INT64_C (512) * 1024 * 1024;
+
+struct kpTransformAutoCropFile
+{
+    enum Error
+    {
+        NoError,
+        LossyFormat,
+        ReadError,
+        WriteError
+    };
+
+    QString fileName;
+    qint64 bytes{};
+    Error error{NoError};
+    QString errorString;
+};
+
+static void AutoCropFile (kpTransformAutoCropFile *file,
+                          int processedColorSimilarity, int quality)
+{
+    QImageReader reader (file->fileName);
+    const QByteArray format = reader.format ();
+    const QImage image = reader.read ();
+    if (image.isNull ())
+    {
+        qCWarning(kpLogImagelib) << "kpTransformAutoCropFiles() could not read"
+                                 << file->fileName << ":" << reader.errorString ();
+        file->error = kpTransformAutoCropFile::ReadError;
+        file->errorString = reader.errorString ();
+        return;
+    }
+
+    const QRect rect = ::kpTransformAutoCropRect (image,
+        processedColorSimilarity, false/*already on a worker thread*/);
+    if (rect.isEmpty ())
+    {
+    #if DEBUG_KP_TOOL_AUTO_CROP
+        qCDebug(kpLogImagelib) << "\tno border in" << file->fileName;
+    #endif
+        return;
+    }
+
+    // Write to a temporary file and only replace the original once that
+    // has worked, so that a failure can't leave a truncated image behind.
+    //
+    // sync: All failure exit paths _must_ call QSaveFile::cancelWriting() or
+    //       else, the QSaveFile destructor will overwrite the file.
+    QSaveFile atomicFileWriter (file->fileName);
+    if (!atomicFileWriter.open (QIODevice::WriteOnly))
+    {
+        atomicFileWriter.cancelWriting ();
+
+        file->error = kpTransformAutoCropFile::WriteError;
+        file->errorString = atomicFileWriter.errorString ();
+        return;
+    }
+
+    QImageWriter writer (&atomicFileWriter, format);
+    writer.setQuality (quality);
+    if (!writer.write (image.copy (rect)))
+    {
+        atomicFileWriter.cancelWriting ();
+
+        file->error = kpTransformAutoCropFile::WriteError;
+        file->errorString = writer.errorString ();
+        return;
+    }
+
+    if (!atomicFileWriter.commit ())
+    {
+        file->error = kpTransformAutoCropFile::WriteError;
+        file->errorString = atomicFileWriter.errorString ();
+        return;
+    }
+}
+
+//---------------------------------------------------------------------
+
+QStringList kpTransformAutoCropFiles (const QStringList &fileNames,
+                                      int processedColorSimilarity,
+                                      int quality)
+{
+    QVector <kpTransformAutoCropFile> files (fileNames.count ());
+
+    // Look at the headers here, rather than on the worker threads, since
+    // the lossy formats are looked up in the config.
+    QMimeDatabase mimeDb;
+    for (int i = 0; i < fileNames.count (); i++)
+    {
+        kpTransformAutoCropFile &file = files [i];
+        file.fileName = fileNames [i];
+
+        const QString mimeType = mimeDb.mimeTypeForFile (file.fileName).name ();
+        if (kpDocumentSaveOptions::qualityIsInvalid (quality) &&
+            kpDocumentSaveOptions::mimeTypeHasConfigurableQuality (mimeType))
+        {
+            file.error = kpTransformAutoCropFile::LossyFormat;
+            continue;
+        }
+
+        const QSize size = QImageReader (file.fileName).size ();
+        file.bytes = size.isValid () ?
+            2 * qint64 (size.width ()) * size.height () * int (sizeof (QRgb)) :
+            AutoCropFilesMaxBytes;
+    }
+
+    // (-1 is the writer's default quality, for the lossless formats)
+    const int writerQuality = kpDocumentSaveOptions::qualityIsInvalid (quality) ?
+        -1 : quality;
+
+    // Each file is autocropped on its own thread so the borders of each
+    // image are calculated one after the other.
+    for (int begin = 0; begin < files.count (); )
+    {
+        QVector <kpTransformAutoCropFile *> batch;
+        qint64 batchBytes = 0;
+
+        int end = begin;
+        for (; end < files.count (); end++)
+        {
+            kpTransformAutoCropFile &file = files [end];
+            if (file.error != kpTransformAutoCropFile::NoError) {
+                continue;
+            }
+
+            if (!batch.isEmpty () && batchBytes + file.bytes > AutoCropFilesMaxBytes) {
+                break;
+            }
+
+            batch.append (&file);
+            batchBytes += file.bytes;
+        }
+
+    #if DEBUG_KP_TOOL_AUTO_CROP
+        qCDebug(kpLogImagelib) << "kpTransformAutoCropFiles() files" << begin
+                               << "to" << end << "bytes=" << batchBytes;
+    #endif
+        kpParallel::forEach (batch.count (),
+            [&] (int i)
+            {
+                ::AutoCropFile (batch [i], processedColorSimilarity, writerQuality);
+            });
+
+        begin = end;
+    }
+
+    QStringList errors;
+    for (const auto &file : files)
+    {
+        switch (file.error)
+        {
+        case kpTransformAutoCropFile::NoError:
+            break;
+
+        case kpTransformAutoCropFile::LossyFormat:
+            errors.append (i18n ("Not autocropping \"%1\" as saving it would lose quality"
+                                 " and no quality was given.",
+                                 file.fileName));
+            break;
+
+        case kpTransformAutoCropFile::ReadError:
+            errors.append (i18n ("Could not read \"%1\": %2",
+                                 file.fileName, file.errorString));
+            break;
+
+        case kpTransformAutoCropFile::WriteError:
+            errors.append (i18n ("Could not save \"%1\": %2",
+                                 file.fileName, file.errorString));
+            break;
+        }
+    }
+
+    return errors;
+}
+
+//---------------------------------------------------------------------
 
 struct kpTransformAutoCropCommandPrivate
 {
     bool actOnSelection{};
     kpTransformAutoCropBorder leftBorder, rightBorder, topBorder, botBorder;
-    kpImage *leftImage{}, *rightImage{}, *topImage{}, *botImage{};
+    kpTransformBorderImages borderImages;
 
     QRect contentsRect;
     int oldWidth{}, oldHeight{};
@@ -349,10 +693,6 @@ kpTransformAutoCropCommand::kpTransformAutoCropCommand (bool actOnSelection,
     d->rightBorder = rightBorder;
     d->topBorder = topBorder;
     d->botBorder = botBorder;
-    d->leftImage = nullptr;
-    d->rightImage = nullptr;
-    d->topImage = nullptr;
-    d->botImage = nullptr;
 
     kpDocument *doc = document ();
     Q_ASSERT (doc);
@@ -367,8 +707,6 @@ kpTransformAutoCropCommand::kpTransformAutoCropCommand (bool actOnSelection,
 
 kpTransformAutoCropCommand::~kpTransformAutoCropCommand ()
 {
-    deleteUndoImages ();
-
     delete d->oldSelectionPtr;
     delete d;
 }
@@ -402,67 +740,23 @@ kpCommandSize::SizeType kpTransformAutoCropCommand::size () const
            d->rightBorder.size () +
            d->topBorder.size () +
            d->botBorder.size () +
-           ImageSize (d->leftImage) +
-           ImageSize (d->rightImage) +
-           ImageSize (d->topImage) +
-           ImageSize (d->botImage) +
+           d->borderImages.size () +
            SelectionSize (d->oldSelectionPtr);
 }
 
-//---------------------------------------------------------------------
-// private
-
-void kpTransformAutoCropCommand::getUndoImage (const kpTransformAutoCropBorder &border, kpImage **image)
-{
-    kpDocument *doc = document ();
-    Q_ASSERT (doc);
-
-#if DEBUG_KP_TOOL_AUTO_CROP && 1
-    qCDebug(kpLogImagelib) << "kpTransformAutoCropCommand::getUndoImage()";
-    qCDebug(kpLogImagelib) << "\timage=" << image
-               << " border: rect=" << border.rect ()
-               << " isSingleColor=" << border.isSingleColor ();
-#endif
-
-    if (image && border.exists () && !border.isSingleColor ())
-    {
-        if (*image)
-        {
-        #if DEBUG_KP_TOOL_AUTO_CROP && 1
-            qCDebug(kpLogImagelib) << "\talready have *image - delete it";
-        #endif
-            delete *image;
-        }
-
-        *image = new kpImage (
-            kpPixmapFX::getPixmapAt (doc->image (d->actOnSelection),
-                                     border.rect ()));
-    }
-}
-
-
-// private
-void kpTransformAutoCropCommand::getUndoImages ()
+// public virtual [base kpCommand]
+void kpTransformAutoCropCommand::spill (kpSpillFile *file)
 {
-    getUndoImage (d->leftBorder, &d->leftImage);
-    getUndoImage (d->rightBorder, &d->rightImage);
-    getUndoImage (d->topBorder, &d->topImage);
-    getUndoImage (d->botBorder, &d->botImage);
+    d->borderImages.spill (file);
 }
 
-// private
-void kpTransformAutoCropCommand::deleteUndoImages ()
+// public virtual [base kpCommand]
+kpCommandSize::SizeType kpTransformAutoCropCommand::spilledSize () const
 {
-#if DEBUG_KP_TOOL_AUTO_CROP && 1
-    qCDebug(kpLogImagelib) << "kpTransformAutoCropCommand::deleteUndoImages()";
-#endif
-
-    delete d->leftImage; d->leftImage = nullptr;
-    delete d->rightImage; d->rightImage = nullptr;
-    delete d->topImage; d->topImage = nullptr;
-    delete d->botImage; d->botImage = nullptr;
+    return d->borderImages.spilledSize ();
 }
 
+//---------------------------------------------------------------------
 
 // public virtual [base kpCommand]
 void kpTransformAutoCropCommand::execute ()
@@ -472,13 +766,16 @@ void kpTransformAutoCropCommand::execute ()
     }
 
 
-    getUndoImages ();
-
-
     kpDocument *doc = document ();
     Q_ASSERT (doc);
 
 
+    // Borders that are a single color (usually the case when there is no
+    // Color Similarity) are saved as just that color.
+    d->borderImages = kpTransformBorderImages (doc->image (d->actOnSelection),
+                                               d->contentsRect);
+
+
     kpImage imageWithoutBorder =
         kpTool::neededPixmap (doc->image (d->actOnSelection),
                               d->contentsRect);
@@ -517,60 +814,8 @@ void kpTransformAutoCropCommand::unexecute ()
     kpDocument *doc = document ();
     Q_ASSERT (doc);
 
-    kpImage image (d->oldWidth, d->oldHeight, QImage::Format_ARGB32_Premultiplied);
-
-    // restore the position of the center image
-    kpPixmapFX::setPixmapAt (&image, d->contentsRect,
-        doc->image (d->actOnSelection));
-
-    // draw the borders
-
-    const kpTransformAutoCropBorder *borders [] =
-    {
-        &d->leftBorder, &d->rightBorder,
-        &d->topBorder, &d->botBorder,
-        nullptr
-    };
-
-    const kpImage *images [] =
-    {
-        d->leftImage, d->rightImage,
-        d->topImage, d->botImage,
-        nullptr
-    };
-
-    const kpImage **p = images;
-    for (const kpTransformAutoCropBorder **b = borders; *b; b++, p++)
-    {
-        if (!(*b)->exists ()) {
-            continue;
-        }
-
-        if ((*b)->isSingleColor ())
-        {
-            kpColor col = (*b)->referenceColor ();
-        #if DEBUG_KP_TOOL_AUTO_CROP && 1
-            qCDebug(kpLogImagelib) << "\tdrawing border " << (*b)->rect ()
-                       << " rgb=" << (int *) col.toQRgb () /* %X hack */;
-        #endif
-
-            const QRect r = (*b)->rect ();
-            kpPainter::fillRect (&image,
-                r.x (), r.y (), r.width (), r.height (),
-                col);
-        }
-        else
-        {
-        #if DEBUG_KP_TOOL_AUTO_CROP && 1
-            qCDebug(kpLogImagelib) << "\trestoring border image " << (*b)->rect ();
-        #endif
-            if (*p)
-            {
-                // REFACTOR: Add equivalent method to kpPainter and use.
-                kpPixmapFX::setPixmapAt (&image, (*b)->rect (), **p);
-            }
-        }
-    }
+    Q_ASSERT (d->borderImages.imageSize () == QSize (d->oldWidth, d->oldHeight));
+    kpImage image = d->borderImages.restore (doc->image (d->actOnSelection));
 
 
     if (!d->actOnSelection) {
@@ -587,7 +832,7 @@ void kpTransformAutoCropCommand::unexecute ()
     }
 
 
-    deleteUndoImages ();
+    d->borderImages = kpTransformBorderImages ();
 }
 
 
@@ -596,20 +841,8 @@ QRect kpTransformAutoCropCommand::contentsRect () const
 {
     const kpImage image = document ()->image (d->actOnSelection);
 
-    QPoint topLeft (d->leftBorder.exists () ?
-                        d->leftBorder.rect ().right () + 1 :
-                        0,
-                    d->topBorder.exists () ?
-                        d->topBorder.rect ().bottom () + 1 :
-                        0);
-    QPoint botRight (d->rightBorder.exists () ?
-                         d->rightBorder.rect ().left () - 1 :
-                         image.width () - 1,
-                     d->botBorder.exists () ?
-                         d->botBorder.rect ().top () - 1 :
-                         image.height () - 1);
-
-    return {topLeft, botRight};
+    return ::ContentsRect (image.rect (),
+        d->leftBorder, d->rightBorder, d->topBorder, d->botBorder);
 }
 
 
@@ -669,19 +902,9 @@ bool kpTransformAutoCrop (kpMainWindow *mainWindow)
     //
     // TODO: e.g. When the top fills entire rect but bot doesn't we could
     //       invalidate top and continue autocrop.
-    int numRegions = 0;
-    if (!leftBorder.calculate (true/*x*/, +1/*going right*/) ||
-        leftBorder.fillsEntireImage () ||
-        !rightBorder.calculate (true/*x*/, -1/*going left*/) ||
-        rightBorder.fillsEntireImage () ||
-        !topBorder.calculate (false/*y*/, +1/*going down*/) ||
-        topBorder.fillsEntireImage () ||
-        !botBorder.calculate (false/*y*/, -1/*going up*/) ||
-        botBorder.fillsEntireImage () ||
-        ((numRegions = leftBorder.exists () +
-                       rightBorder.exists () +
-                       topBorder.exists () +
-                       botBorder.exists ()) == 0))
+    const int numRegions = ::CalculateBorders (&leftBorder, &rightBorder,
+        &topBorder, &botBorder, true/*concurrently*/);
+    if (numRegions == 0)
     {
     #if DEBUG_KP_TOOL_AUTO_CROP
         qCDebug(kpLogImagelib) << "\tcan't find border; leftBorder.rect=" << leftBorder.rect ()
@@ -709,42 +932,8 @@ bool kpTransformAutoCrop (kpMainWindow *mainWindow)
                << " avgCol=" << (botBorder.exists () ? (int *) botBorder.averageColor ().toQRgb () : nullptr);
 #endif
 
-    // In case e.g. the user pastes a solid, coloured-in rectangle,
-    // we favor killing the bottom and right regions
-    // (these regions probably contain the unwanted whitespace due
-    //  to the doc being bigger than the pasted selection to start with).
-    //
-    // We also kill if they kiss or even overlap.
-
-    if (leftBorder.exists () && rightBorder.exists ())
-    {
-        const kpColor leftCol = leftBorder.averageColor ();
-        const kpColor rightCol = rightBorder.averageColor ();
-
-        if ((numRegions == 2 && !leftCol.isSimilarTo (rightCol, processedColorSimilarity)) ||
-            leftBorder.right () >= rightBorder.left () - 1)  // kissing or overlapping
-        {
-        #if DEBUG_KP_TOOL_AUTO_CROP
-            qCDebug(kpLogImagelib) << "\tignoring left border";
-        #endif
-            leftBorder.invalidate ();
-        }
-    }
-
-    if (topBorder.exists () && botBorder.exists ())
-    {
-        const kpColor topCol = topBorder.averageColor ();
-        const kpColor botCol = botBorder.averageColor ();
-
-        if ((numRegions == 2 && !topCol.isSimilarTo (botCol, processedColorSimilarity)) ||
-            topBorder.bottom () >= botBorder.top () - 1)  // kissing or overlapping
-        {
-        #if DEBUG_KP_TOOL_AUTO_CROP
-            qCDebug(kpLogImagelib) << "\tignoring top border";
-        #endif
-            topBorder.invalidate ();
-        }
-    }
+    ::InvalidateConflictingBorders (&leftBorder, &rightBorder,
+        &topBorder, &botBorder, numRegions, processedColorSimilarity);
 
 
     mainWindow->addImageOrSelectionCommand (
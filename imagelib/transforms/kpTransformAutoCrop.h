@@ -34,6 +34,7 @@
 
 
 class QRect;
+class QStringList;
 
 //class kpImage;
 class kpMainWindow;
@@ -61,13 +62,9 @@ public:
     static QString text(bool actOnSelection, int options);
 
     SizeType size () const override;
+    void spill (kpSpillFile *file) override;
+    SizeType spilledSize () const override;
 
-private:
-    void getUndoImage (const kpTransformAutoCropBorder &border, kpImage **image);
-    void getUndoImages ();
-    void deleteUndoImages ();
-
-public:
     void execute () override;
     void unexecute () override;
 
@@ -81,5 +78,27 @@ private:
 // (returns true on success (even if it did nothing) or false on error)
 bool kpTransformAutoCrop (kpMainWindow *mainWindow);
 
+// Returns the part of <image> that autocrop would keep or an empty rect if
+// it could not locate a border.  If <concurrently>, the borders of large
+// images are calculated on several threads at the same time.
+//
+// This does not touch the GUI so it may be called from any thread.
+QRect kpTransformAutoCropRect (const kpImage &image, int processedColorSimilarity,
+                               bool concurrently = true);
+
+// Autocrops the image files <fileNames>, several at a time (as many as fit
+// in a memory budget), overwriting each one in its original format.  Files
+// without a border are left alone.  Each file is replaced only once its
+// cropped image has been written completely.
+//
+// Files in lossy formats (e.g. JPEG) are saved at <quality>.  If <quality>
+// is invalid (see kpDocumentSaveOptions), they are left alone and reported
+// as errors, instead of being recompressed at some default quality.
+//
+// Returns a message for each file that could not be autocropped.
+QStringList kpTransformAutoCropFiles (const QStringList &fileNames,
+                                      int processedColorSimilarity,
+                                      int quality);
+
 
 #endif  // KP_TRANSFORM_AUTO_CROP_H
@@ -51,25 +51,27 @@ void kpTransformCrop (kpMainWindow *mainWindow)
     Q_ASSERT (sel);
 
 
-    kpCommand *resizeDocCommand =
-        new kpTransformResizeScaleCommand (
-            false/*act on doc, not sel*/,
-            sel->width (), sel->height (),
-            kpTransformResizeScaleCommand::Resize,
-            mainWindow->commandEnvironment ());
-
-
     auto *textSel = dynamic_cast <kpTextSelection *> (sel);
     auto *imageSel = dynamic_cast <kpAbstractImageSelection *> (sel);
     // It's either a text selection or an image selection, but cannot be
     // neither or both.
     Q_ASSERT (!!textSel != !!imageSel);
 
-    if (textSel) {
+    if (textSel)
+    {
+        kpCommand *resizeDocCommand =
+            new kpTransformResizeScaleCommand (
+                false/*act on doc, not sel*/,
+                sel->width (), sel->height (),
+                kpTransformResizeScaleCommand::Resize,
+                mainWindow->commandEnvironment ());
+
         ::kpTransformCrop_TextSelection (mainWindow, i18n ("Set as Image"), resizeDocCommand);
     }
     else if (imageSel) {
-        ::kpTransformCrop_ImageSelection (mainWindow, i18n ("Set as Image"), resizeDocCommand);
+        // (resizes the document itself, so that undo only needs to keep
+        //  the pixels around the selection)
+        ::kpTransformCrop_ImageSelection (mainWindow, i18n ("Set as Image"));
     }
     else {
         Q_ASSERT (!"unreachable");
@@ -42,8 +42,11 @@ class kpMainWindow;
 // which resizes the document to the size of the selection.
 void kpTransformCrop_TextSelection (kpMainWindow *mainWindow,
         const QString &commandName, kpCommand *resizeDocCommand);
+
+// Adds a kpMacroCommand, with name <commandName>, to the command history.
+// It resizes the document to the size of the selection itself.
 void kpTransformCrop_ImageSelection (kpMainWindow *mainWindow,
-        const QString &commandName, kpCommand *resizeDocCommand);
+        const QString &commandName);
 
 
 #endif  // kpTransformCropPrivate_H
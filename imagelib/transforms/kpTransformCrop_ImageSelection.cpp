@@ -35,7 +35,9 @@
 #include "layers/selections/image/kpAbstractImageSelection.h"
 #include "environments/commands/kpCommandEnvironment.h"
 #include "commands/kpCommandHistory.h"
+#include "commands/imagelib/transforms/kpTransformBorderImages.h"
 #include "document/kpDocument.h"
+#include "imagelib/kpCompressedImage.h"
 #include "imagelib/kpImage.h"
 #include "commands/kpMacroCommand.h"
 #include "mainWindow/kpMainWindow.h"
@@ -58,21 +60,39 @@ public:
 
     kpCommandSize::SizeType size () const override
     {
-        return ImageSize (m_oldImage) +
-               SelectionSize (m_fromSelectionPtr) +
-               ImageSize (m_imageIfFromSelectionDoesntHaveOne);
+        return m_oldBorderImages.size () +
+               ImageSize (m_oldImageUnderSelection) +
+               SelectionSize (m_fromSelectionPtr);
     }
 
-    // ASSUMPTION: Document has been resized to be the same size as the
-    //             selection.
+    void spill (kpSpillFile *file) override
+    {
+        m_oldBorderImages.spill (file);
+        m_oldImageUnderSelection.spill (file);
+    }
+
+    SizeType spilledSize () const override
+    {
+        return m_oldBorderImages.spilledSize () +
+               kpCommandSize::SpilledImageSize (m_oldImageUnderSelection);
+    }
+
+    // Also resizes the document to be the same size as the selection.
     void execute () override;
     void unexecute () override;
 
 protected:
     kpColor m_backgroundColor;
-    kpImage m_oldImage;
+
+    // The old document image is not kept whole.  Its pixels outside the
+    // selection bounding rectangle are in <m_oldBorderImages>.  The ones
+    // inside are in <m_oldImageUnderSelection> -- unless they ended up
+    // unchanged in the new document image (e.g. for a rectangular selection
+    // border over opaque pixels), in which case that is null.
+    kpTransformBorderImages m_oldBorderImages;
+    kpCompressedImage m_oldImageUnderSelection;
+
     kpAbstractImageSelection *m_fromSelectionPtr;
-    kpImage m_imageIfFromSelectionDoesntHaveOne;
 };
 
 
@@ -84,14 +104,6 @@ SetDocumentToSelectionImageCommand::SetDocumentToSelectionImageCommand (kpComman
             environ->document ()->selection ()->clone ()))
 {
     Q_ASSERT (m_fromSelectionPtr);
-
-    if ( m_fromSelectionPtr )  // make coverity happy
-    {
-      m_imageIfFromSelectionDoesntHaveOne =
-        m_fromSelectionPtr->hasContent () ?
-            kpImage () :
-            document ()->getSelectedBaseImage ();
-    }
 }
 
 //---------------------------------------------------------------------
@@ -112,12 +124,17 @@ void SetDocumentToSelectionImageCommand::execute ()
 
     viewManager ()->setQueueUpdates ();
     {
-        // kpTransformCrop_ImageSelection's <resizeDocCommand> has
-        // executed, resizing the document to be the size of the selection
-        // bounding rectangle.
-        Q_ASSERT (document ()->width () == m_fromSelectionPtr->width ());
-        Q_ASSERT (document ()->height () == m_fromSelectionPtr->height ());
-        m_oldImage = document ()->image ();
+        const kpImage oldDocImage = document ()->image ();
+        const QRect selRect = m_fromSelectionPtr->boundingRect ();
+
+        m_oldBorderImages = kpTransformBorderImages (oldDocImage, selRect);
+
+        // (the part of the selection bounding rectangle that is inside the
+        //  document, relative to the selection)
+        const QRect keptRect =
+            m_oldBorderImages.keptRect ().translated (-selRect.topLeft ());
+
+        const kpImage oldImageInSelRect = kpPixmapFX::getPixmapAt (oldDocImage, selRect);
 
 
         //
@@ -139,7 +156,7 @@ void SetDocumentToSelectionImageCommand::execute ()
         //       any transparent pixels.
         //
 
-        QImage newDocImage(document()->width(), document()->height(), QImage::Format_ARGB32_Premultiplied);
+        QImage newDocImage(selRect.width(), selRect.height(), QImage::Format_ARGB32_Premultiplied);
         newDocImage.fill(m_backgroundColor.toQRgb());
 
     #if DEBUG_KP_TOOL_CROP
@@ -159,7 +176,8 @@ void SetDocumentToSelectionImageCommand::execute ()
         }
         else
         {
-            setTransparentImage = m_imageIfFromSelectionDoesntHaveOne;
+            setTransparentImage =
+                m_fromSelectionPtr->givenImageMaskedByShape (oldImageInSelRect);
         #if DEBUG_KP_TOOL_CROP
             qCDebug(kpLogImagelib) << "\tno pixmap in sel - get it; rect="
                        << setTransparentImage.rect ();
@@ -171,7 +189,24 @@ void SetDocumentToSelectionImageCommand::execute ()
             setTransparentImage);
 
 
-        document ()->setImageAt (newDocImage, QPoint (0, 0));
+        // Undo can get the pixels back from the new document image if they
+        // weren't changed.
+        m_oldImageUnderSelection = kpCompressedImage ();
+        if (!keptRect.isEmpty ())
+        {
+            const kpImage oldImageUnderSelection =
+                kpPixmapFX::getPixmapAt (oldImageInSelRect, keptRect);
+            if (oldImageUnderSelection != kpPixmapFX::getPixmapAt (newDocImage, keptRect)) {
+                m_oldImageUnderSelection = oldImageUnderSelection;
+            }
+        }
+
+    #if DEBUG_KP_TOOL_CROP
+        qCDebug(kpLogImagelib) << "\tsaved border size=" << m_oldBorderImages.size ()
+                   << " saved image under sel=" << !m_oldImageUnderSelection.isNull ();
+    #endif
+
+        document ()->setImage (newDocImage);
         document ()->selectionDelete ();
 
 
@@ -191,8 +226,17 @@ void SetDocumentToSelectionImageCommand::unexecute ()
 
     viewManager ()->setQueueUpdates ();
     {
-        document ()->setImageAt (m_oldImage, QPoint (0, 0));
-        m_oldImage = kpImage ();
+        const QRect keptRect = m_oldBorderImages.keptRect ();
+        kpImage imageUnderSelection = m_oldImageUnderSelection.image ();
+        if (imageUnderSelection.isNull () && !keptRect.isEmpty ())
+        {
+            imageUnderSelection = document ()->getImageAt (
+                keptRect.translated (-m_fromSelectionPtr->topLeft ()));
+        }
+
+        document ()->setImage (m_oldBorderImages.restore (imageUnderSelection));
+        m_oldBorderImages = kpTransformBorderImages ();
+        m_oldImageUnderSelection = kpCompressedImage ();
 
     #if DEBUG_KP_TOOL_CROP
         qCDebug(kpLogImagelib) << "\tsel: rect=" << m_fromSelectionPtr->boundingRect ()
@@ -209,7 +253,7 @@ void SetDocumentToSelectionImageCommand::unexecute ()
 
 
 void kpTransformCrop_ImageSelection (kpMainWindow *mainWindow,
-        const QString &commandName, kpCommand *resizeDocCommand)
+        const QString &commandName)
 {
     // Save starting selection, minus the border.
     auto *borderImageSel = dynamic_cast <kpAbstractImageSelection *> (
@@ -228,10 +272,6 @@ void kpTransformCrop_ImageSelection (kpMainWindow *mainWindow,
     auto *environ = mainWindow->commandEnvironment ();
     auto *macroCmd = new kpMacroCommand (commandName, environ);
 
-    // (must resize doc _before_ SetDocumentToSelectionImageCommand in case
-    //  doc needs to gets bigger - else selection image may not fit)
-    macroCmd->addCommand (resizeDocCommand);
-
 #if DEBUG_KP_TOOL_CROP
     qCDebug(kpLogImagelib) << "\tis pixmap sel";
     qCDebug(kpLogImagelib) << "\tcreating SetImage cmd";
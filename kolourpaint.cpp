@@ -28,14 +28,21 @@
 
 #include <kaboutdata.h>
 
+#include "kpDefs.h"
 #include "kpVersion.h"
+#include "document/kpDocumentSaveOptions.h"
+#include "imagelib/kpColor.h"
+#include "imagelib/transforms/kpTransformAutoCrop.h"
 #include "mainWindow/kpMainWindow.h"
 #include <kolourpaintlicense.h>
 
 #include <QApplication>
 #include <QCommandLineParser>
 #include <QDir>
+#include <QTextStream>
+#include <KConfigGroup>
 #include <KLocalizedString>
+#include <KSharedConfig>
 
 int main(int argc, char *argv [])
 {
@@ -89,11 +96,50 @@ int main(int argc, char *argv [])
   cmdLine.addVersionOption();
   cmdLine.addHelpOption();
   cmdLine.addPositionalArgument(QStringLiteral("files"), i18n("Image files to open, optionally"), QStringLiteral("[files...]"));
+  cmdLine.addOption(QCommandLineOption(QStringLiteral("autocrop"),
+      i18n("Autocrop the given image files, overwriting them, and exit without showing a window")));
+  cmdLine.addOption(QCommandLineOption(QStringLiteral("quality"),
+      i18n("With --autocrop, the quality (0-100) to save files in lossy formats such as JPEG at."
+           " Without it, such files are left alone."),
+      i18n("quality")));
 
   aboutData.setupCommandLine(&cmdLine);
   cmdLine.process(app);
   aboutData.processCommandLine(&cmdLine);
 
+  if ( cmdLine.isSet(QStringLiteral("autocrop")) )
+  {
+    // Use the same Color Similarity as Image / Autocrop.
+    KConfigGroup cfg(KSharedConfig::openConfig(), kpSettingsGroupGeneral);
+    const int processedColorSimilarity =
+        kpColor::processSimilarity(cfg.readEntry(kpSettingColorSimilarity, 0.0));
+
+    QTextStream err(stderr);
+
+    int quality = kpDocumentSaveOptions::invalidQuality();
+    if ( cmdLine.isSet(QStringLiteral("quality")) )
+    {
+      bool ok = false;
+      quality = cmdLine.value(QStringLiteral("quality")).toInt(&ok);
+      if ( !ok || quality < 0 || quality > 100 )
+      {
+        err << i18n("The quality must be a number from 0 to 100.") << QLatin1Char('\n');
+        return 1;
+      }
+    }
+
+    QStringList fileNames;
+    for (const QString &arg : cmdLine.positionalArguments())
+      fileNames.append(QDir::current().absoluteFilePath(arg));
+
+    const QStringList errors = kpTransformAutoCropFiles(fileNames, processedColorSimilarity, quality);
+
+    for (const QString &error : errors)
+      err << error << QLatin1Char('\n');
+
+    return errors.isEmpty() ? 0 : 1;
+  }
+
   if ( app.isSessionRestored() )
   {
     // Creates a kpMainWindow using the default constructor and then
@@ -67,6 +67,7 @@
 #define kpSettingDitherOnOpen "Dither on Open if Screen is 15/16bpp and Image Num Colors More Than"
 #define kpSettingPrintImageCenteredOnPage "Print Image Centered On Page"
 #define kpSettingOpenImagesInSameWindow "Open Images in the Same Window"
+#define kpSettingFloodFillParallelMinPixels "Flood Fill Parallel Min Pixels"
 
 #define kpSettingsGroupFileSaveAs "File/Save As"
 #define kpSettingsGroupFileExport "File/Export"
@@ -91,6 +92,8 @@
 #define kpSettingUndoMinLimit "Min Limit"
 #define kpSettingUndoMaxLimit "Max Limit"
 #define kpSettingUndoMaxLimitSizeLimit "Max Limit Size Limit"
+#define kpSettingUndoMaxLimitDiskSizeLimit "Max Limit Disk Size Limit"
+#define kpSettingUndoByReplay "Undo By Replay"
 
 
 #define kpSettingsGroupThumbnail "Thumbnail Settings"
@@ -32,7 +32,11 @@
 #include "layers/selections/image/kpAbstractImageSelection.h"
 
 #include <QBitmap>
+#include <QColor>
+#include <QCoreApplication>
+#include <QList>
 #include <QPainter>
+#include <QVector>
 
 #include "kpLogCategories.h"
 
@@ -57,6 +61,34 @@ static bool CanSetBaseImageTo (kpAbstractImageSelection *sel, const kpImage &bas
 
 //---------------------------------------------------------------------
 
+// A transparency mask previously calculated by
+// kpAbstractImageSelection::recalculateTransparencyMaskCache().
+struct kpTransparencyMaskCacheEntry
+{
+    qint64 baseImageCacheKey;
+    QRgb transparentColor;
+    int processedColorSimilarity;
+
+    // Null if no pixel was transparent.
+    QBitmap transparencyMask;
+};
+
+// Most recently used first.
+//
+// Selections are cloned for undo/redo, with their base images sharing the
+// same data (and so the same QImage::cacheKey()), so this lets undo/redo and
+// toggling selection transparency back and forth skip recalculating masks.
+static QList <kpTransparencyMaskCacheEntry> TransparencyMaskCache;
+static const int TransparencyMaskCacheMaxEntries = 4;
+
+// The QBitmap's must not outlive the application object.
+static void ClearTransparencyMaskCache ()
+{
+    ::TransparencyMaskCache.clear ();
+}
+
+//---------------------------------------------------------------------
+
 struct kpAbstractImageSelectionPrivate
 {
     kpImage baseImage;
@@ -383,32 +415,23 @@ bool kpAbstractImageSelection::setTransparency (
         #endif
             haveChanged = false;
         }
+        else if (oldTransparencyMaskCache.cacheKey () ==
+                 d->transparencyMaskCache.cacheKey ())
+        {
+        #if DEBUG_KP_SELECTION
+            qCDebug(kpLogLayers) << "\tsame cached mask - nothing changed";
+        #endif
+            haveChanged = false;
+        }
         else if (checkTransparentPixmapChanged)
         {
-            QImage oldTransparencyMaskImage = oldTransparencyMaskCache.toImage();
-            QImage newTransparencyMaskImage = d->transparencyMaskCache.toImage();
-
-            bool changed = false;
-            for (int y = 0; y < oldTransparencyMaskImage.height () && !changed; y++)
+            // Compares the pixels.
+            if (oldTransparencyMaskCache.toImage () ==
+                d->transparencyMaskCache.toImage ())
             {
-                for (int x = 0; x < oldTransparencyMaskImage.width () && !changed; x++)
-                {
-                    if (kpPixmapFX::getColorAtPixel (oldTransparencyMaskImage, x, y) !=
-                        kpPixmapFX::getColorAtPixel (newTransparencyMaskImage, x, y))
-                    {
-                    #if DEBUG_KP_SELECTION
-                        qCDebug(kpLogLayers) << "\tdiffer at " << QPoint (x, y)
-                                   << " old=" << kpPixmapFX::getColorAtPixel (oldTransparencyMaskImage, x, y).toQRgb ()
-                                   << " new=" << kpPixmapFX::getColorAtPixel (newTransparencyMaskImage, x, y).toQRgb ()
-                                   << endl;
-                    #endif
-                        changed = true;
-                        break;
-                    }
-                }
-            }
-
-            if (!changed) {
+            #if DEBUG_KP_SELECTION
+                qCDebug(kpLogLayers) << "\tmasks are identical - nothing changed";
+            #endif
                 haveChanged = false;
             }
         }
@@ -449,41 +472,92 @@ void kpAbstractImageSelection::recalculateTransparencyMaskCache ()
         return;
     }
 
-    d->transparencyMaskCache = QBitmap(d->baseImage.size());
+    const qint64 baseImageCacheKey = d->baseImage.cacheKey ();
+    const kpColor transparentColor = d->transparency.transparentColor ();
+    const int processedColorSimilarity = d->transparency.processedColorSimilarity ();
+
+    for (int i = 0; i < ::TransparencyMaskCache.size (); i++)
+    {
+        const kpTransparencyMaskCacheEntry &entry = ::TransparencyMaskCache [i];
+        if (entry.baseImageCacheKey == baseImageCacheKey &&
+            entry.transparentColor == transparentColor.toQRgb () &&
+            entry.processedColorSimilarity == processedColorSimilarity)
+        {
+        #if DEBUG_KP_SELECTION
+            qCDebug(kpLogLayers) << "\tfound in cache";
+        #endif
+            d->transparencyMaskCache = entry.transparencyMask;
+            ::TransparencyMaskCache.move (i, 0);
+            return;
+        }
+    }
+
+    const QImage image = kpPixmapFX::getRgbaScanlineImage (d->baseImage);
+    const int width = image.width ();
 
-    QPainter transparencyMaskPainter (&d->transparencyMaskCache);
+    // Pixel value 1 is transparent.
+    QImage maskImage (image.size (), QImage::Format_MonoLSB);
+    maskImage.setColorCount (2);
+    maskImage.setColor (0, QColor (Qt::color0).rgb ());
+    maskImage.setColor (1, QColor (Qt::color1).rgb ());
+
+    const int numWords = (width + 31) / 32;
+    const int numBytes = (width + 7) / 8;
+    QVector <quint32> mask (numWords), transparentMask (numWords);
 
     bool hasTransparent = false;
-    for (int y = 0; y < d->baseImage.height (); y++)
+    for (int y = 0; y < image.height (); y++)
     {
-        for (int x = 0; x < d->baseImage.width (); x++)
+        const auto *line = reinterpret_cast <const QRgb *> (image.constScanLine (y));
+
+        transparentColor.similarityMask (line, width, processedColorSimilarity,
+                                         mask.data ());
+        kpColor::Transparent.similarityMask (line, width, kpColor::Exact,
+                                             transparentMask.data ());
+
+        quint32 anyTransparent = 0;
+        for (int i = 0; i < numWords; i++)
         {
-            const kpColor pixelCol = kpPixmapFX::getColorAtPixel (d->baseImage, x, y);
-            if (pixelCol == kpColor::Transparent ||
-                pixelCol.isSimilarTo (d->transparency.transparentColor (),
-                                      d->transparency.processedColorSimilarity ()))
-            {
-                transparencyMaskPainter.setPen (Qt::color1/*transparent*/);
-                hasTransparent = true;
-            }
-            else
-            {
-                transparencyMaskPainter.setPen (Qt::color0/*opaque*/);
-            }
+            mask [i] |= transparentMask [i];
+            anyTransparent |= mask [i];
+        }
 
-            transparencyMaskPainter.drawPoint (x, y);
+        if (anyTransparent) {
+            hasTransparent = true;
         }
-    }
 
-    transparencyMaskPainter.end ();
+        // Pixel x is bit (x % 8) of byte (x / 8) in both.
+        uchar *maskLine = maskImage.scanLine (y);
+        for (int i = 0; i < numBytes; i++) {
+            maskLine [i] = static_cast <uchar> (mask [i >> 2] >> ((i & 3) * 8));
+        }
+    }
 
-    if (!hasTransparent)
+    if (hasTransparent)
+    {
+        d->transparencyMaskCache = QBitmap::fromImage (maskImage);
+    }
+    else
     {
     #if DEBUG_KP_SELECTION
         qCDebug(kpLogLayers) << "\tcolour useless - completely opaque";
     #endif
         d->transparencyMaskCache = QBitmap ();
-        return;
+    }
+
+    static bool registeredClear = false;
+    if (!registeredClear)
+    {
+        qAddPostRoutine (&::ClearTransparencyMaskCache);
+        registeredClear = true;
+    }
+
+    const kpTransparencyMaskCacheEntry entry = {baseImageCacheKey,
+        transparentColor.toQRgb (), processedColorSimilarity,
+        d->transparencyMaskCache};
+    ::TransparencyMaskCache.prepend (entry);
+    while (::TransparencyMaskCache.size () > ::TransparencyMaskCacheMaxEntries) {
+        ::TransparencyMaskCache.removeLast ();
     }
 }
 
@@ -538,7 +612,7 @@ void kpAbstractImageSelection::flip (bool horiz, bool vert)
     #if DEBUG_KP_SELECTION && 1
         qCDebug(kpLogLayers) << "\thave pixmap - flipping that";
     #endif
-        d->baseImage = d->baseImage.mirrored(horiz, vert);
+        kpPixmapFX::flip (&d->baseImage, horiz, vert);
     }
 
     if (!d->transparencyMaskCache.isNull ())
@@ -38,6 +38,7 @@
 #include "kpDefs.h"
 #include "document/kpDocument.h"
 #include "environments/document/kpDocumentEnvironment.h"
+#include "imagelib/kpFloodFill.h"
 #include "layers/selections/kpSelectionDrag.h"
 #include "kpThumbnail.h"
 #include "tools/kpTool.h"
@@ -111,6 +112,8 @@ void kpMainWindow::readGeneralSettings ()
     d->configShowPath = cfg.readEntry (kpSettingShowPath, false);
     d->moreEffectsDialogLastEffect = cfg.readEntry (kpSettingMoreEffectsLastEffect, 0);
     kpToolEnvironment::drawAntiAliased = cfg.readEntry(kpSettingDrawAntiAliased, true);
+    kpFloodFill::parallelMinPixels = cfg.readEntry(kpSettingFloodFillParallelMinPixels,
+        kpFloodFill::parallelMinPixels);
 
     if (cfg.hasKey (kpSettingOpenImagesInSameWindow))
     {
@@ -636,6 +636,7 @@ private slots:
     void slotEnableSettingsShowPath ();
     void slotShowPathToggled ();
     void slotDrawAntiAliasedToggled(bool on);
+    void slotUndoByReplayToggled (bool on);
 
     void slotKeyBindings ();
 
@@ -400,7 +400,8 @@ void kpMainWindow::slotResizeScale ()
             dialog.actOnSelection (),
             dialog.imageWidth (), dialog.imageHeight (),
             dialog.type (),
-            commandEnvironment ());
+            commandEnvironment (),
+            dialog.smoothScaleFilter ());
 
         bool addSelCreateCommand = (dialog.actOnSelection () ||
                                     cmd->scaleSelectionWithImage ());
@@ -539,7 +540,8 @@ void kpMainWindow::slotConvertToBlackAndWhite ()
     toolEndShape ();
 
     addImageOrSelectionCommand (
-        new kpEffectReduceColorsCommand (1/*depth*/, true/*dither*/,
+        new kpEffectReduceColorsCommand (1/*depth*/,
+            kpColorQuantizer::FloydSteinbergDither,
             d->document->selection (),
             commandEnvironment ()));
 }
@@ -39,6 +39,7 @@
 #include <KLocalizedString>
 
 #include "kpDefs.h"
+#include "commands/kpCommandHistory.h"
 #include "document/kpDocument.h"
 #include "tools/kpToolAction.h"
 #include "widgets/toolbars/kpToolToolBar.h"
@@ -73,6 +74,15 @@ void kpMainWindow::setupSettingsMenuActions ()
     action->setChecked(kpToolEnvironment::drawAntiAliased);
     connect (action, &KToggleAction::triggered, this, &kpMainWindow::slotDrawAntiAliasedToggled);
 
+    action = ac->add<KToggleAction>(QStringLiteral("settings_undo_by_replay"));
+    action->setText(i18n("Undo by Re&playing"));
+    action->setWhatsThis(i18n("Use less memory for undo, by undoing effects and"
+                              " transformations of the whole image by redoing"
+                              " the ones before them, from an earlier copy of"
+                              " the image.  Undoing them may be slower."));
+    action->setChecked(d->commandHistory->undoByReplay());
+    connect (action, &KToggleAction::triggered, this, &kpMainWindow::slotUndoByReplayToggled);
+
     d->actionKeyBindings = KStandardAction::keyBindings (this, SLOT (slotKeyBindings()), ac);
 
     KStandardAction::configureToolbars(this, SLOT(configureToolbars()), actionCollection());
@@ -144,6 +154,19 @@ void kpMainWindow::slotDrawAntiAliasedToggled(bool on)
 
 //---------------------------------------------------------------------
 
+// private slot
+void kpMainWindow::slotUndoByReplayToggled (bool on)
+{
+    d->commandHistory->setUndoByReplay (on);
+
+    KConfigGroup cfg (KSharedConfig::openConfig (), kpSettingsGroupUndoRedo);
+
+    cfg.writeEntry (kpSettingUndoByReplay, on);
+    cfg.sync ();
+}
+
+//---------------------------------------------------------------------
+
 // private slot
 void kpMainWindow::slotKeyBindings ()
 {
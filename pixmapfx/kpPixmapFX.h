@@ -114,6 +114,15 @@ public:
     static kpColor getColorAtPixel (const QImage &pm, const QPoint &at);
     static kpColor getColorAtPixel (const QImage &pm, int x, int y);
 
+    //
+    // Returns an image whose 32-bit scanlines hold exactly the QRgb values
+    // that getColorAtPixel() would return for <pm>, so that they can be
+    // read in bulk e.g. by kpColor::similarityMask().  <pm> is returned
+    // without being copied if it is already in such a format, which is the
+    // case for document images.
+    //
+    static QImage getRgbaScanlineImage (const QImage &pm);
+
 //
 // Transforms
 //
@@ -131,12 +140,24 @@ public:
 
     //
     // Scales an image to the given width and height.
-    // If <pretty> is true, a smooth scale will be used.
+    // If <pretty> is true, a smooth scale will be used (see kpImageScaler,
+    // with its Bilinear filter).
     //
     static void scale (QImage *destPtr, int w, int h, bool pretty = false);
     static QImage scale (const QImage &pm, int w, int h, bool pretty = false);
 
 
+    //
+    // Flips an image horizontally and/or vertically (both is the same as
+    // rotating by 180 degrees).
+    //
+    // The first version works in place, reversing and swapping rows, so the
+    // image is only copied if it is shared.
+    //
+    static void flip (QImage *destPtr, bool horiz, bool vert);
+    static QImage flip (const QImage &image, bool horiz, bool vert);
+
+
     // The minimum difference between 2 angles (in degrees) such that they are
     // considered different.  This gives you at least enough precision to
     // rotate an image whose width <= 10000 such that its height increases
@@ -179,6 +200,10 @@ public:
     // Using <targetWidth> & <targetHeight> to generate preview pixmaps is
     // significantly more efficient than rotating and then scaling yourself.
     //
+    // Without them, rotations by multiples of 90 degrees (see
+    // isLosslessRotation()) move the pixels exactly, and the in-place
+    // version rotates by 180 degrees without copying the image.
+    //
     static QTransform rotateMatrix (int width, int height, double angle);
     static QTransform rotateMatrix (const QImage &pixmap, double angle);
 
@@ -140,3 +140,26 @@ kpColor kpPixmapFX::getColorAtPixel (const QImage &img, int x, int y)
 }
 
 //---------------------------------------------------------------------
+
+// public static
+QImage kpPixmapFX::getRgbaScanlineImage (const QImage &img)
+{
+    switch (img.format ())
+    {
+    case QImage::Format_ARGB32:
+    case QImage::Format_ARGB32_Premultiplied:
+        return img;
+
+    // QImage::pixel() returns unpremultiplied ARGB for these.
+    case QImage::Format_Mono:
+    case QImage::Format_MonoLSB:
+    case QImage::Format_Indexed8:
+    case QImage::Format_RGB32:
+        return img.convertToFormat (QImage::Format_ARGB32);
+
+    default:
+        return img.convertToFormat (QImage::Format_ARGB32_Premultiplied);
+    }
+}
+
+//---------------------------------------------------------------------
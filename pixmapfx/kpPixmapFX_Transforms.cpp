@@ -31,6 +31,8 @@
 
 #include "kpPixmapFX.h"
 
+#include <algorithm>
+
 #include <QtMath>
 
 #include <QPainter>
@@ -38,14 +40,30 @@
 #include <QPoint>
 #include <QRect>
 
+#if defined (__SSE2__)
+    #include <emmintrin.h>
+#endif
+
 #include "kpLogCategories.h"
 
 #include "layers/selections/kpAbstractSelection.h"
+#include "generic/kpParallel.h"
 #include "imagelib/kpColor.h"
+#include "imagelib/transforms/kpAffineResampler.h"
+#include "imagelib/transforms/kpImageScaler.h"
 #include "kpDefs.h"
 
 //---------------------------------------------------------------------
 
+static const int MinRowsPerThread = 32;
+
+// Rotations by 90 and 270 degrees copy square tiles of this many pixels
+// along each side, so that the source rows being read down and the
+// destination rows being written across both stay in the L1 cache.
+static const int RotateTileSize = 32;
+
+//---------------------------------------------------------------------
+
 // public static
 void kpPixmapFX::resize (QImage *destPtr, int w, int h,
                          const kpColor &backgroundColor)
@@ -122,8 +140,123 @@ QImage kpPixmapFX::scale (const QImage &image, int w, int h, bool pretty)
         return image;
     }
 
-    return image.scaled(w, h, Qt::IgnoreAspectRatio,
-                        pretty ? Qt::SmoothTransformation : Qt::FastTransformation);
+    if (pretty) {
+        return kpImageScaler::scale (image, w, h, kpImageScaler::Bilinear);
+    }
+
+    return image.scaled(w, h, Qt::IgnoreAspectRatio, Qt::FastTransformation);
+}
+
+//---------------------------------------------------------------------
+
+// Reverses the order of the <count> pixels of <line>.
+static void ReverseLine (QRgb *line, int count)
+{
+    int left = 0, right = count - 1;
+
+#if defined (__SSE2__)
+    // Swap 4 pixels from each end at a time, reversing them as we go.
+    for (; right - left + 1 >= 8; left += 4, right -= 4)
+    {
+        auto *leftPtr = reinterpret_cast <__m128i *> (line + left);
+        auto *rightPtr = reinterpret_cast <__m128i *> (line + right - 3);
+
+        const __m128i leftPixels = _mm_loadu_si128 (leftPtr);
+        const __m128i rightPixels = _mm_loadu_si128 (rightPtr);
+
+        _mm_storeu_si128 (leftPtr,
+            _mm_shuffle_epi32 (rightPixels, _MM_SHUFFLE (0, 1, 2, 3)));
+        _mm_storeu_si128 (rightPtr,
+            _mm_shuffle_epi32 (leftPixels, _MM_SHUFFLE (0, 1, 2, 3)));
+    }
+#endif
+
+    for (; left < right; left++, right--) {
+        std::swap (line [left], line [right]);
+    }
+}
+
+//---------------------------------------------------------------------
+
+// public static
+void kpPixmapFX::flip (QImage *destPtr, bool horiz, bool vert)
+{
+#if DEBUG_KP_PIXMAP_FX && 1
+    qCDebug(kpLogPixmapfx) << "kpPixmapFX::flip(horiz=" << horiz
+                           << ",vert=" << vert << ")";
+#endif
+
+    if (!destPtr || destPtr->isNull () || (!horiz && !vert)) {
+        return;
+    }
+
+    if (destPtr->depth () != 32)
+    {
+        *destPtr = destPtr->mirrored (horiz, vert);
+        return;
+    }
+
+
+    const int width = destPtr->width ();
+    const int height = destPtr->height ();
+
+    // (detaches, if the image is shared, before any threads start)
+    uchar *bits = destPtr->bits ();
+    const int bytesPerLine = destPtr->bytesPerLine ();
+
+    auto line = [bits, bytesPerLine] (int y)
+    {
+        return reinterpret_cast <QRgb *> (bits + y * bytesPerLine);
+    };
+
+    if (!vert)
+    {
+        kpParallel::forRanges (0, height, MinRowsPerThread,
+            [&] (int beginY, int endY)
+            {
+                for (int y = beginY; y < endY; y++) {
+                    ::ReverseLine (line (y), width);
+                }
+            });
+        return;
+    }
+
+
+    // Swap each row in the top half with its mirror in the bottom half,
+    // reversing them both if also flipping horizontally.
+    const int halfHeight = height / 2;
+    kpParallel::forRanges (0, halfHeight, MinRowsPerThread / 2,
+        [&] (int beginY, int endY)
+        {
+            for (int y = beginY; y < endY; y++)
+            {
+                QRgb *top = line (y);
+                QRgb *bottom = line (height - 1 - y);
+
+                std::swap_ranges (top, top + width, bottom);
+
+                if (horiz)
+                {
+                    ::ReverseLine (top, width);
+                    ::ReverseLine (bottom, width);
+                }
+            }
+        });
+
+    // The middle row of an odd number of rows stays where it is.
+    if (horiz && height % 2) {
+        ::ReverseLine (line (halfHeight), width);
+    }
+}
+
+//---------------------------------------------------------------------
+
+// public static
+QImage kpPixmapFX::flip (const QImage &image, bool horiz, bool vert)
+{
+    QImage ret = image;
+    kpPixmapFX::flip (&ret, horiz, vert);
+    return ret;
 }
 
 //---------------------------------------------------------------------
@@ -401,9 +534,8 @@ static QImage TransformPixmap (const QImage &pm, const QTransform &transformMatr
                    pm.width (), pm.height ());
 
 
-    QImage newQImage (targetWidth > 0 ? targetWidth : newRect.width (),
-                      targetHeight > 0 ? targetHeight : newRect.height (),
-                      QImage::Format_ARGB32_Premultiplied);
+    const int newWidth = targetWidth > 0 ? targetWidth : newRect.width ();
+    const int newHeight = targetHeight > 0 ? targetHeight : newRect.height ();
 
     if ((targetWidth > 0 && targetWidth != newRect.width ()) ||
         (targetHeight > 0 && targetHeight != newRect.height ()))
@@ -430,13 +562,27 @@ static QImage TransformPixmap (const QImage &pm, const QTransform &transformMatr
 #endif
 
 
-    // Note: Do _not_ use "p.setRenderHints (QPainter::SmoothPixmapTransform);"
+    // Note: kpAffineResampler doesn't interpolate, and do _not_ use
+    //       "p.setRenderHints (QPainter::SmoothPixmapTransform);" below
     //       as the user does not want their image to get blurier every
     //       time they e.g. rotate it (especially important for multiples
     //       of 90 degrees but also true for every other angle).  Being a
     //       pixel-based program, we generally like to preserve RGB values
     //       and avoid unnecessary blurs -- in the worst case, we'd rather
     //       drop pixels, than blur.
+    const QImage resampledQImage = kpAffineResampler::transform (pm,
+        transformMatrix, newWidth, newHeight, backgroundColor);
+    if (!resampledQImage.isNull ())
+    {
+    #if DEBUG_KP_PIXMAP_FX && 1
+        qCDebug(kpLogPixmapfx) << "Done (resampled)";
+    #endif
+        return resampledQImage;
+    }
+
+    // kpAffineResampler can't handle this matrix so draw with a painter
+    // (single-threaded).
+    QImage newQImage (newWidth, newHeight, QImage::Format_ARGB32_Premultiplied);
     QPainter p (&newQImage);
     {
         // Make sure transparent pixels are drawn into the destination image.
@@ -599,6 +745,92 @@ QTransform kpPixmapFX::rotateMatrix (const QImage &pixmap, double angle)
 //---------------------------------------------------------------------
 
 
+// Returns the number of clockwise quarter turns (0 to 3) that <angle>
+// rounds to.  Only meaningful if kpPixmapFX::isLosslessRotation (angle).
+static int QuarterTurns (double angle)
+{
+    int quarterTurns = qRound (angle / 90) % 4;
+    if (quarterTurns < 0) {
+        quarterTurns += 4;
+    }
+
+    return quarterTurns;
+}
+
+//---------------------------------------------------------------------
+
+// Returns <image> (which must be 32-bit) rotated clockwise by 90 degrees, if
+// <quarterTurns> is 1, or by 270 degrees, if it is 3.  Every pixel is copied
+// exactly.
+static QImage RotateQuarterTurns (const QImage &image, int quarterTurns)
+{
+    Q_ASSERT (quarterTurns == 1 || quarterTurns == 3);
+
+    const int srcWidth = image.width ();
+    const int srcHeight = image.height ();
+
+    QImage ret (srcHeight, srcWidth, image.format ());
+    if (ret.isNull ()) {
+        return ret;
+    }
+
+    ret.setDotsPerMeterX (image.dotsPerMeterY ());
+    ret.setDotsPerMeterY (image.dotsPerMeterX ());
+
+    const uchar *srcBits = image.constBits ();
+    const int srcBytesPerLine = image.bytesPerLine ();
+    uchar *destBits = ret.bits ();
+    const int destBytesPerLine = ret.bytesPerLine ();
+
+    const int destWidth = ret.width ();
+    const int destHeight = ret.height ();
+
+    kpParallel::forRanges (0, destHeight, RotateTileSize,
+        [&] (int beginY, int endY)
+        {
+            for (int tileY = beginY; tileY < endY; tileY += RotateTileSize)
+            {
+                const int tileEndY = qMin (tileY + RotateTileSize, endY);
+
+                for (int tileX = 0; tileX < destWidth; tileX += RotateTileSize)
+                {
+                    const int tileEndX = qMin (tileX + RotateTileSize, destWidth);
+
+                    for (int y = tileY; y < tileEndY; y++)
+                    {
+                        auto *destLine = reinterpret_cast <QRgb *> (
+                            destBits + y * destBytesPerLine);
+
+                        if (quarterTurns == 1)
+                        {
+                            // dest (x, y) = src (y, srcHeight - 1 - x)
+                            const uchar *srcColumn = srcBits + y * 4;
+                            for (int x = tileX; x < tileEndX; x++)
+                            {
+                                destLine [x] = *reinterpret_cast <const QRgb *> (
+                                    srcColumn + (srcHeight - 1 - x) * srcBytesPerLine);
+                            }
+                        }
+                        else
+                        {
+                            // dest (x, y) = src (srcWidth - 1 - y, x)
+                            const uchar *srcColumn = srcBits + (srcWidth - 1 - y) * 4;
+                            for (int x = tileX; x < tileEndX; x++)
+                            {
+                                destLine [x] = *reinterpret_cast <const QRgb *> (
+                                    srcColumn + x * srcBytesPerLine);
+                            }
+                        }
+                    }
+                }
+            }
+        });
+
+    return ret;
+}
+
+//---------------------------------------------------------------------
+
 // public static
 bool kpPixmapFX::isLosslessRotation (double angle)
 {
@@ -642,6 +874,16 @@ void kpPixmapFX::rotate (QImage *destPtr, double angle,
         return;
     }
 
+    // A half turn is a flip in both directions, which can be done in place.
+    if (targetWidth <= 0 && targetHeight <= 0 &&
+        kpPixmapFX::isLosslessRotation (angle) &&
+        ::QuarterTurns (angle) == 2 &&
+        destPtr->depth () == 32)
+    {
+        kpPixmapFX::flip (destPtr, true/*horiz*/, true/*vert*/);
+        return;
+    }
+
     *destPtr = kpPixmapFX::rotate (*destPtr, angle,
                                          backgroundColor,
                                          targetWidth, targetHeight);
@@ -660,6 +902,22 @@ QImage kpPixmapFX::rotate (const QImage &pm, double angle,
         return pm;
     }
 
+    // Multiples of 90 degrees just move pixels around -- don't resample.
+    if (targetWidth <= 0 && targetHeight <= 0 &&
+        kpPixmapFX::isLosslessRotation (angle) &&
+        pm.depth () == 32)
+    {
+        const int quarterTurns = ::QuarterTurns (angle);
+        if (quarterTurns == 0) {
+            return pm;
+        }
+        if (quarterTurns == 2) {
+            return kpPixmapFX::flip (pm, true/*horiz*/, true/*vert*/);
+        }
+
+        return ::RotateQuarterTurns (pm, quarterTurns);
+    }
+
 
     QTransform matrix = rotateMatrix (pm, angle);
 
@@ -76,6 +76,7 @@ void kpToolColorEraser::globalDraw ()
 
     kpToolFlowCommand *cmd = new kpToolFlowCommand (
         i18n ("Color Eraser"), environ ()->commandEnvironment ());
+    cmd->saveOldPixels (document ()->rect ());
 
     const QRect dirtyRect = kpPainter::washRect (document ()->imagePointer (),
         0, 0, document ()->width (), document ()->height (),
@@ -136,6 +137,11 @@ QRect kpToolColorEraser::drawLine (const QPoint &thisPoint, const QPoint &lastPo
 
     environ ()->flashColorSimilarityToolBarItem ();
 
+    // (a superset of the rect that washLine() may change)
+    currentCommand ()->saveOldPixels (neededRect (
+        kpPainter::normalizedRect (thisPoint, lastPoint),
+        qMax (brushWidth (), brushHeight ())));
+
     const QRect dirtyRect = kpPainter::washLine (document ()->imagePointer (),
         lastPoint.x (), lastPoint.y (),
         thisPoint.x (), thisPoint.y (),
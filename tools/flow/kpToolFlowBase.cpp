@@ -83,6 +83,10 @@ struct kpToolFlowBasePrivate
 
         bool brushIsDiagonalLine{};
 
+        // Calculated on demand, by brushStamp().
+        kpToolFlowBrushStamp brushStampForMouseButton [2];
+        bool brushStampIsCalculated [2]{};
+
 
     kpToolFlowCommand *currentCommand{};
 };
@@ -133,6 +137,8 @@ void kpToolFlowBase::clearBrushCursorData ()
     d->cursorWidth = d->cursorHeight = 0;
 
     d->brushIsDiagonalLine = false;
+
+    d->brushStampIsCalculated [0] = d->brushStampIsCalculated [1] = false;
 }
 
 //---------------------------------------------------------------------
@@ -382,6 +388,79 @@ bool kpToolFlowBase::brushIsDiagonalLine () const
 }
 
 
+// protected
+const kpToolFlowBrushStamp &kpToolFlowBase::brushStamp () const
+{
+    const int which = mouseButton ();
+    kpToolFlowBrushStamp &stamp = d->brushStampForMouseButton [which];
+
+    if (d->brushStampIsCalculated [which]) {
+        return stamp;
+    }
+
+    d->brushStampIsCalculated [which] = true;
+
+    stamp.isValid = false;
+    stamp.runs.clear ();
+
+    if (!d->brushDrawFunc || d->brushWidth <= 0 || d->brushHeight <= 0) {
+        return stamp;
+    }
+
+    // Draw the brush once, onto nothing.
+    QImage image (d->brushWidth, d->brushHeight, QImage::Format_ARGB32_Premultiplied);
+    image.fill (0);
+    d->brushDrawFunc (&image, QPoint (0, 0), d->drawPackageForMouseButton [which]);
+
+    for (int y = 0; y < image.height (); y++)
+    {
+        const auto *line = reinterpret_cast <const QRgb *> (image.constScanLine (y));
+
+        int x = 0;
+        while (x < image.width ())
+        {
+            if (line [x] == 0)
+            {
+                x++;
+                continue;
+            }
+
+            // Anything other than a single, opaque color can't be drawn by
+            // just setting pixels, since it would depend on the pixels
+            // underneath.
+            if (qAlpha (line [x]) != 255 ||
+                (!stamp.runs.isEmpty () && line [x] != stamp.rgba))
+            {
+                stamp.runs.clear ();
+                return stamp;
+            }
+
+            stamp.rgba = line [x];
+
+            const int x1 = x;
+            while (x < image.width () && line [x] == stamp.rgba) {
+                x++;
+            }
+
+            stamp.runs.append (QRect (x1, y, x - x1, 1));
+        }
+    }
+
+    // A brush that draws nothing may still change the pixels underneath
+    // (e.g. by clearing them).
+    stamp.isValid = !stamp.runs.isEmpty ();
+
+#if DEBUG_KP_TOOL_FLOW_BASE && 1
+    qCDebug(kpLogTools) << "kpToolFlowBase::brushStamp(" << which << ")"
+                        << " isValid=" << stamp.isValid
+                        << " runs=" << stamp.runs.size ();
+#endif
+
+    return stamp;
+}
+
+//---------------------------------------------------------------------
+
 // protected
 kpToolFlowCommand *kpToolFlowBase::currentCommand () const
 {
@@ -397,6 +476,8 @@ void kpToolFlowBase::updateBrushAndCursor ()
     qCDebug(kpLogTools) << "kpToolFlowBase::updateBrushAndCursor()";
 #endif
 
+    d->brushStampIsCalculated [0] = d->brushStampIsCalculated [1] = false;
+
     if (haveSquareBrushes ())
     {
         d->brushDrawFunc = d->toolWidgetEraserSize->drawFunction ();
@@ -31,6 +31,7 @@
 
 
 #include <QRect>
+#include <QVector>
 
 #include "layers/tempImage/kpTempImage.h"
 #include "tools/kpTool.h"
@@ -43,6 +44,20 @@ class kpColor;
 class kpToolFlowCommand;
 
 
+// What drawing a brush with kpToolFlowBase::brushDrawFunction() does, when
+// all it does is set some pixels to a single opaque color.
+struct kpToolFlowBrushStamp
+{
+    bool isValid{};
+
+    QRgb rgba{};
+
+    // The pixels that are set to <rgba>, as 1-pixel high rectangles relative
+    // to the top-left of the brush.
+    QVector <QRect> runs;
+};
+
+
 class kpToolFlowBase : public kpTool
 {
   Q_OBJECT
@@ -99,6 +114,11 @@ class kpToolFlowBase : public kpTool
 
     bool brushIsDiagonalLine() const;
 
+    // The brush of the current mouse button, worked out the first time that
+    // it is needed after the brush or colors change.  If it is not valid,
+    // brushDrawFunction() must be used to draw the brush.
+    const kpToolFlowBrushStamp &brushStamp() const;
+
     kpToolFlowCommand *currentCommand() const;
     virtual kpColor color(int which);
     QRect hotRect() const;
@@ -30,11 +30,15 @@
 
 #include "imagelib/kpColor.h"
 #include "document/kpDocument.h"
+#include "imagelib/kpLineIterator.h"
 #include "imagelib/kpPainter.h"
 #include "pixmapfx/kpPixmapFX.h"
 #include "commands/tools/flow/kpToolFlowCommand.h"
 
+#include <algorithm>
+
 #include <QBitmap>
+#include <QImage>
 
 //---------------------------------------------------------------------
 
@@ -47,23 +51,51 @@ kpToolFlowPixmapBase::kpToolFlowPixmapBase (const QString &text, const QString &
 
 //---------------------------------------------------------------------
 
+// Sets the pixels of <stamp>, with its top-left at <topLeft>, in <image>.
+static void DrawBrushStamp (kpImage *image, const QPoint &topLeft,
+        const kpToolFlowBrushStamp &stamp)
+{
+    for (const auto &run : stamp.runs)
+    {
+        const int y = topLeft.y () + run.y ();
+        if (y < 0 || y >= image->height ()) {
+            continue;
+        }
+
+        const int x1 = qMax (0, topLeft.x () + run.left ());
+        const int x2 = qMin (image->width () - 1, topLeft.x () + run.right ());
+        if (x1 > x2) {
+            continue;
+        }
+
+        auto *line = reinterpret_cast <QRgb *> (image->scanLine (y));
+        std::fill (line + x1, line + x2 + 1, stamp.rgba);
+    }
+}
+
+//---------------------------------------------------------------------
+
 QRect kpToolFlowPixmapBase::drawLine (const QPoint &thisPoint, const QPoint &lastPoint)
 {
     QRect docRect = kpPainter::normalizedRect(thisPoint, lastPoint);
     docRect = neededRect (docRect, qMax (brushWidth (), brushHeight ()));
     kpImage image = document ()->getImageAt (docRect);
 
+    // If the brush just sets some pixels to an opaque color, set them
+    // directly at each point instead of drawing the brush from scratch.
+    const kpToolFlowBrushStamp &stamp = brushStamp ();
+    const bool drawStamps = stamp.isValid &&
+        (image.format () == QImage::Format_ARGB32_Premultiplied ||
+         image.format () == QImage::Format_ARGB32);
 
-    QList <QPoint> points = kpPainter::interpolatePoints (lastPoint, thisPoint,
-        brushIsDiagonalLine ());
 
-    for (QList <QPoint>::const_iterator pit = points.constBegin ();
-         pit != points.constEnd ();
-         ++pit)
+    kpLineIterator it (lastPoint, thisPoint, brushIsDiagonalLine ());
+    QPoint docPoint;
+    while (it.next (&docPoint))
     {
         const QPoint point =
             hotRectForMousePointAndBrushWidthHeight (
-                (*pit), brushWidth (), brushHeight ())
+                docPoint, brushWidth (), brushHeight ())
                     .topLeft () - docRect.topLeft ();
 
         // OPT: This may be redrawing pixels that were drawn on a previous
@@ -74,10 +106,16 @@ QRect kpToolFlowPixmapBase::drawLine (const QPoint &thisPoint, const QPoint &las
         //      Try this at least for the easy case of the Eraser, which has
         //      square, simply-filled brushes.  Profiling needs to be done as
         //      QRegion is known to be a CPU hog.
-        brushDrawFunction () (&image, point, brushDrawFunctionData ());
+        if (drawStamps) {
+            ::DrawBrushStamp (&image, point, stamp);
+        }
+        else {
+            brushDrawFunction () (&image, point, brushDrawFunctionData ());
+        }
     }
 
 
+    currentCommand ()->saveOldPixels (docRect);
     document ()->setImageAt (image, docRect.topLeft ());
     return docRect;
 }
@@ -31,12 +31,14 @@
 #include "imagelib/kpColor.h"
 #include "document/kpDocument.h"
 #include "imagelib/kpImage.h"
+#include "imagelib/kpLineIterator.h"
 #include "imagelib/kpPainter.h"
 #include "commands/tools/flow/kpToolFlowCommand.h"
 #include "environments/tools/kpToolEnvironment.h"
 
 #include <KLocalizedString>
 
+#include <QImage>
 #include <QPainter>
 #include <QPen>
 
@@ -69,14 +71,42 @@ QRect kpToolPen::drawLine (const QPoint &thisPoint, const QPoint &lastPoint)
   const QPoint sp = lastPoint - docRect.topLeft (),
                ep = thisPoint - docRect.topLeft ();
 
-  QPainter painter(&image);
-
-  // never use AA - it does not look good for the usually very short lines
-  //painter.setRenderHint(QPainter::Antialiasing, kpToolEnvironment::drawAntiAliased);
-
-  painter.setPen(color(mouseButton()).toQColor());
-  painter.drawLine(sp, ep);
-
+  const kpColor col = color(mouseButton());
+
+  // Only horizontal, vertical and 45 degree lines are plotted the same way
+  // by kpLineIterator and QPainter (every pixel centre is on the line).
+  // QPainter rounds the steps of other lines differently.
+  const QPoint delta = ep - sp;
+  const bool isAxisOrDiagonal = (delta != QPoint()) &&
+      (delta.x() == 0 || delta.y() == 0 || qAbs(delta.x()) == qAbs(delta.y()));
+
+  if ( isAxisOrDiagonal && col.isValid() && col.alpha() == 255 &&
+       (image.format() == QImage::Format_ARGB32_Premultiplied ||
+        image.format() == QImage::Format_ARGB32) )
+  {
+    // An opaque pixel just replaces what is underneath so set the pixels of
+    // the line directly.
+    kpLineIterator it(sp, ep);
+    QPoint p;
+    while ( it.next(&p) )
+    {
+      if ( image.valid(p.x(), p.y()) ) {
+        reinterpret_cast<QRgb *>(image.scanLine(p.y()))[p.x()] = col.toQRgb();
+      }
+    }
+  }
+  else
+  {
+    QPainter painter(&image);
+
+    // never use AA - it does not look good for the usually very short lines
+    //painter.setRenderHint(QPainter::Antialiasing, kpToolEnvironment::drawAntiAliased);
+
+    painter.setPen(col.toQColor());
+    painter.drawLine(sp, ep);
+  }
+
+  currentCommand ()->saveOldPixels (docRect);
   document ()->setImageAt (image, docRect.topLeft ());
   return docRect;
 }
@@ -32,6 +32,7 @@
 
 #include "kpDefs.h"
 #include "document/kpDocument.h"
+#include "imagelib/kpLineIterator.h"
 #include "imagelib/kpPainter.h"
 #include "pixmapfx/kpPixmapFX.h"
 #include "environments/tools/kpToolEnvironment.h"
@@ -125,16 +126,21 @@ QRect kpToolSpraycan::drawLineWithProbability (const QPoint &thisPoint,
                << ")";
 #endif
 
-    QList <QPoint> docPoints = kpPainter::interpolatePoints (lastPoint, thisPoint,
+    m_docPoints.clear ();
+    kpLineIterator it (lastPoint, thisPoint,
         false/*no need for cardinally adjacency points*/,
         probability);
+    QPoint docPoint;
+    while (it.next (&docPoint)) {
+        m_docPoints.append (docPoint);
+    }
 #if DEBUG_KP_TOOL_SPRAYCAN
-    qCDebug(kpLogTools) << "\tdocPoints=" << docPoints;
+    qCDebug(kpLogTools) << "\tdocPoints=" << m_docPoints;
 #endif
 
 
     // By chance no points to draw?
-    if (docPoints.empty ()) {
+    if (m_docPoints.isEmpty ()) {
         return  {};
     }
 
@@ -151,16 +157,14 @@ QRect kpToolSpraycan::drawLineWithProbability (const QPoint &thisPoint,
     //                  over the same point does result in a different
     //                  appearance.
 
-    QList <QPoint> imagePoints;
-    for (const auto &dp : docPoints)
-        imagePoints.append (dp - docRect.topLeft ());
-
     kpPainter::sprayPoints (&image,
-        imagePoints,
+        m_docPoints, -docRect.topLeft (),
         color (mouseButton ()),
         spraycanSize ());
 
 
+    currentCommand ()->saveOldPixels (docRect);
+
     viewManager ()->setFastUpdates ();
     document ()->setImageAt (image, docRect.topLeft ());
     viewManager ()->restoreFastUpdates ();
@@ -30,10 +30,12 @@
 #define KP_TOOL_SPRAYCAN_H
 
 
+#include <QPoint>
+#include <QVector>
+
 #include "kpToolFlowBase.h"
 
 
-class QPoint;
 class QRect;
 class QString;
 class QTimer;
@@ -84,6 +86,10 @@ protected slots:
 protected:
     QTimer *m_timer;
     kpToolWidgetSpraycanSize *m_toolWidgetSpraycanSize;
+
+    // The points of the line being sprayed by drawLineWithProbability().
+    // Kept between calls so that its memory is reused.
+    QVector <QPoint> m_docPoints;
 };
 
 
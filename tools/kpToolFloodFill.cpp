@@ -36,6 +36,7 @@
 #include "document/kpDocument.h"
 #include "environments/tools/kpToolEnvironment.h"
 #include "commands/tools/kpToolFloodFillCommand.h"
+#include "layers/selections/image/kpAbstractImageSelection.h"
 
 #include "kpLogCategories.h"
 #include <KLocalizedString>
@@ -72,7 +73,7 @@ kpToolFloodFill::~kpToolFloodFill ()
 // private
 QString kpToolFloodFill::haventBegunDrawUserMessage () const
 {
-    return i18n ("Click to fill a region.");
+    return i18n ("Click to fill a region. Shift+click to replace a color everywhere.");
 }
 
 //---------------------------------------------------------------------
@@ -98,16 +99,31 @@ void kpToolFloodFill::beginDraw ()
 
         // Flood Fill is an expensive CPU operation so we only fill at a
         // mouse click (beginDraw ()), not on mouse move (virtually draw())
+        //
+        // Holding Shift replaces every similar pixel in the image, not just
+        // the connected region.
         d->currentCommand = new kpToolFloodFillCommand (
             currentPoint ().x (), currentPoint ().y (),
             color (mouseButton ()), processedColorSimilarity (),
+            !shiftPressed ()/*contiguous*/,
             environ ()->commandEnvironment ());
 
+        // Replacing a color only touches the selected area, if any.
+        kpAbstractSelection *sel = document ()->selection ();
+        const bool limitedToSel = (sel && !d->currentCommand->isContiguous ());
+        if (limitedToSel)
+        {
+            auto *imageSel = dynamic_cast <kpAbstractImageSelection *> (sel);
+            d->currentCommand->setFillArea (sel->boundingRect (),
+                imageSel ? imageSel->shapeBitmap (true/*null for rectangular*/) : QBitmap ());
+        }
+
     #if DEBUG_KP_TOOL_FLOOD_FILL && 1
         qCDebug(kpLogTools) << "\tperforming new-doc-corner-case check";
     #endif
 
-        if (document ()->url ().isEmpty () && !document ()->isModified ())
+        if (document ()->url ().isEmpty () && !document ()->isModified () &&
+            !limitedToSel)
         {
             // Collect the colour that gets changed before we change the pixels
             // (execute() below).  Needed in unexecute().
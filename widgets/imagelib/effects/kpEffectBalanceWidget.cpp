@@ -31,6 +31,7 @@
 #include "kpEffectBalanceWidget.h"
 
 #include "imagelib/effects/kpEffectBalance.h"
+#include "imagelib/effects/kpEffectPipeline.h"
 #include "commands/imagelib/effects/kpEffectBalanceCommand.h"
 #include "pixmapfx/kpPixmapFX.h"
 
@@ -170,10 +171,18 @@ bool kpEffectBalanceWidget::isNoOp () const
 }
 
 // public virtual [base kpEffectWidgetBase]
-kpImage kpEffectBalanceWidget::applyEffect (const kpImage &image)
+kpEffectWidgetBase::EffectFunction kpEffectBalanceWidget::effectFunction () const
 {
-    return kpEffectBalance::applyEffect (image,
-        channels (), brightness (), contrast (), gamma ());
+    const int channels = this->channels ();
+    const int brightness = this->brightness ();
+    const int contrast = this->contrast ();
+    const int gamma = this->gamma ();
+
+    return [=] (const kpImage &image)
+    {
+        return kpEffectBalance::applyEffect (image,
+            channels, brightness, contrast, gamma);
+    };
 }
 
 // public virtual [base kpEffectWidgetBase]
@@ -186,6 +195,13 @@ kpEffectCommandBase *kpEffectBalanceWidget::createCommand (
                                        cmdEnviron);
 }
 
+// public virtual [base kpEffectWidgetBase]
+bool kpEffectBalanceWidget::addToPipeline (kpEffectPipeline *pipeline) const
+{
+    pipeline->addBalance (channels (), brightness (), contrast (), gamma ());
+    return true;
+}
+
 
 // protected
 int kpEffectBalanceWidget::channels () const
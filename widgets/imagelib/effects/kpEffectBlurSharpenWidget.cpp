@@ -125,10 +125,16 @@ bool kpEffectBlurSharpenWidget::isNoOp () const
 }
 
 // public virtual [base kpEffectWidgetBase]
-kpImage kpEffectBlurSharpenWidget::applyEffect (const kpImage &image)
+kpEffectWidgetBase::EffectFunction kpEffectBlurSharpenWidget::effectFunction () const
 {
-    return kpEffectBlurSharpen::applyEffect (image,
-        type (), strength ());
+    const kpEffectBlurSharpen::Type type = this->type ();
+    const int strength = this->strength ();
+
+    return [=] (const kpImage &image)
+    {
+        return kpEffectBlurSharpen::applyEffect (image,
+            type, strength);
+    };
 }
 
 // public virtual [base kpEffectWidgetBase]
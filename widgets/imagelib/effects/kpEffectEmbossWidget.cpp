@@ -79,13 +79,19 @@ bool kpEffectEmbossWidget::isNoOp () const
 }
 
 // public virtual [base kpEffectWidgetBase]
-kpImage kpEffectEmbossWidget::applyEffect (const kpImage &image)
+kpEffectWidgetBase::EffectFunction kpEffectEmbossWidget::effectFunction () const
 {
-    if (isNoOp ()) {
-        return image;
-    }
+    const bool isNoOp = this->isNoOp ();
+    const int strength = this->strength ();
 
-    return kpEffectEmboss::applyEffect (image, strength ());
+    return [=] (const kpImage &image)
+    {
+        if (isNoOp) {
+            return image;
+        }
+
+        return kpEffectEmboss::applyEffect (image, strength);
+    };
 }
 
 // public virtual [base kpEffectWidgetBase]
@@ -139,18 +139,25 @@ bool kpEffectFlattenWidget::isNoOp () const
 }
 
 // public virtual [base kpEffectWidgetBase]
-kpImage kpEffectFlattenWidget::applyEffect (const kpImage &image)
+kpEffectWidgetBase::EffectFunction kpEffectFlattenWidget::effectFunction () const
 {
 #if DEBUG_KP_EFFECT_FLATTEN
-    qCDebug(kpLogWidgets) << "kpEffectFlattenWidget::applyEffect() nop="
+    qCDebug(kpLogWidgets) << "kpEffectFlattenWidget::effectFunction() nop="
                << isNoOp () << endl;
 #endif
 
-    if (isNoOp ()) {
-        return image;
-    }
+    const bool isNoOp = this->isNoOp ();
+    const QColor color1 = this->color1 ();
+    const QColor color2 = this->color2 ();
+
+    return [=] (const kpImage &image)
+    {
+        if (isNoOp) {
+            return image;
+        }
 
-    return kpEffectFlatten::applyEffect (image, color1 (), color2 ());
+        return kpEffectFlatten::applyEffect (image, color1, color2);
+    };
 }
 
 
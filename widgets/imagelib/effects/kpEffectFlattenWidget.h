@@ -63,7 +63,7 @@ public:
     QString caption () const override;
 
     bool isNoOp () const override;
-    kpImage applyEffect (const kpImage &image) override;
+    EffectFunction effectFunction () const override;
 
     kpEffectCommandBase *createCommand (
         kpCommandEnvironment *cmdEnviron) const override;
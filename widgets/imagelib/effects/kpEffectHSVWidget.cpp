@@ -36,6 +36,7 @@
 
 #include "kpNumInput.h"
 #include "imagelib/effects/kpEffectHSV.h"
+#include "imagelib/effects/kpEffectPipeline.h"
 #include "commands/imagelib/effects/kpEffectHSVCommand.h"
 
 
@@ -102,10 +103,16 @@ bool kpEffectHSVWidget::isNoOp () const
 }
 
 // public virtual [base kpEffectWidgetBase]
-kpImage kpEffectHSVWidget::applyEffect (const kpImage &image)
+kpEffectWidgetBase::EffectFunction kpEffectHSVWidget::effectFunction () const
 {
-    return kpEffectHSV::applyEffect (image,
-        m_hueInput->value (), m_saturationInput->value (), m_valueInput->value ());
+    const double hue = m_hueInput->value ();
+    const double saturation = m_saturationInput->value ();
+    const double value = m_valueInput->value ();
+
+    return [=] (const kpImage &image)
+    {
+        return kpEffectHSV::applyEffect (image, hue, saturation, value);
+    };
 }
 
 // public virtual [base kpEffectWidgetBase]
@@ -118,4 +125,12 @@ kpEffectCommandBase *kpEffectHSVWidget::createCommand (
         cmdEnviron);
 }
 
+// public virtual [base kpEffectWidgetBase]
+bool kpEffectHSVWidget::addToPipeline (kpEffectPipeline *pipeline) const
+{
+    pipeline->addHSV (m_hueInput->value (), m_saturationInput->value (),
+                      m_valueInput->value ());
+    return true;
+}
+
 
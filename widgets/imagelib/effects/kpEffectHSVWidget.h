@@ -47,11 +47,13 @@ public:
     QString caption () const override;
 
     bool isNoOp () const override;
-    kpImage applyEffect (const kpImage &image) override;
+    EffectFunction effectFunction () const override;
 
     kpEffectCommandBase *createCommand (
         kpCommandEnvironment *cmdEnviron) const override;
 
+    bool addToPipeline (kpEffectPipeline *pipeline) const override;
+
 protected:
     kpDoubleNumInput *m_hueInput;
     kpDoubleNumInput *m_saturationInput;
@@ -32,6 +32,7 @@
 #include "kpEffectInvertWidget.h"
 
 #include "imagelib/effects/kpEffectInvert.h"
+#include "imagelib/effects/kpEffectPipeline.h"
 #include "commands/imagelib/effects/kpEffectInvertCommand.h"
 #include "pixmapfx/kpPixmapFX.h"
 
@@ -152,9 +153,14 @@ bool kpEffectInvertWidget::isNoOp () const
 }
 
 // public virtual [base kpEffectWidgetBase]
-kpImage kpEffectInvertWidget::applyEffect (const kpImage &image)
+kpEffectWidgetBase::EffectFunction kpEffectInvertWidget::effectFunction () const
 {
-    return kpEffectInvert::applyEffect (image, channels ());
+    const int channels = this->channels ();
+
+    return [=] (const kpImage &image)
+    {
+        return kpEffectInvert::applyEffect (image, channels);
+    };
 }
 
 
@@ -167,6 +173,13 @@ kpEffectCommandBase *kpEffectInvertWidget::createCommand (
                                       cmdEnviron);
 }
 
+// public virtual [base kpEffectWidgetBase]
+bool kpEffectInvertWidget::addToPipeline (kpEffectPipeline *pipeline) const
+{
+    pipeline->addInvert (channels ());
+    return true;
+}
+
 
 // protected slots
 void kpEffectInvertWidget::slotRGBCheckBoxToggled ()
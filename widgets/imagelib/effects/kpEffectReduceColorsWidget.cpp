@@ -60,10 +60,15 @@ kpEffectReduceColorsWidget::kpEffectReduceColorsWidget (bool actOnSelection,
     m_blackAndWhiteDitheredRadioButton =
         new QRadioButton (i18n ("Mo&nochrome (dithered)"), this);
 
+    m_blackAndWhiteOrderedRadioButton =
+        new QRadioButton (i18n ("Monoc&hrome (ordered dither)"), this);
+
     m_8BitRadioButton = new QRadioButton (i18n ("256 co&lor"), this);
 
     m_8BitDitheredRadioButton = new QRadioButton (i18n ("256 colo&r (dithered)"), this);
 
+    m_8BitOrderedRadioButton = new QRadioButton (i18n ("256 &color (ordered dither)"), this);
+
     m_24BitRadioButton = new QRadioButton (i18n ("24-&bit color"), this);
 
 
@@ -71,8 +76,10 @@ kpEffectReduceColorsWidget::kpEffectReduceColorsWidget (bool actOnSelection,
     auto *buttonGroup = new QButtonGroup (this);
     buttonGroup->addButton (m_blackAndWhiteRadioButton);
     buttonGroup->addButton (m_blackAndWhiteDitheredRadioButton);
+    buttonGroup->addButton (m_blackAndWhiteOrderedRadioButton);
     buttonGroup->addButton (m_8BitRadioButton);
     buttonGroup->addButton (m_8BitDitheredRadioButton);
+    buttonGroup->addButton (m_8BitOrderedRadioButton);
     buttonGroup->addButton (m_24BitRadioButton);
 
     m_defaultRadioButton = m_24BitRadioButton;
@@ -80,8 +87,10 @@ kpEffectReduceColorsWidget::kpEffectReduceColorsWidget (bool actOnSelection,
 
     lay->addWidget (m_blackAndWhiteRadioButton);
     lay->addWidget (m_blackAndWhiteDitheredRadioButton);
+    lay->addWidget (m_blackAndWhiteOrderedRadioButton);
     lay->addWidget (m_8BitRadioButton);
     lay->addWidget (m_8BitDitheredRadioButton);
+    lay->addWidget (m_8BitOrderedRadioButton);
     lay->addWidget (m_24BitRadioButton);
 
     connect (m_blackAndWhiteRadioButton, &QRadioButton::toggled,
@@ -90,12 +99,18 @@ kpEffectReduceColorsWidget::kpEffectReduceColorsWidget (bool actOnSelection,
     connect (m_blackAndWhiteDitheredRadioButton, &QRadioButton::toggled,
              this, &kpEffectReduceColorsWidget::settingsChanged);
 
+    connect (m_blackAndWhiteOrderedRadioButton, &QRadioButton::toggled,
+             this, &kpEffectReduceColorsWidget::settingsChanged);
+
     connect (m_8BitRadioButton, &QRadioButton::toggled,
              this, &kpEffectReduceColorsWidget::settingsChanged);
 
     connect (m_8BitDitheredRadioButton, &QRadioButton::toggled,
              this, &kpEffectReduceColorsWidget::settingsChanged);
 
+    connect (m_8BitOrderedRadioButton, &QRadioButton::toggled,
+             this, &kpEffectReduceColorsWidget::settingsChanged);
+
     connect (m_24BitRadioButton, &QRadioButton::toggled,
              this, &kpEffectReduceColorsWidget::settingsChanged);
 }
@@ -108,13 +123,15 @@ int kpEffectReduceColorsWidget::depth () const
     // These values (1, 8, 32) are QImage's supported depths.
     // TODO: Qt-4.7.1: 1, 8, 16, 24 and 32
     if (m_blackAndWhiteRadioButton->isChecked () ||
-        m_blackAndWhiteDitheredRadioButton->isChecked ())
+        m_blackAndWhiteDitheredRadioButton->isChecked () ||
+        m_blackAndWhiteOrderedRadioButton->isChecked ())
     {
         return 1;
     }
 
     if (m_8BitRadioButton->isChecked () ||
-             m_8BitDitheredRadioButton->isChecked ())
+             m_8BitDitheredRadioButton->isChecked () ||
+             m_8BitOrderedRadioButton->isChecked ())
     {
         return 8;
     }
@@ -130,10 +147,21 @@ int kpEffectReduceColorsWidget::depth () const
 //---------------------------------------------------------------------
 
 // public
-bool kpEffectReduceColorsWidget::dither () const
+kpColorQuantizer::DitherMode kpEffectReduceColorsWidget::ditherMode () const
 {
-    return (m_blackAndWhiteDitheredRadioButton->isChecked () ||
-            m_8BitDitheredRadioButton->isChecked ());
+    if (m_blackAndWhiteDitheredRadioButton->isChecked () ||
+        m_8BitDitheredRadioButton->isChecked ())
+    {
+        return kpColorQuantizer::FloydSteinbergDither;
+    }
+
+    if (m_blackAndWhiteOrderedRadioButton->isChecked () ||
+        m_8BitOrderedRadioButton->isChecked ())
+    {
+        return kpColorQuantizer::OrderedDither;
+    }
+
+    return kpColorQuantizer::NoDither;
 }
 
 //---------------------------------------------------------------------
@@ -158,9 +186,15 @@ bool kpEffectReduceColorsWidget::isNoOp () const
 //---------------------------------------------------------------------
 
 // public virtual [base kpEffectWidgetBase]
-kpImage kpEffectReduceColorsWidget::applyEffect (const kpImage &image)
+kpEffectWidgetBase::EffectFunction kpEffectReduceColorsWidget::effectFunction () const
 {
-    return kpEffectReduceColors::applyEffect (image, depth (), dither ());
+    const int depth = this->depth ();
+    const kpColorQuantizer::DitherMode ditherMode = this->ditherMode ();
+
+    return [=] (const kpImage &image)
+    {
+        return kpEffectReduceColors::applyEffect (image, depth, ditherMode);
+    };
 }
 
 //---------------------------------------------------------------------
@@ -169,7 +203,7 @@ kpImage kpEffectReduceColorsWidget::applyEffect (const kpImage &image)
 kpEffectCommandBase *kpEffectReduceColorsWidget::createCommand (
         kpCommandEnvironment *cmdEnviron) const
 {
-    return new kpEffectReduceColorsCommand (depth (), dither (),
+    return new kpEffectReduceColorsCommand (depth (), ditherMode (),
                                             m_actOnSelection,
                                             cmdEnviron);
 }
@@ -31,6 +31,7 @@
 
 
 #include "kpEffectWidgetBase.h"
+#include "imagelib/kpColorQuantizer.h"
 
 
 class QRadioButton;
@@ -45,7 +46,7 @@ public:
                                 QWidget *parent);
 
     int depth () const;
-    bool dither () const;
+    kpColorQuantizer::DitherMode ditherMode () const;
 
 
     //
@@ -55,7 +56,7 @@ public:
     QString caption () const override;
 
     bool isNoOp () const override;
-    kpImage applyEffect (const kpImage &image) override;
+    EffectFunction effectFunction () const override;
 
     kpEffectCommandBase *createCommand (
         kpCommandEnvironment *cmdEnviron) const override;
@@ -63,8 +64,10 @@ public:
 protected:
     QRadioButton *m_blackAndWhiteRadioButton,
                  *m_blackAndWhiteDitheredRadioButton,
+                 *m_blackAndWhiteOrderedRadioButton,
                  *m_8BitRadioButton,
                  *m_8BitDitheredRadioButton,
+                 *m_8BitOrderedRadioButton,
                  *m_24BitRadioButton;
     QRadioButton *m_defaultRadioButton;
 };
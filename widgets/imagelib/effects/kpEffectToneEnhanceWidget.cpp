@@ -121,10 +121,16 @@ bool kpEffectToneEnhanceWidget::isNoOp () const
 }
 
 // public virtual [base kpEffectWidgetBase]
-kpImage kpEffectToneEnhanceWidget::applyEffect (const kpImage &image)
+kpEffectWidgetBase::EffectFunction kpEffectToneEnhanceWidget::effectFunction () const
 {
-    return kpEffectToneEnhance::applyEffect (image,
-        granularity (), amount ());
+    const double granularity = this->granularity ();
+    const double amount = this->amount ();
+
+    return [=] (const kpImage &image)
+    {
+        return kpEffectToneEnhance::applyEffect (image,
+            granularity, amount);
+    };
 }
 
 // public virtual [base kpEffectWidgetBase]
@@ -46,3 +46,12 @@ QString kpEffectWidgetBase::caption () const
 }
 
 
+// public virtual
+bool kpEffectWidgetBase::addToPipeline (kpEffectPipeline *pipeline) const
+{
+    Q_UNUSED (pipeline);
+
+    return false;
+}
+
+
@@ -30,6 +30,8 @@
 #define kpEffectWidgetBase_H
 
 
+#include <functional>
+
 #include <QWidget>
 
 #include "imagelib/kpImage.h"
@@ -37,6 +39,7 @@
 
 class kpCommandEnvironment;
 class kpEffectCommandBase;
+class kpEffectPipeline;
 
 
 class kpEffectWidgetBase : public QWidget
@@ -57,14 +60,25 @@ signals:
     void settingsChangedDelayed ();
 
 public:
+    // Applies the effect to an image.  The settings are captured by value,
+    // instead of being read from the widgets, so that previews can call it
+    // on another thread (see kpPreviewRenderer).
+    typedef std::function <kpImage (const kpImage &image)> EffectFunction;
+
     virtual QString caption () const;
 
     virtual bool isNoOp () const = 0;
-    virtual kpImage applyEffect (const kpImage &image) = 0;
+    // Returns the effect, with the current settings.
+    virtual EffectFunction effectFunction () const = 0;
 
     virtual kpEffectCommandBase *createCommand (
         kpCommandEnvironment *cmdEnviron) const = 0;
 
+    // Appends the effect, with the current settings, to <pipeline> and
+    // returns true.  Returns false, leaving <pipeline> alone, if the effect
+    // isn't per-pixel so can't be chained.
+    virtual bool addToPipeline (kpEffectPipeline *pipeline) const;
+
 protected:
     bool m_actOnSelection;
 };